@@ -144,6 +144,7 @@ IndexCurrentReaction::~IndexCurrentReaction()
 BaseMatcher::BaseMatcher(BaseIndex& index, IndigoObject*& current_obj) : _index(index), _current_obj(current_obj)
 {
     _current_obj_used = false;
+    _lazy_loading = false;
     _current_id = -1;
     _part_id = -1;
     _part_count = -1;
@@ -285,9 +286,18 @@ bool BaseMatcher::_loadCurrentObject()
         {
             Molecule& mol = _current_obj->getMolecule();
 
-            CmfLoader cmf_loader(buf_scn);
+            if (_lazy_loading)
+            {
+                _cmf_loader = std::make_unique<CmfLoader>(buf_scn);
+                _cmf_loader->lazy = true;
+                _cmf_loader->loadMolecule(mol);
+            }
+            else
+            {
+                CmfLoader cmf_loader(buf_scn);
 
-            cmf_loader.loadMolecule(mol);
+                cmf_loader.loadMolecule(mol);
+            }
         }
         else if (IndigoReaction::is(*_current_obj))
         {
@@ -539,6 +549,7 @@ MoleculeSubMatcher::MoleculeSubMatcher(/*const */ BaseIndex& index)
     : BaseSubstructureMatcher(index, (IndigoObject*&)_current_mol), _current_mol(new IndexCurrentMolecule(_current_mol))
 {
     _mapping.clear();
+    _lazy_loading = true;
 }
 
 const Array<int>& MoleculeSubMatcher::currentMapping()
@@ -559,6 +570,10 @@ bool MoleculeSubMatcher::_tryCurrent() // const
 
     Molecule& target_mol = _current_obj->getMolecule();
 
+    // The target stereo is needed before matching only for stereo queries
+    if (query_mol.stereocenters.size() > 0 || query_mol.cis_trans.count() > 0 || query_mol.allene_stereo.size() > 0)
+        _cmf_loader->loadStereo();
+
     profTimerStart(tr_m, "sub_try_matching");
     MoleculeSubstructureMatcher msm(target_mol);
 
@@ -570,6 +585,10 @@ bool MoleculeSubMatcher::_tryCurrent() // const
 
     if (find_res)
     {
+        // The object goes to the user as it is stored
+        _cmf_loader->loadStereo();
+        _cmf_loader->loadHighlighting();
+
         _mapping.copy(msm.getTargetMapping(), target_mol.vertexCount());
         return true;
     }
@@ -218,6 +218,11 @@ namespace bingo
         // Variables used for estimation
         MeanEstimator _match_probability_esimate, _match_time_esimate;
 
+        // Substructure matchers load molecules in the CmfLoader lazy mode
+        // and ask _cmf_loader for the stereo and highlighting when needed
+        bool _lazy_loading;
+        std::unique_ptr<CmfLoader> _cmf_loader;
+
         bool _isCurrentObjectExist();
 
         bool _loadCurrentObject();
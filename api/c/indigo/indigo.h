@@ -78,6 +78,12 @@ CEXPORT const char* indigoGetLastError(void);
 typedef void (*INDIGO_ERROR_HANDLER)(const char* message, void* context);
 CEXPORT void indigoSetErrorHandler(INDIGO_ERROR_HANDLER handler, void* context);
 
+// Object handles are positive ints: the low 24 bits hold the slot of the
+// object, the next 7 bits count how many times the slot has been reused.
+// A handle is never given out twice within a session, so a stale handle is
+// always rejected. A session can hold up to 2^24 - 1 objects at a time and
+// create about 2^31 objects over its lifetime.
+
 // Free an object
 CEXPORT int indigoFree(int handle);
 // Clone an object
@@ -689,6 +695,16 @@ CEXPORT double indigoLogP(int molecule);
 CEXPORT double indigoMolarRefractivity(int molecule);
 
 CEXPORT const char* indigoCanonicalSmiles(int molecule);
+// Canonical SMILES of all the remaining iterator items, one line per item, in
+// input order. Items are processed on nthreads threads (all the cores if
+// nthreads <= 0, and never more threads than cores). An item that can not
+// be processed gives an empty line. The batch fails as a whole when it runs
+// out of memory or past the "timeout" option.
+CEXPORT const char* indigoCanonicalSmilesBatch(int iterator, int nthreads);
+// The same lines written to an output, which is flushed after every block of
+// items, so the whole text is never held in memory
+CEXPORT int indigoSaveCanonicalSmilesBatch(int iterator, int output, int nthreads);
+CEXPORT int indigoSaveCanonicalSmilesBatchToFile(int iterator, const char* filename, int nthreads);
 CEXPORT const char* indigoLayeredCode(int molecule);
 
 CEXPORT int64_t indigoHash(int chemicalObject);
@@ -833,19 +849,26 @@ CEXPORT int indigoLoadFingerprintFromDescriptors(const double* arr, int arr_len,
 // "tversky" without numbers defaults to alpha = beta = 0.5
 CEXPORT float indigoSimilarity(int item1, int item2, const char* metrics);
 
-/* Working with SDF/RDF/SMILES/CML/CDX files  */
+/* Working with SDF/RDF/SMILES/CML/CDX/KET files  */
 
 CEXPORT int indigoIterateSDF(int reader);
 CEXPORT int indigoIterateRDF(int reader);
 CEXPORT int indigoIterateSmiles(int reader);
 CEXPORT int indigoIterateCML(int reader);
 CEXPORT int indigoIterateCDX(int reader);
+// KET documents follow one another, e.g. one per line
+CEXPORT int indigoIterateKET(int reader);
 
 CEXPORT int indigoIterateSDFile(const char* filename);
 CEXPORT int indigoIterateRDFile(const char* filename);
 CEXPORT int indigoIterateSmilesFile(const char* filename);
 CEXPORT int indigoIterateCMLFile(const char* filename);
 CEXPORT int indigoIterateCDXFile(const char* filename);
+CEXPORT int indigoIterateKETFile(const char* filename);
+// Items of a CMF container written by the 'cmf' saver. The iterator also
+// supports indigoAt and indigoCount, which do not read the records.
+// The 'iterate-file-threads' option does not apply: items are decoded on access.
+CEXPORT int indigoIterateCmfFile(const char* filename);
 
 // Applicable to items returned by SDF/RDF iterators.
 // Returns the content of SDF/RDF item.
@@ -871,15 +894,36 @@ CEXPORT int indigoCmlAppend(int output, int item);
 CEXPORT int indigoCmlFooter(int output);
 
 // Create saver objects that can be used to save molecules or reactions
-// Supported formats: 'sdf', 'smi' or 'smiles', 'cml', 'rdf'
+// Supported formats: 'sdf', 'smi' or 'smiles', 'cml', 'rdf', 'cmf'
 // Format argument is case-insensitive
 // Saver should be closed with indigoClose function
+// 'cmf' is a container of indigoSerialize records with their names and
+// properties, read back by indigoIterateCmfFile. With the 'cmf-container-fingerprint'
+// option set to a fingerprint type it also keeps the fingerprints, and with
+// 'cmf-container-hash' the hashes, so that indigoFingerprint and indigoHash
+// of the loaded items do not decode them.
 CEXPORT int indigoCreateSaver(int output, const char* format);
 CEXPORT int indigoCreateFileSaver(const char* filename, const char* format);
+// Appends to an existing file, or creates it. Only 'cmf' is supported.
+// The container keeps the fingerprint and hash settings it was created with.
+CEXPORT int indigoCreateFileAppender(const char* filename, const char* format);
 
 // Append object to a specified saver stream
 CEXPORT int indigoAppend(int saver, int object);
 
+// Saves the remaining items of an iterator, or the items of an array, into an
+// Arrow IPC file (readable by pyarrow, pandas, Polars, DuckDB), one row per item.
+// 'columns' is a comma-separated list of:
+//   'smiles' -- canonical SMILES, 'molfile', 'cmf' -- what indigoSerialize gives,
+//   'name', 'formula' -- gross formula, 'mw' -- molecular weight, 'tpsa', 'logp',
+//   'fingerprint' or 'fingerprint:<type>' -- fingerprint bytes, 'sim' by default,
+//   'property:<name>' -- SDF property, in the column named after it.
+// Columns are computed on nthreads threads (all the cores if nthreads <= 0,
+// and never more threads than cores). A value that can not be computed is null.
+// The save fails as a whole when it runs out of memory or past the "timeout" option.
+CEXPORT int indigoSaveArrow(int items, int output, const char* columns, int nthreads);
+CEXPORT int indigoSaveArrowToFile(int items, const char* filename, const char* columns, int nthreads);
+
 /* Arrays */
 
 CEXPORT int indigoCreateArray();
@@ -919,6 +963,16 @@ CEXPORT int indigoCountMatchesWithLimit(int matcher, int query, int embeddings_l
 // Returns substructure matches iterator
 CEXPORT int indigoIterateMatches(int matcher, int query);
 
+// Returns a new 'query set' object built from an array of query molecules.
+// The queries are copied; query ids are their indices in the array.
+CEXPORT int indigoCreateQuerySet(int queries);
+
+// Returns ids of the queries from the set that have a substructure match
+// in the target molecule, in ascending order. The list is terminated by -1.
+// Queries needing more atoms or bonds of some element than the target has
+// are dropped up front; each of the others is searched on its own.
+CEXPORT const int* indigoMatchQuerySet(int query_set, int target, int* count_out);
+
 // Accepts a 'match' object obtained from indigoMatchSubstructure.
 // Returns a new molecule which has the query highlighted.
 CEXPORT int indigoHighlightedTarget(int match);
@@ -958,6 +1012,9 @@ CEXPORT int indigoIterateTautomers(int molecule, const char* options);
 //   (i) treated as a structure: the maximum (by the number of rings) common
 //       substructure of the given structures.
 //  (ii) passed to indigoAllScaffolds()
+// Options: "EXACT [max_iterations]" (default), "APPROX [max_iterations]" or
+//   "MCSPLIT [time_limit_ms [threads]]" -- maximum common connected induced
+//   substructure; on timeout the best scaffold found so far is returned.
 CEXPORT int indigoExtractCommonScaffold(int structures, const char* options);
 
 // Returns an array of all possible scaffolds.
@@ -1044,4 +1101,10 @@ CEXPORT int indigoDbgResetProfiling(int /*bool*/ whole_session);
 // Methods that returns profiling counter value for a particular counter
 CEXPORT qword indigoDbgProfilingGetCounter(const char* name, int /*bool*/ whole_session);
 
+// Enable or disable recording of profiling scopes as trace events
+CEXPORT int indigoDbgTraceEnable(int /*bool*/ enable);
+
+// Write trace events recorded since the previous dump to a file in the Chrome trace event (JSON) format
+CEXPORT int indigoDbgTraceDump(const char* filename);
+
 #endif
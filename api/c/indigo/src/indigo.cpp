@@ -96,6 +96,13 @@ void Indigo::init()
     aam_cancellation_timeout = 0;
     cancellation_timeout = 0;
 
+    iterate_file_threads = 0;
+    iterate_file_ordered = true;
+    iterate_file_index = false;
+
+    cmf_container_fingerprint.clear();
+    cmf_container_hash = false;
+
     preserve_ordering_in_serialize = false;
 
     unique_dearomatization = false;
@@ -119,26 +126,36 @@ Indigo::Indigo()
 
 void Indigo::removeAllObjects()
 {
-    auto objects_holder = sf::xlock_safe_ptr(_objects_holder);
-    for (const auto& item : objects_holder->objects)
+    std::vector<std::pair<int, IndigoObject*>> removed;
+    _objects.removeAll(removed);
+    for (const auto& item : removed)
     {
 #ifdef INDIGO_DEBUG
         std::stringstream ss;
-        ss << "~IndigoObject(" << TL_GET_SESSION_ID() << ", " << objects_holder->objects.key(i) << ")";
+        ss << "~IndigoObject(" << TL_GET_SESSION_ID() << ", " << item.first << ")";
         std::cout << ss.str() << std::endl;
 #endif
         delete item.second;
     }
-    objects_holder->objects.clear();
 }
 
 void Indigo::updateCancellationHandler()
 {
+    CancellationHandler* current = getCancellationHandler();
     if (cancellation_timeout > 0)
     {
-        resetCancellationHandler(new TimeoutCancellationHandler(cancellation_timeout));
+        // A timeout handler left by the previous call is re-armed instead of replaced
+        TimeoutCancellationHandler* timeout = dynamic_cast<TimeoutCancellationHandler*>(current);
+        if (timeout != nullptr)
+        {
+            timeout->reset(cancellation_timeout);
+        }
+        else
+        {
+            resetCancellationHandler(new TimeoutCancellationHandler(cancellation_timeout));
+        }
     }
-    else
+    else if (current != nullptr)
     {
         resetCancellationHandler(nullptr);
     }
@@ -187,14 +204,28 @@ const Array<char>& Indigo::getErrorMessage()
     return error_message();
 }
 
+namespace
+{
+    // A plain flag is cheaper to reach than the message buffer, whose thread
+    // local wrapper checks for initialization on every access
+    thread_local bool error_message_set = false;
+} // namespace
+
+// Called on every API entry, so the buffer is only touched after an error
 void Indigo::clearErrorMessage()
 {
-    error_message().clear();
+    if (!error_message_set)
+        return;
+    Array<char>& message = error_message();
+    message.clear();
+    message.push(0);
+    error_message_set = false;
 }
 
 void Indigo::setErrorMessage(const char* message)
 {
     error_message().readString(message, true);
+    error_message_set = true;
 }
 
 void Indigo::handleError(const char* message)
@@ -339,51 +370,169 @@ CEXPORT void indigoSetErrorMessage(const char* message)
 
 int Indigo::addObject(IndigoObject* obj)
 {
-    auto objects_holder = sf::xlock_safe_ptr(_objects_holder);
-    int id = objects_holder->next_id++;
+    int id = _objects.add(obj);
 #ifdef INDIGO_DEBUG
     std::stringstream ss;
     ss << "IndigoObject(" << TL_GET_SESSION_ID() << ", " << id << ")";
     std::cout << ss.str() << std::endl;
 #endif
-    objects_holder->objects.emplace(id, obj);
     return id;
 }
 
 void Indigo::removeObject(int id)
 {
-    auto objects_holder = sf::xlock_safe_ptr(_objects_holder);
 #ifdef INDIGO_DEBUG
     std::stringstream ss;
     ss << "~IndigoObject(" << TL_GET_SESSION_ID() << ", " << id << ")";
     std::cout << ss.str() << std::endl;
 #endif
-    if (objects_holder->objects.count(id) == 0)
+    delete _objects.remove(id);
+}
+
+IndigoObject& Indigo::getObject(int handle)
+{
+    IndigoObject* obj = _objects.get(handle);
+    if (obj == nullptr)
     {
-        return;
+        throw IndigoError("can not access object #%d", handle);
     }
-    delete objects_holder->objects.at(id);
-    objects_holder->objects.erase(id);
+    return *obj;
 }
 
-IndigoObject& Indigo::getObject(int handle)
+int Indigo::countObjects() const
+{
+    return _objects.count();
+}
+
+//
+// Indigo::ObjectsTable
+//
+
+Indigo::ObjectsTable::ObjectsTable() : _chunks(new std::atomic<Slot*>[MAX_CHUNKS]), _slots_count(0), _objects_count(0)
 {
-    auto objects_holder = sf::slock_safe_ptr(_objects_holder);
+    for (int i = 0; i < MAX_CHUNKS; i++)
+    {
+        _chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+Indigo::ObjectsTable::~ObjectsTable()
+{
+    for (int i = 0; i < MAX_CHUNKS; i++)
+    {
+        delete[] _chunks[i].load(std::memory_order_relaxed);
+    }
+}
 
-    try
+int Indigo::ObjectsTable::add(IndigoObject* obj)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    int index;
+    if (!_free_slots.empty())
     {
-        return *objects_holder->objects.at(handle);
+        index = _free_slots.back();
+        _free_slots.pop_back();
     }
-    catch (const std::out_of_range& e)
+    else
     {
-        throw IndigoError("can not access object #%d: %s", handle, e.what());
+        if (_slots_count == MAX_SLOTS)
+        {
+            throw IndigoError("too many objects allocated (%d)", _objects_count.load(std::memory_order_relaxed));
+        }
+        index = _slots_count++;
+        std::atomic<Slot*>& chunk = _chunks[index >> CHUNK_BITS];
+        if (chunk.load(std::memory_order_relaxed) == nullptr)
+        {
+            // Value-initialization zeroes all the atomics
+            chunk.store(new Slot[CHUNK_SIZE](), std::memory_order_release);
+        }
     }
+    Slot& slot = _chunks[index >> CHUNK_BITS].load(std::memory_order_relaxed)[index & (CHUNK_SIZE - 1)];
+    slot.object.store(obj, std::memory_order_release);
+    _objects_count.fetch_add(1, std::memory_order_relaxed);
+    // Fresh slots have zero generation, so handles are 1, 2, 3... until slots get recycled
+    return (slot.generation.load(std::memory_order_relaxed) << SLOT_BITS) | (index + 1);
 }
 
-int Indigo::countObjects() const
+Indigo::ObjectsTable::Slot* Indigo::ObjectsTable::_getSlot(const int handle) const
+{
+    const int index = (handle & ((1 << SLOT_BITS) - 1)) - 1;
+    if (handle <= 0 || index < 0)
+    {
+        return nullptr;
+    }
+    const Slot* chunk = _chunks[index >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk == nullptr)
+    {
+        return nullptr;
+    }
+    Slot* slot = const_cast<Slot*>(&chunk[index & (CHUNK_SIZE - 1)]);
+    if (slot->generation.load(std::memory_order_acquire) != (handle >> SLOT_BITS))
+    {
+        return nullptr;
+    }
+    return slot;
+}
+
+IndigoObject* Indigo::ObjectsTable::get(const int handle) const
+{
+    const Slot* slot = _getSlot(handle);
+    if (slot == nullptr)
+    {
+        return nullptr;
+    }
+    return slot->object.load(std::memory_order_acquire);
+}
+
+IndigoObject* Indigo::ObjectsTable::remove(const int handle)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    Slot* slot = _getSlot(handle);
+    if (slot == nullptr)
+    {
+        return nullptr;
+    }
+    IndigoObject* obj = slot->object.exchange(nullptr, std::memory_order_acq_rel);
+    if (obj == nullptr)
+    {
+        return nullptr;
+    }
+    const int generation = slot->generation.load(std::memory_order_relaxed) + 1;
+    slot->generation.store(generation, std::memory_order_release);
+    if (generation != RETIRED_GENERATION)
+    {
+        _free_slots.push_back((handle & ((1 << SLOT_BITS) - 1)) - 1);
+    }
+    _objects_count.fetch_sub(1, std::memory_order_relaxed);
+    return obj;
+}
+
+void Indigo::ObjectsTable::removeAll(std::vector<std::pair<int, IndigoObject*>>& removed)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _free_slots.clear();
+    // Pushed in reverse order so that low slots are reused first
+    for (int index = _slots_count - 1; index >= 0; index--)
+    {
+        Slot& slot = _chunks[index >> CHUNK_BITS].load(std::memory_order_relaxed)[index & (CHUNK_SIZE - 1)];
+        IndigoObject* obj = slot.object.exchange(nullptr, std::memory_order_acq_rel);
+        int generation = slot.generation.load(std::memory_order_relaxed);
+        if (obj != nullptr)
+        {
+            removed.emplace_back((generation << SLOT_BITS) | (index + 1), obj);
+            slot.generation.store(++generation, std::memory_order_release);
+        }
+        if (generation != RETIRED_GENERATION)
+        {
+            _free_slots.push_back(index);
+        }
+    }
+    _objects_count.store(0, std::memory_order_relaxed);
+}
+
+int Indigo::ObjectsTable::count() const
 {
-    auto objects_holder = sf::slock_safe_ptr(_objects_holder);
-    return objects_holder->objects.size();
+    return _objects_count.load(std::memory_order_relaxed);
 }
 
 void Indigo::TmpData::clear()
@@ -559,3 +708,24 @@ CEXPORT qword indigoDbgProfilingGetCounter(const char* name, int whole_session)
     }
     INDIGO_END(-1);
 }
+
+CEXPORT int indigoDbgTraceEnable(int enable)
+{
+    INDIGO_BEGIN
+    {
+        profTraceEnable(enable != 0);
+        return 1;
+    }
+    INDIGO_END(-1);
+}
+
+CEXPORT int indigoDbgTraceDump(const char* filename)
+{
+    INDIGO_BEGIN
+    {
+        FileOutput output(filename);
+        profTraceDump(output);
+        return 1;
+    }
+    INDIGO_END(-1);
+}
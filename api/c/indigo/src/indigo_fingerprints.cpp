@@ -22,6 +22,7 @@
 #include "base_cpp/output.h"
 #include "base_cpp/scanner.h"
 #include "indigo_io.h"
+#include "indigo_loaders.h"
 #include "indigo_molecule.h"
 #include "indigo_reaction.h"
 #include "molecule/molecule_fingerprint.h"
@@ -118,11 +119,47 @@ void _indigoParseReactionFingerprintType(ReactionFingerprintBuilder& builder, co
         throw IndigoError("unknown molecule fingerprint type: %s", type);
 }
 
-CEXPORT int indigoFingerprint(int item, const char* type)
+void _indigoGetFingerprintMetadata(const char* type, Array<char>& metadata)
 {
-    INDIGO_BEGIN
+    Indigo& self = indigoGetInstance();
+    Array<char> name;
+
+    if (type == 0 || *type == 0)
+        type = "sim";
+    for (; *type != 0; type++)
+        name.push(tolower(*type));
+    name.push(0);
+
+    // Everything in fp_params changes the fingerprint bytes
+    ArrayOutput output(metadata);
+    output.printf("%s ext=%d ord=%d any=%d tau=%d sim=%d similarity-type=%s", name.ptr(), self.fp_params.ext ? 1 : 0, self.fp_params.ord_qwords,
+                  self.fp_params.any_qwords, self.fp_params.tau_qwords, self.fp_params.sim_qwords,
+                  MoleculeFingerprintBuilder::printSimilarityType(self.fp_params.similarity_type));
+    output.writeChar(0);
+}
+
+void _indigoGetFingerprint(IndigoObject& obj, const char* type, Array<byte>& bytes)
+{
+    Indigo& self = indigoGetInstance();
+
+    if (IndigoBaseMolecule::is(obj) || IndigoBaseReaction::is(obj))
     {
-        IndigoObject& obj = self.getObject(item);
+        int size = IndigoBaseMolecule::is(obj) ? self.fp_params.fingerprintSize() : self.fp_params.fingerprintSizeExtOrdSim() * 2;
+
+        if (IndigoCmfData::is(obj))
+        {
+            IndigoCmfData& data = (IndigoCmfData&)obj;
+            if (!data.isLoaded() && data.fingerprint.size() >= size)
+            {
+                Array<char> metadata;
+                _indigoGetFingerprintMetadata(type, metadata);
+                if (strcmp(metadata.ptr(), data.fingerprint_metadata.ptr()) == 0)
+                {
+                    bytes.copy(data.fingerprint.ptr(), size);
+                    return;
+                }
+            }
+        }
 
         if (IndigoBaseMolecule::is(obj))
         {
@@ -131,24 +168,31 @@ CEXPORT int indigoFingerprint(int item, const char* type)
 
             _indigoParseMoleculeFingerprintType(builder, type, mol.isQueryMolecule());
             builder.process();
-            std::unique_ptr<IndigoFingerprint> fp = std::make_unique<IndigoFingerprint>();
-            fp->bytes.copy(builder.get(), self.fp_params.fingerprintSize());
-            return self.addObject(fp.release());
+            bytes.copy(builder.get(), size);
         }
-        else if (IndigoBaseReaction::is(obj))
+        else
         {
             BaseReaction& rxn = obj.getBaseReaction();
             ReactionFingerprintBuilder builder(rxn, self.fp_params);
 
             _indigoParseReactionFingerprintType(builder, type, rxn.isQueryReaction());
             builder.process();
-            std::unique_ptr<IndigoFingerprint> fp = std::make_unique<IndigoFingerprint>();
-            fp->bytes.copy(builder.get(), self.fp_params.fingerprintSizeExtOrdSim() * 2);
-            return self.addObject(fp.release());
+            bytes.copy(builder.get(), size);
         }
-        else
-            throw IndigoError("indigoFingerprint(): accepting only molecules and reactions, got %s", obj.debugInfo());
-        return 1;
+    }
+    else
+        throw IndigoError("indigoFingerprint(): accepting only molecules and reactions, got %s", obj.debugInfo());
+}
+
+CEXPORT int indigoFingerprint(int item, const char* type)
+{
+    INDIGO_BEGIN
+    {
+        IndigoObject& obj = self.getObject(item);
+        std::unique_ptr<IndigoFingerprint> fp = std::make_unique<IndigoFingerprint>();
+
+        _indigoGetFingerprint(obj, type, fp->bytes);
+        return self.addObject(fp.release());
     }
     INDIGO_END(-1);
 }
@@ -26,6 +26,12 @@
 #pragma warning(disable : 4251)
 #endif
 
+// Fingerprint bytes of a molecule or a reaction for a fingerprint type: "sim", "sub", "full" etc.
+// A CMF container record gives the fingerprint kept with it if that was made the same way.
+void _indigoGetFingerprint(IndigoObject& obj, const char* type, Array<byte>& bytes);
+// Fingerprint type and the fingerprint parameters the fingerprints are made with
+void _indigoGetFingerprintMetadata(const char* type, Array<char>& metadata);
+
 class DLLEXPORT IndigoFingerprint : public IndigoObject
 {
 public:
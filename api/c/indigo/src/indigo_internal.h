@@ -24,8 +24,11 @@
 #pragma warning(disable : 4251)
 #endif
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <utility>
+#include <vector>
 
 #include "indigo.h"
 
@@ -164,6 +167,12 @@ public:
         GROSS_REACTION,
         JSON_MOLECULE,
         JSON_REACTION,
+        QUERY_SET,
+        PARALLEL_LOADER,
+        MULTIPLE_KET_LOADER,
+        CMF_MOLECULE,
+        CMF_REACTION,
+        CMF_LOADER,
         INDIGO_OBJECT_LAST_TYPE // must be the last element in the enum
     };
 
@@ -329,6 +338,13 @@ public:
 
     int cancellation_timeout; // default is 0 seconds - no timeout
 
+    int iterate_file_threads;  // default is zero -- records are parsed on first access; BGZF input is also inflated on these threads
+    bool iterate_file_ordered; // parsed records come back in input order, default is true
+    bool iterate_file_index;   // file iterators keep record offsets in a sidecar file, default is false
+
+    Array<char> cmf_container_fingerprint; // fingerprint type kept in new CMF containers, default is empty -- none
+    bool cmf_container_hash;               // new CMF containers keep the molecule and reaction hashes, default is false
+
     void updateCancellationHandler();
 
     void initMolfileSaver(MolfileSaver& saver);
@@ -359,12 +375,54 @@ private:
     static INDIGO_ERROR_HANDLER& error_handler();
     static void*& error_handler_context();
 
-    struct ObjectsHolder
+    // Handle table. Slots are allocated in chunks that never move, so lookups
+    // are done without locking. A handle encodes the slot index and the slot
+    // generation, which is bumped every time the slot is freed and recycled.
+    // A slot whose generation would wrap around is retired instead, so a stale
+    // handle never matches a newer object.
+    class ObjectsTable
     {
-        std::unordered_map<int, IndigoObject*> objects;
-        int next_id = 1;
+    public:
+        ObjectsTable();
+        ~ObjectsTable();
+
+        int add(IndigoObject* obj);
+        // Returns the detached object or nullptr if the handle is not valid
+        IndigoObject* remove(int handle);
+        IndigoObject* get(int handle) const;
+        // Detaches all objects and returns them with their handles
+        void removeAll(std::vector<std::pair<int, IndigoObject*>>& removed);
+        int count() const;
+
+    private:
+        enum
+        {
+            SLOT_BITS = 24,
+            GENERATION_MASK = (1 << 7) - 1,
+            // No handle carries it, a retired slot is never matched again
+            RETIRED_GENERATION = GENERATION_MASK + 1,
+            CHUNK_BITS = 12,
+            CHUNK_SIZE = 1 << CHUNK_BITS,
+            MAX_CHUNKS = 1 << (SLOT_BITS - CHUNK_BITS),
+            // Slot index + 1 must fit SLOT_BITS
+            MAX_SLOTS = (1 << SLOT_BITS) - 1
+        };
+
+        struct Slot
+        {
+            std::atomic<IndigoObject*> object;
+            std::atomic<int> generation;
+        };
+
+        Slot* _getSlot(int handle) const;
+
+        std::unique_ptr<std::atomic<Slot*>[]> _chunks;
+        std::mutex _lock;
+        std::vector<int> _free_slots;
+        int _slots_count;
+        std::atomic<int> _objects_count;
     };
-    sf::safe_shared_hide_obj<ObjectsHolder> _objects_holder;
+    ObjectsTable _objects;
 
     int _indigo_id;
 };
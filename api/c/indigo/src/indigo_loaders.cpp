@@ -17,61 +17,68 @@
  ***************************************************************************/
 
 #include "indigo_loaders.h"
+#include "base_cpp/mmap_scanner.h"
 #include "base_cpp/scanner.h"
 #include "indigo_io.h"
 #include "indigo_molecule.h"
 #include "indigo_reaction.h"
 #include "molecule/cml_loader.h"
+#include "molecule/icm_loader.h"
+#include "molecule/icm_saver.h"
 #include "molecule/molecule_cdx_loader.h"
 #include "molecule/molfile_loader.h"
 #include "molecule/multiple_cdx_loader.h"
 #include "molecule/multiple_cml_loader.h"
+#include "molecule/multiple_ket_loader.h"
 #include "molecule/rdf_loader.h"
 #include "molecule/sdf_loader.h"
 #include "molecule/smiles_loader.h"
+#include "reaction/icr_loader.h"
+#include "reaction/icr_saver.h"
 #include "reaction/reaction_cdx_loader.h"
 #include "reaction/reaction_cml_loader.h"
 #include "reaction/reaction_json_loader.h"
 #include "reaction/rsmiles_loader.h"
 #include "reaction/rxnfile_loader.h"
 
+#include <algorithm>
 #include <limits>
 
 using namespace rapidjson;
 
-IndigoJSONMolecule::IndigoJSONMolecule(Document& ket) : IndigoObject(JSON_MOLECULE), _loader(ket), _loaded(false)
+IndigoRecordIndexFile::IndigoRecordIndexFile() : _filename_encoding(ENCODING_ASCII)
 {
 }
 
-Molecule& IndigoJSONMolecule::getMolecule()
+bool IndigoRecordIndexFile::open(const char* filename, RecordIndex& index)
 {
-    if (!_loaded)
-    {
-        _loader.loadMolecule(_mol);
-        _loaded = true;
-    }
-    return _mol;
-}
+    Indigo& self = indigoGetInstance();
 
-BaseMolecule& IndigoJSONMolecule::getBaseMolecule()
-{
-    return getMolecule();
-}
+    if (!self.iterate_file_index)
+        return false;
+    if (index.load(self.filename_encoding, filename))
+        return true;
 
-IndigoObject* IndigoJSONMolecule::clone()
-{
-    return IndigoMolecule::cloneFrom(*this);
+    _filename = filename;
+    _filename_encoding = self.filename_encoding;
+    return false;
 }
 
-const char* IndigoJSONMolecule::getName()
+bool IndigoRecordIndexFile::pending() const
 {
-    if (getMolecule().name.ptr() == 0)
-        return "";
-    return getMolecule().name.ptr();
+    return !_filename.empty();
 }
 
-IndigoJSONMolecule::~IndigoJSONMolecule()
+void IndigoRecordIndexFile::save(const RecordIndex& index)
 {
+    try
+    {
+        index.save(_filename_encoding, _filename.c_str());
+    }
+    catch (Exception&)
+    {
+    }
+    _filename.clear();
 }
 
 IndigoSdfLoader::IndigoSdfLoader(Scanner& scanner) : IndigoObject(SDF_LOADER)
@@ -82,8 +89,13 @@ IndigoSdfLoader::IndigoSdfLoader(Scanner& scanner) : IndigoObject(SDF_LOADER)
 IndigoSdfLoader::IndigoSdfLoader(const char* filename) : IndigoObject(SDF_LOADER)
 {
     // AutoPtr guard in case of exception in SdfLoader (happens in case of empty file)
-    _own_scanner = std::make_unique<FileScanner>(indigoGetInstance().filename_encoding, filename);
+    _own_scanner = MMapScanner::open(indigoGetInstance().filename_encoding, filename);
     sdf_loader = std::make_unique<SdfLoader>(*_own_scanner);
+    sdf_loader->setThreads(indigoGetInstance().iterate_file_threads);
+
+    RecordIndex index;
+    if (_index_file.open(filename, index))
+        sdf_loader->loadIndex(index);
 }
 
 IndigoSdfLoader::~IndigoSdfLoader()
@@ -247,7 +259,10 @@ IndigoRdfReaction::~IndigoRdfReaction()
 IndigoObject* IndigoSdfLoader::next()
 {
     if (sdf_loader->isEOF())
+    {
+        _saveIndex();
         return 0;
+    }
 
     int counter = sdf_loader->currentNumber();
     long long offset = sdf_loader->tell();
@@ -274,6 +289,24 @@ long long IndigoSdfLoader::tell()
     return sdf_loader->tell();
 }
 
+int IndigoSdfLoader::count()
+{
+    int res = sdf_loader->count();
+
+    _saveIndex();
+    return res;
+}
+
+void IndigoSdfLoader::_saveIndex()
+{
+    if (!_index_file.pending())
+        return;
+
+    RecordIndex index;
+    sdf_loader->buildIndex(index);
+    _index_file.save(index);
+}
+
 IndigoRdfLoader::IndigoRdfLoader(Scanner& scanner) : IndigoObject(RDF_LOADER)
 {
     rdf_loader = std::make_unique<RdfLoader>(scanner);
@@ -281,8 +314,13 @@ IndigoRdfLoader::IndigoRdfLoader(Scanner& scanner) : IndigoObject(RDF_LOADER)
 
 IndigoRdfLoader::IndigoRdfLoader(const char* filename) : IndigoObject(RDF_LOADER)
 {
-    _own_scanner = std::make_unique<FileScanner>(indigoGetInstance().filename_encoding, filename);
+    _own_scanner = MMapScanner::open(indigoGetInstance().filename_encoding, filename);
     rdf_loader = std::make_unique<RdfLoader>(*_own_scanner);
+    rdf_loader->setThreads(indigoGetInstance().iterate_file_threads);
+
+    RecordIndex index;
+    if (_index_file.open(filename, index))
+        rdf_loader->loadIndex(index);
 }
 
 IndigoRdfLoader::~IndigoRdfLoader()
@@ -292,7 +330,10 @@ IndigoRdfLoader::~IndigoRdfLoader()
 IndigoObject* IndigoRdfLoader::next()
 {
     if (rdf_loader->isEOF())
+    {
+        _saveIndex();
         return 0;
+    }
 
     int counter = rdf_loader->currentNumber();
     long long offset = rdf_loader->tell();
@@ -320,6 +361,24 @@ long long IndigoRdfLoader::tell()
     return rdf_loader->tell();
 }
 
+int IndigoRdfLoader::count()
+{
+    int res = rdf_loader->count();
+
+    _saveIndex();
+    return res;
+}
+
+void IndigoRdfLoader::_saveIndex()
+{
+    if (!_index_file.pending())
+        return;
+
+    RecordIndex index;
+    rdf_loader->buildIndex(index);
+    _index_file.save(index);
+}
+
 bool IndigoRdfLoader::hasNext()
 {
     return !rdf_loader->isEOF();
@@ -422,12 +481,16 @@ IndigoMultilineSmilesLoader::IndigoMultilineSmilesLoader(Scanner& scanner) : Ind
 
 IndigoMultilineSmilesLoader::IndigoMultilineSmilesLoader(const char* filename) : IndigoObject(MULTILINE_SMILES_LOADER), CP_INIT, TL_CP_GET(_offsets)
 {
-    _own_scanner = std::make_unique<FileScanner>(indigoGetInstance().filename_encoding, filename);
+    _own_scanner = MMapScanner::open(indigoGetInstance().filename_encoding, filename);
     _scanner = _own_scanner.get();
 
     _current_number = 0;
     _max_offset = 0LL;
     _offsets.clear();
+
+    RecordIndex index;
+    if (_index_file.open(filename, index))
+        loadIndex(index);
 }
 
 IndigoMultilineSmilesLoader::~IndigoMultilineSmilesLoader()
@@ -447,7 +510,10 @@ void IndigoMultilineSmilesLoader::_advance()
 IndigoObject* IndigoMultilineSmilesLoader::next()
 {
     if (_scanner->isEOF())
+    {
+        _saveIndex();
         return 0;
+    }
 
     long long offset = _scanner->tell();
     int counter = _current_number;
@@ -471,6 +537,14 @@ long long IndigoMultilineSmilesLoader::tell()
 }
 
 int IndigoMultilineSmilesLoader::count()
+{
+    int res = _scanAll();
+
+    _saveIndex();
+    return res;
+}
+
+int IndigoMultilineSmilesLoader::_scanAll()
 {
     long long offset = _scanner->tell();
     int cn = _current_number;
@@ -495,6 +569,29 @@ int IndigoMultilineSmilesLoader::count()
     return res;
 }
 
+void IndigoMultilineSmilesLoader::loadIndex(const RecordIndex& index)
+{
+    _offsets.copy(index.offsets);
+    _max_offset = index.end_offset;
+}
+
+void IndigoMultilineSmilesLoader::buildIndex(RecordIndex& index)
+{
+    _scanAll();
+    index.offsets.copy(_offsets);
+    index.end_offset = _max_offset;
+}
+
+void IndigoMultilineSmilesLoader::_saveIndex()
+{
+    if (!_index_file.pending())
+        return;
+
+    RecordIndex index;
+    buildIndex(index);
+    _index_file.save(index);
+}
+
 IndigoObject* IndigoMultilineSmilesLoader::at(int index)
 {
     if (index < _offsets.size())
@@ -510,6 +607,163 @@ IndigoObject* IndigoMultilineSmilesLoader::at(int index)
     return next();
 }
 
+IndigoCmfData::IndigoCmfData(int type, Array<char>& data, PropertiesMap& properties, int index, long long offset)
+    : IndigoRdfData(type, data, properties, index, offset), has_hash(false), hash(0)
+{
+}
+
+IndigoCmfData::~IndigoCmfData()
+{
+}
+
+bool IndigoCmfData::is(IndigoObject& obj)
+{
+    return obj.type == CMF_MOLECULE || obj.type == CMF_REACTION;
+}
+
+const char* IndigoCmfData::getName()
+{
+    if (name.size() == 0)
+        return "";
+    return name.ptr();
+}
+
+IndigoCmfMolecule::IndigoCmfMolecule(Array<char>& data, PropertiesMap& properties, int index, long long offset)
+    : IndigoCmfData(CMF_MOLECULE, data, properties, index, offset)
+{
+}
+
+IndigoCmfMolecule::~IndigoCmfMolecule()
+{
+}
+
+Molecule& IndigoCmfMolecule::getMolecule()
+{
+    if (!_loaded)
+    {
+        BufferScanner scanner(_data);
+        IcmLoader loader(scanner);
+        loader.loadMolecule(_mol);
+        _mol.name.copy(name);
+        _loaded = true;
+    }
+    return _mol;
+}
+
+BaseMolecule& IndigoCmfMolecule::getBaseMolecule()
+{
+    return getMolecule();
+}
+
+IndigoObject* IndigoCmfMolecule::clone()
+{
+    return IndigoMolecule::cloneFrom(*this);
+}
+
+IndigoCmfReaction::IndigoCmfReaction(Array<char>& data, PropertiesMap& properties, int index, long long offset)
+    : IndigoCmfData(CMF_REACTION, data, properties, index, offset)
+{
+}
+
+IndigoCmfReaction::~IndigoCmfReaction()
+{
+}
+
+Reaction& IndigoCmfReaction::getReaction()
+{
+    if (!_loaded)
+    {
+        BufferScanner scanner(_data);
+        IcrLoader loader(scanner);
+        loader.loadReaction(_rxn);
+        _rxn.name.copy(name);
+        _loaded = true;
+    }
+    return _rxn;
+}
+
+BaseReaction& IndigoCmfReaction::getBaseReaction()
+{
+    return getReaction();
+}
+
+IndigoObject* IndigoCmfReaction::clone()
+{
+    return IndigoReaction::cloneFrom(*this);
+}
+
+IndigoCmfLoader::IndigoCmfLoader(const char* filename) : IndigoObject(CMF_LOADER), _current(0)
+{
+    _scanner = MMapScanner::open(indigoGetInstance().filename_encoding, filename);
+    _reader = std::make_unique<CmfContainerReader>(*_scanner);
+}
+
+IndigoCmfLoader::~IndigoCmfLoader()
+{
+}
+
+bool IndigoCmfLoader::hasNext()
+{
+    return _current < _reader->count();
+}
+
+IndigoObject* IndigoCmfLoader::next()
+{
+    if (!hasNext())
+        return 0;
+
+    int index = _current++;
+    Indigo& self = indigoGetInstance();
+    auto& tmp = self.getThreadTmpData();
+
+    _reader->readRecord(index, _data, &tmp.string, &_properties);
+
+    long long offset = _reader->offset(index);
+    std::unique_ptr<IndigoCmfData> item;
+
+    if (_data.size() >= 3 && IcmSaver::checkVersion(_data.ptr()))
+        item = std::make_unique<IndigoCmfMolecule>(_data, _properties, index, offset);
+    else if (_data.size() >= 3 && IcrSaver::checkVersion(_data.ptr()))
+        item = std::make_unique<IndigoCmfReaction>(_data, _properties, index, offset);
+    else
+        throw IndigoError("CMF container record %d is neither a molecule nor a reaction", index);
+
+    item->name.copy(tmp.string);
+
+    int flags = _reader->flags();
+    if (flags & CmfContainerWriter::FINGERPRINTS)
+    {
+        _reader->readFingerprint(index, item->fingerprint);
+        item->fingerprint_metadata.readString(_reader->metadata(), true);
+    }
+    if (flags & CmfContainerWriter::HASHES)
+    {
+        item->hash = _reader->readHash(index);
+        item->has_hash = true;
+    }
+    return item.release();
+}
+
+IndigoObject* IndigoCmfLoader::at(int index)
+{
+    if (index < 0 || index >= _reader->count())
+        return 0;
+    _current = index;
+    return next();
+}
+
+int IndigoCmfLoader::count()
+{
+    return _reader->count();
+}
+
+long long IndigoCmfLoader::tell()
+{
+    if (!hasNext())
+        return _scanner->length();
+    return _reader->offset(_current);
+}
+
 CEXPORT int indigoIterateSDF(int reader)
 {
     INDIGO_BEGIN
@@ -567,12 +821,20 @@ CEXPORT int indigoTell(int handle)
             size = ((IndigoCmlMolecule&)obj).tell();
         else if (obj.type == IndigoObject::CML_REACTION)
             size = ((IndigoCmlReaction&)obj).tell();
+        else if (obj.type == IndigoObject::MULTIPLE_KET_LOADER)
+            size = ((IndigoMultipleKetLoader&)obj).tell();
+        else if (obj.type == IndigoObject::JSON_MOLECULE || obj.type == IndigoObject::JSON_REACTION)
+            size = ((IndigoRdfData&)obj).tell();
         else if (obj.type == IndigoObject::MULTIPLE_CDX_LOADER)
             size = ((IndigoMultipleCdxLoader&)obj).tell();
         else if (obj.type == IndigoObject::CDX_MOLECULE)
             size = ((IndigoCdxMolecule&)obj).tell();
         else if (obj.type == IndigoObject::CDX_REACTION)
             size = ((IndigoCdxReaction&)obj).tell();
+        else if (obj.type == IndigoObject::CMF_LOADER)
+            size = ((IndigoCmfLoader&)obj).tell();
+        else if (IndigoCmfData::is(obj))
+            size = ((IndigoCmfData&)obj).tell();
         else
             throw IndigoError("indigoTell(): not applicable to %s", obj.debugInfo());
 
@@ -605,23 +867,163 @@ CEXPORT long long indigoTell64(int handle)
             return ((IndigoCmlMolecule&)obj).tell();
         if (obj.type == IndigoObject::CML_REACTION)
             return ((IndigoCmlReaction&)obj).tell();
+        if (obj.type == IndigoObject::MULTIPLE_KET_LOADER)
+            return ((IndigoMultipleKetLoader&)obj).tell();
+        if (obj.type == IndigoObject::JSON_MOLECULE || obj.type == IndigoObject::JSON_REACTION)
+            return ((IndigoRdfData&)obj).tell();
         if (obj.type == IndigoObject::MULTIPLE_CDX_LOADER)
             return ((IndigoMultipleCdxLoader&)obj).tell();
         if (obj.type == IndigoObject::CDX_MOLECULE)
             return ((IndigoCdxMolecule&)obj).tell();
         if (obj.type == IndigoObject::CDX_REACTION)
             return ((IndigoCdxReaction&)obj).tell();
+        if (obj.type == IndigoObject::CMF_LOADER)
+            return ((IndigoCmfLoader&)obj).tell();
+        if (IndigoCmfData::is(obj))
+            return ((IndigoCmfData&)obj).tell();
 
         throw IndigoError("indigoTell64(): not applicable to %s", obj.debugInfo());
     }
     INDIGO_END(-1);
 }
 
+IndigoParallelLoader::IndigoParallelLoader(std::unique_ptr<IndigoObject> source, int nthreads, bool ordered)
+    : IndigoObject(PARALLEL_LOADER), _source(std::move(source)), _ordered(ordered), _terminate(false)
+{
+    // A few records per worker keep the pool busy while the caller takes the results
+    _max_pending = nthreads * 4;
+
+    qword session_id = TL_GET_SESSION_ID();
+    try
+    {
+        for (int i = 0; i < nthreads; i++)
+            _threads.emplace_back(&IndigoParallelLoader::_workerFunc, this, session_id);
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _terminate = true;
+        }
+        _task_cond.notify_all();
+        for (auto& thread : _threads)
+            thread.join();
+        throw;
+    }
+}
+
+IndigoParallelLoader::~IndigoParallelLoader()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _terminate = true;
+    }
+    _task_cond.notify_all();
+    for (auto& thread : _threads)
+        thread.join();
+}
+
+void IndigoParallelLoader::_workerFunc(qword session_id)
+{
+    TL_SET_SESSION_ID(session_id);
+
+    while (true)
+    {
+        Record* record;
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _task_cond.wait(guard, [this]() { return _terminate || !_tasks.empty(); });
+            if (_terminate)
+                return;
+            record = _tasks.front();
+            _tasks.pop_front();
+        }
+
+        IndigoObject& object = *record->object;
+        try
+        {
+            if (object.type == RDF_REACTION || object.type == SMILES_REACTION || object.type == JSON_REACTION || object.type == CMF_REACTION)
+                object.getBaseReaction();
+            else
+                object.getBaseMolecule();
+        }
+        catch (...)
+        {
+            // The record stays unloaded and raises the error again on first access
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            record->parsed = true;
+        }
+        _parsed_cond.notify_one();
+    }
+}
+
+void IndigoParallelLoader::_fill()
+{
+    // _pending is only used by the calling thread, so splitting runs without the lock
+    while ((int)_pending.size() < _max_pending)
+    {
+        std::unique_ptr<IndigoObject> object(_source->next());
+        if (!object)
+            break;
+
+        _pending.push_back(std::make_unique<Record>());
+        Record* record = _pending.back().get();
+        record->object = std::move(object);
+        record->parsed = false;
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _tasks.push_back(record);
+        }
+        _task_cond.notify_one();
+    }
+}
+
+IndigoObject* IndigoParallelLoader::next()
+{
+    _fill();
+    if (_pending.empty())
+        return 0;
+
+    std::unique_lock<std::mutex> guard(_lock);
+    auto it = _pending.begin();
+
+    if (_ordered)
+        _parsed_cond.wait(guard, [this]() { return _pending.front()->parsed; });
+    else
+        _parsed_cond.wait(guard, [this, &it]() {
+            it = std::find_if(_pending.begin(), _pending.end(), [](const std::unique_ptr<Record>& record) { return record->parsed; });
+            return it != _pending.end();
+        });
+
+    IndigoObject* object = (*it)->object.release();
+    _pending.erase(it);
+    return object;
+}
+
+bool IndigoParallelLoader::hasNext()
+{
+    return !_pending.empty() || _source->hasNext();
+}
+
+// Wraps a file iterator into IndigoParallelLoader if "iterate-file-threads" is set
+static IndigoObject* _parallelFileLoader(Indigo& self, IndigoObject* loader)
+{
+    std::unique_ptr<IndigoObject> source(loader);
+
+    if (self.iterate_file_threads <= 0)
+        return source.release();
+
+    return new IndigoParallelLoader(std::move(source), self.iterate_file_threads, self.iterate_file_ordered);
+}
+
 CEXPORT int indigoIterateSDFile(const char* filename)
 {
     INDIGO_BEGIN
     {
-        return self.addObject(new IndigoSdfLoader(filename));
+        return self.addObject(_parallelFileLoader(self, new IndigoSdfLoader(filename)));
     }
     INDIGO_END(-1);
 }
@@ -630,7 +1032,7 @@ CEXPORT int indigoIterateRDFile(const char* filename)
 {
     INDIGO_BEGIN
     {
-        return self.addObject(new IndigoRdfLoader(filename));
+        return self.addObject(_parallelFileLoader(self, new IndigoRdfLoader(filename)));
     }
     INDIGO_END(-1);
 }
@@ -639,7 +1041,18 @@ CEXPORT int indigoIterateSmilesFile(const char* filename)
 {
     INDIGO_BEGIN
     {
-        return self.addObject(new IndigoMultilineSmilesLoader(filename));
+        return self.addObject(_parallelFileLoader(self, new IndigoMultilineSmilesLoader(filename)));
+    }
+    INDIGO_END(-1);
+}
+
+CEXPORT int indigoIterateCmfFile(const char* filename)
+{
+    INDIGO_BEGIN
+    {
+        // Not parsed ahead on worker threads: undecoded records give their
+        // stored fingerprints and hashes, and decoding them is cheap anyway
+        return self.addObject(new IndigoCmfLoader(filename));
     }
     INDIGO_END(-1);
 }
@@ -794,6 +1207,192 @@ CEXPORT int indigoIterateCMLFile(const char* filename)
     INDIGO_END(-1);
 }
 
+IndigoJSONMolecule::IndigoJSONMolecule(Array<char>& data, int index, long long offset) : IndigoRdfData(JSON_MOLECULE, data, index, offset)
+{
+}
+
+IndigoJSONMolecule::~IndigoJSONMolecule()
+{
+}
+
+Molecule& IndigoJSONMolecule::getMolecule()
+{
+    if (!_loaded)
+    {
+        Indigo& self = indigoGetInstance();
+
+        auto setLoaderOptions = [&self](MoleculeJsonLoader& loader) {
+            loader.stereochemistry_options = self.stereochemistry_options;
+            loader.ignore_noncritical_query_features = self.ignore_noncritical_query_features;
+            loader.treat_x_as_pseudoatom = self.treat_x_as_pseudoatom;
+            loader.skip_3d_chirality = self.skip_3d_chirality;
+            loader.ignore_no_chiral_flag = self.ignore_no_chiral_flag;
+            loader.treat_stereo_as = self.treat_stereo_as;
+        };
+
+        BufferScanner scanner(_data);
+        MoleculeJsonLoader plain_loader;
+        setLoaderOptions(plain_loader);
+        if (!plain_loader.loadPlainMolecule(scanner, _mol))
+        {
+            Document ket;
+            if (!MultipleKetLoader::parse(scanner, ket) || !ket.HasMember("root") || !ket["root"].HasMember("nodes"))
+                throw IndigoError("Ketcher's JSON has no root node");
+
+            MoleculeJsonLoader loader(ket);
+            setLoaderOptions(loader);
+            loader.loadMolecule(_mol);
+        }
+        _loaded = true;
+    }
+    return _mol;
+}
+
+BaseMolecule& IndigoJSONMolecule::getBaseMolecule()
+{
+    return getMolecule();
+}
+
+const char* IndigoJSONMolecule::getName()
+{
+    if (getMolecule().name.ptr() == 0)
+        return "";
+    return getMolecule().name.ptr();
+}
+
+IndigoObject* IndigoJSONMolecule::clone()
+{
+    return IndigoMolecule::cloneFrom(*this);
+}
+
+const char* IndigoJSONMolecule::debugInfo() const
+{
+    return "<ket molecule>";
+}
+
+IndigoJSONReaction::IndigoJSONReaction(Array<char>& data, int index, long long offset) : IndigoRdfData(JSON_REACTION, data, index, offset)
+{
+}
+
+IndigoJSONReaction::~IndigoJSONReaction()
+{
+}
+
+Reaction& IndigoJSONReaction::getReaction()
+{
+    if (!_loaded)
+    {
+        Indigo& self = indigoGetInstance();
+
+        auto setLoaderOptions = [&self](ReactionJsonLoader& loader) {
+            loader.stereochemistry_options = self.stereochemistry_options;
+            loader.ignore_noncritical_query_features = self.ignore_noncritical_query_features;
+            loader.treat_x_as_pseudoatom = self.treat_x_as_pseudoatom;
+            loader.ignore_no_chiral_flag = self.ignore_no_chiral_flag;
+        };
+
+        BufferScanner scanner(_data);
+        ReactionJsonLoader plain_loader;
+        setLoaderOptions(plain_loader);
+        if (!plain_loader.loadPlainReaction(scanner, _rxn))
+        {
+            Document ket;
+            if (!MultipleKetLoader::parse(scanner, ket) || !ket.HasMember("root") || !ket["root"].HasMember("nodes"))
+                throw IndigoError("Ketcher's JSON has no root node");
+
+            ReactionJsonLoader loader(ket);
+            setLoaderOptions(loader);
+            loader.loadReaction(_rxn);
+        }
+        _loaded = true;
+    }
+    return _rxn;
+}
+
+BaseReaction& IndigoJSONReaction::getBaseReaction()
+{
+    return getReaction();
+}
+
+const char* IndigoJSONReaction::getName()
+{
+    if (getReaction().name.ptr() == 0)
+        return "";
+    return getReaction().name.ptr();
+}
+
+IndigoObject* IndigoJSONReaction::clone()
+{
+    return IndigoReaction::cloneFrom(*this);
+}
+
+const char* IndigoJSONReaction::debugInfo() const
+{
+    return "<ket reaction>";
+}
+
+IndigoMultipleKetLoader::IndigoMultipleKetLoader(Scanner& scanner) : IndigoObject(MULTIPLE_KET_LOADER)
+{
+    _own_scanner = 0;
+    loader = std::make_unique<MultipleKetLoader>(scanner);
+}
+
+IndigoMultipleKetLoader::IndigoMultipleKetLoader(const char* filename) : IndigoObject(MULTIPLE_KET_LOADER)
+{
+    _own_scanner = std::make_unique<FileScanner>(indigoGetInstance().filename_encoding, filename);
+    loader = std::make_unique<MultipleKetLoader>(*_own_scanner);
+}
+
+IndigoMultipleKetLoader::~IndigoMultipleKetLoader()
+{
+}
+
+long long IndigoMultipleKetLoader::tell()
+{
+    return loader->tell();
+}
+
+bool IndigoMultipleKetLoader::hasNext()
+{
+    return !loader->isEOF();
+}
+
+IndigoObject* IndigoMultipleKetLoader::next()
+{
+    if (!hasNext())
+        return 0;
+
+    int counter = loader->currentNumber();
+    long long offset = loader->tell();
+
+    loader->readNext();
+
+    if (loader->isReaction())
+        return new IndigoJSONReaction(loader->data, counter, offset);
+    else
+        return new IndigoJSONMolecule(loader->data, counter, offset);
+}
+
+CEXPORT int indigoIterateKET(int reader)
+{
+    INDIGO_BEGIN
+    {
+        IndigoObject& obj = self.getObject(reader);
+
+        return self.addObject(new IndigoMultipleKetLoader(IndigoScanner::get(obj)));
+    }
+    INDIGO_END(-1);
+}
+
+CEXPORT int indigoIterateKETFile(const char* filename)
+{
+    INDIGO_BEGIN
+    {
+        return self.addObject(_parallelFileLoader(self, new IndigoMultipleKetLoader(filename)));
+    }
+    INDIGO_END(-1);
+}
+
 IndigoCdxMolecule::IndigoCdxMolecule(Array<char>& data, PropertiesMap& properties, int index, long long offset)
     : IndigoRdfData(CDX_MOLECULE, data, properties, index, offset)
 {
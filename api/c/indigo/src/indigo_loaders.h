@@ -21,9 +21,17 @@
 
 #include "indigo_internal.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <rapidjson/document.h>
 
 #include "base_cpp/properties_map.h"
+#include "base_cpp/record_index.h"
+#include "molecule/cmf_container.h"
 #include "molecule/molecule.h"
 #include "molecule/molecule_json_loader.h"
 #include "molecule/query_molecule.h"
@@ -85,6 +93,24 @@ protected:
     Reaction _rxn;
 };
 
+// Sidecar record index of a file iterator, see the "iterate-file-index" option
+class IndigoRecordIndexFile
+{
+public:
+    IndigoRecordIndexFile();
+
+    // Loads a valid sidecar of the file, or remembers to write one. Returns true if loaded.
+    bool open(const char* filename, RecordIndex& index);
+    // True until the sidecar of a file without a valid one has been written
+    bool pending() const;
+    // Errors are ignored: iterators over read-only locations work without a sidecar
+    void save(const RecordIndex& index);
+
+protected:
+    std::string _filename;
+    Encoding _filename_encoding;
+};
+
 class IndigoSdfLoader : public IndigoObject
 {
 public:
@@ -95,27 +121,15 @@ public:
     bool hasNext() override;
     IndigoObject* at(int index);
     long long tell();
+    int count();
     std::unique_ptr<SdfLoader> sdf_loader;
 
 protected:
-    std::unique_ptr<Scanner> _own_scanner;
-};
-
-/*
-class IndigoJSONLoader : public IndigoObject
-{
-public:
-    IndigoJSONLoader(Scanner& scanner);
-    IndigoJSONLoader(const char* filename);
-    ~IndigoJSONLoader() override;
-    IndigoObject* next() override;
-    bool hasNext() override;
-    IndigoObject* at(int index);
-    std::unique_ptr<JSONLoader> json_loader;
+    void _saveIndex();
 
-protected:
     std::unique_ptr<Scanner> _own_scanner;
-};*/
+    IndigoRecordIndexFile _index_file;
+};
 
 class IndigoRdfLoader : public IndigoObject
 {
@@ -130,27 +144,15 @@ public:
     IndigoObject* at(int index);
 
     long long tell();
+    int count();
 
     std::unique_ptr<RdfLoader> rdf_loader;
 
 protected:
-    std::unique_ptr<Scanner> _own_scanner;
-};
+    void _saveIndex();
 
-class IndigoJSONMolecule : public IndigoObject
-{
-public:
-    IndigoJSONMolecule(rapidjson::Document& ket);
-    ~IndigoJSONMolecule() override;
-    Molecule& getMolecule() override;
-    BaseMolecule& getBaseMolecule() override;
-    const char* getName() override;
-    IndigoObject* clone() override;
-
-protected:
-    Molecule _mol;
-    MoleculeJsonLoader _loader;
-    bool _loaded;
+    std::unique_ptr<Scanner> _own_scanner;
+    IndigoRecordIndexFile _index_file;
 };
 
 class IndigoSmilesMolecule : public IndigoRdfData
@@ -198,12 +200,19 @@ public:
     IndigoObject* at(int index);
     int count();
 
+    void loadIndex(const RecordIndex& index);
+    void buildIndex(RecordIndex& index);
+
 protected:
     Scanner* _scanner;
     Array<char> _str;
     std::unique_ptr<Scanner> _own_scanner;
 
     void _advance();
+    int _scanAll();
+    void _saveIndex();
+
+    IndigoRecordIndexFile _index_file;
 
     CP_DECL;
     TL_CP_DECL(Array<long long>, _offsets);
@@ -211,9 +220,121 @@ protected:
     long long _max_offset;
 };
 
+// Record of a CMF container, see indigoIterateCmfFile(). The fingerprint and
+// the hash kept in the container come with it and need no decoding.
+class IndigoCmfData : public IndigoRdfData
+{
+public:
+    IndigoCmfData(int type, Array<char>& data, PropertiesMap& properties, int index, long long offset);
+    ~IndigoCmfData() override;
+
+    static bool is(IndigoObject& obj);
+
+    const char* getName() override;
+
+    // The stored fingerprint and hash describe the record only until it is decoded and can be changed
+    bool isLoaded() const
+    {
+        return _loaded;
+    }
+
+    Array<char> name;
+    Array<byte> fingerprint;          // empty if the container has no fingerprints
+    Array<char> fingerprint_metadata; // see _indigoGetFingerprintMetadata()
+    bool has_hash;
+    qword hash;
+};
+
+class IndigoCmfMolecule : public IndigoCmfData
+{
+public:
+    IndigoCmfMolecule(Array<char>& data, PropertiesMap& properties, int index, long long offset);
+    ~IndigoCmfMolecule() override;
+
+    Molecule& getMolecule() override;
+    BaseMolecule& getBaseMolecule() override;
+    IndigoObject* clone() override;
+
+protected:
+    Molecule _mol;
+};
+
+class IndigoCmfReaction : public IndigoCmfData
+{
+public:
+    IndigoCmfReaction(Array<char>& data, PropertiesMap& properties, int index, long long offset);
+    ~IndigoCmfReaction() override;
+
+    Reaction& getReaction() override;
+    BaseReaction& getBaseReaction() override;
+    IndigoObject* clone() override;
+
+protected:
+    Reaction _rxn;
+};
+
+// Iterator over a CMF container file. The file is memory-mapped when possible.
+class IndigoCmfLoader : public IndigoObject
+{
+public:
+    IndigoCmfLoader(const char* filename);
+    ~IndigoCmfLoader() override;
+
+    IndigoObject* next() override;
+    bool hasNext() override;
+
+    IndigoObject* at(int index);
+    int count();
+    long long tell();
+
+protected:
+    std::unique_ptr<Scanner> _scanner;
+    std::unique_ptr<CmfContainerReader> _reader;
+    int _current;
+    Array<char> _data;
+    PropertiesMap _properties;
+};
+
+// Parses the records of a file iterator on worker threads ahead of the caller.
+// Records are split by the wrapped iterator on the calling thread; the workers
+// run in the caller's session and see its loader options. A record that fails
+// to parse is returned unloaded and raises the error on first access.
+// Forward-only: indexing, counting and tell are not supported.
+class IndigoParallelLoader : public IndigoObject
+{
+public:
+    IndigoParallelLoader(std::unique_ptr<IndigoObject> source, int nthreads, bool ordered);
+    ~IndigoParallelLoader() override;
+
+    IndigoObject* next() override;
+    bool hasNext() override;
+
+protected:
+    struct Record
+    {
+        std::unique_ptr<IndigoObject> object;
+        bool parsed;
+    };
+
+    void _fill();
+    void _workerFunc(qword session_id);
+
+    std::unique_ptr<IndigoObject> _source;
+    bool _ordered;
+    int _max_pending;
+
+    std::mutex _lock;
+    std::condition_variable _task_cond, _parsed_cond;
+    std::deque<std::unique_ptr<Record>> _pending; // in input order
+    std::deque<Record*> _tasks;
+    bool _terminate;
+    std::vector<std::thread> _threads;
+};
+
 namespace indigo
 {
     class MultipleCmlLoader;
+    class MultipleKetLoader;
 }
 
 class IndigoCmlMolecule : public IndigoRdfData
@@ -270,6 +391,58 @@ protected:
     std::unique_ptr<Scanner> _own_scanner;
 };
 
+class IndigoJSONMolecule : public IndigoRdfData
+{
+public:
+    IndigoJSONMolecule(Array<char>& data_, int index, long long offset);
+    ~IndigoJSONMolecule() override;
+
+    Molecule& getMolecule() override;
+    BaseMolecule& getBaseMolecule() override;
+    const char* getName() override;
+    IndigoObject* clone() override;
+
+    const char* debugInfo() const override;
+
+protected:
+    Molecule _mol;
+};
+
+class IndigoJSONReaction : public IndigoRdfData
+{
+public:
+    IndigoJSONReaction(Array<char>& data_, int index, long long offset);
+    ~IndigoJSONReaction() override;
+
+    Reaction& getReaction() override;
+    BaseReaction& getBaseReaction() override;
+    const char* getName() override;
+    IndigoObject* clone() override;
+
+    const char* debugInfo() const override;
+
+protected:
+    Reaction _rxn;
+};
+
+class IndigoMultipleKetLoader : public IndigoObject
+{
+public:
+    IndigoMultipleKetLoader(Scanner& scanner);
+    IndigoMultipleKetLoader(const char* filename);
+    ~IndigoMultipleKetLoader() override;
+
+    IndigoObject* next() override;
+    bool hasNext() override;
+
+    long long tell();
+
+    std::unique_ptr<MultipleKetLoader> loader;
+
+protected:
+    std::unique_ptr<Scanner> _own_scanner;
+};
+
 namespace indigo
 {
     class MultipleCdxLoader;
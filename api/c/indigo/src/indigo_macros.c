@@ -98,6 +98,34 @@ CEXPORT int indigoSaveMolfileToFile(int molecule, const char* filename)
     return res;
 }
 
+CEXPORT int indigoSaveCanonicalSmilesBatchToFile(int iterator, const char* filename, int nthreads)
+{
+    int f = indigoWriteFile(filename);
+    int res;
+
+    if (f == -1)
+        return -1;
+
+    res = indigoSaveCanonicalSmilesBatch(iterator, f, nthreads);
+
+    indigoFree(f);
+    return res;
+}
+
+CEXPORT int indigoSaveArrowToFile(int items, const char* filename, const char* columns, int nthreads)
+{
+    int f = indigoWriteFile(filename);
+    int res;
+
+    if (f == -1)
+        return -1;
+
+    res = indigoSaveArrow(items, f, columns, nthreads);
+
+    indigoFree(f);
+    return res;
+}
+
 CEXPORT int indigoSaveJsonToFile(int item, const char* filename)
 {
     int f = indigoWriteFile(filename);
@@ -18,6 +18,7 @@
 
 #include "indigo_match.h"
 #include "base_cpp/scanner.h"
+#include "indigo_array.h"
 #include "indigo_mapping.h"
 #include "indigo_molecule.h"
 #include "indigo_reaction.h"
@@ -496,51 +497,32 @@ bool IndigoTautomerSubstructureMatchIter::hasNext()
     return _found;
 }
 
-struct MatchCountContext
-{
-    int embeddings_count, max_count;
-};
-
-static bool _matchCountEmbeddingsCallback(Graph& sub, Graph& super, const int* core1, const int* core2, void* context_)
-{
-    MatchCountContext* context = (MatchCountContext*)context_;
-    context->embeddings_count++;
-    if (context->embeddings_count >= context->max_count)
-        return false;
-    return true;
-}
-
 int IndigoMoleculeSubstructureMatchIter::countMatches(int embeddings_limit)
 {
     if (max_embeddings <= 0)
         throw IndigoError("Maximum allowed embeddings limit must be positive "
                           "Adjust options to raise this limit.");
 
-    MatchCountContext context;
-    context.embeddings_count = 0;
+    int max_count;
     if (embeddings_limit != 0)
-        context.max_count = std::min(max_embeddings, embeddings_limit);
+        max_count = std::min(max_embeddings, embeddings_limit);
     else
-        context.max_count = max_embeddings;
+        max_count = max_embeddings;
 
-    matcher.find_all_embeddings = true;
-    matcher.cb_embedding = _matchCountEmbeddingsCallback;
-    matcher.cb_embedding_context = &context;
-    matcher.find();
-    if (embeddings_limit != 0 && context.embeddings_count >= embeddings_limit)
+    int embeddings_count = matcher.countEmbeddings(max_count);
+    if (embeddings_limit != 0 && embeddings_count >= embeddings_limit)
         return embeddings_limit;
-    if (context.embeddings_count >= max_embeddings)
+    if (embeddings_count >= max_embeddings)
         throw IndigoError("Number of embeddings exceeded maximum allowed limit (%d). "
                           "Adjust options to raise this limit.",
                           max_embeddings);
-    return context.embeddings_count;
+    return embeddings_count;
 }
 
-IndigoMoleculeSubstructureMatcher::IndigoMoleculeSubstructureMatcher(Molecule& target, int mode_) : IndigoObject(MOLECULE_SUBSTRUCTURE_MATCHER), target(target)
+IndigoMoleculeSubstructureMatcher::IndigoMoleculeSubstructureMatcher(Molecule& target, int mode_)
+    : IndigoObject(MOLECULE_SUBSTRUCTURE_MATCHER), target(target), _prepared_target(target)
 {
-    _arom_h_unfolded_prepared = false;
-    _arom_prepared = false;
-    _aromatized = false;
+    _tau_matcher_target = 0;
     mode = mode_;
 }
 
@@ -575,64 +557,28 @@ IndigoMoleculeSubstructureMatchIter* IndigoMoleculeSubstructureMatcher::iterateQ
                                                                                             bool find_unique_embeddings, bool for_iteration, int max_embeddings)
 {
     QueryMolecule& query = query_object.getQueryMolecule();
-
-    Molecule* target_prepared;
-    Array<int>* mapping;
-    bool* prepared;
-    MoleculeAtomNeighbourhoodCounters* nei_counters;
+    Indigo& indigo = indigoGetInstance();
 
     // If max_embeddings is 1 then it is only check for substructure
     // and not enumeration of number of matches
-    if (MoleculeSubstructureMatcher::shouldUnfoldTargetHydrogens(query, max_embeddings != 1))
-    {
-        if (!_arom_h_unfolded_prepared)
-            _target_arom_h_unfolded.clone(target, &_mapping_arom_h_unfolded, 0);
-
-        target_prepared = &_target_arom_h_unfolded;
-        mapping = &_mapping_arom_h_unfolded;
-        prepared = &_arom_h_unfolded_prepared;
-        nei_counters = &_nei_counters_h_unfolded;
-    }
-    else
-    {
-        if (!_arom_prepared)
-            _target_arom.clone(target, &_mapping_arom, 0);
-        target_prepared = &_target_arom;
-        mapping = &_mapping_arom;
-        prepared = &_arom_prepared;
-        nei_counters = &_nei_counters;
-    }
-    if (!*prepared)
-    {
-        if (!target.isAromatized())
-        {
-            Indigo& indigo = indigoGetInstance();
-            target_prepared->aromatize(indigo.arom_options);
-        }
-        nei_counters->calculate(*target_prepared);
-        *prepared = true;
-    }
+    bool h_unfolded = MoleculeSubstructureMatcher::shouldUnfoldTargetHydrogens(query, max_embeddings != 1);
+    MoleculePreparedTarget::Variant& prepared = _prepared_target.get(h_unfolded, indigo.arom_options);
 
-    auto iter = std::make_unique<IndigoMoleculeSubstructureMatchIter>(*target_prepared, query, target, (mode == RESONANCE), max_embeddings != 1);
+    auto iter = std::make_unique<IndigoMoleculeSubstructureMatchIter>(prepared.molecule, query, target, (mode == RESONANCE), max_embeddings != 1);
 
+    const MoleculeAtomNeighbourhoodCounters* query_counters = 0;
     if (query_object.type == IndigoObject::QUERY_MOLECULE)
-    {
-        IndigoQueryMolecule& qm_object = (IndigoQueryMolecule&)query_object;
-        iter->matcher.setNeiCounters(&qm_object.getNeiCounters(), nei_counters);
-    }
-
-    Indigo& indigo = indigoGetInstance();
-    iter->matcher.arom_options = indigo.arom_options;
+        query_counters = &((IndigoQueryMolecule&)query_object).getNeiCounters();
+    MoleculePreparedTarget::setupMatcher(iter->matcher, prepared, query_counters);
 
     iter->matcher.find_unique_embeddings = find_unique_embeddings;
     iter->matcher.find_unique_by_edges = embedding_edges_uniqueness;
     iter->matcher.save_for_iteration = for_iteration;
 
     for (int i = 0; i < _ignored_atoms.size(); i++)
-        iter->matcher.ignoreTargetAtom(mapping->at(_ignored_atoms[i]));
+        iter->matcher.ignoreTargetAtom(prepared.mapping[_ignored_atoms[i]]);
 
-    iter->matcher.restore_unfolded_h = false;
-    iter->mapping.copy(*mapping);
+    iter->mapping.copy(prepared.mapping);
     iter->max_embeddings = max_embeddings;
 
     return iter.release();
@@ -644,27 +590,13 @@ IndigoTautomerSubstructureMatchIter* IndigoMoleculeSubstructureMatcher::iterateT
 {
     QueryMolecule& query = query_object.getQueryMolecule();
 
-    Molecule* target_prepared;
-    Array<int>* mapping;
-    bool* prepared;
-    MoleculeAtomNeighbourhoodCounters* nei_counters;
-
-    {
-        _target_arom_h_unfolded.clone(target, &_mapping_arom_h_unfolded, 0);
-
-        target_prepared = &_target_arom_h_unfolded;
-        mapping = &_mapping_arom_h_unfolded;
-        prepared = &_arom_h_unfolded_prepared;
-        nei_counters = &_nei_counters_h_unfolded;
-    }
-
     auto iter = std::make_unique<IndigoTautomerSubstructureMatchIter>(target, query, moleculeFound, method);
     iter->matcher.find_unique_embeddings = find_unique_embeddings;
     iter->matcher.find_unique_by_edges = embedding_edges_uniqueness;
     iter->matcher.save_for_iteration = for_iteration;
 
     Array<int> simpleMapping;
-    simpleMapping.expand(mapping->size());
+    simpleMapping.expand(target.vertexEnd());
     for (int i = 0; i < simpleMapping.size(); ++i)
     {
         simpleMapping[i] = i;
@@ -677,35 +609,16 @@ IndigoTautomerSubstructureMatchIter* IndigoMoleculeSubstructureMatcher::iterateT
 
 bool IndigoMoleculeSubstructureMatcher::findTautomerMatch(QueryMolecule& query, PtrArray<TautomerRule>& tautomer_rules, Array<int>& mapping_out)
 {
-    // shameless copy-paste from the method above
-    bool* prepared;
-    Molecule* target_prepared;
-    Array<int>* mapping;
-    if (MoleculeSubstructureMatcher::shouldUnfoldTargetHydrogens(query, false))
-    {
-        if (!_arom_h_unfolded_prepared)
-            _target_arom_h_unfolded.clone(target, &_mapping_arom_h_unfolded, 0);
-        target_prepared = &_target_arom_h_unfolded;
-        mapping = &_mapping_arom_h_unfolded;
-        prepared = &_arom_h_unfolded_prepared;
-    }
-    else
-    {
-        if (!_arom_prepared)
-            _target_arom.clone(target, &_mapping_arom, 0);
-        target_prepared = &_target_arom;
-        mapping = &_mapping_arom;
-        prepared = &_arom_prepared;
-    }
     Indigo& indigo = indigoGetInstance();
-    if (!target.isAromatized() && !*prepared)
-        target_prepared->aromatize(indigo.arom_options);
-    *prepared = true;
+    bool h_unfolded = MoleculeSubstructureMatcher::shouldUnfoldTargetHydrogens(query, false);
+    MoleculePreparedTarget::Variant& prepared = _prepared_target.get(h_unfolded, indigo.arom_options);
 
-    if (tau_matcher.get() == 0)
+    if (tau_matcher.get() == 0 || _tau_matcher_target != &prepared.molecule)
     {
         bool substructure = true;
-        tau_matcher.create(*target_prepared, substructure);
+        tau_matcher.free();
+        tau_matcher.create(prepared.molecule, substructure);
+        _tau_matcher_target = &prepared.molecule;
     }
 
     tau_matcher->setRulesList(&tautomer_rules);
@@ -722,7 +635,7 @@ bool IndigoMoleculeSubstructureMatcher::findTautomerMatch(QueryMolecule& query,
 
     for (int i = query.vertexBegin(); i != query.vertexEnd(); i = query.vertexNext(i))
         if (qm[i] >= 0)
-            mapping_out[i] = mapping->at(qm[i]);
+            mapping_out[i] = prepared.mapping[qm[i]];
 
     return true;
 }
@@ -1030,3 +943,68 @@ IndigoReactionSubstructureMatcher& IndigoReactionSubstructureMatcher::cast(Indig
 
     return (IndigoReactionSubstructureMatcher&)obj;
 }
+
+IndigoQuerySet::IndigoQuerySet() : IndigoObject(QUERY_SET)
+{
+}
+
+IndigoQuerySet::~IndigoQuerySet()
+{
+}
+
+const char* IndigoQuerySet::debugInfo() const
+{
+    return "<query set>";
+}
+
+IndigoQuerySet& IndigoQuerySet::cast(IndigoObject& obj)
+{
+    if (obj.type != IndigoObject::QUERY_SET)
+        throw IndigoError("%s is not a query set object", obj.debugInfo());
+
+    return (IndigoQuerySet&)obj;
+}
+
+CEXPORT int indigoCreateQuerySet(int queries)
+{
+    INDIGO_BEGIN
+    {
+        IndigoArray& arr = IndigoArray::cast(self.getObject(queries));
+        auto query_set = std::make_unique<IndigoQuerySet>();
+
+        for (int i = 0; i < arr.objects.size(); i++)
+        {
+            QueryMolecule& query = query_set->queries.add(new QueryMolecule());
+
+            query.clone(arr.objects[i]->getQueryMolecule(), 0, 0);
+            query_set->matcher.addQuery(query);
+        }
+
+        return self.addObject(query_set.release());
+    }
+    INDIGO_END(-1);
+}
+
+CEXPORT const int* indigoMatchQuerySet(int query_set, int target, int* count_out)
+{
+    INDIGO_BEGIN
+    {
+        IndigoQuerySet& qs = IndigoQuerySet::cast(self.getObject(query_set));
+        Molecule& mol = self.getObject(target).getMolecule();
+
+        QS_DEF(Array<int>, ids);
+        qs.matcher.arom_options = self.arom_options;
+        qs.matcher.match(mol, ids);
+        ids.push(-1);
+
+        auto& tmp = self.getThreadTmpData();
+        tmp.string.resize(ids.sizeInBytes());
+        tmp.string.copy((char*)ids.ptr(), ids.sizeInBytes());
+
+        if (count_out != 0)
+            *count_out = ids.size() - 1;
+
+        return (const int*)tmp.string.ptr();
+    }
+    INDIGO_END(0);
+}
@@ -21,6 +21,8 @@
 
 #include "indigo_internal.h"
 #include "molecule/molecule_neighbourhood_counters.h"
+#include "molecule/molecule_prepared_target.h"
+#include "molecule/molecule_query_set_matcher.h"
 #include "molecule/molecule_substructure_matcher.h"
 #include "molecule/molecule_tautomer_matcher.h"
 #include "molecule/molecule_tautomer_substructure_matcher.h"
@@ -139,10 +141,10 @@ public:
 
     int mode; // NORMAL, TAUTOMER, or RESONANCE
 private:
-    Molecule _target_arom_h_unfolded, _target_arom;
-    Array<int> _mapping_arom_h_unfolded, _mapping_arom, _ignored_atoms;
-    bool _arom_h_unfolded_prepared, _arom_prepared, _aromatized;
-    MoleculeAtomNeighbourhoodCounters _nei_counters, _nei_counters_h_unfolded;
+    // Aromatized copies of the target with the data shared by all the queries
+    MoleculePreparedTarget _prepared_target;
+    Molecule* _tau_matcher_target;
+    Array<int> _ignored_atoms;
 };
 
 class DLLEXPORT IndigoReactionSubstructureMatcher : public IndigoObject
@@ -164,6 +166,21 @@ public:
     Array<int> mol_mapping;
 };
 
+// Set of query molecules matched against a target all at once
+class DLLEXPORT IndigoQuerySet : public IndigoObject
+{
+public:
+    IndigoQuerySet();
+    ~IndigoQuerySet() override;
+
+    static IndigoQuerySet& cast(IndigoObject& obj);
+
+    const char* debugInfo() const override;
+
+    PtrArray<QueryMolecule> queries;
+    MoleculeQuerySetMatcher matcher;
+};
+
 DLLEXPORT bool _indigoParseTautomerFlags(const char* flags, IndigoTautomerParams& params);
 DLLEXPORT int _indigoParseExactFlags(const char* flags, bool reaction, float* rms_threshold);
 
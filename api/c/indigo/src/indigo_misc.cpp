@@ -401,11 +401,36 @@ CEXPORT const char* indigoCanonicalSmiles(int item)
     INDIGO_END(0);
 }
 
+CEXPORT const char* indigoCanonicalSmilesBatch(int iterator, int nthreads)
+{
+    INDIGO_BEGIN
+    {
+        IndigoObject& obj = self.getObject(iterator);
+        auto& tmp = self.getThreadTmpData();
+        ArrayOutput output(tmp.string);
+        IndigoCanonicalSmilesBatch batch(nthreads);
+        batch.generate(obj, output);
+        tmp.string.push(0);
+
+        return tmp.string.ptr();
+    }
+    INDIGO_END(0);
+}
+
 CEXPORT int64_t indigoHash(int item)
 {
     INDIGO_BEGIN
     {
         IndigoObject& obj = self.getObject(item);
+
+        // Records of a CMF container with hashes do not need to be decoded
+        if (IndigoCmfData::is(obj))
+        {
+            IndigoCmfData& data = (IndigoCmfData&)obj;
+            if (data.has_hash && !data.isLoaded())
+                return static_cast<int64_t>(data.hash);
+        }
+
         if (IndigoMolecule::is(obj))
         {
             Molecule& mol = obj.getMolecule();
@@ -560,7 +585,8 @@ CEXPORT const char* indigoRawData(int handler)
 
         if (obj.type == IndigoObject::RDF_MOLECULE || obj.type == IndigoObject::RDF_REACTION || obj.type == IndigoObject::SMILES_MOLECULE ||
             obj.type == IndigoObject::SMILES_REACTION || obj.type == IndigoObject::CML_MOLECULE || obj.type == IndigoObject::CML_REACTION ||
-            obj.type == IndigoObject::CDX_MOLECULE || obj.type == IndigoObject::CDX_REACTION)
+            obj.type == IndigoObject::CDX_MOLECULE || obj.type == IndigoObject::CDX_REACTION || obj.type == IndigoObject::JSON_MOLECULE ||
+            obj.type == IndigoObject::JSON_REACTION)
         {
             IndigoRdfData& data = (IndigoRdfData&)obj;
 
@@ -625,6 +651,13 @@ CEXPORT int indigoAt(int item, int index)
                 return 0;
             return self.addObject(newobj);
         }
+        else if (obj.type == IndigoObject::CMF_LOADER)
+        {
+            IndigoObject* newobj = ((IndigoCmfLoader&)obj).at(index);
+            if (newobj == 0)
+                return 0;
+            return self.addObject(newobj);
+        }
         else if (IndigoArray::is(obj))
         {
             IndigoArray& arr = IndigoArray::cast(obj);
@@ -647,14 +680,17 @@ CEXPORT int indigoCount(int item)
             return IndigoArray::cast(obj).objects.size();
 
         if (obj.type == IndigoObject::SDF_LOADER)
-            return ((IndigoSdfLoader&)obj).sdf_loader->count();
+            return ((IndigoSdfLoader&)obj).count();
 
         if (obj.type == IndigoObject::RDF_LOADER)
-            return ((IndigoRdfLoader&)obj).rdf_loader->count();
+            return ((IndigoRdfLoader&)obj).count();
 
         if (obj.type == IndigoObject::MULTILINE_SMILES_LOADER)
             return ((IndigoMultilineSmilesLoader&)obj).count();
 
+        if (obj.type == IndigoObject::CMF_LOADER)
+            return ((IndigoCmfLoader&)obj).count();
+
         throw IndigoError("indigoCount(): can not handle %s", obj.debugInfo());
     }
     INDIGO_END(-1);
@@ -668,27 +704,7 @@ CEXPORT int indigoSerialize(int item, byte** buf, int* size)
         auto& tmp = self.getThreadTmpData();
         ArrayOutput out(tmp.string);
 
-        if (IndigoBaseMolecule::is(obj))
-        {
-            Molecule& mol = obj.getMolecule();
-
-            IcmSaver saver(out);
-            saver.save_xyz = mol.have_xyz;
-            saver.save_bond_dirs = true;
-            saver.save_highlighting = true;
-            saver.save_ordering = self.preserve_ordering_in_serialize;
-            saver.saveMolecule(mol);
-        }
-        else if (IndigoBaseReaction::is(obj))
-        {
-            Reaction& rxn = obj.getReaction();
-            IcrSaver saver(out);
-            saver.save_xyz = BaseReaction::haveCoord(rxn);
-            saver.save_bond_dirs = true;
-            saver.save_highlighting = true;
-            saver.save_ordering = self.preserve_ordering_in_serialize;
-            saver.saveReaction(rxn);
-        }
+        IndigoCmfSaver::serialize(obj, out);
 
         *buf = (byte*)tmp.string.ptr();
         *size = tmp.string.size();
@@ -69,6 +69,7 @@ bool IndigoBaseMolecule::is(const IndigoObject& object)
     case CML_MOLECULE:
     case JSON_MOLECULE:
     case CDX_MOLECULE:
+    case CMF_MOLECULE:
     case SUBMOLECULE:
         return true;
 
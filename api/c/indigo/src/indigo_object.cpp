@@ -121,6 +121,12 @@ IndigoObjectTypes::IndigoObjectTypes()
     emplace(IndigoObject::GROSS_REACTION, "<GrossReaction>");
     emplace(IndigoObject::JSON_MOLECULE, "<JsonMolecule>");
     emplace(IndigoObject::JSON_REACTION, "<JsonReaction>");
+    emplace(IndigoObject::QUERY_SET, "<QuerySet>");
+    emplace(IndigoObject::PARALLEL_LOADER, "<ParallelLoader>");
+    emplace(IndigoObject::MULTIPLE_KET_LOADER, "<MultipleKETLoader>");
+    emplace(IndigoObject::CMF_MOLECULE, "<CMFMolecule>");
+    emplace(IndigoObject::CMF_REACTION, "<CMFReaction>");
+    emplace(IndigoObject::CMF_LOADER, "<CMFLoader>");
 
     if (size() != IndigoObject::INDIGO_OBJECT_LAST_TYPE - 1)
     {
@@ -297,6 +297,13 @@ void IndigoOptionHandlerSetter::setBasicOptionHandlers(const qword id)
     mgr->setOptionHandlerInt("aam-timeout", SETTER_GETTER_INT_OPTION(indigo.aam_cancellation_timeout));
     mgr->setOptionHandlerInt("timeout", SETTER_GETTER_INT_OPTION(indigo.cancellation_timeout));
 
+    mgr->setOptionHandlerInt("iterate-file-threads", SETTER_GETTER_INT_OPTION(indigo.iterate_file_threads));
+    mgr->setOptionHandlerBool("iterate-file-ordered", SETTER_GETTER_BOOL_OPTION(indigo.iterate_file_ordered));
+    mgr->setOptionHandlerBool("iterate-file-index", SETTER_GETTER_BOOL_OPTION(indigo.iterate_file_index));
+
+    mgr->setOptionHandlerString("cmf-container-fingerprint", SETTER_GETTER_STR_OPTION(indigo.cmf_container_fingerprint));
+    mgr->setOptionHandlerBool("cmf-container-hash", SETTER_GETTER_BOOL_OPTION(indigo.cmf_container_hash));
+
     mgr->setOptionHandlerBool("serialize-preserve-ordering", SETTER_GETTER_BOOL_OPTION(indigo.preserve_ordering_in_serialize));
 
     mgr->setOptionHandlerString("aromaticity-model", indigoSetAromaticityModel, indigoGetAromaticityModel);
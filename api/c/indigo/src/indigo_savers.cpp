@@ -18,25 +18,39 @@
 
 #include "indigo_savers.h"
 
+#include <algorithm>
+#include <cstring>
 #include <ctime>
+#include <new>
 
 #include "base_cpp/output.h"
 #include "base_cpp/scanner.h"
 #include "molecule/canonical_smiles_saver.h"
 #include "molecule/cml_saver.h"
+#include "molecule/crippen.h"
+#include "molecule/icm_saver.h"
 #include "molecule/molecule_cdxml_saver.h"
+#include "molecule/molecule_gross_formula.h"
+#include "molecule/molecule_hash.h"
 #include "molecule/molecule_json_saver.h"
+#include "molecule/molecule_mass.h"
 #include "molecule/molfile_loader.h"
 #include "molecule/molfile_saver.h"
 #include "molecule/smiles_saver.h"
+#include "molecule/tpsa.h"
 #include "reaction/canonical_rsmiles_saver.h"
+#include "reaction/icr_saver.h"
 #include "reaction/reaction_cdxml_saver.h"
 #include "reaction/reaction_cml_saver.h"
+#include "reaction/reaction_gross_formula.h"
+#include "reaction/reaction_hash.h"
 #include "reaction/reaction_json_saver.h"
 #include "reaction/rsmiles_saver.h"
 #include "reaction/rxnfile_saver.h"
 #include <memory>
 
+#include "indigo_array.h"
+#include "indigo_fingerprints.h"
 #include "indigo_io.h"
 #include "indigo_molecule.h"
 #include "indigo_reaction.h"
@@ -86,8 +100,10 @@ IndigoSaver* IndigoSaver::create(Output& output, const char* type)
         saver = std::make_unique<IndigoCmlSaver>(output);
     else if (strcasecmp(type, "rdf") == 0)
         saver = std::make_unique<IndigoRdfSaver>(output);
+    else if (strcasecmp(type, "cmf") == 0)
+        saver = std::make_unique<IndigoCmfSaver>(output);
     else
-        throw IndigoError("unsupported saver type: '%s'. Supported formats are sdf, smiles, cml, rdf", type);
+        throw IndigoError("unsupported saver type: '%s'. Supported formats are sdf, smiles, cml, rdf, cmf", type);
 
     saver->_appendHeader();
     return saver.release();
@@ -281,6 +297,12 @@ void IndigoCanonicalSmilesSaver::generateSmiles(IndigoObject& obj, Array<char>&
 {
     ArrayOutput output(out_buffer);
 
+    generateSmiles(obj, output);
+    out_buffer.push(0);
+}
+
+void IndigoCanonicalSmilesSaver::generateSmiles(IndigoObject& obj, Output& output)
+{
     if (IndigoBaseMolecule::is(obj))
     {
         BaseMolecule& mol = obj.getBaseMolecule();
@@ -305,7 +327,6 @@ void IndigoCanonicalSmilesSaver::generateSmiles(IndigoObject& obj, Array<char>&
     }
     else
         throw IndigoError("%s can not be converted to SMILES", obj.debugInfo());
-    out_buffer.push(0);
 }
 
 void IndigoCanonicalSmilesSaver::generateSmarts(IndigoObject& obj, Array<char>& out_buffer)
@@ -346,6 +367,414 @@ const char* IndigoCanonicalSmilesSaver::debugInfo() const
     return "<smiles saver>";
 }
 
+//
+// IndigoWorkerPool
+//
+
+IndigoWorkerPool::IndigoWorkerPool(int nthreads) : _task(0), _timeout(0), _generation(0), _running(0), _terminate(false)
+{
+    // More workers than cores would only compete for them
+    int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    if (nthreads <= 0 || nthreads > cores)
+        nthreads = cores;
+    _slices.resize(nthreads);
+
+    qword session_id = TL_GET_SESSION_ID();
+    try
+    {
+        for (int i = 0; i < nthreads; i++)
+            _threads.emplace_back(&IndigoWorkerPool::_workerFunc, this, i, session_id);
+    }
+    catch (...)
+    {
+        _stop();
+        throw;
+    }
+}
+
+IndigoWorkerPool::~IndigoWorkerPool()
+{
+    _stop();
+}
+
+int IndigoWorkerPool::size() const
+{
+    return (int)_slices.size();
+}
+
+void IndigoWorkerPool::_stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _terminate = true;
+    }
+    _start_cond.notify_all();
+    for (auto& thread : _threads)
+        thread.join();
+    _threads.clear();
+}
+
+void IndigoWorkerPool::_workerFunc(int index, qword session_id)
+{
+    TL_SET_SESSION_ID(session_id);
+
+    int generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _start_cond.wait(guard, [this, generation]() { return _terminate || _generation != generation; });
+            if (_terminate)
+                return;
+            generation = _generation;
+        }
+
+        if (_timeout != 0)
+        {
+            TimeoutCancellationHandler* timeout = new TimeoutCancellationHandler(0);
+            timeout->reset(*_timeout);
+            resetCancellationHandler(timeout);
+        }
+        else
+        {
+            resetCancellationHandler(nullptr);
+        }
+
+        try
+        {
+            (*_task)(index, _slices[index].first, _slices[index].second);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            if (!_error)
+                _error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _running--;
+        }
+        _done_cond.notify_one();
+    }
+}
+
+void IndigoWorkerPool::run(int count, const Task& task)
+{
+    int nworkers = size();
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        for (int i = 0; i < nworkers; i++)
+        {
+            _slices[i].first = (int)((long long)count * i / nworkers);
+            _slices[i].second = (int)((long long)count * (i + 1) / nworkers);
+        }
+        _task = &task;
+        _timeout = dynamic_cast<TimeoutCancellationHandler*>(getCancellationHandler());
+        _running = nworkers;
+        _generation++;
+    }
+    _start_cond.notify_all();
+
+    std::unique_lock<std::mutex> guard(_lock);
+    _done_cond.wait(guard, [this]() { return _running == 0; });
+    _task = 0;
+    _timeout = 0;
+
+    if (_error)
+    {
+        std::exception_ptr error = _error;
+        _error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+// Called from a catch block of a worker task. Errors of a single item are
+// swallowed; running out of memory or time is rethrown to stop the whole run.
+static void _rethrowIfNotItemError()
+{
+    try
+    {
+        throw;
+    }
+    catch (std::bad_alloc&)
+    {
+        throw;
+    }
+    catch (...)
+    {
+        CancellationHandler* cancellation = getCancellationHandler();
+        if (cancellation != nullptr && cancellation->isCancelled())
+            throw;
+    }
+}
+
+// Takes up to "count" next items of "source" into "block"
+static void _takeItems(IndigoObject& source, int count, std::vector<std::unique_ptr<IndigoObject>>& block)
+{
+    block.clear();
+    while ((int)block.size() < count)
+    {
+        std::unique_ptr<IndigoObject> item(source.next());
+        if (!item)
+            break;
+        block.push_back(std::move(item));
+    }
+}
+
+//
+// IndigoCanonicalSmilesBatch
+//
+
+IndigoCanonicalSmilesBatch::IndigoCanonicalSmilesBatch(int nthreads) : _pool(nthreads)
+{
+    for (int i = 0; i < _pool.size(); i++)
+        _buffers.push();
+}
+
+void IndigoCanonicalSmilesBatch::generate(IndigoObject& iterator, Output& output)
+{
+    // Enough items per worker to make the block handoff negligible
+    int block_size = _pool.size() * 256;
+
+    IndigoWorkerPool::Task task = [this](int worker, int begin, int end) {
+        Array<char>& buffer = _buffers[worker];
+        ArrayOutput worker_output(buffer);
+
+        for (int i = begin; i < end; i++)
+        {
+            int mark = buffer.size();
+            try
+            {
+                IndigoCanonicalSmilesSaver::generateSmiles(*_block[i], worker_output);
+            }
+            catch (...)
+            {
+                _rethrowIfNotItemError();
+                // Drop whatever was written before the error and leave the line empty
+                buffer.resize(mark);
+            }
+            worker_output.writeChar('\n');
+        }
+    };
+
+    while (true)
+    {
+        _takeItems(iterator, block_size, _block);
+        if (_block.empty())
+            break;
+
+        _pool.run((int)_block.size(), task);
+        for (int i = 0; i < _buffers.size(); i++)
+            output.write(_buffers[i].ptr(), _buffers[i].size());
+        output.flush();
+    }
+}
+
+//
+// IndigoArrowSaver
+//
+
+IndigoArrowSaver::IndigoArrowSaver(Output& output, const char* columns, int nthreads) : _writer(output), _pool(nthreads)
+{
+    _parseColumns(columns);
+
+    for (int i = 0; i < _pool.size(); i++)
+    {
+        ObjArray<ArrowColumn>& worker_columns = _worker_columns.push();
+        for (int j = 0; j < _columns.size(); j++)
+            worker_columns.push().init(_columns[j].type);
+        _buffers.push();
+    }
+    for (int j = 0; j < _columns.size(); j++)
+        _batch.push().init(_columns[j].type);
+}
+
+void IndigoArrowSaver::_parseColumns(const char* columns)
+{
+    static const struct
+    {
+        const char* name;
+        int kind;
+        int type;
+    } kinds[] = {{"smiles", SMILES, ArrowColumn::UTF8},      {"molfile", MOLFILE, ArrowColumn::UTF8},     {"cmf", CMF, ArrowColumn::BINARY},
+                 {"name", NAME, ArrowColumn::UTF8},          {"formula", FORMULA, ArrowColumn::UTF8},     {"mw", MW, ArrowColumn::FLOAT64},
+                 {"tpsa", TPSA_VALUE, ArrowColumn::FLOAT64}, {"logp", LOGP, ArrowColumn::FLOAT64},        {"fingerprint", FINGERPRINT, ArrowColumn::BINARY},
+                 {"property", PROPERTY, ArrowColumn::UTF8}};
+
+    BufferScanner scanner(columns);
+    Array<char> token;
+
+    while (!scanner.isEOF())
+    {
+        token.clear();
+        scanner.skipSpace();
+        while (!scanner.isEOF() && scanner.lookNext() != ',')
+            token.push(scanner.readChar());
+        if (!scanner.isEOF())
+            scanner.skip(1);
+        while (token.size() > 0 && isspace(token.top()))
+            token.pop();
+        if (token.size() == 0)
+            continue;
+        token.push(0);
+
+        const char* name = token.ptr();
+        const char* arg = strchr(name, ':');
+        int name_length = arg != 0 ? (int)(arg - name) : (int)strlen(name);
+        Column& column = _columns.push();
+
+        column.kind = -1;
+        for (auto& kind : kinds)
+        {
+            if ((int)strlen(kind.name) == name_length && strncmp(kind.name, name, name_length) == 0)
+            {
+                column.kind = kind.kind;
+                column.type = kind.type;
+            }
+        }
+        if (column.kind == -1)
+            throw IndigoError("unknown Arrow column '%s'", name);
+
+        if (arg != 0)
+            column.arg.readString(arg + 1, true);
+        else if (column.kind == PROPERTY)
+            throw IndigoError("Arrow column 'property' needs a property name, like 'property:name'");
+        else
+            column.arg.readString("", true);
+
+        // SDF property columns are named after the property, the others after their description
+        _writer.addField(column.kind == PROPERTY ? column.arg.ptr() : name, column.type);
+    }
+
+    if (_columns.size() == 0)
+        throw IndigoError("no Arrow columns given");
+}
+
+void IndigoArrowSaver::_computeCell(IndigoObject& obj, const Column& column, Array<char>& buf, ArrowColumn& cell)
+{
+    Indigo& self = indigoGetInstance();
+    ArrayOutput output(buf);
+
+    switch (column.kind)
+    {
+    case SMILES:
+        IndigoCanonicalSmilesSaver::generateSmiles(obj, output);
+        break;
+    case MOLFILE:
+        IndigoSdfSaver::appendMolfile(output, obj);
+        break;
+    case CMF:
+        IndigoCmfSaver::serialize(obj, output);
+        break;
+    case NAME:
+        output.writeString(obj.getName());
+        break;
+    case FORMULA:
+        if (IndigoBaseReaction::is(obj))
+        {
+            auto gross = ReactionGrossFormula::collect(obj.getBaseReaction(), self.gross_formula_options.add_isotopes);
+            ReactionGrossFormula::toString_Hill(*gross, buf, self.gross_formula_options.add_rsites);
+        }
+        else
+        {
+            auto gross = MoleculeGrossFormula::collect(obj.getBaseMolecule(), self.gross_formula_options.add_isotopes);
+            MoleculeGrossFormula::toString_Hill(*gross, buf, self.gross_formula_options.add_rsites);
+        }
+        // Without the terminating zero
+        buf.pop();
+        break;
+    case MW: {
+        MoleculeMass mass;
+        mass.mass_options = self.mass_options;
+        cell.appendDouble(mass.molecularWeight(obj.getMolecule()));
+        return;
+    }
+    case TPSA_VALUE:
+        cell.appendDouble(TPSA::calculate(obj.getMolecule()));
+        return;
+    case LOGP:
+        cell.appendDouble(Crippen::logP(obj.getMolecule()));
+        return;
+    case FINGERPRINT: {
+        Array<byte> fingerprint;
+        _indigoGetFingerprint(obj, column.arg.ptr(), fingerprint);
+        buf.copy((const char*)fingerprint.ptr(), fingerprint.size());
+        break;
+    }
+    case PROPERTY: {
+        auto& props = obj.getProperties();
+        if (!props.contains(column.arg.ptr()))
+        {
+            cell.appendNull();
+            return;
+        }
+        output.writeString(props.at(column.arg.ptr()));
+        break;
+    }
+    }
+
+    cell.appendBytes(buf.ptr(), buf.size());
+}
+
+void IndigoArrowSaver::save(IndigoObject& items)
+{
+    std::unique_ptr<IndigoArrayIter> array_iter;
+    if (IndigoArray::is(items))
+        array_iter = std::make_unique<IndigoArrayIter>(IndigoArray::cast(items));
+    IndigoObject& source = array_iter ? *array_iter : items;
+
+    // One record batch per block
+    int block_size = std::max(4096, _pool.size() * 256);
+
+    IndigoWorkerPool::Task task = [this](int worker, int begin, int end) {
+        ObjArray<ArrowColumn>& columns = _worker_columns[worker];
+        Array<char>& buf = _buffers[worker];
+
+        for (int j = 0; j < columns.size(); j++)
+            columns[j].clear();
+
+        for (int i = begin; i < end; i++)
+        {
+            for (int j = 0; j < _columns.size(); j++)
+            {
+                int rows = columns[j].valid.size();
+                try
+                {
+                    _computeCell(*_block[i], _columns[j], buf, columns[j]);
+                }
+                catch (...)
+                {
+                    _rethrowIfNotItemError();
+                    if (columns[j].valid.size() == rows)
+                        columns[j].appendNull();
+                }
+            }
+        }
+    };
+
+    while (true)
+    {
+        _takeItems(source, block_size, _block);
+        if (_block.empty())
+            break;
+
+        _pool.run((int)_block.size(), task);
+
+        for (int j = 0; j < _batch.size(); j++)
+        {
+            _batch[j].clear();
+            for (int i = 0; i < _worker_columns.size(); i++)
+                _batch[j].append(_worker_columns[i][j]);
+        }
+        _writer.writeBatch(_batch);
+    }
+
+    _writer.close();
+}
+
 //
 // IndigoCMLSaver
 //
@@ -529,6 +958,146 @@ CEXPORT int indigoRdfAppend(int output, int item)
     INDIGO_END(-1);
 }
 
+//
+// IndigoCmfSaver
+//
+
+// The fingerprint slot of a record fits both molecule and reaction fingerprints
+static int _cmfFingerprintSize()
+{
+    Indigo& self = indigoGetInstance();
+    return std::max(self.fp_params.fingerprintSize(), self.fp_params.fingerprintSizeExtOrdSim() * 2);
+}
+
+IndigoCmfSaver::IndigoCmfSaver(Output& output) : IndigoSaver(output), _writer(output)
+{
+    Indigo& self = indigoGetInstance();
+
+    if (self.cmf_container_fingerprint.size() > 0 && self.cmf_container_fingerprint[0] != 0)
+        _fingerprint_type.readString(self.cmf_container_fingerprint.ptr(), true);
+    _hashes = self.cmf_container_hash;
+}
+
+IndigoCmfSaver::IndigoCmfSaver(Output& output, const CmfContainerReader& reader) : IndigoSaver(output), _writer(output)
+{
+    _hashes = (reader.flags() & CmfContainerWriter::HASHES) != 0;
+
+    if (reader.flags() & CmfContainerWriter::FINGERPRINTS)
+    {
+        // The metadata starts with the fingerprint type
+        const char* metadata = reader.metadata();
+        const char* end = strchr(metadata, ' ');
+
+        _fingerprint_type.copy(metadata, end != 0 ? (int)(end - metadata) : (int)strlen(metadata));
+        _fingerprint_type.push(0);
+
+        Array<char> current;
+        _indigoGetFingerprintMetadata(_fingerprint_type.ptr(), current);
+        if (strcmp(current.ptr(), metadata) != 0 || reader.fingerprintSize() != _cmfFingerprintSize())
+            throw IndigoError("CMF container fingerprints (%s) were made with other fingerprint options", metadata);
+    }
+
+    _writer.beginAppend(reader);
+}
+
+IndigoCmfSaver::~IndigoCmfSaver()
+{
+    // The container table is written on close. IndigoSaver can not do it, as it is destroyed after this class.
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+const char* IndigoCmfSaver::debugInfo() const
+{
+    return "<cmf saver>";
+}
+
+void IndigoCmfSaver::serialize(IndigoObject& obj, Output& output)
+{
+    Indigo& self = indigoGetInstance();
+
+    if (IndigoBaseMolecule::is(obj))
+    {
+        Molecule& mol = obj.getMolecule();
+
+        IcmSaver saver(output);
+        saver.save_xyz = mol.have_xyz;
+        saver.save_bond_dirs = true;
+        saver.save_highlighting = true;
+        saver.save_ordering = self.preserve_ordering_in_serialize;
+        saver.saveMolecule(mol);
+    }
+    else if (IndigoBaseReaction::is(obj))
+    {
+        Reaction& rxn = obj.getReaction();
+        IcrSaver saver(output);
+        saver.save_xyz = BaseReaction::haveCoord(rxn);
+        saver.save_bond_dirs = true;
+        saver.save_highlighting = true;
+        saver.save_ordering = self.preserve_ordering_in_serialize;
+        saver.saveReaction(rxn);
+    }
+    else
+        throw IndigoError("%s can not be serialized", obj.debugInfo());
+}
+
+void IndigoCmfSaver::_appendHeader()
+{
+    int flags = 0;
+    int fingerprint_size = 0;
+    Array<char> metadata;
+
+    if (_fingerprint_type.size() > 0)
+    {
+        flags |= CmfContainerWriter::FINGERPRINTS;
+        fingerprint_size = _cmfFingerprintSize();
+        _indigoGetFingerprintMetadata(_fingerprint_type.ptr(), metadata);
+    }
+    if (_hashes)
+        flags |= CmfContainerWriter::HASHES;
+
+    _writer.begin(flags, fingerprint_size, metadata.size() > 0 ? metadata.ptr() : 0);
+}
+
+void IndigoCmfSaver::_append(IndigoObject& object)
+{
+    _data.clear();
+    ArrayOutput output(_data);
+    serialize(object, output);
+
+    const byte* fingerprint = 0;
+    if (_fingerprint_type.size() > 0)
+    {
+        _indigoGetFingerprint(object, _fingerprint_type.ptr(), _fingerprint);
+
+        int size = _fingerprint.size();
+        _fingerprint.resize(_cmfFingerprintSize());
+        memset(_fingerprint.ptr() + size, 0, _fingerprint.size() - size);
+        fingerprint = _fingerprint.ptr();
+    }
+
+    qword hash = 0;
+    if (_hashes)
+    {
+        if (IndigoBaseReaction::is(object))
+            hash = ReactionHash::calculate(object.getReaction());
+        else
+            hash = MoleculeHash::calculate(object.getMolecule());
+    }
+
+    _writer.append(_data.ptr(), _data.size(), object.getName(), &object.getProperties(), fingerprint, hash);
+}
+
+void IndigoCmfSaver::_appendFooter()
+{
+    _writer.close();
+}
+
 //
 // Saving functions
 //
@@ -554,6 +1123,56 @@ CEXPORT int indigoCreateFileSaver(const char* filename, const char* format)
     INDIGO_END(-1);
 }
 
+CEXPORT int indigoCreateFileAppender(const char* filename, const char* format)
+{
+    INDIGO_BEGIN
+    {
+        if (strcasecmp(format, "cmf") != 0)
+            throw IndigoError("indigoCreateFileAppender(): unsupported format '%s'. Only cmf files can be appended to", format);
+
+        long long size, mtime;
+        if (!getFileInfo(self.filename_encoding, filename, size, mtime) || size == 0)
+            return indigoCreateFileSaver(filename, format);
+
+        // The reader is only needed to take over the container settings
+        std::unique_ptr<CmfContainerReader> reader;
+        std::unique_ptr<FileScanner> scanner = std::make_unique<FileScanner>(self.filename_encoding, filename);
+        reader = std::make_unique<CmfContainerReader>(*scanner);
+
+        std::unique_ptr<FileOutput> output = std::make_unique<FileOutput>(true, "%s", filename);
+        std::unique_ptr<IndigoSaver> saver = std::make_unique<IndigoCmfSaver>(*output, *reader);
+        saver->acquireOutput(output.release());
+        return self.addObject(saver.release());
+    }
+    INDIGO_END(-1);
+}
+
+CEXPORT int indigoSaveCanonicalSmilesBatch(int iterator, int output, int nthreads)
+{
+    INDIGO_BEGIN
+    {
+        IndigoObject& obj = self.getObject(iterator);
+        Output& out = IndigoOutput::get(self.getObject(output));
+        IndigoCanonicalSmilesBatch batch(nthreads);
+        batch.generate(obj, out);
+        return 1;
+    }
+    INDIGO_END(-1);
+}
+
+CEXPORT int indigoSaveArrow(int items, int output, const char* columns, int nthreads)
+{
+    INDIGO_BEGIN
+    {
+        IndigoObject& obj = self.getObject(items);
+        Output& out = IndigoOutput::get(self.getObject(output));
+        IndigoArrowSaver saver(out, columns, nthreads);
+        saver.save(obj);
+        return 1;
+    }
+    INDIGO_END(-1);
+}
+
 CEXPORT int indigoSaveMolfile(int molecule, int output)
 {
     INDIGO_BEGIN
@@ -26,6 +26,17 @@
 
 #include "indigo_internal.h"
 
+#include "base_cpp/arrow_ipc_writer.h"
+#include "molecule/cmf_container.h"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 class DLLEXPORT IndigoSaver : public IndigoObject
 {
 public:
@@ -74,6 +85,7 @@ public:
     const char* debugInfo() const override;
 
     static void generateSmiles(IndigoObject& obj, Array<char>& out_buffer);
+    static void generateSmiles(IndigoObject& obj, Output& output);
 
     static void generateSmarts(IndigoObject& obj, Array<char>& out_buffer);
 
@@ -92,12 +104,119 @@ public:
     const char* debugInfo() const override;
 
     static void generateSmiles(IndigoObject& obj, Array<char>& out_buffer);
+    static void generateSmiles(IndigoObject& obj, Output& output);
 
     static void generateSmarts(IndigoObject& obj, Array<char>& out_buffer);
 
 protected:
 };
 
+// Worker threads that live as long as the pool and run in the caller's session,
+// so thread-local pools are reused from one run to the next. run() splits
+// [0, count) into one contiguous slice per worker and waits for all of them.
+//
+// The caller is blocked in run() while the task runs, so the task may read the
+// session options and the objects the caller has handed to it. It must not
+// change the options, add or free session objects, or use the session's
+// thread temporary data, which belong to the calling thread.
+//
+// If the caller has a timeout, every worker gets a timeout handler with the
+// same deadline for the run. Other cancellation handlers are not passed on.
+// The first exception a task lets out is rethrown by run() once all the
+// workers have finished.
+class DLLEXPORT IndigoWorkerPool
+{
+public:
+    typedef std::function<void(int worker, int begin, int end)> Task;
+
+    // All cores are used if nthreads <= 0; no more workers than cores are started
+    explicit IndigoWorkerPool(int nthreads);
+    ~IndigoWorkerPool();
+
+    int size() const;
+    void run(int count, const Task& task);
+
+protected:
+    void _workerFunc(int index, qword session_id);
+    void _stop();
+
+    std::vector<std::pair<int, int>> _slices;
+    std::vector<std::thread> _threads;
+    const Task* _task;
+    const TimeoutCancellationHandler* _timeout;
+    std::exception_ptr _error;
+
+    std::mutex _lock;
+    std::condition_variable _start_cond, _done_cond;
+    int _generation;
+    int _running;
+    bool _terminate;
+};
+
+// Writes canonical SMILES of the iterator items, one line per item, in input order.
+// Items are taken in blocks and each block is split between the workers, which
+// keep their output buffers from block to block. Every block is written and
+// flushed as soon as it is done. An item that can not be loaded or saved gives
+// an empty line; running out of memory or time stops the whole batch.
+class IndigoCanonicalSmilesBatch
+{
+public:
+    explicit IndigoCanonicalSmilesBatch(int nthreads);
+
+    void generate(IndigoObject& iterator, Output& output);
+
+protected:
+    IndigoWorkerPool _pool;
+    ObjArray<Array<char>> _buffers;
+    std::vector<std::unique_ptr<IndigoObject>> _block;
+};
+
+// Writes the items of an iterator or an array into an Arrow IPC file, one row
+// per item and one record batch per block of items. The columns of a block are
+// computed by the workers, each for its own rows. A cell that can not be
+// computed is null; running out of memory or time fails the whole save.
+class IndigoArrowSaver
+{
+public:
+    // columns: comma-separated, see indigoSaveArrow()
+    IndigoArrowSaver(Output& output, const char* columns, int nthreads);
+
+    void save(IndigoObject& items);
+
+protected:
+    enum
+    {
+        SMILES,
+        MOLFILE,
+        CMF,
+        NAME,
+        FORMULA,
+        MW,
+        TPSA_VALUE,
+        LOGP,
+        FINGERPRINT,
+        PROPERTY
+    };
+
+    struct Column
+    {
+        int kind;
+        int type;
+        Array<char> arg; // fingerprint type or property name
+    };
+
+    void _parseColumns(const char* columns);
+    void _computeCell(IndigoObject& obj, const Column& column, Array<char>& buf, ArrowColumn& cell);
+
+    ArrowIpcWriter _writer;
+    ObjArray<Column> _columns;
+    IndigoWorkerPool _pool;
+    ObjArray<ObjArray<ArrowColumn>> _worker_columns;
+    ObjArray<Array<char>> _buffers;
+    ObjArray<ArrowColumn> _batch;
+    std::vector<std::unique_ptr<IndigoObject>> _block;
+};
+
 class IndigoCmlSaver : public IndigoSaver
 {
 public:
@@ -131,6 +250,34 @@ protected:
     void _appendHeader() override;
 };
 
+// Writes a CMF container, see indigoIterateCmfFile(). New containers keep
+// the fingerprints and hashes the "cmf-container-*" options ask for; records
+// appended to an existing container get what it already has.
+class IndigoCmfSaver : public IndigoSaver
+{
+public:
+    IndigoCmfSaver(Output& output);
+    // Appends to the container read by "reader". "output" writes at the end of its file.
+    IndigoCmfSaver(Output& output, const CmfContainerReader& reader);
+    ~IndigoCmfSaver();
+
+    const char* debugInfo() const override;
+
+    // The bytes indigoSerialize() gives
+    static void serialize(IndigoObject& object, Output& output);
+
+protected:
+    void _append(IndigoObject& object) override;
+    void _appendHeader() override;
+    void _appendFooter() override;
+
+    CmfContainerWriter _writer;
+    Array<char> _fingerprint_type; // empty if the container has no fingerprints
+    bool _hashes;
+    Array<char> _data;
+    Array<byte> _fingerprint;
+};
+
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
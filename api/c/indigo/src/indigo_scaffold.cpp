@@ -54,8 +54,10 @@ CEXPORT int indigoExtractCommonScaffold(int structures, const char* options)
 
         msd.basketStructures = &scaf->all_scaffolds;
 
-        bool approximate = false;
+        int mode = MoleculeScaffoldDetection::SEARCH_EXACT;
         int max_iterations = 0;
+        int time_limit = 0;
+        int threads = 0;
 
         if (options != 0)
         {
@@ -68,14 +70,27 @@ CEXPORT int indigoExtractCommonScaffold(int structures, const char* options)
                 scanner.readWord(word, 0);
 
                 if (strcasecmp(word.ptr(), "APPROX") == 0)
-                    approximate = true;
+                    mode = MoleculeScaffoldDetection::SEARCH_APPROXIMATE;
                 else if (strcasecmp(word.ptr(), "EXACT") == 0)
-                    approximate = false;
+                    mode = MoleculeScaffoldDetection::SEARCH_EXACT;
+                else if (strcasecmp(word.ptr(), "MCSPLIT") == 0)
+                    mode = MoleculeScaffoldDetection::SEARCH_MCSPLIT;
                 else
                     throw IndigoError("indigoExtractCommonScaffold: unknown option %s\n", word.ptr());
 
                 scanner.skipSpace();
-                if (!scanner.isEOF())
+                if (mode == MoleculeScaffoldDetection::SEARCH_MCSPLIT)
+                {
+                    // MCSPLIT [time_limit_ms [threads]]
+                    if (!scanner.isEOF())
+                    {
+                        time_limit = scanner.readInt();
+                        scanner.skipSpace();
+                    }
+                    if (!scanner.isEOF())
+                        threads = scanner.readInt();
+                }
+                else if (!scanner.isEOF())
                 {
                     max_iterations = scanner.readInt();
                 }
@@ -83,9 +98,15 @@ CEXPORT int indigoExtractCommonScaffold(int structures, const char* options)
         }
         if (max_iterations > 0)
             msd.maxIterations = max_iterations;
+        if (time_limit > 0)
+            msd.timeLimit = time_limit;
+        if (threads > 0)
+            msd.threadCount = threads;
 
-        if (approximate)
+        if (mode == MoleculeScaffoldDetection::SEARCH_APPROXIMATE)
             msd.extractApproximateScaffold(scaf->max_scaffold);
+        else if (mode == MoleculeScaffoldDetection::SEARCH_MCSPLIT)
+            msd.extractMcSplitScaffold(scaf->max_scaffold);
         else
             msd.extractExactScaffold(scaf->max_scaffold);
 
@@ -16,6 +16,13 @@
  * limitations under the License.
  ***************************************************************************/
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <molecule/molecule_mass.h>
@@ -23,6 +30,8 @@
 #include <indigo-renderer.h>
 #include <indigo.h>
 #include <indigo_internal.h>
+#include <indigo_loaders.h>
+#include <indigo_savers.h>
 
 #include "common.h"
 
@@ -293,3 +302,522 @@ TEST_F(IndigoApiBasicTest, submolecule_test_general)
         ASSERT_STREQ("", e.message());
     }
 }
+
+TEST_F(IndigoApiBasicTest, object_handles_recycling)
+{
+    int mol = indigoLoadMoleculeFromString("CCO");
+    ASSERT_EQ(1, indigoCountReferences());
+
+    int atoms = indigoIterateAtoms(mol);
+    int stale = -1;
+    while (indigoHasNext(atoms) > 0)
+    {
+        int atom = indigoNext(atoms);
+        ASSERT_NE(atom, stale);
+        indigoFree(atom);
+        stale = atom;
+    }
+    indigoFree(atoms);
+    ASSERT_EQ(1, indigoCountReferences());
+
+    // Freed handles must not resolve, even when their slot has been reused
+    ASSERT_THROW(indigoIndex(stale), Exception);
+    int other = indigoLoadMoleculeFromString("N");
+    ASSERT_NE(other, stale);
+    ASSERT_STREQ("N", indigoCanonicalSmiles(other));
+
+    indigoFreeAllObjects();
+    ASSERT_EQ(0, indigoCountReferences());
+    ASSERT_THROW(indigoCanonicalSmiles(mol), Exception);
+}
+
+TEST_F(IndigoApiBasicTest, object_handles_never_repeat)
+{
+    // The same slot is recycled far more often than the generation bits can count
+    const int first = indigoLoadMoleculeFromString("C");
+    std::vector<int> handles = {first};
+    indigoFree(first);
+    for (int i = 0; i < 1000; i++)
+    {
+        const int handle = indigoLoadMoleculeFromString("C");
+        ASSERT_GT(handle, 0);
+        ASSERT_EQ(handles.end(), std::find(handles.begin(), handles.end(), handle));
+        handles.push_back(handle);
+        indigoFree(handle);
+    }
+    ASSERT_THROW(indigoCountAtoms(first), Exception);
+    ASSERT_EQ(0, indigoCountReferences());
+}
+
+TEST_F(IndigoApiBasicTest, canonical_smiles_symmetric)
+{
+    // Canonical numbering of highly symmetric molecules must stay stable
+    const char* cases[][2] = {
+        {"c1cc2ccc3ccc4ccc5ccc6ccc1c7c2c3c4c5c67", "c1cc2ccc3ccc4ccc5ccc6ccc1c1c6c5c4c3c21"},
+        {"C1C2CC3CC1CC(C2)C3", "C1C2CC3CC1CC(C2)C3"},
+        {"C(CC(C)(C)C)(CC(C)(C)C)(CC(C)(C)C)CC(C)(C)C", "CC(C)(C)CC(CC(C)(C)C)(CC(C)(C)C)CC(C)(C)C"},
+        {"C(C(C(C)(C)C)(C(C)(C)C)C(C)(C)C)(C(C(C)(C)C)(C(C)(C)C)C(C)(C)C)C(C(C)(C)C)(C(C)(C)C)C(C)(C)C",
+         "CC(C)(C)C(C(C(C(C)(C)C)(C(C)(C)C)C(C)(C)C)C(C(C)(C)C)(C(C)(C)C)C(C)(C)C)(C(C)(C)C)C(C)(C)C"},
+    };
+
+    for (auto& item : cases)
+    {
+        int mol = indigoLoadMoleculeFromString(item[0]);
+        ASSERT_STREQ(item[1], indigoCanonicalSmiles(mol));
+        indigoFree(mol);
+    }
+}
+
+TEST_F(IndigoApiBasicTest, matcher_reuse)
+{
+    int mol = indigoLoadMoleculeFromString("OC1=CC=CC=C1");
+    int match = indigoSubstructureMatcher(mol, "");
+
+    // Aromatized and hydrogen-unfolded target copies are prepared once and
+    // then reused by every query run against the same matcher
+    for (int i = 0; i < 2; i++)
+    {
+        ASSERT_EQ(1, indigoCountMatches(match, indigoLoadQueryMoleculeFromString("c1ccccc1")));
+        ASSERT_EQ(1, indigoCountMatches(match, indigoLoadSmartsFromString("[OH]c")));
+        ASSERT_EQ(6, indigoCountMatches(match, indigoLoadSmartsFromString("[#1]")));
+        ASSERT_EQ(0, indigoCountMatches(match, indigoLoadSmartsFromString("[#7]")));
+    }
+
+    indigoSetOption("aromaticity-model", "generic");
+    ASSERT_EQ(1, indigoCountMatches(match, indigoLoadQueryMoleculeFromString("c1ccccc1")));
+    indigoSetOption("aromaticity-model", "basic");
+
+    // The original target is left untouched
+    ASSERT_STREQ("OC1C=CC=CC=1", indigoSmiles(mol));
+}
+
+TEST_F(IndigoApiBasicTest, query_set)
+{
+    int queries = indigoCreateArray();
+    indigoArrayAdd(queries, indigoLoadSmartsFromString("C(=O)[OH]"));
+    indigoArrayAdd(queries, indigoLoadSmartsFromString("[N+](=O)[O-]"));
+    indigoArrayAdd(queries, indigoLoadQueryMoleculeFromString("c1ccccc1"));
+    int query_set = indigoCreateQuerySet(queries);
+    ASSERT_LT(0, query_set);
+
+    int count = -1;
+    const int* ids = indigoMatchQuerySet(query_set, indigoLoadMoleculeFromString("OC(=O)C1=CC=CC=C1"), &count);
+    ASSERT_EQ(2, count);
+    ASSERT_EQ(0, ids[0]);
+    ASSERT_EQ(2, ids[1]);
+    ASSERT_EQ(-1, ids[2]);
+
+    ids = indigoMatchQuerySet(query_set, indigoLoadMoleculeFromString("CCC"), &count);
+    ASSERT_EQ(0, count);
+    ASSERT_EQ(-1, ids[0]);
+}
+
+TEST_F(IndigoApiBasicTest, scaffold_mcsplit)
+{
+    const char* smiles[] = {"CC(C)CC1C(=O)NC(CC2=CC=CC=C2)C(=O)NC(CCCCN)C(=O)NC(CC(=O)O)C(=O)NC(CO)C(=O)NC(C(C)O)C(=O)N1",
+                            "CC(C)CC1C(=O)NC(CC2=CC=C(O)C=C2)C(=O)NC(CCCN)C(=O)NC(CC(=O)N)C(=O)NC(C)C(=O)NC(C(C)C)C(=O)N1"};
+    int structures = indigoCreateArray();
+    for (auto item : smiles)
+        indigoArrayAdd(structures, indigoLoadMoleculeFromString(item));
+
+    // Cyclic peptides are too slow for the default exact search
+    const char* options[] = {"MCSPLIT", "MCSPLIT 10000 2"};
+    for (auto item : options)
+    {
+        int scaffold = indigoExtractCommonScaffold(structures, item);
+        ASSERT_LT(0, scaffold);
+        ASSERT_EQ(44, indigoCountAtoms(scaffold));
+        ASSERT_EQ(45, indigoCountBonds(scaffold));
+        indigoFree(scaffold);
+    }
+
+    // An exhausted time budget still gives a common substructure
+    int scaffold = indigoExtractCommonScaffold(structures, "MCSPLIT 1");
+    ASSERT_LT(0, scaffold);
+    ASSERT_GE(44, indigoCountAtoms(scaffold));
+    indigoFree(scaffold);
+}
+
+TEST_F(IndigoApiBasicTest, parallel_file_iterator)
+{
+    const std::string sdf = dataPath("molecules/basic/thiazolidines.sdf");
+    const std::string smi = dataPath("molecules/basic/pubchem_slice_50.smi");
+
+    auto read = [](int iterator) {
+        std::vector<std::string> result;
+        int item;
+        while ((item = indigoNext(iterator)) > 0)
+        {
+            result.emplace_back(std::to_string(indigoIndex(item)) + " " + indigoCanonicalSmiles(item));
+            indigoFree(item);
+        }
+        indigoFree(iterator);
+        return result;
+    };
+
+    for (const bool is_sdf : {true, false})
+    {
+        auto iterate = [&]() { return is_sdf ? indigoIterateSDFile(sdf.c_str()) : indigoIterateSmilesFile(smi.c_str()); };
+
+        const std::vector<std::string> serial = read(iterate());
+        ASSERT_LT(0u, serial.size());
+
+        indigoSetOptionInt("iterate-file-threads", 3);
+        ASSERT_EQ(serial, read(iterate()));
+
+        indigoSetOptionBool("iterate-file-ordered", false);
+        std::vector<std::string> unordered = read(iterate());
+        std::vector<std::string> expected = serial;
+        std::sort(unordered.begin(), unordered.end());
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(expected, unordered);
+
+        indigoSetOptionInt("iterate-file-threads", 0);
+        indigoSetOptionBool("iterate-file-ordered", true);
+    }
+}
+
+TEST_F(IndigoApiBasicTest, file_record_index)
+{
+    const std::string path = ::testing::TempDir() + "record_index.sdf";
+    const std::string sidecar = path + ".idx";
+    {
+        std::ifstream src(dataPath("molecules/basic/thiazolidines.sdf"), std::ios::binary);
+        std::ofstream dst(path, std::ios::binary);
+        dst << src.rdbuf();
+    }
+    std::remove(sidecar.c_str());
+
+    auto smilesAt = [&](int index) {
+        int iterator = indigoIterateSDFile(path.c_str());
+        int item = indigoAt(iterator, index);
+        std::string result = indigoCanonicalSmiles(item);
+        indigoFree(item);
+        indigoFree(iterator);
+        return result;
+    };
+    const std::string expected = smilesAt(400);
+
+    // The first full pass writes the sidecar
+    indigoSetOptionBool("iterate-file-index", true);
+    int iterator = indigoIterateSDFile(path.c_str());
+    ASSERT_EQ(450, indigoCount(iterator));
+    indigoFree(iterator);
+    ASSERT_TRUE(std::ifstream(sidecar).good());
+
+    iterator = indigoIterateSDFile(path.c_str());
+    ASSERT_EQ(450, indigoCount(iterator));
+    indigoFree(iterator);
+    ASSERT_EQ(expected, smilesAt(400));
+
+    // A sidecar written for another version of the file is not used
+    {
+        std::ifstream src(dataPath("molecules/basic/thiazolidines.sdf"), std::ios::binary);
+        std::ofstream dst(path, std::ios::binary | std::ios::app);
+        dst << src.rdbuf();
+    }
+    iterator = indigoIterateSDFile(path.c_str());
+    ASSERT_EQ(900, indigoCount(iterator));
+    indigoFree(iterator);
+    ASSERT_EQ(expected, smilesAt(850));
+
+    indigoSetOptionBool("iterate-file-index", false);
+    std::remove(sidecar.c_str());
+    std::remove(path.c_str());
+}
+
+TEST_F(IndigoApiBasicTest, ket_iterator)
+{
+    int mol = indigoLoadMoleculeFromString("CCO");
+    int rxn = indigoLoadReactionFromString("CC>>CO");
+    indigoLayout(rxn);
+    const std::string mol_ket = indigoJson(mol);
+    const std::string rxn_ket = indigoJson(rxn);
+    const std::string mol_smiles = indigoCanonicalSmiles(mol);
+    const std::string rxn_smiles = indigoCanonicalSmiles(rxn);
+    indigoFree(mol);
+    indigoFree(rxn);
+
+    const std::string stream = mol_ket + "\n" + rxn_ket + "\n" + mol_ket + "\n";
+    int reader = indigoReadString(stream.c_str());
+    int iterator = indigoIterateKET(reader);
+
+    std::vector<std::string> smiles;
+    std::vector<long long> offsets;
+    while (indigoHasNext(iterator) > 0)
+    {
+        int item = indigoNext(iterator);
+        smiles.emplace_back(indigoCanonicalSmiles(item));
+        offsets.push_back(indigoTell64(item));
+        indigoFree(item);
+    }
+    indigoFree(iterator);
+    indigoFree(reader);
+
+    ASSERT_EQ(3, smiles.size());
+    ASSERT_EQ(mol_smiles, smiles[0]);
+    ASSERT_EQ(rxn_smiles, smiles[1]);
+    ASSERT_EQ(mol_smiles, smiles[2]);
+    ASSERT_EQ(0, offsets[0]);
+    ASSERT_EQ((long long)mol_ket.size() + 1, offsets[1]);
+
+    // A broken document stops the iteration with an error
+    const std::string broken = mol_ket + " {\"root\": ";
+    reader = indigoReadString(broken.c_str());
+    iterator = indigoIterateKET(reader);
+    indigoFree(indigoNext(iterator));
+    ASSERT_THROW(indigoNext(iterator), Exception);
+    indigoFree(iterator);
+    indigoFree(reader);
+}
+
+TEST_F(IndigoApiBasicTest, ket_trailing_text)
+{
+    int mol = indigoLoadMoleculeFromString("CCO");
+    int rxn = indigoLoadReactionFromString("CC>>CO");
+    const std::string mol_ket = indigoJson(mol);
+    const std::string rxn_ket = indigoJson(rxn);
+    indigoFree(mol);
+    indigoFree(rxn);
+
+    mol = indigoLoadMoleculeFromString((mol_ket + " \n\t").c_str());
+    ASSERT_EQ(3, indigoCountAtoms(mol));
+    indigoFree(mol);
+    ASSERT_THROW(indigoLoadMoleculeFromString((mol_ket + " x").c_str()), Exception);
+    ASSERT_THROW(indigoLoadMoleculeFromString((mol_ket + mol_ket).c_str()), Exception);
+
+    rxn = indigoLoadReactionFromString((rxn_ket + "\n").c_str());
+    ASSERT_EQ(2, indigoCountMolecules(rxn));
+    indigoFree(rxn);
+    ASSERT_THROW(indigoLoadReactionFromString((rxn_ket + "}").c_str()), Exception);
+}
+
+TEST_F(IndigoApiBasicTest, canonical_smiles_batch)
+{
+    const std::string smi = dataPath("molecules/basic/pubchem_slice_50.smi");
+
+    std::string serial;
+    int iterator = indigoIterateSmilesFile(smi.c_str());
+    int item;
+    while ((item = indigoNext(iterator)) > 0)
+    {
+        serial += indigoCanonicalSmiles(item);
+        serial += "\n";
+        indigoFree(item);
+    }
+    indigoFree(iterator);
+    ASSERT_LT(0u, serial.size());
+
+    for (const int nthreads : {1, 3})
+    {
+        iterator = indigoIterateSmilesFile(smi.c_str());
+        ASSERT_EQ(serial, std::string(indigoCanonicalSmilesBatch(iterator, nthreads)));
+        indigoFree(iterator);
+
+        iterator = indigoIterateSmilesFile(smi.c_str());
+        int buffer = indigoWriteBuffer();
+        ASSERT_EQ(1, indigoSaveCanonicalSmilesBatch(iterator, buffer, nthreads));
+        ASSERT_EQ(serial, std::string(indigoToString(buffer)));
+        indigoFree(buffer);
+        indigoFree(iterator);
+    }
+
+    // A broken item gives an empty line
+    int reader = indigoReadString("OCC\nC1CC\nc1ccccc1\n");
+    iterator = indigoIterateSmiles(reader);
+    ASSERT_STREQ("CCO\n\nc1ccccc1\n", indigoCanonicalSmilesBatch(iterator, 2));
+    indigoFree(iterator);
+    indigoFree(reader);
+}
+
+TEST_F(IndigoApiBasicTest, worker_pool_timeout)
+{
+    IndigoWorkerPool pool(2);
+    IndigoWorkerPool::Task task = [](int, int, int) {
+        CancellationHandler* cancellation = getCancellationHandler();
+        if (cancellation != nullptr && cancellation->isCancelled())
+            throw Exception("%s", cancellation->cancelledRequestMessage());
+    };
+
+    // Without a timeout the workers are not cancelled
+    pool.run(4, task);
+
+    // The workers get the caller's deadline, which has passed here
+    AutoCancellationHandler timeout(new TimeoutCancellationHandler(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    ASSERT_THROW(pool.run(4, task), Exception);
+
+    // A failed run leaves the pool usable
+    resetCancellationHandler(nullptr);
+    pool.run(4, task);
+}
+
+TEST_F(IndigoApiBasicTest, arrow_export)
+{
+    const std::string smi = dataPath("molecules/basic/pubchem_slice_50.smi");
+    const char* columns = "smiles, cmf, name, formula, mw, fingerprint:sim, property:missing";
+
+    std::string serial;
+    for (const int nthreads : {1, 3})
+    {
+        int iterator = indigoIterateSmilesFile(smi.c_str());
+        int buffer = indigoWriteBuffer();
+        ASSERT_EQ(1, indigoSaveArrow(iterator, buffer, columns, nthreads));
+
+        char* data;
+        int size;
+        indigoToBuffer(buffer, &data, &size);
+        const std::string file(data, size);
+        indigoFree(buffer);
+        indigoFree(iterator);
+
+        // Arrow IPC file magic at both ends
+        ASSERT_EQ(0u, file.find("ARROW1"));
+        ASSERT_EQ(file.size() - 6, file.rfind("ARROW1"));
+        ASSERT_NE(std::string::npos, file.find("fingerprint:sim"));
+
+        // The split between the workers does not change the file
+        if (serial.empty())
+            serial = file;
+        else
+            ASSERT_EQ(serial, file);
+    }
+
+    int reader = indigoReadString("OCC");
+    int iterator = indigoIterateSmiles(reader);
+    int buffer = indigoWriteBuffer();
+    ASSERT_THROW(indigoSaveArrow(iterator, buffer, "smiles,weight", 1), Exception);
+    ASSERT_THROW(indigoSaveArrow(iterator, buffer, "property", 1), Exception);
+    indigoFree(buffer);
+    indigoFree(iterator);
+    indigoFree(reader);
+}
+
+TEST_F(IndigoApiBasicTest, cmf_container)
+{
+    const std::string sdf = dataPath("molecules/basic/thiazolidines.sdf");
+    const std::string path = ::testing::TempDir() + "container.cmf";
+    std::remove(path.c_str());
+
+    auto describe = [](int item) {
+        std::string result = std::string(indigoName(item)) + " " + indigoCanonicalSmiles(item);
+        if (indigoHasProperty(item, "ID"))
+            result += std::string(" ") + indigoGetProperty(item, "ID");
+        return result;
+    };
+
+    auto append = [&](int from, int to) {
+        int saver = indigoCreateFileAppender(path.c_str(), "cmf");
+        int iterator = indigoIterateSDFile(sdf.c_str());
+        for (int i = from; i < to; i++)
+        {
+            int item = indigoAt(iterator, i);
+            indigoAppend(saver, item);
+            indigoFree(item);
+        }
+        indigoFree(iterator);
+        indigoClose(saver);
+        indigoFree(saver);
+    };
+
+    indigoSetOption("cmf-container-fingerprint", "sim");
+    indigoSetOptionBool("cmf-container-hash", true);
+    append(0, 300);
+    indigoSetOption("cmf-container-fingerprint", "");
+    indigoSetOptionBool("cmf-container-hash", false);
+    // The container keeps its own settings
+    append(300, 450);
+
+    std::vector<std::string> expected;
+    int iterator = indigoIterateSDFile(sdf.c_str());
+    int item;
+    while ((item = indigoNext(iterator)) > 0)
+    {
+        expected.push_back(describe(item));
+        indigoFree(item);
+    }
+    indigoFree(iterator);
+
+    auto read = [&]() {
+        std::vector<std::string> result;
+        int iterator = indigoIterateCmfFile(path.c_str());
+        int item;
+        while ((item = indigoNext(iterator)) > 0)
+        {
+            result.push_back(describe(item));
+            indigoFree(item);
+        }
+        indigoFree(iterator);
+        return result;
+    };
+    ASSERT_EQ(expected, read());
+
+    indigoSetOptionInt("iterate-file-threads", 3);
+    ASSERT_EQ(expected, read());
+    // Records are not decoded ahead, so their stored fingerprints stay usable
+    iterator = indigoIterateCmfFile(path.c_str());
+    item = indigoNext(iterator);
+    IndigoObject& record = indigoGetInstance().getObject(item);
+    ASSERT_EQ(IndigoObject::CMF_MOLECULE, record.type);
+    ASSERT_FALSE(static_cast<IndigoCmfData&>(record).isLoaded());
+    indigoFree(item);
+    indigoFree(iterator);
+    indigoSetOptionInt("iterate-file-threads", 0);
+
+    iterator = indigoIterateCmfFile(path.c_str());
+    ASSERT_EQ(450, indigoCount(iterator));
+    item = indigoAt(iterator, 400);
+    ASSERT_EQ(expected[400], describe(item));
+    indigoFree(item);
+
+    // Stored fingerprints and hashes are the ones computed from the structure
+    item = indigoAt(iterator, 100);
+    int stored = indigoFingerprint(item, "sim");
+    int64_t stored_hash = indigoHash(item);
+    int clone = indigoClone(item);
+    int computed = indigoFingerprint(clone, "sim");
+    ASSERT_STREQ(std::string(indigoToString(stored)).c_str(), indigoToString(computed));
+    ASSERT_EQ(indigoHash(clone), stored_hash);
+    indigoFree(stored);
+    indigoFree(computed);
+    indigoFree(clone);
+    indigoFree(item);
+
+    // The container was written with the SIM similarity type, so the
+    // stored fingerprints do not apply to ECFP4 ones
+    indigoSetOption("similarity-type", "ecfp4");
+    item = indigoAt(iterator, 100);
+    stored = indigoFingerprint(item, "sim");
+    clone = indigoClone(item);
+    computed = indigoFingerprint(clone, "sim");
+    ASSERT_STREQ(std::string(indigoToString(stored)).c_str(), indigoToString(computed));
+    indigoFree(stored);
+    indigoFree(computed);
+    indigoFree(clone);
+    indigoFree(item);
+    indigoSetOption("similarity-type", "sim");
+    indigoFree(iterator);
+
+    ASSERT_THROW(indigoCreateFileAppender(path.c_str(), "sdf"), Exception);
+    std::remove(path.c_str());
+}
+
+TEST_F(IndigoApiBasicTest, timeout_handler_reuse)
+{
+    int m = indigoLoadMoleculeFromString("CC(C)Cc1ccc(cc1)C(C)C(O)=O");
+
+    // The timeout handler is re-armed by every call instead of being recreated
+    indigoSetOptionInt("timeout", 10000);
+    ASSERT_EQ(15, indigoCountAtoms(m));
+    CancellationHandler* handler = getCancellationHandler();
+    ASSERT_NE(nullptr, dynamic_cast<TimeoutCancellationHandler*>(handler));
+    for (int i = 0; i < 100; i++)
+        ASSERT_EQ(15, indigoCountAtoms(m));
+    ASSERT_EQ(handler, getCancellationHandler());
+
+    indigoSetOptionInt("timeout", 0);
+    ASSERT_EQ(15, indigoCountAtoms(m));
+    ASSERT_EQ(nullptr, getCancellationHandler());
+
+    indigoFree(m);
+}
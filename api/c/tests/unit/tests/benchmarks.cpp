@@ -0,0 +1,126 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <indigo.h>
+
+#include "common.h"
+
+using namespace indigo;
+
+// Timings of the C API. The tests are disabled, run them with
+//   indigo-api-unit-tests --gtest_also_run_disabled_tests --gtest_filter='IndigoApiBenchmarkTest.*'
+class IndigoApiBenchmarkTest : public IndigoApiTest
+{
+protected:
+    // Best of "repeats" runs of fn(), in seconds
+    template <typename F>
+    static double measure(int repeats, F fn)
+    {
+        double best = 0;
+        for (int i = 0; i < repeats; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (i == 0 || seconds < best)
+                best = seconds;
+        }
+        return best;
+    }
+
+    static void report(const char* name, double seconds, int count)
+    {
+        printf("[ BENCH    ] %-40s %10.3f ms %12.1f ns/op (%d ops)\n", name, seconds * 1000, seconds * 1e9 / count, count);
+    }
+};
+
+// File iterators loading the records on the calling thread and on worker threads
+TEST_F(IndigoApiBenchmarkTest, DISABLED_parallel_file_iterator)
+{
+    const std::string sdf = dataPath("molecules/basic/thiazolidines.sdf");
+    const std::string smi = dataPath("molecules/basic/pubchem_slice_5000.smi");
+
+    for (const bool is_sdf : {true, false})
+    {
+        for (const int threads : {0, 1, 2, 4})
+        {
+            indigoSetOptionInt("iterate-file-threads", threads);
+
+            int count = 0;
+            double seconds = measure(3, [&]() {
+                int iterator = is_sdf ? indigoIterateSDFile(sdf.c_str()) : indigoIterateSmilesFile(smi.c_str());
+                int item;
+
+                count = 0;
+                while ((item = indigoNext(iterator)) > 0)
+                {
+                    if (indigoCountAtoms(item) >= 0)
+                        count++;
+                    indigoFree(item);
+                }
+                indigoFree(iterator);
+            });
+
+            char name[64];
+            snprintf(name, sizeof(name), "parallel_file_iterator: %s, %d thr", is_sdf ? "sdf" : "smi", threads);
+            report(name, seconds, count);
+        }
+    }
+    indigoSetOptionInt("iterate-file-threads", 0);
+}
+
+// Cheap getters, where the per-call bookkeeping of the API dominates
+TEST_F(IndigoApiBenchmarkTest, DISABLED_api_call_overhead)
+{
+    int mol = indigoLoadMoleculeFromString("CC(=O)Oc1ccccc1C(=O)O");
+    std::vector<int> atoms;
+    for (int i = 0; i < indigoCountAtoms(mol); i++)
+        atoms.push_back(indigoGetAtom(mol, i));
+
+    const int rounds = 100000;
+    for (const int timeout : {0, 60000})
+    {
+        indigoSetOptionInt("timeout", timeout);
+
+        int charge, sum = 0;
+        double seconds = measure(5, [&]() {
+            for (int r = 0; r < rounds; r++)
+            {
+                for (int atom : atoms)
+                {
+                    indigoGetCharge(atom, &charge);
+                    sum += charge + indigoIsotope(atom);
+                }
+            }
+        });
+        ASSERT_EQ(0, sum);
+        report(timeout ? "api_call_overhead: with timeout" : "api_call_overhead: no timeout", seconds, rounds * (int)atoms.size() * 2);
+    }
+    indigoSetOptionInt("timeout", 0);
+
+    for (int atom : atoms)
+        indigoFree(atom);
+    indigoFree(mol);
+}
@@ -135,3 +135,20 @@ TEST_F(IndigoApiRendererTest, render_superatoms)
         thread.join();
     }
 }
+
+TEST_F(IndigoApiRendererTest, no_stale_error)
+{
+    indigoSetErrorHandler(nullptr, nullptr);
+
+    ASSERT_EQ(-1, indigoLoadMoleculeFromString("C1=C(*)C=?C=C1"));
+    ASSERT_STRNE("", indigoGetLastError());
+    // indigoRendererInit() enters through INDIGO_BEGIN_STATIC
+    ASSERT_EQ(0, indigoRendererInit());
+    ASSERT_STREQ("", indigoGetLastError());
+
+    ASSERT_EQ(-1, indigoLoadMoleculeFromString("C1=C(*)C=?C=C1"));
+    int mol = indigoLoadMoleculeFromString("CCO");
+    ASSERT_STREQ("", indigoGetLastError());
+    ASSERT_EQ(3, indigoCountAtoms(mol));
+    indigoFree(mol);
+}
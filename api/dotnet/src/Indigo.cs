@@ -701,6 +701,18 @@ namespace com.epam.indigo
             return new IndigoObject(this, checkResult(IndigoLib.indigoIterateCDXFile(filename)));
         }
 
+        public IndigoObject iterateKETFile(string filename)
+        {
+            setSessionID();
+            return new IndigoObject(this, checkResult(IndigoLib.indigoIterateKETFile(filename)));
+        }
+
+        public IndigoObject iterateCmfFile(string filename)
+        {
+            setSessionID();
+            return new IndigoObject(this, checkResult(IndigoLib.indigoIterateCmfFile(filename)));
+        }
+
         public IndigoObject substructureMatcher(IndigoObject target, string mode)
         {
             setSessionID();
@@ -712,6 +724,17 @@ namespace com.epam.indigo
             return substructureMatcher(target, "");
         }
 
+        public IndigoObject createQuerySet(IndigoObject queries)
+        {
+            setSessionID();
+            return new IndigoObject(this, checkResult(IndigoLib.indigoCreateQuerySet(queries.self)));
+        }
+
+        public IndigoObject createQuerySet(IEnumerable queries)
+        {
+            return createQuerySet(toIndigoArray(queries));
+        }
+
         public IndigoObject extractCommonScaffold(IndigoObject structures, string options)
         {
             setSessionID();
@@ -853,6 +876,12 @@ namespace com.epam.indigo
             return new IndigoObject(this, checkResult(checkResult(IndigoLib.indigoCreateFileSaver(filename, format))));
         }
 
+        public IndigoObject createFileAppender(string filename, string format)
+        {
+            setSessionID();
+            return new IndigoObject(this, checkResult(IndigoLib.indigoCreateFileAppender(filename, format)));
+        }
+
         public IndigoObject transform(IndigoObject reaction, IndigoObject monomer)
         {
             setSessionID();
@@ -920,6 +949,17 @@ namespace com.epam.indigo
             return new IndigoObject(this, result, reader);
         }
 
+        public IndigoObject iterateKET(IndigoObject reader)
+        {
+            setSessionID();
+            int result = checkResult(IndigoLib.indigoIterateKET(reader.self));
+            if (result == 0)
+            {
+                return null;
+            }
+            return new IndigoObject(this, result, reader);
+        }
+
         public IndigoObject iterateSmiles(IndigoObject reader)
         {
             setSessionID();
@@ -173,6 +173,9 @@ namespace com.epam.indigo
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern int indigoCreateFileSaver(string filename, string format);
 
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int indigoCreateFileAppender(string filename, string format);
+
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern int indigoAppend(int saver, int obj);
 
@@ -834,6 +837,21 @@ namespace com.epam.indigo
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern byte* indigoCanonicalSmiles(int molecule);
 
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern byte* indigoCanonicalSmilesBatch(int iterator, int nthreads);
+
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int indigoSaveCanonicalSmilesBatch(int iterator, int output, int nthreads);
+
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int indigoSaveCanonicalSmilesBatchToFile(int iterator, string filename, int nthreads);
+
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int indigoSaveArrow(int items, int output, string columns, int nthreads);
+
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int indigoSaveArrowToFile(int items, string filename, string columns, int nthreads);
+
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern long indigoHash(int item);
 
@@ -999,6 +1017,9 @@ namespace com.epam.indigo
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern int indigoIterateCDX(int reader);
 
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int indigoIterateKET(int reader);
+
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern int indigoIterateSDFile(string filename);
 
@@ -1014,6 +1035,12 @@ namespace com.epam.indigo
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern int indigoIterateCDXFile(string filename);
 
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int indigoIterateKETFile(string filename);
+
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int indigoIterateCmfFile(string filename);
+
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern byte* indigoRawData(int item);
 
@@ -1083,6 +1110,12 @@ namespace com.epam.indigo
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern int indigoIterateMatches(int matcher, int query);
 
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int indigoCreateQuerySet(int queries);
+
+        [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
+        public static extern int* indigoMatchQuerySet(int query_set, int target, int* count);
+
         [DllImport("indigo"), SuppressUnmanagedCodeSecurity]
         public static extern int indigoHighlightedTarget(int match);
 
@@ -1444,6 +1444,28 @@ namespace com.epam.indigo
             return dispatcher.checkResult(IndigoLib.indigoCanonicalSmiles(self));
         }
 
+        public string canonicalSmilesBatch(int nthreads = 0)
+        {
+            dispatcher.setSessionID();
+            return dispatcher.checkResult(IndigoLib.indigoCanonicalSmilesBatch(self, nthreads));
+        }
+
+        public void saveCanonicalSmilesBatch(string filename, int nthreads = 0)
+        {
+            dispatcher.setSessionID();
+            int s = dispatcher.checkResult(IndigoLib.indigoWriteFile(filename));
+            dispatcher.checkResult(IndigoLib.indigoSaveCanonicalSmilesBatch(self, s, nthreads));
+            dispatcher.checkResult(IndigoLib.indigoFree(s));
+        }
+
+        public void saveArrow(string filename, string columns, int nthreads = 0)
+        {
+            dispatcher.setSessionID();
+            int s = dispatcher.checkResult(IndigoLib.indigoWriteFile(filename));
+            dispatcher.checkResult(IndigoLib.indigoSaveArrow(self, s, columns, nthreads));
+            dispatcher.checkResult(IndigoLib.indigoFree(s));
+        }
+
         public int[] symmetryClasses()
         {
             dispatcher.setSessionID();
@@ -1892,6 +1914,21 @@ namespace com.epam.indigo
             return new IndigoObject(dispatcher, dispatcher.checkResult(IndigoLib.indigoIterateMatches(self, query.self)), this);
         }
 
+        public int[] matchQuerySet(IndigoObject target)
+        {
+            dispatcher.setSessionID();
+            int count;
+            int* ids = dispatcher.checkResult(IndigoLib.indigoMatchQuerySet(self, target.self, &count));
+
+            int[] res = new int[count];
+            for (int i = 0; i < count; ++i)
+            {
+                res[i] = ids[i];
+            }
+
+            return res;
+        }
+
         public IndigoObject highlightedTarget()
         {
             dispatcher.setSessionID();
@@ -582,6 +582,16 @@ public class Indigo {
         return new IndigoObject(this, checkResult(this, lib.indigoIterateCDXFile(filename)));
     }
 
+    public IndigoObject iterateKETFile(String filename) {
+        setSessionID();
+        return new IndigoObject(this, checkResult(this, lib.indigoIterateKETFile(filename)));
+    }
+
+    public IndigoObject iterateCmfFile(String filename) {
+        setSessionID();
+        return new IndigoObject(this, checkResult(this, lib.indigoIterateCmfFile(filename)));
+    }
+
     public IndigoObject substructureMatcher(IndigoObject target, String mode) {
         setSessionID();
         return new IndigoObject(
@@ -594,6 +604,16 @@ public class Indigo {
         return substructureMatcher(target, "");
     }
 
+    public IndigoObject createQuerySet(IndigoObject queries) {
+        setSessionID();
+        return new IndigoObject(
+                this, checkResult(this, queries, lib.indigoCreateQuerySet(queries.self)));
+    }
+
+    public IndigoObject createQuerySet(Collection<IndigoObject> queries) {
+        return createQuerySet(toIndigoArray(queries));
+    }
+
     public IndigoObject extractCommonScaffold(IndigoObject structures, String options) {
         setSessionID();
         int res =
@@ -712,6 +732,12 @@ public class Indigo {
                 this, checkResult(this, lib.indigoCreateFileSaver(filename, format)));
     }
 
+    public IndigoObject createFileAppender(String filename, String format) {
+        setSessionID();
+        return new IndigoObject(
+                this, checkResult(this, lib.indigoCreateFileAppender(filename, format)));
+    }
+
     public void dbgBreakpoint() {
         setSessionID();
         lib.indigoDbgBreakpoint();
@@ -775,6 +801,14 @@ public class Indigo {
         return new IndigoObject(this, result, reader);
     }
 
+    public IndigoObject iterateKET(IndigoObject reader) {
+        setSessionID();
+        int result = checkResult(this, lib.indigoIterateKET(reader.self));
+        if (result == 0) return null;
+
+        return new IndigoObject(this, result, reader);
+    }
+
     public IndigoObject iterateSmiles(IndigoObject reader) {
         setSessionID();
         int result = checkResult(this, lib.indigoIterateSmiles(reader.self));
@@ -613,6 +613,16 @@ public interface IndigoLib extends Library {
 
     Pointer indigoCanonicalSmiles(int molecule);
 
+    Pointer indigoCanonicalSmilesBatch(int iterator, int nthreads);
+
+    int indigoSaveCanonicalSmilesBatch(int iterator, int output, int nthreads);
+
+    int indigoSaveCanonicalSmilesBatchToFile(int iterator, String filename, int nthreads);
+
+    int indigoSaveArrow(int items, int output, String columns, int nthreads);
+
+    int indigoSaveArrowToFile(int items, String filename, String columns, int nthreads);
+
     long indigoHash(int item);
 
     Pointer indigoLayeredCode(int molecule);
@@ -714,6 +724,8 @@ public interface IndigoLib extends Library {
 
     int indigoIterateCDX(int reader);
 
+    int indigoIterateKET(int reader);
+
     int indigoIterateSDFile(String filename);
 
     int indigoIterateRDFile(String filename);
@@ -724,6 +736,10 @@ public interface IndigoLib extends Library {
 
     int indigoIterateCDXFile(String filename);
 
+    int indigoIterateKETFile(String filename);
+
+    int indigoIterateCmfFile(String filename);
+
     Pointer indigoRawData(int item);
 
     int indigoTell(int handle);
@@ -746,6 +762,8 @@ public interface IndigoLib extends Library {
 
     int indigoCreateFileSaver(String filename, String format);
 
+    int indigoCreateFileAppender(String filename, String format);
+
     int indigoAppend(int saver, int object);
 
     int indigoCreateArray();
@@ -776,6 +794,10 @@ public interface IndigoLib extends Library {
 
     int indigoIterateMatches(int matcher, int query);
 
+    int indigoCreateQuerySet(int queries);
+
+    Pointer indigoMatchQuerySet(int query_set, int target, IntByReference count);
+
     int indigoHighlightedTarget(int match);
 
     int indigoMapAtom(int match, int query_atom);
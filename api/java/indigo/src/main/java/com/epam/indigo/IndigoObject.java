@@ -864,6 +864,33 @@ public class IndigoObject implements Iterator<IndigoObject>, Iterable<IndigoObje
         return Indigo.checkResultString(this, lib.indigoCanonicalSmiles(self));
     }
 
+    public String canonicalSmilesBatch(int nthreads) {
+        dispatcher.setSessionID();
+        return Indigo.checkResultString(this, lib.indigoCanonicalSmilesBatch(self, nthreads));
+    }
+
+    public String canonicalSmilesBatch() {
+        return canonicalSmilesBatch(0);
+    }
+
+    public void saveCanonicalSmilesBatch(String filename, int nthreads) {
+        dispatcher.setSessionID();
+        Indigo.checkResult(this, lib.indigoSaveCanonicalSmilesBatchToFile(self, filename, nthreads));
+    }
+
+    public void saveCanonicalSmilesBatch(String filename) {
+        saveCanonicalSmilesBatch(filename, 0);
+    }
+
+    public void saveArrow(String filename, String columns, int nthreads) {
+        dispatcher.setSessionID();
+        Indigo.checkResult(this, lib.indigoSaveArrowToFile(self, filename, columns, nthreads));
+    }
+
+    public void saveArrow(String filename, String columns) {
+        saveArrow(filename, columns, 0);
+    }
+
     public String layeredCode() {
         dispatcher.setSessionID();
         return Indigo.checkResultString(this, lib.indigoLayeredCode(self));
@@ -1653,6 +1680,15 @@ public class IndigoObject implements Iterator<IndigoObject>, Iterable<IndigoObje
                 this);
     }
 
+    public int[] matchQuerySet(IndigoObject target) {
+        IntByReference count = new IntByReference();
+        dispatcher.setSessionID();
+        Pointer p =
+                Indigo.checkResultPointer(
+                        this, lib.indigoMatchQuerySet(self, target.self, count));
+        return p.getIntArray(0, count.getValue());
+    }
+
     public IndigoObject highlightedTarget() {
         dispatcher.setSessionID();
         return new IndigoObject(
@@ -3297,6 +3297,58 @@ class IndigoObject(object):
             Indigo._lib.indigoCanonicalSmiles(self.id)
         )
 
+    def canonicalSmilesBatch(self, nthreads=0):
+        """Iterator method returns canonical smiles of all remaining items
+
+        Args:
+            nthreads (int): number of threads, all cores if 0. Optional, defaults to 0.
+
+        Returns:
+            str: canonical smiles, one line per item, empty for broken items
+        """
+        self.dispatcher._setSessionId()
+        return self.dispatcher._checkResultString(
+            Indigo._lib.indigoCanonicalSmilesBatch(self.id, nthreads)
+        )
+
+    def saveCanonicalSmilesBatch(self, filename, nthreads=0):
+        """Iterator method saves canonical smiles of all remaining items into a file
+
+        Args:
+            filename (str): full file path to the output file
+            nthreads (int): number of threads, all cores if 0. Optional, defaults to 0.
+
+        Returns:
+            int: 1 if file is saved successfully
+        """
+        self.dispatcher._setSessionId()
+        return self.dispatcher._checkResult(
+            Indigo._lib.indigoSaveCanonicalSmilesBatchToFile(
+                self.id, filename.encode(ENCODE_ENCODING), nthreads
+            )
+        )
+
+    def saveArrow(self, filename, columns, nthreads=0):
+        """Iterator or array method saves the remaining items into an Arrow IPC file
+
+        Args:
+            filename (str): full file path to the output file
+            columns (str): comma-separated columns, like "smiles,mw,fingerprint:sim,property:name"
+            nthreads (int): number of threads, all cores if 0. Optional, defaults to 0.
+
+        Returns:
+            int: 1 if file is saved successfully
+        """
+        self.dispatcher._setSessionId()
+        return self.dispatcher._checkResult(
+            Indigo._lib.indigoSaveArrowToFile(
+                self.id,
+                filename.encode(ENCODE_ENCODING),
+                columns.encode(ENCODE_ENCODING),
+                nthreads,
+            )
+        )
+
     def canonicalSmarts(self):
         """Molecule method returns canonical smarts
 
@@ -4049,6 +4101,25 @@ class IndigoObject(object):
             ),
         )
 
+    def matchQuerySet(self, target):
+        """Query set method returns ids of the queries matching the target
+
+        Args:
+            target (IndigoObject): target molecule
+
+        Returns:
+            list: indices of the matching queries in the array given to
+            Indigo.createQuerySet(), in ascending order
+        """
+        c_size = c_int()
+        self.dispatcher._setSessionId()
+        c_buf = self.dispatcher._checkResultPtr(
+            Indigo._lib.indigoMatchQuerySet(
+                self.id, target.id, pointer(c_size)
+            )
+        )
+        return [c_buf[i] for i in range(c_size.value)]
+
     def highlightedTarget(self):
         """Mapping method returns highlighted target
 
@@ -4554,6 +4625,8 @@ class Indigo(object):
         Indigo._lib.indigoIterateCML.argtypes = [c_int]
         Indigo._lib.indigoIterateCDX.restype = c_int
         Indigo._lib.indigoIterateCDX.argtypes = [c_int]
+        Indigo._lib.indigoIterateKET.restype = c_int
+        Indigo._lib.indigoIterateKET.argtypes = [c_int]
         Indigo._lib.indigoIterateSDFile.restype = c_int
         Indigo._lib.indigoIterateSDFile.argtypes = [c_char_p]
         Indigo._lib.indigoIterateRDFile.restype = c_int
@@ -4564,10 +4637,16 @@ class Indigo(object):
         Indigo._lib.indigoIterateCMLFile.argtypes = [c_char_p]
         Indigo._lib.indigoIterateCDXFile.restype = c_int
         Indigo._lib.indigoIterateCDXFile.argtypes = [c_char_p]
+        Indigo._lib.indigoIterateKETFile.restype = c_int
+        Indigo._lib.indigoIterateKETFile.argtypes = [c_char_p]
+        Indigo._lib.indigoIterateCmfFile.restype = c_int
+        Indigo._lib.indigoIterateCmfFile.argtypes = [c_char_p]
         Indigo._lib.indigoCreateSaver.restype = c_int
         Indigo._lib.indigoCreateSaver.argtypes = [c_int, c_char_p]
         Indigo._lib.indigoCreateFileSaver.restype = c_int
         Indigo._lib.indigoCreateFileSaver.argtypes = [c_char_p, c_char_p]
+        Indigo._lib.indigoCreateFileAppender.restype = c_int
+        Indigo._lib.indigoCreateFileAppender.argtypes = [c_char_p, c_char_p]
         Indigo._lib.indigoCreateArray.restype = c_int
         Indigo._lib.indigoCreateArray.argtypes = None
         Indigo._lib.indigoSubstructureMatcher.restype = c_int
@@ -5108,6 +5187,21 @@ class Indigo(object):
         Indigo._lib.indigoMolarRefractivity.argtypes = [c_int]
         Indigo._lib.indigoCanonicalSmiles.restype = c_char_p
         Indigo._lib.indigoCanonicalSmiles.argtypes = [c_int]
+        Indigo._lib.indigoCanonicalSmilesBatch.restype = c_char_p
+        Indigo._lib.indigoCanonicalSmilesBatch.argtypes = [c_int, c_int]
+        Indigo._lib.indigoSaveCanonicalSmilesBatchToFile.restype = c_int
+        Indigo._lib.indigoSaveCanonicalSmilesBatchToFile.argtypes = [
+            c_int,
+            c_char_p,
+            c_int,
+        ]
+        Indigo._lib.indigoSaveArrowToFile.restype = c_int
+        Indigo._lib.indigoSaveArrowToFile.argtypes = [
+            c_int,
+            c_char_p,
+            c_char_p,
+            c_int,
+        ]
         Indigo._lib.indigoCanonicalSmarts.restype = c_char_p
         Indigo._lib.indigoCanonicalSmarts.argtypes = [c_int]
         Indigo._lib.indigoHash.restype = c_int64
@@ -5270,6 +5364,14 @@ class Indigo(object):
         ]
         Indigo._lib.indigoIterateMatches.restype = c_int
         Indigo._lib.indigoIterateMatches.argtypes = [c_int, c_int]
+        Indigo._lib.indigoCreateQuerySet.restype = c_int
+        Indigo._lib.indigoCreateQuerySet.argtypes = [c_int]
+        Indigo._lib.indigoMatchQuerySet.restype = POINTER(c_int)
+        Indigo._lib.indigoMatchQuerySet.argtypes = [
+            c_int,
+            c_int,
+            POINTER(c_int),
+        ]
         Indigo._lib.indigoHighlightedTarget.restype = c_int
         Indigo._lib.indigoHighlightedTarget.argtypes = [c_int]
         Indigo._lib.indigoMapAtom.restype = c_int
@@ -6291,6 +6393,46 @@ class Indigo(object):
             ),
         )
 
+    def iterateKETFile(self, filename):
+        """Returns iterator for files with KET documents following one
+        another, e.g. one per line
+
+        Args:
+            filename (str): full file path
+
+        Returns:
+            IndigoObject: KET iterator object
+        """
+        self._setSessionId()
+        return self.IndigoObject(
+            self,
+            self._checkResult(
+                Indigo._lib.indigoIterateKETFile(
+                    filename.encode(ENCODE_ENCODING)
+                )
+            ),
+        )
+
+    def iterateCmfFile(self, filename):
+        """Returns iterator for CMF container files written by the "cmf" saver.
+        The iterator supports at() and count()
+
+        Args:
+            filename (str): full file path
+
+        Returns:
+            IndigoObject: CMF container iterator object
+        """
+        self._setSessionId()
+        return self.IndigoObject(
+            self,
+            self._checkResult(
+                Indigo._lib.indigoIterateCmfFile(
+                    filename.encode(ENCODE_ENCODING)
+                )
+            ),
+        )
+
     def createFileSaver(self, filename, format):
         """Creates file saver object
 
@@ -6312,6 +6454,28 @@ class Indigo(object):
             ),
         )
 
+    def createFileAppender(self, filename, format):
+        """Creates saver object that appends to the file, or creates it.
+        Only "cmf" is supported
+
+        Args:
+            filename (str): full file path
+            format (str): file format
+
+        Returns:
+            IndigoObject: file saver object
+        """
+        self._setSessionId()
+        return self.IndigoObject(
+            self,
+            self._checkResult(
+                Indigo._lib.indigoCreateFileAppender(
+                    filename.encode(ENCODE_ENCODING),
+                    format.encode(ENCODE_ENCODING),
+                )
+            ),
+        )
+
     def createSaver(self, obj, format):
         """Creates saver object
 
@@ -6366,6 +6530,23 @@ class Indigo(object):
             target,
         )
 
+    def createQuerySet(self, queries):
+        """Creates a set of queries matched against a target all at once
+
+        Args:
+            queries (IndigoObject): array of query molecules. The queries
+                are copied.
+
+        Returns:
+            IndigoObject: query set object
+        """
+        queries = self.convertToArray(queries)
+        self._setSessionId()
+        return self.IndigoObject(
+            self,
+            self._checkResult(Indigo._lib.indigoCreateQuerySet(queries.id)),
+        )
+
     def extractCommonScaffold(self, structures, options=""):
         """Extracts common scaffold for the given structures
 
@@ -6611,6 +6792,21 @@ class Indigo(object):
             return None
         return self.IndigoObject(self, result, reader)
 
+    def iterateKET(self, reader):
+        """Creates KET iterator from scanner object
+
+        Args:
+            reader (IndigoObject): scanner object
+
+        Returns:
+            IndigoObject: KET iterator object
+        """
+        self._setSessionId()
+        result = self._checkResult(Indigo._lib.indigoIterateKET(reader.id))
+        if not result:
+            return None
+        return self.IndigoObject(self, result, reader)
+
     def iterateRDF(self, reader):
         """Creates RDF iterator from scanner object
 
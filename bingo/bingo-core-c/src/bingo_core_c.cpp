@@ -721,16 +721,14 @@ CEXPORT qword bingoProfNanoClock()
 
 CEXPORT void bingoProfIncTimer(const char* name, qword dt)
 {
-    auto inst = sf::xlock_safe_ptr(ProfilingSystem::getInstance());
-    int name_index = inst->getNameIndex(name);
-    inst->addTimer(name_index, dt);
+    int name_index = sf::xlock_safe_ptr(ProfilingSystem::getInstance())->getNameIndex(name);
+    ProfilingSystem::addTimer(name_index, dt);
 }
 
 CEXPORT void bingoProfIncCounter(const char* name, int dv)
 {
-    auto inst = sf::xlock_safe_ptr(ProfilingSystem::getInstance());
-    int name_index = inst->getNameIndex(name);
-    inst->addCounter(name_index, dv);
+    int name_index = sf::xlock_safe_ptr(ProfilingSystem::getInstance())->getNameIndex(name);
+    ProfilingSystem::addCounter(name_index, dv);
 }
 
 const char* BingoCore::bingoGetNameCore(const char* target_buf, int target_buf_len)
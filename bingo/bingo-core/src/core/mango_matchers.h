@@ -87,11 +87,15 @@ namespace indigo
 
         ObjArray<RedBlackStringMap<int>> _fmcache;
 
+        // enumerator reused by the matchers of all the targets
+        Obj<EmbeddingEnumerator> _ee;
+
         // cmf loader for delayed xyz loading
         Obj<CmfLoader> cmf_loader;
 
         bool _query_has_stereocare_bonds;
         bool _query_has_stereocenters;
+        bool _query_has_allene_stereo;
         bool _query_fp_valid;
         bool _query_extra_valid;
 
@@ -138,6 +138,7 @@ void MangoSubstructure::_validateQueryExtraData()
 
     _query_has_stereocenters = _query.stereocenters.size() > 0;
     _query_has_stereocare_bonds = _query.cis_trans.count() > 0;
+    _query_has_allene_stereo = _query.allene_stereo.size() > 0;
     _query_extra_valid = true;
 }
 
@@ -177,6 +178,9 @@ bool MangoSubstructure::matchLoadedTarget()
 
     _fmcache.clear();
 
+    if (_ee.get() == 0)
+        _ee.create(_target);
+    matcher.setEmbeddingEnumerator(_ee.get());
     matcher.setQuery(_query);
 
     profTimerStart(temb, "match.embedding");
@@ -326,7 +330,11 @@ bool MangoSubstructure::matchBinary(Scanner& scanner, Scanner* xyz_scanner)
     if (!_query_has_stereocenters)
         cmf_loader->skip_stereocenters = true;
 
+    // Only the layers the query looks at are put into the target before matching
+    cmf_loader->lazy = true;
     cmf_loader->loadMolecule(_target);
+    if (_query_has_stereocare_bonds || _query_has_stereocenters || _query_has_allene_stereo)
+        cmf_loader->loadStereo();
     if (xyz_scanner != 0)
         cmf_loader->loadXyz(*xyz_scanner);
 
@@ -336,7 +344,12 @@ bool MangoSubstructure::matchBinary(Scanner& scanner, Scanner* xyz_scanner)
     _initTarget(true);
     profTimerStop(tinit);
 
-    return matchLoadedTarget();
+    if (!matchLoadedTarget())
+        return false;
+
+    // For getHighlightedTarget()
+    cmf_loader->loadHighlighting();
+    return true;
 }
 
 bool MangoSubstructure::parse(const char* params)
@@ -0,0 +1,590 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "base_cpp/arrow_ipc_writer.h"
+
+#include <cstring>
+
+#include "base_cpp/output.h"
+
+using namespace indigo;
+
+IMPL_ERROR(ArrowIpcWriter, "Arrow IPC writer");
+
+namespace
+{
+    // Values from the Arrow format flatbuffers schema (Schema.fbs, Message.fbs)
+    enum
+    {
+        METADATA_V5 = 4,
+        HEADER_SCHEMA = 1,
+        HEADER_RECORD_BATCH = 3,
+        TYPE_FLOATING_POINT = 3,
+        TYPE_BINARY = 4,
+        TYPE_UTF8 = 5,
+        PRECISION_DOUBLE = 2
+    };
+
+    // Minimal flatbuffers builder. Like the reference one, it fills the buffer
+    // from the back, so every object is created before the objects that refer
+    // to it. Offsets are counted from the end of the buffer. Little-endian
+    // hosts only, like the rest of the Arrow writer.
+    class FlatBuilder
+    {
+    public:
+        FlatBuilder() : _head(0), _min_align(1), _table_start(0)
+        {
+        }
+
+        int size() const
+        {
+            return _buf.size() - _head;
+        }
+
+        const char* data() const
+        {
+            return _buf.ptr() + _head;
+        }
+
+        template <typename T> void addScalar(int id, T value)
+        {
+            _align(sizeof(T), 0);
+            _prepend(&value, sizeof(T));
+            _addField(id);
+        }
+
+        void addOffset(int id, int target)
+        {
+            _pushOffset(target);
+            _addField(id);
+        }
+
+        int createString(const char* str, int length)
+        {
+            _align(4, length + 1);
+            _prepend("", 1);
+            _prepend(str, length);
+            _pushScalar<unsigned>(length);
+            return size();
+        }
+
+        int createOffsetVector(const Array<int>& targets)
+        {
+            _align(4, targets.size() * 4);
+            for (int i = targets.size() - 1; i >= 0; i--)
+                _pushOffset(targets[i]);
+            _pushScalar<unsigned>(targets.size());
+            return size();
+        }
+
+        // Elements are structs of 8-byte fields, already laid out in memory
+        int createStructVector(const void* data, int count, int struct_size)
+        {
+            _align(8, count * struct_size);
+            _prepend(data, count * struct_size);
+            _pushScalar<unsigned>(count);
+            return size();
+        }
+
+        void startTable()
+        {
+            _fields.clear();
+            _table_start = size();
+        }
+
+        int endTable()
+        {
+            int i, nfields = 0;
+
+            _pushScalar<int>(0);
+            int table = size();
+
+            for (i = 0; i < _fields.size(); i++)
+                if (_fields[i].id + 1 > nfields)
+                    nfields = _fields[i].id + 1;
+
+            for (i = nfields - 1; i >= 0; i--)
+            {
+                unsigned short offset = 0;
+                for (int j = 0; j < _fields.size(); j++)
+                    if (_fields[j].id == i)
+                        offset = (unsigned short)(table - _fields[j].offset);
+                _pushScalar<unsigned short>(offset);
+            }
+            _pushScalar<unsigned short>((unsigned short)(table - _table_start));
+            _pushScalar<unsigned short>((unsigned short)(4 + nfields * 2));
+
+            // The table starts with the distance back to its vtable
+            int vtable = size();
+            int soffset = vtable - table;
+            memcpy(_buf.ptr() + _buf.size() - table, &soffset, 4);
+            return table;
+        }
+
+        void finish(int root)
+        {
+            _align(_min_align, 4);
+            _pushOffset(root);
+        }
+
+    protected:
+        struct _FieldLoc
+        {
+            int id;
+            int offset;
+        };
+
+        void _prepend(const void* bytes, int length)
+        {
+            if (_head < length)
+            {
+                int old_size = size();
+                int capacity = _buf.size() * 2;
+                if (capacity < old_size + length + 64)
+                    capacity = old_size + length + 64;
+
+                Array<char> grown;
+                grown.resize(capacity);
+                memcpy(grown.ptr() + capacity - old_size, data(), old_size);
+                _buf.copy(grown);
+                _head = capacity - old_size;
+            }
+            _head -= length;
+            memcpy(_buf.ptr() + _head, bytes, length);
+        }
+
+        // Pads so that an object of "extra" bytes written next ends aligned to "alignment"
+        void _align(int alignment, int extra)
+        {
+            static const char zeros[8] = {0};
+
+            if (alignment > _min_align)
+                _min_align = alignment;
+            int padding = (alignment - (size() + extra) % alignment) % alignment;
+            _prepend(zeros, padding);
+        }
+
+        template <typename T> void _pushScalar(T value)
+        {
+            _align(sizeof(T), 0);
+            _prepend(&value, sizeof(T));
+        }
+
+        void _pushOffset(int target)
+        {
+            _align(4, 0);
+            _pushScalar<unsigned>(size() + 4 - target);
+        }
+
+        void _addField(int id)
+        {
+            _FieldLoc& field = _fields.push();
+            field.id = id;
+            field.offset = size();
+        }
+
+        Array<char> _buf;
+        int _head;
+        int _min_align;
+        int _table_start;
+        Array<_FieldLoc> _fields;
+    };
+
+    struct FieldNode
+    {
+        long long length;
+        long long null_count;
+    };
+
+    struct BufferDesc
+    {
+        long long offset;
+        long long length;
+    };
+
+    struct BlockDesc
+    {
+        long long offset;
+        int metadata_length;
+        int padding;
+        long long body_length;
+    };
+
+    int padTo8(long long size)
+    {
+        return (int)((8 - size % 8) % 8);
+    }
+} // namespace
+
+//
+// ArrowColumn
+//
+
+ArrowColumn::ArrowColumn() : type(UTF8)
+{
+    clear();
+}
+
+void ArrowColumn::init(int type_)
+{
+    type = type_;
+    clear();
+}
+
+void ArrowColumn::clear()
+{
+    valid.clear();
+    offsets.clear();
+    offsets.push(0);
+    data.clear();
+    values.clear();
+}
+
+void ArrowColumn::appendBytes(const char* bytes, int size)
+{
+    if (type == UTF8 && !isValidUtf8(bytes, size))
+    {
+        appendNull();
+        return;
+    }
+    valid.push(1);
+    data.concat(bytes, size);
+    offsets.push(data.size());
+}
+
+void ArrowColumn::appendDouble(double value)
+{
+    valid.push(1);
+    values.push(value);
+}
+
+void ArrowColumn::appendNull()
+{
+    valid.push(0);
+    if (type == FLOAT64)
+        values.push(0);
+    else
+        offsets.push(data.size());
+}
+
+void ArrowColumn::append(const ArrowColumn& other)
+{
+    valid.concat(other.valid);
+    if (type == FLOAT64)
+    {
+        values.concat(other.values);
+        return;
+    }
+
+    int shift = data.size();
+    for (int i = 1; i < other.offsets.size(); i++)
+        offsets.push(other.offsets[i] + shift);
+    data.concat(other.data);
+}
+
+bool ArrowColumn::isValidUtf8(const char* data, int size)
+{
+    const unsigned char* s = (const unsigned char*)data;
+    int i = 0;
+
+    while (i < size)
+    {
+        unsigned char c = s[i];
+        int length;
+        unsigned min;
+        unsigned code;
+
+        if (c < 0x80)
+        {
+            i++;
+            continue;
+        }
+        if ((c & 0xE0) == 0xC0)
+            length = 2, min = 0x80, code = c & 0x1F;
+        else if ((c & 0xF0) == 0xE0)
+            length = 3, min = 0x800, code = c & 0x0F;
+        else if ((c & 0xF8) == 0xF0)
+            length = 4, min = 0x10000, code = c & 0x07;
+        else
+            return false;
+
+        if (i + length > size)
+            return false;
+        for (int k = 1; k < length; k++)
+        {
+            if ((s[i + k] & 0xC0) != 0x80)
+                return false;
+            code = (code << 6) | (s[i + k] & 0x3F);
+        }
+        // Overlong forms, surrogates and code points past U+10FFFF
+        if (code < min || (code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF)
+            return false;
+        i += length;
+    }
+    return true;
+}
+
+//
+// ArrowIpcWriter
+//
+
+ArrowIpcWriter::ArrowIpcWriter(Output& output) : _output(output), _position(0), _started(false), _closed(false)
+{
+}
+
+void ArrowIpcWriter::addField(const char* name, int type)
+{
+    if (_started)
+        throw Error("fields can not be added after the first batch");
+    if (!ArrowColumn::isValidUtf8(name, (int)strlen(name)))
+        throw Error("field name is not valid UTF-8");
+
+    _names.push().readString(name, false);
+    _types.push(type);
+}
+
+void ArrowIpcWriter::_write(const void* data, int size)
+{
+    _output.write(data, size);
+    _position += size;
+}
+
+void ArrowIpcWriter::_writePadding(int size)
+{
+    static const char zeros[8] = {0};
+    _write(zeros, size);
+}
+
+static int _buildSchema(FlatBuilder& builder, const ObjArray<Array<char>>& names, const Array<int>& types);
+
+void ArrowIpcWriter::_writeMessage(const Array<char>& metadata, long long body_length)
+{
+    _Block& block = _blocks.push();
+    int padding = padTo8(metadata.size());
+    int continuation = -1;
+    int length = metadata.size() + padding;
+
+    block.offset = _position;
+    block.metadata_length = 8 + length;
+    block.body_length = body_length;
+
+    _write(&continuation, 4);
+    _write(&length, 4);
+    _write(metadata.ptr(), metadata.size());
+    _writePadding(padding);
+}
+
+void ArrowIpcWriter::_begin()
+{
+    if (_closed)
+        throw Error("writer is closed");
+    if (_started)
+        return;
+    _started = true;
+
+    _write("ARROW1\0\0", 8);
+
+    FlatBuilder builder;
+    int schema = _buildSchema(builder, _names, _types);
+
+    builder.startTable();
+    builder.addScalar<long long>(3, 0);
+    builder.addOffset(2, schema);
+    builder.addScalar<short>(0, METADATA_V5);
+    builder.addScalar<unsigned char>(1, HEADER_SCHEMA);
+    int message = builder.endTable();
+    builder.finish(message);
+
+    Array<char> metadata;
+    metadata.copy(builder.data(), builder.size());
+    _writeMessage(metadata, 0);
+    // The schema is not a record batch
+    _blocks.pop();
+}
+
+void ArrowIpcWriter::writeBatch(const ObjArray<ArrowColumn>& columns)
+{
+    int i;
+
+    if (columns.size() != _types.size())
+        throw Error("%d columns given for %d fields", columns.size(), _types.size());
+
+    _begin();
+
+    int length = columns.size() > 0 ? columns[0].valid.size() : 0;
+    Array<FieldNode> nodes;
+    Array<BufferDesc> buffers;
+    long long body_length = 0;
+
+    auto addBuffer = [&](long long size) {
+        BufferDesc& buffer = buffers.push();
+        buffer.offset = body_length;
+        buffer.length = size;
+        body_length += size + padTo8(size);
+    };
+
+    for (i = 0; i < columns.size(); i++)
+    {
+        const ArrowColumn& column = columns[i];
+
+        if (column.type != _types[i])
+            throw Error("column %d type does not match its field", i);
+        if (column.valid.size() != length)
+            throw Error("column %d has %d rows instead of %d", i, column.valid.size(), length);
+
+        FieldNode& node = nodes.push();
+        node.length = length;
+        node.null_count = 0;
+        for (int j = 0; j < length; j++)
+            if (!column.valid[j])
+                node.null_count++;
+
+        addBuffer((length + 7) / 8);
+        if (column.type == ArrowColumn::FLOAT64)
+            addBuffer((long long)length * 8);
+        else
+        {
+            addBuffer((long long)(length + 1) * 4);
+            addBuffer(column.data.size());
+        }
+    }
+
+    FlatBuilder builder;
+    int buffers_vector = builder.createStructVector(buffers.ptr(), buffers.size(), sizeof(BufferDesc));
+    int nodes_vector = builder.createStructVector(nodes.ptr(), nodes.size(), sizeof(FieldNode));
+
+    builder.startTable();
+    builder.addScalar<long long>(0, length);
+    builder.addOffset(1, nodes_vector);
+    builder.addOffset(2, buffers_vector);
+    int batch = builder.endTable();
+
+    builder.startTable();
+    builder.addScalar<long long>(3, body_length);
+    builder.addOffset(2, batch);
+    builder.addScalar<short>(0, METADATA_V5);
+    builder.addScalar<unsigned char>(1, HEADER_RECORD_BATCH);
+    int message = builder.endTable();
+    builder.finish(message);
+
+    Array<char> metadata;
+    metadata.copy(builder.data(), builder.size());
+    _writeMessage(metadata, body_length);
+
+    // Body: validity bitmap (bit per row, least significant first), then offsets and data or values
+    Array<char> bitmap;
+    for (i = 0; i < columns.size(); i++)
+    {
+        const ArrowColumn& column = columns[i];
+
+        bitmap.clear_resize((length + 7) / 8);
+        bitmap.zerofill();
+        for (int j = 0; j < length; j++)
+            if (column.valid[j])
+                bitmap[j / 8] |= (char)(1 << (j % 8));
+        _write(bitmap.ptr(), bitmap.size());
+        _writePadding(padTo8(bitmap.size()));
+
+        if (column.type == ArrowColumn::FLOAT64)
+            _write(column.values.ptr(), length * 8);
+        else
+        {
+            _write(column.offsets.ptr(), (length + 1) * 4);
+            _writePadding(padTo8((length + 1) * 4));
+            _write(column.data.ptr(), column.data.size());
+            _writePadding(padTo8(column.data.size()));
+        }
+    }
+}
+
+void ArrowIpcWriter::close()
+{
+    _begin();
+    _closed = true;
+
+    // End-of-stream marker
+    int eos[2] = {-1, 0};
+    _write(eos, 8);
+
+    Array<BlockDesc> blocks;
+    for (int i = 0; i < _blocks.size(); i++)
+    {
+        BlockDesc& block = blocks.push();
+        block.offset = _blocks[i].offset;
+        block.metadata_length = _blocks[i].metadata_length;
+        block.padding = 0;
+        block.body_length = _blocks[i].body_length;
+    }
+
+    FlatBuilder builder;
+    int batches = builder.createStructVector(blocks.ptr(), blocks.size(), sizeof(BlockDesc));
+    int dictionaries = builder.createStructVector(0, 0, sizeof(BlockDesc));
+    int schema = _buildSchema(builder, _names, _types);
+
+    builder.startTable();
+    builder.addOffset(1, schema);
+    builder.addOffset(2, dictionaries);
+    builder.addOffset(3, batches);
+    builder.addScalar<short>(0, METADATA_V5);
+    int footer = builder.endTable();
+    builder.finish(footer);
+
+    int footer_length = builder.size();
+    _write(builder.data(), footer_length);
+    _write(&footer_length, 4);
+    _write("ARROW1", 6);
+    _output.flush();
+}
+
+static int _buildSchema(FlatBuilder& builder, const ObjArray<Array<char>>& names, const Array<int>& types)
+{
+    Array<int> field_tables;
+    Array<int> no_children;
+
+    for (int i = 0; i < types.size(); i++)
+    {
+        int name = builder.createString(names[i].ptr(), names[i].size());
+        int children = builder.createOffsetVector(no_children);
+
+        int type_type;
+        builder.startTable();
+        if (types[i] == ArrowColumn::FLOAT64)
+        {
+            builder.addScalar<short>(0, PRECISION_DOUBLE);
+            type_type = TYPE_FLOATING_POINT;
+        }
+        else
+            type_type = types[i] == ArrowColumn::UTF8 ? TYPE_UTF8 : TYPE_BINARY;
+        int type = builder.endTable();
+
+        builder.startTable();
+        builder.addOffset(0, name);
+        builder.addOffset(3, type);
+        builder.addOffset(5, children);
+        builder.addScalar<unsigned char>(1, 1);
+        builder.addScalar<unsigned char>(2, (unsigned char)type_type);
+        field_tables.push(builder.endTable());
+    }
+
+    int fields_vector = builder.createOffsetVector(field_tables);
+
+    builder.startTable();
+    builder.addOffset(1, fields_vector);
+    builder.addScalar<short>(0, 0); // little endian
+    return builder.endTable();
+}
@@ -0,0 +1,112 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __arrow_ipc_writer_h__
+#define __arrow_ipc_writer_h__
+
+#include "base_cpp/array.h"
+#include "base_cpp/exception.h"
+#include "base_cpp/obj_array.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+    class Output;
+
+    // Cells of one column of an Arrow record batch, appended in row order.
+    // Columns filled for different row ranges are joined with append().
+    class DLLEXPORT ArrowColumn
+    {
+    public:
+        enum
+        {
+            UTF8,
+            BINARY,
+            FLOAT64
+        };
+
+        ArrowColumn();
+
+        void init(int type);
+        void clear();
+
+        // A UTF8 cell that is not valid UTF-8 is written as null
+        void appendBytes(const char* data, int size);
+        void appendDouble(double value);
+        void appendNull();
+        void append(const ArrowColumn& other);
+
+        static bool isValidUtf8(const char* data, int size);
+
+        int type;
+        Array<char> valid;    // one byte per row
+        Array<int> offsets;   // UTF8 and BINARY: row count + 1 entries into data
+        Array<char> data;     // UTF8 and BINARY
+        Array<double> values; // FLOAT64
+    };
+
+    // Writes the Arrow IPC file format (also known as Feather V2): the schema,
+    // record batches and a footer with the batch offsets. Only flat nullable
+    // UTF8, binary and float64 columns are supported. The flatbuffers metadata
+    // is built here, so no Arrow or flatbuffers library is needed.
+    class DLLEXPORT ArrowIpcWriter
+    {
+    public:
+        DECL_ERROR;
+
+        explicit ArrowIpcWriter(Output& output);
+
+        // All fields are added before the first batch
+        void addField(const char* name, int type);
+        void writeBatch(const ObjArray<ArrowColumn>& columns);
+        // Writes the footer. Nothing can be written after it.
+        void close();
+
+    protected:
+        struct _Block
+        {
+            long long offset;
+            int metadata_length;
+            long long body_length;
+        };
+
+        void _begin();
+        void _write(const void* data, int size);
+        void _writePadding(int size);
+        void _writeMessage(const Array<char>& metadata, long long body_length);
+
+        Output& _output;
+        long long _position;
+        bool _started;
+        bool _closed;
+        ObjArray<Array<char>> _names;
+        Array<int> _types;
+        Array<_Block> _blocks;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
@@ -59,6 +59,12 @@ void TimeoutCancellationHandler::reset(int mseconds)
     _currentTime = nanoClock();
 }
 
+void TimeoutCancellationHandler::reset(const TimeoutCancellationHandler& other)
+{
+    _mseconds = other._mseconds;
+    _currentTime = other._currentTime;
+}
+
 CancellationHandler* indigo::getCancellationHandler()
 {
     return CancellationHandler::cancellation_handler().get();
@@ -56,6 +56,8 @@ namespace indigo
         const char* cancelledRequestMessage() override;
 
         void reset(int mseconds);
+        // Times out when "other" does, for work handed over to other threads
+        void reset(const TimeoutCancellationHandler& other);
 
     private:
         std::string _message;
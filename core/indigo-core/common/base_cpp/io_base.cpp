@@ -17,6 +17,8 @@
  ***************************************************************************/
 
 #include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 #include "base_cpp/io_base.h"
 
@@ -52,6 +54,35 @@ FILE* indigo::openFile(Encoding filename_encoding, const char* filename, const c
     return file;
 }
 
+bool indigo::getFileInfo(Encoding filename_encoding, const char* filename, long long& size, long long& mtime)
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    int res = -1;
+#ifndef __MINGW32__
+    if (filename_encoding == ENCODING_UTF8)
+    {
+        wchar_t w_filename[1024];
+
+        MultiByteToWideChar(CP_UTF8, 0, filename, -1, w_filename, 1024);
+        res = _wstat64(w_filename, &st);
+    }
+#endif
+    if (res != 0)
+        res = _stat64(filename, &st);
+#else
+    struct stat st;
+    int res = stat(filename, &st);
+#endif
+
+    if (res != 0)
+        return false;
+
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
 #if defined(_WIN32) && !defined(__MINGW32__)
 CLocale CLocale::instance;
 
@@ -35,6 +35,9 @@ namespace indigo
 
     FILE* openFile(Encoding filename_encoding, const char* filename, const char* mode);
 
+    // Size and modification time (in seconds) of a file; returns false if it can not be accessed
+    bool getFileInfo(Encoding filename_encoding, const char* filename, long long& size, long long& mtime);
+
 #if defined(_WIN32) && !defined(__MINGW32__)
     _locale_t getCLocale();
 
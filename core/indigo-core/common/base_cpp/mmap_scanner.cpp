@@ -0,0 +1,199 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "base_cpp/mmap_scanner.h"
+
+#include <string.h>
+
+using namespace indigo;
+
+MMapScanner::MMapScanner() : _data(0), _size(0LL), _offset(0LL)
+{
+}
+
+MMapScanner::~MMapScanner()
+{
+    _unmap();
+}
+
+std::unique_ptr<Scanner> MMapScanner::open(Encoding filename_encoding, const char* filename)
+{
+    if (filename == 0)
+        throw Error("null filename");
+
+    std::unique_ptr<MMapScanner> scanner(new MMapScanner());
+    if (scanner->_map(filename_encoding, filename))
+        return scanner;
+
+    return std::make_unique<FileScanner>(filename_encoding, filename);
+}
+
+void MMapScanner::read(int length, void* res)
+{
+    if (length < 0 || _offset + length > _size)
+        throw Error("MMapScanner::read() error");
+
+    memcpy(res, _data + _offset, length);
+    _offset += length;
+}
+
+bool MMapScanner::isEOF()
+{
+    return _offset >= _size;
+}
+
+void MMapScanner::skip(int n)
+{
+    _offset += n;
+
+    if (_offset > _size)
+        throw Error("skip() passes after end of file");
+}
+
+int MMapScanner::lookNext()
+{
+    if (_offset >= _size)
+        return -1;
+
+    return (unsigned char)_data[_offset];
+}
+
+void MMapScanner::seek(long long pos, int from)
+{
+    long long offset;
+
+    if (from == SEEK_SET)
+        offset = pos;
+    else if (from == SEEK_CUR)
+        offset = _offset + pos;
+    else // SEEK_END
+        offset = _size + pos;
+
+    if (offset < 0 || offset > _size)
+        throw Error("size = %lld, offset = %lld after seek()", _size, offset);
+
+    _offset = offset;
+}
+
+long long MMapScanner::length()
+{
+    return _size;
+}
+
+long long MMapScanner::tell()
+{
+    return _offset;
+}
+
+byte MMapScanner::readByte()
+{
+    if (_offset >= _size)
+        throw Error("readByte(): end of file");
+
+    return _data[_offset++];
+}
+
+char MMapScanner::readChar()
+{
+    if (_offset >= _size)
+        throw Error("readChar() passes after end of file");
+
+    return _data[_offset++];
+}
+
+const char* MMapScanner::curptr() const
+{
+    return _data + _offset;
+}
+
+bool MMapScanner::readLineView(const char*& line, int& length)
+{
+    if (_offset >= _size)
+        throw Error("readLineView(): end of stream");
+
+    const char* begin = _data + _offset;
+    const char* end = _data + _size;
+
+    // Same terminators as Scanner::appendLine(): "\n", "\r" and "\r\n"
+    const char* eol = (const char*)memchr(begin, '\n', end - begin);
+    if (eol == 0)
+        eol = end;
+    const char* cr = (const char*)memchr(begin, '\r', eol - begin);
+    if (cr != 0)
+        eol = cr;
+
+    if (eol - begin > MAX_LINE_LENGTH)
+        throw Error("Line length is too long. Probably the file format is not correct.");
+
+    line = begin;
+    length = (int)(eol - begin);
+
+    if (eol == end)
+        _offset = _size;
+    else if (*eol == '\r' && eol + 1 < end && eol[1] == '\n')
+        _offset = eol - _data + 2;
+    else
+        _offset = eol - _data + 1;
+
+    return true;
+}
+
+void MMapScanner::appendLine(Array<char>& out, bool append_zero)
+{
+    if (isEOF())
+        throw Error("appendLine(): end of stream");
+
+    if (out.size() > 0)
+        while (out.top() == 0)
+            out.pop();
+
+    const char* line;
+    int length;
+
+    readLineView(line, length);
+
+    if (out.size() + length > MAX_LINE_LENGTH)
+        throw Error("Line length is too long. Probably the file format is not correct.");
+
+    out.concat(line, length);
+
+    if (append_zero)
+        out.push(0);
+}
+
+void MMapScanner::skipUntil(const char* delimiters)
+{
+    // The terminating zero of delimiters is matched as well, as in Scanner::skipUntil()
+    bool stop[256] = {};
+
+    stop[0] = true;
+
+    for (const char* d = delimiters; *d != 0; d++)
+        stop[(unsigned char)*d] = true;
+
+    const unsigned char* p = (const unsigned char*)_data + _offset;
+    const unsigned char* end = (const unsigned char*)_data + _size;
+
+    while (p < end && !stop[*p])
+        p++;
+
+    if (p == end)
+        throw Error("skip() passes after end of file");
+
+    _offset = (const char*)p - _data;
+}
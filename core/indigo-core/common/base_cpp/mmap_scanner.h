@@ -0,0 +1,74 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __mmap_scanner_h__
+#define __mmap_scanner_h__
+
+#include <memory>
+
+#include "base_cpp/scanner.h"
+
+namespace indigo
+{
+
+    // Scanner over a read-only mapping of a regular file. Lines and bytes
+    // are taken directly from the mapping instead of going through a read cache.
+    class DLLEXPORT MMapScanner : public Scanner
+    {
+    public:
+        ~MMapScanner() override;
+
+        // Maps the file if it is a regular file that fits in the address space,
+        // otherwise falls back to FileScanner
+        static std::unique_ptr<Scanner> open(Encoding filename_encoding, const char* filename);
+
+        void read(int length, void* res) override;
+        bool isEOF() override;
+        void skip(int n) override;
+        int lookNext() override;
+        void seek(long long pos, int from) override;
+        long long length() override;
+        long long tell() override;
+
+        byte readByte() override;
+        char readChar() override;
+
+        void appendLine(Array<char>& out, bool append_zero) override;
+        bool readLineView(const char*& line, int& length) override;
+        void skipUntil(const char* delimiters) override;
+
+        const char* curptr() const;
+
+    private:
+        MMapScanner();
+
+        // Platform-specific, see mmap_scanner_posix.cpp and mmap_scanner_win32.cpp
+        bool _map(Encoding filename_encoding, const char* filename);
+        void _unmap();
+
+        const char* _data;
+        long long _size;
+        long long _offset;
+
+        // no implicit copy
+        MMapScanner(const MMapScanner&);
+    };
+
+} // namespace indigo
+
+#endif
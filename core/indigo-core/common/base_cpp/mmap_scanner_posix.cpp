@@ -0,0 +1,73 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#if !defined(_WIN32)
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base_cpp/mmap_scanner.h"
+
+using namespace indigo;
+
+bool MMapScanner::_map(Encoding /* filename_encoding */, const char* filename)
+{
+    int fd = ::open(filename, O_RDONLY);
+
+    if (fd == -1)
+        return false;
+
+    struct stat st;
+
+    // Pipes and devices have no stable length to map
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (unsigned long long)st.st_size > SIZE_MAX)
+    {
+        close(fd);
+        return false;
+    }
+
+    _size = st.st_size;
+
+    if (_size > 0)
+    {
+        void* data = mmap(0, (size_t)_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+        madvise(data, (size_t)_size, MADV_SEQUENTIAL);
+        _data = (const char*)data;
+    }
+
+    close(fd);
+    return true;
+}
+
+void MMapScanner::_unmap()
+{
+    if (_data != 0)
+        munmap((void*)_data, (size_t)_size);
+    _data = 0;
+}
+
+#endif
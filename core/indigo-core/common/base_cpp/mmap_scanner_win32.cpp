@@ -0,0 +1,88 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#if defined(_WIN32)
+
+#include <stdint.h>
+#include <windows.h>
+
+#include "base_cpp/mmap_scanner.h"
+
+using namespace indigo;
+
+bool MMapScanner::_map(Encoding filename_encoding, const char* filename)
+{
+    HANDLE file = INVALID_HANDLE_VALUE;
+
+    if (filename_encoding == ENCODING_UTF8)
+    {
+        wchar_t w_filename[1024];
+
+        MultiByteToWideChar(CP_UTF8, 0, filename, -1, w_filename, 1024);
+        file = CreateFileW(w_filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    }
+    if (file == INVALID_HANDLE_VALUE)
+        file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+
+    // Pipes and devices have no stable length to map
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || (unsigned long long)size.QuadPart > SIZE_MAX)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    _size = size.QuadPart;
+
+    if (_size > 0)
+    {
+        HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if (mapping == NULL)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        // The view keeps the mapping alive after its handle is closed
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+        CloseHandle(mapping);
+        if (data == NULL)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        _data = (const char*)data;
+    }
+
+    CloseHandle(file);
+    return true;
+}
+
+void MMapScanner::_unmap()
+{
+    if (_data != NULL)
+        UnmapViewOfFile(_data);
+    _data = NULL;
+}
+
+#endif
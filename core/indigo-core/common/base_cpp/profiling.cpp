@@ -20,21 +20,332 @@
 
 #include <algorithm>
 #include <cmath>
+#include <mutex>
+#include <vector>
 
 #include <safe_ptr.h>
 
 #include "base_cpp/output.h"
 #include "base_cpp/reusable_obj_array.h"
 #include "base_cpp/smart_output.h"
+#include "base_cpp/tlscont.h"
 
 using namespace indigo;
 
+//
+// ProfilingSystem::ThreadRecords
+//
+// Each thread owns its records and is the only writer, so updates are plain
+// relaxed loads and stores without read-modify-write or locking. Aggregation
+// reads them concurrently under the registry lock. Resets are implemented by
+// bumping an epoch: data with an outdated epoch is ignored by the readers and
+// lazily cleared by its owner on the next update.
+//
+
+struct ProfilingSystem::ThreadRecords
+{
+    struct Histogram
+    {
+        std::atomic<qword> buckets[HISTOGRAM_BUCKETS];
+    };
+
+    struct Data
+    {
+        std::atomic<unsigned> epoch;
+        std::atomic<qword> count, value, max_value;
+        // Allocated by the owner thread on the first value
+        std::atomic<Histogram*> histogram;
+
+        ~Data()
+        {
+            delete histogram.load(std::memory_order_relaxed);
+        }
+
+        void add(unsigned cur_epoch, qword adding_value)
+        {
+            if (epoch.load(std::memory_order_relaxed) != cur_epoch)
+            {
+                _clear();
+                epoch.store(cur_epoch, std::memory_order_release);
+            }
+            _inc(count, 1);
+            _inc(value, adding_value);
+            if (adding_value > max_value.load(std::memory_order_relaxed))
+                max_value.store(adding_value, std::memory_order_relaxed);
+            _inc(_obtainHistogram().buckets[histogramBucket(adding_value)], 1);
+        }
+
+        // Called by the owner thread or under the registry lock only
+        void merge(const Data& other, unsigned cur_epoch)
+        {
+            if (other.epoch.load(std::memory_order_acquire) != cur_epoch)
+                return;
+            if (epoch.load(std::memory_order_relaxed) != cur_epoch)
+            {
+                _clear();
+                epoch.store(cur_epoch, std::memory_order_release);
+            }
+            _inc(count, other.count.load(std::memory_order_relaxed));
+            _inc(value, other.value.load(std::memory_order_relaxed));
+            max_value.store(std::max(max_value.load(std::memory_order_relaxed), other.max_value.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+            const Histogram* other_histogram = other.histogram.load(std::memory_order_acquire);
+            if (other_histogram == nullptr)
+                return;
+            Histogram& own = _obtainHistogram();
+            for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+                _inc(own.buckets[i], other_histogram->buckets[i].load(std::memory_order_relaxed));
+        }
+
+        void collect(unsigned cur_epoch, Record::Data& dst) const
+        {
+            if (epoch.load(std::memory_order_acquire) != cur_epoch)
+                return;
+            dst.count += count.load(std::memory_order_relaxed);
+            dst.value += value.load(std::memory_order_relaxed);
+            dst.max_value = std::max(dst.max_value, max_value.load(std::memory_order_relaxed));
+            const Histogram* own = histogram.load(std::memory_order_acquire);
+            if (own == nullptr)
+                return;
+            for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+                dst.buckets[i] += own->buckets[i].load(std::memory_order_relaxed);
+        }
+
+    private:
+        static void _inc(std::atomic<qword>& field, qword delta)
+        {
+            field.store(field.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+
+        Histogram& _obtainHistogram()
+        {
+            Histogram* own = histogram.load(std::memory_order_relaxed);
+            if (own == nullptr)
+            {
+                own = new Histogram();
+                histogram.store(own, std::memory_order_release);
+            }
+            return *own;
+        }
+
+        void _clear()
+        {
+            count.store(0, std::memory_order_relaxed);
+            value.store(0, std::memory_order_relaxed);
+            max_value.store(0, std::memory_order_relaxed);
+            Histogram* own = histogram.load(std::memory_order_relaxed);
+            if (own == nullptr)
+                return;
+            for (auto& bucket : own->buckets)
+                bucket.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    struct Slot
+    {
+        // 0 if not used, otherwise Record::RecordType + 1
+        std::atomic<int> type;
+        Data current, total;
+    };
+
+    // Slots are allocated in blocks that never move, so readers can walk
+    // them while the owner thread keeps adding new labels
+    enum
+    {
+        BLOCK_SIZE = 16,
+        MAX_BLOCKS = MAX_LABELS / BLOCK_SIZE
+    };
+
+    struct Block
+    {
+        Slot slots[BLOCK_SIZE];
+    };
+
+    // Trace events ring buffer. Only the owner thread writes; a reader
+    // discards the entries that could have been overwritten while reading.
+    enum
+    {
+        TRACE_BUFFER_SIZE = 1 << 16,
+        // Trace buffers of finished threads are kept for the next dump
+        MAX_FINISHED_TRACES = 64
+    };
+
+    struct TraceEvent
+    {
+        std::atomic<qword> timestamp, session_id;
+        std::atomic<int> name_index;
+        std::atomic<bool> begin;
+    };
+
+    struct Registry
+    {
+        std::mutex lock;
+        std::vector<ThreadRecords*> threads;
+        std::vector<ThreadRecords*> finished_traces;
+        ThreadRecords* retired;
+        std::atomic<unsigned> current_epoch, total_epoch;
+        std::atomic<bool> tracing;
+        std::atomic<qword> trace_start;
+        int next_thread_id;
+
+        Registry() : retired(new ThreadRecords()), current_epoch(1), total_epoch(1), tracing(false), trace_start(0), next_thread_id(1)
+        {
+        }
+    };
+
+    std::atomic<Block*> blocks[MAX_BLOCKS];
+    std::atomic<TraceEvent*> trace_events;
+    std::atomic<qword> trace_head;
+    int thread_id;
+    // Guarded by the registry lock: events before trace_dumped have been
+    // written already, trace_depth is the scope depth at that point
+    qword trace_dumped;
+    int trace_depth;
+
+    ThreadRecords() : trace_events(nullptr), trace_head(0), thread_id(0), trace_dumped(0), trace_depth(0)
+    {
+        for (auto& block : blocks)
+            block.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~ThreadRecords()
+    {
+        releaseBlocks();
+        delete[] trace_events.load(std::memory_order_relaxed);
+    }
+
+    void releaseBlocks()
+    {
+        for (auto& block : blocks)
+            delete block.exchange(nullptr, std::memory_order_relaxed);
+    }
+
+    void addTraceEvent(int name_index, bool begin, qword timestamp)
+    {
+        TraceEvent* events = trace_events.load(std::memory_order_relaxed);
+        if (events == nullptr)
+        {
+            events = new TraceEvent[TRACE_BUFFER_SIZE]();
+            trace_events.store(events, std::memory_order_release);
+        }
+        const qword head = trace_head.load(std::memory_order_relaxed);
+        TraceEvent& event = events[head % TRACE_BUFFER_SIZE];
+        event.timestamp.store(timestamp, std::memory_order_relaxed);
+        event.session_id.store(TL_GET_SESSION_ID(), std::memory_order_relaxed);
+        event.name_index.store(name_index, std::memory_order_relaxed);
+        event.begin.store(begin, std::memory_order_relaxed);
+        trace_head.store(head + 1, std::memory_order_release);
+    }
+
+    const Slot* getSlot(int name_index) const
+    {
+        const Block* block = blocks[name_index / BLOCK_SIZE].load(std::memory_order_acquire);
+        if (block == nullptr)
+            return nullptr;
+        return &block->slots[name_index % BLOCK_SIZE];
+    }
+
+    Slot& obtainSlot(int name_index)
+    {
+        std::atomic<Block*>& block_ptr = blocks[name_index / BLOCK_SIZE];
+        Block* block = block_ptr.load(std::memory_order_relaxed);
+        if (block == nullptr)
+        {
+            // Value-initialization zeroes all the atomics
+            block = new Block();
+            block_ptr.store(block, std::memory_order_release);
+        }
+        return block->slots[name_index % BLOCK_SIZE];
+    }
+
+    void add(int name_index, Record::RecordType type, qword value)
+    {
+        if (name_index < 0 || name_index >= BLOCK_SIZE * MAX_BLOCKS)
+            return;
+        Registry& reg = registry();
+        Slot& slot = obtainSlot(name_index);
+        slot.type.store(static_cast<int>(type) + 1, std::memory_order_relaxed);
+        slot.current.add(reg.current_epoch.load(std::memory_order_relaxed), value);
+        slot.total.add(reg.total_epoch.load(std::memory_order_relaxed), value);
+    }
+
+    // Called under the registry lock
+    void merge(const ThreadRecords& other, unsigned current_epoch, unsigned total_epoch)
+    {
+        for (int i = 0; i < BLOCK_SIZE * MAX_BLOCKS; i++)
+        {
+            const Slot* other_slot = other.getSlot(i);
+            if (other_slot == nullptr)
+            {
+                i += BLOCK_SIZE - 1;
+                continue;
+            }
+            int type = other_slot->type.load(std::memory_order_relaxed);
+            if (type == 0)
+                continue;
+            Slot& slot = obtainSlot(i);
+            slot.type.store(type, std::memory_order_relaxed);
+            slot.current.merge(other_slot->current, current_epoch);
+            slot.total.merge(other_slot->total, total_epoch);
+        }
+    }
+
+    static Registry& registry()
+    {
+        // Intentionally leaked: threads may exit after static destructors
+        static Registry* _registry = new Registry();
+        return *_registry;
+    }
+
+    static ThreadRecords& local()
+    {
+        struct Holder
+        {
+            ThreadRecords* records;
+
+            Holder() : records(new ThreadRecords())
+            {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> guard(reg.lock);
+                records->thread_id = reg.next_thread_id++;
+                reg.threads.push_back(records);
+            }
+
+            ~Holder()
+            {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> guard(reg.lock);
+                reg.retired->merge(*records, reg.current_epoch.load(), reg.total_epoch.load());
+                reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), records));
+                if (records->trace_events.load() == nullptr)
+                {
+                    delete records;
+                    return;
+                }
+                records->releaseBlocks();
+                reg.finished_traces.push_back(records);
+                if (reg.finished_traces.size() > MAX_FINISHED_TRACES)
+                {
+                    delete reg.finished_traces.front();
+                    reg.finished_traces.erase(reg.finished_traces.begin());
+                }
+            }
+        };
+
+        static thread_local Holder _holder;
+        return *_holder.records;
+    }
+};
+
 //
 // ProfilingTimer
 //
 
-ProfilingTimer::ProfilingTimer(int name_index) : _name_index(name_index), _start_time(nanoClock()), _dt(0)
+ProfilingTimer::ProfilingTimer(int name_index) : _name_index(name_index), _start_time(nanoClock()), _dt(0), _traced(ProfilingSystem::isTracing())
 {
+    if (_traced)
+    {
+        ProfilingSystem::addTraceEvent(_name_index, true, _start_time);
+    }
 }
 
 ProfilingTimer::~ProfilingTimer()
@@ -49,9 +360,10 @@ qword ProfilingTimer::stop()
         return 0;
     }
     _dt = nanoClock() - _start_time;
+    ProfilingSystem::addTimer(_name_index, _dt);
+    if (_traced)
     {
-        auto inst = sf::xlock_safe_ptr(ProfilingSystem::getInstance());
-        inst->addTimer(_name_index, _dt);
+        ProfilingSystem::addTraceEvent(_name_index, false, _start_time + _dt);
     }
     _name_index = -1;
     return _dt;
@@ -77,10 +389,6 @@ float ProfilingTimer::getTimeSec() const
 
 IMPL_ERROR(ProfilingSystem, "Profiling system");
 
-namespace indigo
-{
-}
-
 sf::safe_shared_hide_obj<ProfilingSystem>& ProfilingSystem::getInstance()
 {
     static sf::safe_shared_hide_obj<ProfilingSystem> _profiling_system;
@@ -100,6 +408,15 @@ int ProfilingSystem::getNameIndex(const char* name, bool add_if_not_exists)
     {
         return -1;
     }
+    if (_names.size() >= MAX_LABELS - 1)
+    {
+        // Out of slots: all further labels share the last one
+        if (_names.size() == MAX_LABELS - 1)
+        {
+            _names.push().readString(OVERFLOW_LABEL, true);
+        }
+        return MAX_LABELS - 1;
+    }
     // Add new label
     Array<char>& name_record = _names.push();
     name_record.copy(name, static_cast<int>(strlen(name)) + 1);
@@ -108,30 +425,68 @@ int ProfilingSystem::getNameIndex(const char* name, bool add_if_not_exists)
 
 void ProfilingSystem::addTimer(const int name_index, const qword dt)
 {
-    _ensureRecordExistanceLocked(name_index);
-    Record& rec = _records[name_index];
-    rec.type = Record::RecordType::TYPE_TIMER;
-    rec.current.add(dt);
-    rec.total.add(dt);
+    ThreadRecords::local().add(name_index, Record::RecordType::TYPE_TIMER, dt);
 }
 
 void ProfilingSystem::addCounter(const int name_index, const int value)
 {
-    _ensureRecordExistanceLocked(name_index);
-    Record& rec = _records[name_index];
-    rec.type = Record::RecordType::TYPE_COUNTER;
-    rec.current.add(value);
-    rec.total.add(value);
+    ThreadRecords::local().add(name_index, Record::RecordType::TYPE_COUNTER, value);
 }
 
 void ProfilingSystem::reset(const bool all)
 {
+    ThreadRecords::Registry& reg = ThreadRecords::registry();
+    reg.current_epoch++;
+    if (all)
+    {
+        reg.total_epoch++;
+    }
     for (int i = 0; i < _records.size(); i++)
     {
         _records[i].reset(all);
     }
 }
 
+void ProfilingSystem::_aggregate()
+{
+    ThreadRecords::Registry& reg = ThreadRecords::registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+
+    _ensureRecordExistanceLocked(_names.size() - 1);
+    for (int i = 0; i < _records.size(); i++)
+    {
+        _records[i].reset(true);
+    }
+
+    const unsigned current_epoch = reg.current_epoch.load();
+    const unsigned total_epoch = reg.total_epoch.load();
+
+    auto collect = [&](const ThreadRecords& thread_records) {
+        for (int i = 0; i < _records.size(); i++)
+        {
+            const ThreadRecords::Slot* slot = thread_records.getSlot(i);
+            if (slot == nullptr)
+            {
+                i += ThreadRecords::BLOCK_SIZE - 1 - i % ThreadRecords::BLOCK_SIZE;
+                continue;
+            }
+            int type = slot->type.load(std::memory_order_relaxed);
+            if (type == 0)
+                continue;
+            Record& rec = _records[i];
+            rec.type = static_cast<Record::RecordType>(type - 1);
+            slot->current.collect(current_epoch, rec.current);
+            slot->total.collect(total_epoch, rec.total);
+        }
+    };
+
+    collect(*reg.retired);
+    for (const ThreadRecords* thread_records : reg.threads)
+    {
+        collect(*thread_records);
+    }
+}
+
 int ProfilingSystem::_recordsCmp(const int idx1, const int idx2, void* context)
 {
     auto* this_ = static_cast<ProfilingSystem*>(context);
@@ -140,6 +495,8 @@ int ProfilingSystem::_recordsCmp(const int idx1, const int idx2, void* context)
 
 void ProfilingSystem::getStatistics(Output& output, const bool get_all)
 {
+    _aggregate();
+
     // Print formatted statistics
     while (_sorted_records.size() < _records.size())
     {
@@ -147,31 +504,16 @@ void ProfilingSystem::getStatistics(Output& output, const bool get_all)
     }
     _sorted_records.qsort(_recordsCmp, this);
 
-    // Find maximum name length
-    int max_len = 0;
-    for (int i = 0; i < _records.size(); i++)
-    {
-        if (!_hasLabelIndex(i))
-        {
-            continue;
-        }
-
-        if (_names.at(i).size() > max_len)
-        {
-            max_len = _names.at(i).size();
-        }
-    }
-
     SmartTableOutput table_output(output, true);
 
-    table_output.setLineFormat("|c|5c|5c|");
+    table_output.setLineFormat("|c|7c|7c|");
     table_output.printHLine();
-    table_output.printf("Name\tStatistics\t\t\t\t\tSession statistics\t\t\t\t\n");
-    table_output.setLineFormat("|l|ccccc|ccccc|");
-    table_output.printf("\ttotal\tcount\tavg.\tst.dev.\tmax\ttotal\tcount\tavg.\tst.dev.\tmax\n");
+    table_output.printf("Name\tStatistics\t\t\t\t\t\t\tSession statistics\t\t\t\t\t\t\n");
+    table_output.setLineFormat("|l|ccccccc|ccccccc|");
+    table_output.printf("\ttotal\tcount\tavg.\tp50\tp90\tp99\tmax\ttotal\tcount\tavg.\tp50\tp90\tp99\tmax\n");
     table_output.printHLine();
 
-    table_output.setLineFormat("|l|rrrrr|rrrrr|");
+    table_output.setLineFormat("|l|rrrrrrr|rrrrrrr|");
 
     for (int i = 0; i < _sorted_records.size(); i++)
     {
@@ -204,36 +546,35 @@ void ProfilingSystem::getStatistics(Output& output, const bool get_all)
     table_output.flush();
 }
 
-void ProfilingSystem::_printTimerData(const Record::Data& data, Output& output) const
+void ProfilingSystem::_printTimerData(const Record::Data& data, Output& output)
 {
     if (data.count == 0)
     {
-        output.printf("-\t0\t\t\t");
+        output.printf("-\t0\t\t\t\t\t");
         return;
     }
     float total_sec = nanoHowManySeconds(data.value);
     float avg_ms = nanoHowManySeconds(data.value / data.count) * 1000;
+    float p50_ms = nanoHowManySeconds(data.percentile(0.5f)) * 1000;
+    float p90_ms = nanoHowManySeconds(data.percentile(0.9f)) * 1000;
+    float p99_ms = nanoHowManySeconds(data.percentile(0.99f)) * 1000;
     float max_ms = nanoHowManySeconds(data.max_value) * 1000;
 
-    double avg_value = (double)data.value / data.count;
-    double sigma_sq = data.square_sum / data.count - avg_value * avg_value;
-    float sigma_ms = nanoHowManySeconds((qword)sqrt(sigma_sq)) * 1000;
-
-    output.printf("%0.2fs\t%0.0lf\t%0.1fms\t%0.1lfms\t%0.1fms", total_sec, (double)data.count, avg_ms, sigma_ms, max_ms);
+    output.printf("%0.2fs\t%0.0lf\t%0.1fms\t%0.1fms\t%0.1fms\t%0.1fms\t%0.1fms", total_sec, (double)data.count, avg_ms, p50_ms, p90_ms, p99_ms, max_ms);
 }
 
 void ProfilingSystem::_printCounterData(const Record::Data& data, Output& output)
 {
     if (data.count == 0)
     {
-        output.printf("-\t0\t\t\t");
+        output.printf("-\t0\t\t\t\t\t");
         return;
     }
     float avg_value = (float)data.value / data.count;
 
     // To avoid platform-specific code qwords were casted to doubles
-    double sigma_sq = data.square_sum / data.count - avg_value * avg_value;
-    output.printf("%0.0lf\t%0.0lf\t%0.1f\t%0.1lf\t%0.0lf", (double)data.value, (double)data.count, avg_value, sqrt(sigma_sq), (double)data.max_value);
+    output.printf("%0.0lf\t%0.0lf\t%0.1f\t%0.0lf\t%0.0lf\t%0.0lf\t%0.0lf", (double)data.value, (double)data.count, avg_value, (double)data.percentile(0.5f),
+                  (double)data.percentile(0.9f), (double)data.percentile(0.99f), (double)data.max_value);
 }
 
 bool ProfilingSystem::_hasLabelIndex(const int name_index) const
@@ -252,6 +593,7 @@ bool ProfilingSystem::hasLabel(const char* name)
     {
         return false;
     }
+    _aggregate();
     return _hasLabelIndex(name_index);
 }
 
@@ -266,7 +608,7 @@ void ProfilingSystem::_ensureRecordExistanceLocked(const int name_index)
 float ProfilingSystem::getLabelExecTime(const char* name, const bool total)
 {
     int idx = getNameIndex(name);
-    _ensureRecordExistanceLocked(idx);
+    _aggregate();
 
     if (total)
     {
@@ -278,7 +620,7 @@ float ProfilingSystem::getLabelExecTime(const char* name, const bool total)
 qword ProfilingSystem::getLabelValue(const char* name, const bool total)
 {
     int idx = getNameIndex(name);
-    _ensureRecordExistanceLocked(idx);
+    _aggregate();
     if (total)
     {
         return _records[idx].total.value;
@@ -289,7 +631,7 @@ qword ProfilingSystem::getLabelValue(const char* name, const bool total)
 qword ProfilingSystem::getLabelCallCount(const char* name, const bool total)
 {
     int idx = getNameIndex(name);
-    _ensureRecordExistanceLocked(idx);
+    _aggregate();
     if (total)
     {
         return _records[idx].total.count;
@@ -297,6 +639,182 @@ qword ProfilingSystem::getLabelCallCount(const char* name, const bool total)
     return _records[idx].current.count;
 }
 
+qword ProfilingSystem::getLabelPercentile(const char* name, const float percentile, const bool total)
+{
+    int idx = getNameIndex(name);
+    _aggregate();
+    if (total)
+    {
+        return _records[idx].total.percentile(percentile);
+    }
+    return _records[idx].current.percentile(percentile);
+}
+
+void ProfilingSystem::setTracing(const bool enabled)
+{
+    ThreadRecords::Registry& reg = ThreadRecords::registry();
+    if (enabled)
+    {
+        // Events recorded before this moment are skipped by writeTrace
+        reg.trace_start = nanoClock();
+    }
+    reg.tracing = enabled;
+}
+
+bool ProfilingSystem::isTracing()
+{
+    return ThreadRecords::registry().tracing.load(std::memory_order_relaxed);
+}
+
+void ProfilingSystem::addTraceEvent(const int name_index, const bool begin, const qword timestamp)
+{
+    if (name_index < 0)
+    {
+        return;
+    }
+    ThreadRecords::local().addTraceEvent(name_index, begin, timestamp);
+}
+
+void ProfilingSystem::writeTrace(Output& output)
+{
+    ThreadRecords::Registry& reg = ThreadRecords::registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+
+    const qword trace_start = reg.trace_start.load();
+    // Timestamps are in nanoClock ticks, Chrome trace format expects microseconds
+    const double us_per_tick = nanoHowManySeconds(1000000000ULL) / 1000.0;
+
+    output.writeString("{\"traceEvents\":[");
+    bool first = true;
+
+    auto write_thread = [&](ThreadRecords& thread_records) {
+        const ThreadRecords::TraceEvent* events = thread_records.trace_events.load(std::memory_order_acquire);
+        if (events == nullptr)
+        {
+            return;
+        }
+        const qword head = thread_records.trace_head.load(std::memory_order_acquire);
+        const qword size = ThreadRecords::TRACE_BUFFER_SIZE;
+        qword from = std::max(head > size ? head - size : 0, thread_records.trace_dumped);
+
+        struct Event
+        {
+            qword timestamp, session_id;
+            int name_index;
+            bool begin;
+        };
+        std::vector<Event> copy;
+        copy.reserve(static_cast<size_t>(head - from));
+        for (qword i = from; i < head; i++)
+        {
+            const ThreadRecords::TraceEvent& event = events[i % size];
+            copy.push_back({event.timestamp.load(std::memory_order_relaxed), event.session_id.load(std::memory_order_relaxed),
+                            event.name_index.load(std::memory_order_relaxed), event.begin.load(std::memory_order_relaxed)});
+        }
+        // Drop entries the owner thread could have overwritten meanwhile
+        const qword head_after = thread_records.trace_head.load(std::memory_order_acquire);
+        const qword skip = (head_after > size && head_after - size > from) ? head_after - size - from : 0;
+
+        // The open scopes are known only if no event was lost since the previous dump
+        int depth = (from == thread_records.trace_dumped && skip == 0) ? thread_records.trace_depth : 0;
+        for (size_t i = static_cast<size_t>(std::min<qword>(skip, copy.size())); i < copy.size(); i++)
+        {
+            const Event& event = copy[i];
+            if (event.timestamp < trace_start || event.name_index >= _names.size())
+            {
+                continue;
+            }
+            // The ring buffer may start in the middle of a scope
+            if (!event.begin && depth == 0)
+            {
+                continue;
+            }
+            depth += event.begin ? 1 : -1;
+
+            if (!first)
+            {
+                output.writeChar(',');
+            }
+            first = false;
+            output.writeString("{\"name\":");
+            _writeJsonString(_names.at(event.name_index).ptr(), output);
+            output.printf(",\"cat\":\"indigo\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%llu,\"tid\":%d}", event.begin ? 'B' : 'E',
+                          (double)(event.timestamp - trace_start) * us_per_tick, (unsigned long long)event.session_id, thread_records.thread_id);
+        }
+        thread_records.trace_dumped = head;
+        thread_records.trace_depth = depth;
+    };
+
+    for (ThreadRecords* thread_records : reg.finished_traces)
+    {
+        write_thread(*thread_records);
+        // Nothing is added to the buffers of finished threads
+        delete thread_records;
+    }
+    reg.finished_traces.clear();
+    for (ThreadRecords* thread_records : reg.threads)
+    {
+        write_thread(*thread_records);
+    }
+
+    output.writeString("],\"displayTimeUnit\":\"ms\"}\n");
+    output.flush();
+}
+
+void ProfilingSystem::_writeJsonString(const char* str, Output& output)
+{
+    output.writeChar('"');
+    for (const char* c = str; *c != 0; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            output.writeChar('\\');
+            output.writeChar(*c);
+        }
+        else if (static_cast<unsigned char>(*c) < 0x20)
+        {
+            output.printf("\\u%04x", static_cast<unsigned char>(*c));
+        }
+        else
+        {
+            output.writeChar(*c);
+        }
+    }
+    output.writeChar('"');
+}
+
+int ProfilingSystem::histogramBucket(const qword value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS)
+    {
+        return static_cast<int>(value);
+    }
+    // Position of the most significant bit
+    int msb = 0;
+    qword v = value;
+    for (int shift = 32; shift > 0; shift >>= 1)
+    {
+        if (v >> shift)
+        {
+            v >>= shift;
+            msb += shift;
+        }
+    }
+    const int sub = static_cast<int>(value >> (msb - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return HISTOGRAM_SUB_BUCKETS + (msb - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+qword ProfilingSystem::histogramBucketLowerBound(const int bucket)
+{
+    if (bucket < HISTOGRAM_SUB_BUCKETS)
+    {
+        return static_cast<qword>(bucket);
+    }
+    const int k = bucket - HISTOGRAM_SUB_BUCKETS;
+    const int shift = k / HISTOGRAM_SUB_BUCKETS;
+    return static_cast<qword>(HISTOGRAM_SUB_BUCKETS + k % HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
 //
 // ProfilingSystem::Record
 //
@@ -313,7 +831,7 @@ void ProfilingSystem::Record::reset(const bool all)
 // ProfilingSystem::Record::Data
 //
 
-ProfilingSystem::Record::Data::Data() : count(0), value(0), max_value(0), square_sum(0.0)
+ProfilingSystem::Record::Data::Data() : count(0), value(0), max_value(0)
 {
     reset();
 }
@@ -321,15 +839,34 @@ ProfilingSystem::Record::Data::Data() : count(0), value(0), max_value(0), square
 void ProfilingSystem::Record::Data::reset()
 {
     count = value = max_value = 0;
-    square_sum = 0;
+    std::fill(buckets, buckets + HISTOGRAM_BUCKETS, 0);
 }
 
-void ProfilingSystem::Record::Data::add(const qword adding_value)
+qword ProfilingSystem::Record::Data::percentile(const float p) const
 {
-    count++;
-    value += adding_value;
-    max_value = std::max(max_value, adding_value);
+    if (count == 0)
+    {
+        return 0;
+    }
+    qword rank = static_cast<qword>(std::ceil(p * count));
+    if (rank >= count)
+    {
+        return max_value;
+    }
+    rank = std::max<qword>(1, rank);
 
-    const auto adding_value_dbl = static_cast<double>(adding_value);
-    square_sum += adding_value_dbl * adding_value_dbl;
+    qword seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen < rank)
+        {
+            continue;
+        }
+        // Report the middle of the bucket, but never above the exact maximum
+        const qword lower = histogramBucketLowerBound(i);
+        const qword upper = (i + 1 < HISTOGRAM_BUCKETS) ? histogramBucketLowerBound(i + 1) - 1 : max_value;
+        return std::min(lower + (upper - lower) / 2, max_value);
+    }
+    return max_value;
 }
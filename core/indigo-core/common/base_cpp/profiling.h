@@ -27,8 +27,8 @@
 #include "base_cpp/os_sync_wrapper.h"
 
 #define PROF_GET_NAME_INDEX(var_name, name)                                                                                                                    \
-    static std::atomic<int> var_name##_name_index;                                                                                                             \
-    if (var_name##_name_index == 0)                                                                                                                            \
+    static std::atomic<int> var_name##_name_index(-1);                                                                                                         \
+    if (var_name##_name_index == -1)                                                                                                                           \
     {                                                                                                                                                          \
         auto inst = sf::xlock_safe_ptr(indigo::ProfilingSystem::getInstance());                                                                                \
         var_name##_name_index = inst->getNameIndex(name);                                                                                                      \
@@ -48,16 +48,14 @@
     do                                                                                                                                                         \
     {                                                                                                                                                          \
         PROF_GET_NAME_INDEX(var_name, name)                                                                                                                    \
-        auto inst = sf::xlock_safe_ptr(indigo::ProfilingSystem::getInstance());                                                                                \
-        inst->addTimer(var_name##_name_index, dt);                                                                                                             \
+        indigo::ProfilingSystem::addTimer(var_name##_name_index, dt);                                                                                          \
     } while (false)
 
 #define profIncCounter(name, count)                                                                                                                            \
     do                                                                                                                                                         \
     {                                                                                                                                                          \
         PROF_GET_NAME_INDEX(var_name, name)                                                                                                                    \
-        auto inst = sf::xlock_safe_ptr(indigo::ProfilingSystem::getInstance());                                                                                \
-        inst->addCounter(var_name##_name_index, count);                                                                                                        \
+        indigo::ProfilingSystem::addCounter(var_name##_name_index, count);                                                                                     \
     } while (false)
 
 #define profTimersReset() sf::xlock_safe_ptr(indigo::ProfilingSystem::getInstance())->reset(false)
@@ -65,19 +63,27 @@
 
 #define profGetStatistics(output, all) sf::xlock_safe_ptr(indigo::ProfilingSystem::getInstance())->getStatistics(output, all)
 
+#define profTraceEnable(enabled) indigo::ProfilingSystem::setTracing(enabled)
+#define profTraceDump(output) sf::xlock_safe_ptr(indigo::ProfilingSystem::getInstance())->writeTrace(output)
+
 namespace indigo
 {
     class Output;
 
+    // Timers and counters are accumulated lock-free into per-thread records;
+    // the instance lock is only needed to register label names and to
+    // aggregate the per-thread records when statistics are requested.
     class DLLEXPORT ProfilingSystem
     {
     public:
         static sf::safe_shared_hide_obj<ProfilingSystem>& getInstance();
 
+        // At most MAX_LABELS labels are kept apart. Labels registered past
+        // that share the last index, reported as OVERFLOW_LABEL.
         int getNameIndex(const char* name, bool add_if_not_exists = true);
 
-        void addTimer(int name_index, qword dt);
-        void addCounter(int name_index, int value);
+        static void addTimer(int name_index, qword dt);
+        static void addCounter(int name_index, int value);
         void reset(bool all);
         void getStatistics(Output& output, bool get_all);
 
@@ -85,10 +91,41 @@ namespace indigo
         float getLabelExecTime(const char* name, bool total = false);
         qword getLabelValue(const char* name, bool total = false);
         qword getLabelCallCount(const char* name, bool total = false);
+        qword getLabelPercentile(const char* name, float percentile, bool total = false);
+
+        // Opt-in tracing: begin and end of every ProfilingTimer scope are
+        // recorded into per-thread ring buffers and can be written out in
+        // the Chrome trace event format (chrome://tracing, Perfetto)
+        static void setTracing(bool enabled);
+        static bool isTracing();
+        static void addTraceEvent(int name_index, bool begin, qword timestamp);
+        // Writes the events recorded since the previous call
+        void writeTrace(Output& output);
 
         DECL_ERROR;
 
+        enum
+        {
+            MAX_LABELS = 4096
+        };
+
+        static constexpr const char* OVERFLOW_LABEL = "(other labels)";
+
+        // Log-linear histogram: values below 4 are exact, every further power
+        // of two is split into 4 sub-buckets (~12% relative error)
+        enum
+        {
+            HISTOGRAM_SUB_BITS = 2,
+            HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS,
+            HISTOGRAM_BUCKETS = HISTOGRAM_SUB_BUCKETS + (64 - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB_BUCKETS
+        };
+
+        static int histogramBucket(qword value);
+        static qword histogramBucketLowerBound(int bucket);
+
     private:
+        struct ThreadRecords;
+
         struct Record
         {
             enum class RecordType
@@ -100,13 +137,13 @@ namespace indigo
             struct Data
             {
                 qword count, value, max_value;
-                double square_sum;
+                qword buckets[HISTOGRAM_BUCKETS];
 
                 Data();
 
                 void reset();
 
-                void add(qword value);
+                qword percentile(float p) const;
             };
 
             Data current, total;
@@ -118,11 +155,13 @@ namespace indigo
 
         static int _recordsCmp(int idx1, int idx2, void* context);
 
-        void _printTimerData(const Record::Data& data, Output& output) const;
+        static void _printTimerData(const Record::Data& data, Output& output);
         static void _printCounterData(const Record::Data& data, Output& output);
+        static void _writeJsonString(const char* str, Output& output);
 
         bool _hasLabelIndex(int name_index) const;
         void _ensureRecordExistanceLocked(int name_index);
+        void _aggregate();
 
         ObjArray<Array<char>> _names;
         ObjArray<Record> _records;
@@ -146,5 +185,6 @@ namespace indigo
     private:
         int _name_index;
         qword _start_time, _dt;
+        bool _traced;
     };
 }
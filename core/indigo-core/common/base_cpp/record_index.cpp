@@ -0,0 +1,143 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "base_cpp/record_index.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include "base_cpp/output.h"
+#include "base_cpp/scanner.h"
+
+using namespace indigo;
+
+IMPL_ERROR(RecordIndex, "record index");
+
+// Header: magic, then version, file size, file modification time, end offset,
+// record count and access point data size as 64-bit words in native byte order,
+// followed by the offsets and the access point data
+static const char _MAGIC[8] = {'I', 'N', 'D', 'I', 'G', 'O', 'I', 'X'};
+static const long long _VERSION = 2;
+static const int _HEADER_WORDS = 6;
+
+// Offsets are read and written in chunks, as the byte count is an int
+static const int _CHUNK = 1 << 20;
+
+RecordIndex::RecordIndex() : end_offset(0LL)
+{
+}
+
+void RecordIndex::getSidecarName(const char* filename, Array<char>& sidecar)
+{
+    sidecar.readString(filename, false);
+    sidecar.appendString(".idx", true);
+}
+
+bool RecordIndex::load(Encoding filename_encoding, const char* filename)
+{
+    offsets.clear();
+    access_points.clear();
+    end_offset = 0LL;
+
+    long long file_size, file_mtime, sidecar_size, sidecar_mtime;
+    Array<char> sidecar;
+
+    getSidecarName(filename, sidecar);
+    if (!getFileInfo(filename_encoding, filename, file_size, file_mtime) || !getFileInfo(filename_encoding, sidecar.ptr(), sidecar_size, sidecar_mtime))
+        return false;
+
+    try
+    {
+        FileScanner scanner(filename_encoding, sidecar.ptr());
+        char magic[sizeof(_MAGIC)];
+        long long header[_HEADER_WORDS];
+
+        if (sidecar_size < (long long)(sizeof(magic) + sizeof(header)))
+            return false;
+
+        scanner.read(sizeof(magic), magic);
+        scanner.read(sizeof(header), header);
+
+        long long count = header[4];
+        long long access_points_size = header[5];
+
+        if (memcmp(magic, _MAGIC, sizeof(magic)) != 0 || header[0] != _VERSION || header[1] != file_size || header[2] != file_mtime)
+            return false;
+        if (count < 0 || count > 0x7FFFFFFF || access_points_size < 0 || access_points_size > 0x7FFFFFFF)
+            return false;
+        if (sidecar_size != (long long)(sizeof(magic) + sizeof(header)) + count * (long long)sizeof(long long) + access_points_size)
+            return false;
+
+        end_offset = header[3];
+        offsets.clear_resize((int)count);
+
+        for (int i = 0; i < offsets.size(); i += _CHUNK)
+        {
+            int n = std::min(_CHUNK, offsets.size() - i);
+            scanner.read(n * (int)sizeof(long long), offsets.ptr() + i);
+        }
+
+        access_points.clear_resize((int)access_points_size);
+        if (access_points.size() > 0)
+            scanner.read(access_points.size(), access_points.ptr());
+    }
+    catch (Exception&)
+    {
+        offsets.clear();
+        access_points.clear();
+        end_offset = 0LL;
+        return false;
+    }
+    return true;
+}
+
+void RecordIndex::save(Encoding filename_encoding, const char* filename) const
+{
+    long long file_size, file_mtime;
+
+    if (!getFileInfo(filename_encoding, filename, file_size, file_mtime))
+        throw Error("can't access %s", filename);
+
+    Array<char> sidecar, temp;
+
+    getSidecarName(filename, sidecar);
+    temp.copy(sidecar);
+    temp.pop();
+    temp.appendString(".tmp", true);
+
+    {
+        FileOutput output(filename_encoding, temp.ptr());
+        long long header[_HEADER_WORDS] = {_VERSION, file_size, file_mtime, end_offset, offsets.size(), access_points.size()};
+
+        output.write(_MAGIC, sizeof(_MAGIC));
+        output.write(header, sizeof(header));
+        for (int i = 0; i < offsets.size(); i += _CHUNK)
+            output.write(offsets.ptr() + i, std::min(_CHUNK, offsets.size() - i) * (int)sizeof(long long));
+        if (access_points.size() > 0)
+            output.write(access_points.ptr(), access_points.size());
+    }
+
+    // Readers never see a partially written sidecar
+    remove(sidecar.ptr());
+    if (rename(temp.ptr(), sidecar.ptr()) != 0)
+    {
+        remove(temp.ptr());
+        throw Error("can't write %s", sidecar.ptr());
+    }
+}
@@ -0,0 +1,61 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __record_index_h__
+#define __record_index_h__
+
+#include "base_cpp/array.h"
+#include "base_cpp/exception.h"
+#include "base_cpp/io_base.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    // Offsets of the records in a multi-record file (SDF, RDF, SMILES), kept in a
+    // sidecar file "<filename>.idx" next to it. The sidecar is only accepted for
+    // the file size and modification time it was written for.
+    class DLLEXPORT RecordIndex
+    {
+    public:
+        DECL_ERROR;
+
+        RecordIndex();
+
+        // Returns false if the sidecar is missing, damaged or was written for another version of the file
+        bool load(Encoding filename_encoding, const char* filename);
+        void save(Encoding filename_encoding, const char* filename) const;
+
+        static void getSidecarName(const char* filename, Array<char>& sidecar);
+
+        Array<long long> offsets;
+        long long end_offset; // position after the last record
+        Array<char> access_points; // of a gzipped file, see GZipScanner::saveAccessPoints()
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
@@ -33,11 +33,6 @@
 
 using namespace indigo;
 
-enum
-{
-    MAX_LINE_LENGTH = 1048576
-};
-
 IMPL_ERROR(Scanner, "scanner");
 
 Scanner::~Scanner()
@@ -408,6 +403,11 @@ void Scanner::appendLine(Array<char>& out, bool append_zero)
         out.push(0);
 }
 
+bool Scanner::readLineView(const char*& /* line */, int& /* length */)
+{
+    return false;
+}
+
 void Scanner::readLine(Array<char>& out, bool append_zero)
 {
     out.clear();
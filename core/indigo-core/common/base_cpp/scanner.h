@@ -49,9 +49,14 @@ namespace indigo
         void read(int length, Array<char>& buf);
 
         void readLine(Array<char>& out, bool append_zero);
-        void appendLine(Array<char>& out, bool append_zero);
+        virtual void appendLine(Array<char>& out, bool append_zero);
         bool skipLine();
 
+        // Reads the next line without copying it, for scanners holding the whole input in memory.
+        // The line excludes the terminator and stays valid while the scanner lives.
+        // Returns false and reads nothing if the scanner does not support it.
+        virtual bool readLineView(const char*& line, int& length);
+
         virtual char readChar();
         word readBinaryWord();
         int readBinaryInt();
@@ -66,7 +71,7 @@ namespace indigo
         int readIntFix(int digits);
         void skipSpace();
 
-        void skipUntil(const char* delimiters);
+        virtual void skipUntil(const char* delimiters);
 
         float readFloat(void);
         bool tryReadFloat(float& value);
@@ -85,6 +90,11 @@ namespace indigo
         static bool isSingleLine(Scanner& scanner);
 
     protected:
+        enum
+        {
+            MAX_LINE_LENGTH = 1048576
+        };
+
         bool _readDouble(double& res, int max);
         void _prefixFunction(Array<char>& str, Array<int>& prefix);
     };
@@ -16,6 +16,8 @@
  * limitations under the License.
  ***************************************************************************/
 
+#include <cstdint>
+
 #include "base_cpp/tlscont.h"
 
 using namespace indigo;
@@ -57,6 +59,25 @@ void _SIDManager::releaseSessionId(qword id)
 
 qword& _SIDManager::_sessionId()
 {
-    static thread_local qword _sessionId;
-    return _sessionId;
+    return _SessionLocalCache::_state().session_id;
+}
+
+_SessionLocalCache::_ThreadState& _SessionLocalCache::_state()
+{
+    static thread_local _ThreadState _thread_state;
+    return _thread_state;
+}
+
+_SessionLocalCache::Entry& _SessionLocalCache::getEntry(const void* owner)
+{
+    const auto key = reinterpret_cast<uintptr_t>(owner);
+    return _state().entries[((key >> 4) ^ (key >> 12)) % CACHE_SIZE];
+}
+
+_SessionLocalCache::Entry& _SessionLocalCache::getEntry(const void* owner, qword& session_id)
+{
+    _ThreadState& state = _state();
+    const auto key = reinterpret_cast<uintptr_t>(owner);
+    session_id = state.session_id;
+    return state.entries[((key >> 4) ^ (key >> 12)) % CACHE_SIZE];
 }
@@ -19,6 +19,7 @@
 #ifndef __tlscont_h__
 #define __tlscont_h__
 
+#include <atomic>
 #include <memory>
 #include <stack>
 #include <typeinfo>
@@ -82,42 +83,144 @@ namespace indigo
 #define TL_ALLOC_SESSION_ID() _SIDManager::getInst().allocSessionId()
 #define TL_RELEASE_SESSION_ID(id) _SIDManager::getInst().releaseSessionId(id)
 
+    // Per-thread direct-mapped cache of session-local copies. Repeated lookups
+    // of an existing copy are served from it without touching the shared map.
+    // An entry is valid while the owner's generation is unchanged.
+    class DLLEXPORT _SessionLocalCache
+    {
+    public:
+        struct Entry
+        {
+            const void* owner;
+            qword session_id;
+            qword generation;
+            void* value;
+        };
+
+        static Entry& getEntry(const void* owner);
+        // The same with the current session ID, in one thread-local access
+        static Entry& getEntry(const void* owner, qword& session_id);
+
+    private:
+        friend class _SIDManager;
+
+        enum
+        {
+            CACHE_SIZE = 64
+        };
+
+        // The session ID of the thread is kept next to the cache
+        struct _ThreadState
+        {
+            qword session_id;
+            Entry entries[CACHE_SIZE];
+        };
+
+        static _ThreadState& _state();
+    };
+
     // Container that keeps one instance of specified type per session
     template <typename T>
     class _SessionLocalContainer
     {
     public:
+        _SessionLocalContainer() : _generation(1)
+        {
+        }
+
         T& createOrGetLocalCopy(const qword id = TL_GET_SESSION_ID())
         {
+            T* cached = _getCached(id);
+            if (cached != nullptr)
+            {
+                return *cached;
+            }
+            // Generation must be read before the lookup, see removeLocalCopy()
+            const qword generation = _generation.load(std::memory_order_acquire);
+            {
+                const auto map = sf::slock_safe_ptr(_map);
+                const auto it = map->find(id);
+                if (it != map->end())
+                {
+                    return *_cache(id, generation, it->second.get());
+                }
+            }
             auto map = sf::xlock_safe_ptr(_map);
-            if (!map->count(id))
+            auto& value = (*map)[id];
+            if (!value)
+            {
+                value = std::make_unique<T>();
+            }
+            return *_cache(id, generation, value.get());
+        }
+
+        // Copy of the current session. This is the path of every C API call.
+        T& getLocalCopy() const
+        {
+            qword id;
+            const _SessionLocalCache::Entry& entry = _SessionLocalCache::getEntry(this, id);
+            if (entry.owner == this && entry.session_id == id && entry.generation == _generation.load(std::memory_order_acquire))
             {
-                map->emplace(id, std::make_unique<T>());
+                return *static_cast<T*>(entry.value);
             }
-            return *map->at(id);
+            return getLocalCopy(id);
         }
 
         // FIXME:MK: it's not thread safe, decide what to do
-        T& getLocalCopy(const qword id = TL_GET_SESSION_ID()) const
+        T& getLocalCopy(const qword id) const
         {
+            T* cached = _getCached(id);
+            if (cached != nullptr)
+            {
+                return *cached;
+            }
+            const qword generation = _generation.load(std::memory_order_acquire);
             const auto map = sf::slock_safe_ptr(_map);
-            return *map->at(id);
+            return *_cache(id, generation, map->at(id).get());
         }
 
         void removeLocalCopy(const qword id = TL_GET_SESSION_ID())
         {
             auto map = sf::xlock_safe_ptr(_map);
             map->erase(id);
+            // Bumped after the erase: a concurrent lookup that still found
+            // the erased copy has cached it with the previous generation
+            _generation.fetch_add(1, std::memory_order_acq_rel);
         }
 
         bool hasLocalCopy(const qword id = TL_GET_SESSION_ID()) const
         {
+            if (_getCached(id) != nullptr)
+            {
+                return true;
+            }
             const auto map = sf::slock_safe_ptr(_map);
             return map->count(id) > 0;
         }
 
     private:
+        T* _getCached(const qword id) const
+        {
+            const _SessionLocalCache::Entry& entry = _SessionLocalCache::getEntry(this);
+            if (entry.owner == this && entry.session_id == id && entry.generation == _generation.load(std::memory_order_acquire))
+            {
+                return static_cast<T*>(entry.value);
+            }
+            return nullptr;
+        }
+
+        T* _cache(const qword id, const qword generation, T* value) const
+        {
+            _SessionLocalCache::Entry& entry = _SessionLocalCache::getEntry(this);
+            entry.owner = this;
+            entry.session_id = id;
+            entry.generation = generation;
+            entry.value = value;
+            return value;
+        }
+
         sf::safe_shared_hide_obj<std::unordered_map<qword, std::unique_ptr<T>>> _map;
+        std::atomic<qword> _generation;
     };
 
 // Macros for working with global variables per each session
@@ -18,13 +18,20 @@
 
 #include "gzip/gzip_output.h"
 
+#include <algorithm>
+#include <string.h>
+
 using namespace indigo;
 
 IMPL_ERROR(GZipOutput, "GZip output");
 
 CP_DEF(GZipOutput);
 
-GZipOutput::GZipOutput(Output& dest, int level) : _dest(dest), CP_INIT, TL_CP_GET(_outbuf), TL_CP_GET(_inbuf)
+// Empty BGZF member that marks the end of a BGZF file
+static const Bytef _BGZF_EOF[28] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static const int _BGZF_MAX_MEMBER = 65536;
+
+GZipOutput::GZipOutput(Output& dest, int level, bool bgzf) : _dest(dest), _bgzf(bgzf), CP_INIT, TL_CP_GET(_outbuf), TL_CP_GET(_inbuf)
 {
     _zstream.zalloc = Z_NULL;
     _zstream.zfree = Z_NULL;
@@ -46,10 +53,40 @@ GZipOutput::GZipOutput(Output& dest, int level) : _dest(dest), CP_INIT, TL_CP_GE
     _outbuf.clear_resize(CHUNK_SIZE);
     _inbuf.clear_resize(CHUNK_SIZE);
     _total_written = 0;
+    _block_size = 0;
+
+    if (_bgzf)
+    {
+        // "BC" subfield, the member size is filled in by _writeBlock()
+        memset(&_header, 0, sizeof(_header));
+        memcpy(_extra, "BC\x02\x00\x00\x00", sizeof(_extra));
+        _header.extra = _extra;
+        _header.extra_len = sizeof(_extra);
+        _header.os = 255;
+        deflateSetHeader(&_zstream, &_header);
+
+        _inbuf.clear_resize(BGZF_BLOCK_SIZE);
+        _outbuf.clear_resize(deflateBound(&_zstream, BGZF_BLOCK_SIZE));
+    }
 }
 
 GZipOutput::~GZipOutput()
 {
+    if (_bgzf)
+    {
+        try
+        {
+            if (_block_size > 0)
+                _writeBlock();
+            _dest.write(_BGZF_EOF, sizeof(_BGZF_EOF));
+        }
+        catch (Exception&)
+        {
+        }
+        deflateEnd(&_zstream);
+        return;
+    }
+
     _zstream.avail_in = 0;
     _zstream.next_in = Z_NULL;
 
@@ -66,6 +103,23 @@ void GZipOutput::write(const void* data, int size)
     if (size < 1)
         return;
 
+    if (_bgzf)
+    {
+        while (size > 0)
+        {
+            int n = std::min(size, _inbuf.size() - _block_size);
+
+            memcpy(_inbuf.ptr() + _block_size, data, n);
+            _block_size += n;
+            data = (const char*)data + n;
+            size -= n;
+
+            if (_block_size == _inbuf.size())
+                _writeBlock();
+        }
+        return;
+    }
+
     _zstream.avail_in = size;
     _zstream.next_in = (Bytef*)data;
 
@@ -80,6 +134,14 @@ void GZipOutput::write(const void* data, int size)
 
 void GZipOutput::flush()
 {
+    if (_bgzf)
+    {
+        if (_block_size > 0)
+            _writeBlock();
+        _dest.flush();
+        return;
+    }
+
     _zstream.avail_in = 0;
     _zstream.next_in = Z_NULL;
     _deflate(Z_FULL_FLUSH);
@@ -113,6 +175,34 @@ int GZipOutput::_deflate(int flush)
     return rc;
 }
 
+// Compresses the pending input into one BGZF member
+void GZipOutput::_writeBlock()
+{
+    deflateReset(&_zstream);
+    deflateSetHeader(&_zstream, &_header);
+
+    _zstream.next_in = _inbuf.ptr();
+    _zstream.avail_in = _block_size;
+    _zstream.next_out = _outbuf.ptr();
+    _zstream.avail_out = _outbuf.size();
+
+    int rc = deflate(&_zstream, Z_FINISH);
+
+    if (rc != Z_STREAM_END)
+        throw Error("unexpected zlib error (%d)", rc);
+
+    int n = _outbuf.size() - _zstream.avail_out;
+
+    if (n > _BGZF_MAX_MEMBER)
+        throw Error("BGZF member is too large");
+
+    _outbuf[16] = (Bytef)((n - 1) & 0xff);
+    _outbuf[17] = (Bytef)((n - 1) >> 8);
+    _dest.write(_outbuf.ptr(), n);
+    _total_written += n;
+    _block_size = 0;
+}
+
 long long GZipOutput::tell() const noexcept
 {
     return _total_written;
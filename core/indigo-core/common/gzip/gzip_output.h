@@ -32,10 +32,14 @@ namespace indigo
     public:
         enum
         {
-            CHUNK_SIZE = 32768
+            CHUNK_SIZE = 32768,
+            BGZF_BLOCK_SIZE = 0xff00
         };
 
-        explicit GZipOutput(Output& dest, int level);
+        // With bgzf set, the data is written as BGZF: a series of gzip members of
+        // at most BGZF_BLOCK_SIZE input bytes, each carrying its compressed size,
+        // so that the file can be split and inflated member by member
+        explicit GZipOutput(Output& dest, int level, bool bgzf = false);
         ~GZipOutput() override;
 
         void write(const void* data, int size) override;
@@ -47,9 +51,14 @@ namespace indigo
     protected:
         Output& _dest;
         z_stream _zstream;
-        int _total_written;
+        long long _total_written;
+        bool _bgzf;
+        gz_header _header;
+        Bytef _extra[6];
+        int _block_size;
 
         int _deflate(int flush);
+        void _writeBlock();
 
         CP_DECL;
         TL_CP_DECL(Array<Bytef>, _outbuf);
@@ -17,7 +17,11 @@
  ***************************************************************************/
 
 #include "gzip/gzip_scanner.h"
+
 #include <algorithm>
+#include <string.h>
+
+#include "base_cpp/output.h"
 
 using namespace indigo;
 
@@ -25,6 +29,18 @@ IMPL_ERROR(GZipScanner, "GZip scanner");
 
 CP_DEF(GZipScanner);
 
+// BGZF members start with an 18-byte gzip header holding the "BC" extra subfield
+// with the member size minus one, and end with the usual 8-byte trailer
+static const int _BGZF_HEADER_SIZE = 18;
+static const int _GZIP_TRAILER_SIZE = 8;
+static const int _WINDOW_SIZE = 32768;
+
+static bool _isBGZFHeader(const byte* header)
+{
+    return header[0] == 0x1f && header[1] == 0x8b && header[2] == Z_DEFLATED && (header[3] & 4) != 0 && header[10] == 6 && header[11] == 0 &&
+           header[12] == 'B' && header[13] == 'C' && header[14] == 2 && header[15] == 0;
+}
+
 GZipScanner::GZipScanner(Scanner& source) : _source(source), CP_INIT, TL_CP_GET(_inbuf), TL_CP_GET(_outbuf)
 {
     _zstream.zalloc = Z_NULL;
@@ -42,19 +58,47 @@ GZipScanner::GZipScanner(Scanner& source) : _source(source), CP_INIT, TL_CP_GET(
     if (rc != Z_OK)
         throw Error("unknown zlib error code: %d", rc);
 
+    _source_start = _source.tell();
+
+    // Sources of unknown length are read byte by byte
+    try
+    {
+        _source_length = _source.length();
+    }
+    catch (Exception&)
+    {
+        _source_length = -1;
+    }
+
     _outbuf.clear_resize(CHUNK_SIZE);
     _inbuf.clear_resize(CHUNK_SIZE);
-    _outbuf_start = 0;
     _inbuf_end = 0;
-    _uncompressed_total = 0;
+    _in_pos = 0;
+    _out_begin = 0;
+    _out_end = 0;
+    _out_pos = 0;
+    _length = -1;
+    _raw = false;
+    _member_end = false;
     _eof = false;
+    _stop = false;
+    _parallel = false;
+    _blocks_end = false;
+    _block_in = 0;
 
-    _zstream.avail_out = _outbuf.size();
-    _zstream.next_out = _outbuf.ptr();
+    _zstream.next_in = _inbuf.ptr();
+
+    AccessPoint& start = _points.push();
+
+    start.out = 0;
+    start.in = 0;
+    start.bits = 0;
+    start.member_start = true;
 }
 
 GZipScanner::~GZipScanner()
 {
+    _stopWorkers();
     inflateEnd(&_zstream);
 }
 
@@ -63,152 +107,624 @@ void GZipScanner::read(int length, void* res)
     if (res == 0)
         throw Error("zero pointer given");
 
-    if (_outbuf_start < _outbuf.size() - (int)_zstream.avail_out)
+    while (length > 0)
     {
-        int n = std::min(length, CHUNK_SIZE - (int)_zstream.avail_out - _outbuf_start);
+        if (_out_begin == _out_end && !_fill())
+            throw Error("end of compressed data");
+
+        int n = std::min(length, _out_end - _out_begin);
 
-        memcpy(res, _outbuf.ptr() + _outbuf_start, n);
-        _outbuf_start += n;
-        _uncompressed_total += n;
+        memcpy(res, _outbuf.ptr() + _out_begin, n);
+        _out_begin += n;
         length -= n;
         res = (char*)res + n;
     }
-
-    if (!_read(length, res))
-        throw Error("end of compressed data");
 }
 
-bool GZipScanner::_read(int length, void* res)
+void GZipScanner::readAll(Array<char>& arr)
 {
-    while (length > 0)
+    arr.clear();
+
+    while (_out_begin < _out_end || _fill())
     {
-        if (_eof)
-            return false;
+        arr.concat((char*)_outbuf.ptr() + _out_begin, _out_end - _out_begin);
+        _out_begin = _out_end;
+    }
+}
 
-        if (_zstream.avail_in == 0)
-        {
-            _inbuf_end = 0;
+void GZipScanner::appendLine(Array<char>& out, bool append_zero)
+{
+    if (isEOF())
+        throw Error("appendLine(): end of stream");
 
-            if (_source.isEOF())
-                throw Error("end of file in source stream");
+    while (out.size() > 0 && out.top() == 0)
+        out.pop();
 
-            do
-            {
-                _inbuf[_inbuf_end++] = _source.readChar();
-            } while (!_source.isEOF() && _inbuf_end < _inbuf.size());
-            _zstream.avail_in = _inbuf_end;
-            _zstream.next_in = _inbuf.ptr();
-        }
+    // Same terminators as Scanner::appendLine(): "\n", "\r" and "\r\n"
+    while (_out_begin < _out_end || _fill())
+    {
+        const Bytef* begin = _outbuf.ptr() + _out_begin;
+        const Bytef* end = _outbuf.ptr() + _out_end;
+        const Bytef* eol = (const Bytef*)memchr(begin, '\n', end - begin);
 
-        _zstream.avail_out = _outbuf.size();
-        _zstream.next_out = _outbuf.ptr();
-        _outbuf_start = 0;
+        if (eol == 0)
+            eol = end;
 
-        int rc = inflate(&_zstream, Z_NO_FLUSH);
+        const Bytef* cr = (const Bytef*)memchr(begin, '\r', eol - begin);
 
-        if (rc == Z_STREAM_ERROR)
-            throw Error("inconsistent stream structure");
+        if (cr != 0)
+            eol = cr;
 
-        if (rc == Z_NEED_DICT)
-        {
-            inflateEnd(&_zstream);
-            throw Error("need a dictionary");
-        }
+        out.concat((const char*)begin, (int)(eol - begin));
+
+        if (out.size() > MAX_LINE_LENGTH)
+            throw Error("Line length is too long. Probably the file format is not correct.");
 
-        if (rc == Z_MEM_ERROR)
+        if (eol == end)
         {
-            inflateEnd(&_zstream);
-            throw Error("not enough memory");
+            _out_begin = _out_end;
+            continue;
         }
 
-        if (rc == Z_DATA_ERROR)
+        _out_begin = (int)(eol - _outbuf.ptr()) + 1;
+        if (*eol == '\r' && lookNext() == '\n')
+            _out_begin++;
+        break;
+    }
+
+    if (append_zero)
+        out.push(0);
+}
+
+void GZipScanner::skip(int length)
+{
+    while (length > 0)
+    {
+        if (_out_begin == _out_end && !_fill())
+            throw Error("end of compressed data");
+
+        int n = std::min(length, _out_end - _out_begin);
+
+        _out_begin += n;
+        length -= n;
+    }
+}
+
+long long GZipScanner::tell()
+{
+    return _out_pos + _out_begin;
+}
+
+bool GZipScanner::isEOF()
+{
+    return _out_begin == _out_end && !_fill();
+}
+
+int GZipScanner::lookNext()
+{
+    if (_out_begin == _out_end && !_fill())
+        return -1;
+
+    return _outbuf[_out_begin];
+}
+
+void GZipScanner::seek(long long pos, int from)
+{
+    if (from == SEEK_CUR)
+        pos += tell();
+    else if (from == SEEK_END)
+        pos += length();
+
+    if (pos < 0)
+        throw Error("negative seek position");
+
+    if (pos >= _out_pos && pos <= _out_pos + _out_end)
+    {
+        _out_begin = (int)(pos - _out_pos);
+        return;
+    }
+
+    // Last access point at or before pos
+    int lo = 0, hi = _points.size() - 1;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+
+        if (_points[mid].out <= pos)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    // Going forward, inflating from the current position may be closer
+    if (pos < tell() || _points[lo].out > tell())
+        _restore(_points[lo]);
+
+    while (tell() < pos)
+    {
+        if (_out_begin == _out_end && !_fill())
+            throw Error("seek beyond the end of data");
+
+        _out_begin += (int)std::min((long long)(_out_end - _out_begin), pos - tell());
+    }
+}
+
+long long GZipScanner::length()
+{
+    if (_length < 0)
+    {
+        long long pos = tell();
+
+        // _fill() sets the length when it reaches the end
+        while (_out_begin < _out_end || _fill())
+            _out_begin = _out_end;
+
+        seek(pos, SEEK_SET);
+    }
+
+    return _length;
+}
+
+void GZipScanner::setThreads(int threads)
+{
+    if (threads < 2 || _parallel || _source_length < 0 || _out_pos + _out_end > 0 || _in_pos + _inbuf_end > 0)
+        return;
+
+    if (!isBGZF(_source))
+        return;
+
+    _parallel = true;
+    for (int i = 0; i < threads; i++)
+        _workers.emplace_back([this]() { _worker(); });
+}
+
+bool GZipScanner::isBGZF(Scanner& source)
+{
+    long long pos = source.tell();
+    byte header[_BGZF_HEADER_SIZE];
+    bool res;
+
+    try
+    {
+        source.read(sizeof(header), header);
+        res = _isBGZFHeader(header);
+    }
+    catch (Exception&)
+    {
+        res = false;
+    }
+
+    source.seek(pos, SEEK_SET);
+    return res;
+}
+
+void GZipScanner::saveAccessPoints(Output& output)
+{
+    output.writeBinaryInt(_points.size());
+
+    for (int i = 0; i < _points.size(); i++)
+    {
+        const AccessPoint& point = _points[i];
+
+        output.write(&point.out, sizeof(point.out));
+        output.write(&point.in, sizeof(point.in));
+        output.writeByte((byte)point.bits);
+        output.writeByte(point.member_start ? 1 : 0);
+        output.writeBinaryInt(point.window.size());
+        if (point.window.size() > 0)
+            output.write(point.window.ptr(), point.window.size());
+    }
+}
+
+bool GZipScanner::loadAccessPoints(Scanner& input)
+{
+    _points.clear();
+
+    try
+    {
+        int count = input.readBinaryInt();
+
+        for (int i = 0; i < count; i++)
         {
-            inflateEnd(&_zstream);
-            throw Error("corrupted input data");
+            AccessPoint& point = _points.push();
+
+            input.read(sizeof(point.out), &point.out);
+            input.read(sizeof(point.in), &point.in);
+            point.bits = input.readByte();
+            point.member_start = input.readByte() != 0;
+
+            int window_size = input.readBinaryInt();
+
+            if (window_size < 0 || window_size > _WINDOW_SIZE || point.bits > 7 || point.in < 0)
+                throw Error("invalid access point");
+            if (i == 0 ? (point.out != 0 || point.in != 0 || !point.member_start) : point.out <= _points[i - 1].out)
+                throw Error("invalid access point");
+
+            point.window.clear_resize(window_size);
+            if (window_size > 0)
+                input.read(window_size, point.window.ptr());
         }
 
-        if (rc == Z_BUF_ERROR)
-            throw Error("Z_BUF_ERROR (workaround not implemented)");
+        if (_points.size() > 0)
+            return true;
+    }
+    catch (Exception&)
+    {
+    }
+
+    _points.clear();
 
-        if (rc != Z_OK && rc != Z_STREAM_END)
-            throw Error("unknown zlib error code: %d", rc);
+    AccessPoint& start = _points.push();
 
-        int n = std::min(length, CHUNK_SIZE - (int)_zstream.avail_out - _outbuf_start);
+    start.out = 0;
+    start.in = 0;
+    start.bits = 0;
+    start.member_start = true;
+    return false;
+}
+
+bool GZipScanner::_fill()
+{
+    _out_pos += _out_end;
+    _out_begin = 0;
+    _out_end = 0;
 
-        if (n > 0 && res != 0)
+    if (_eof)
+        return false;
+
+    if (_parallel ? _fillParallel() : _fillSequential())
+        return true;
+
+    _eof = true;
+    _length = _out_pos;
+    return false;
+}
+
+bool GZipScanner::_fillSequential()
+{
+    while (true)
+    {
+        if (_member_end && !_nextMember())
+            return false;
+
+        if (_zstream.avail_in == 0 && !_fillInput())
+            throw Error("unexpected end of compressed data");
+
+        // Stopping at deflate block boundaries costs a little, so only do it when a new access point is due
+        bool indexing = _out_pos - _points.top().out >= ACCESS_SPAN;
+
+        _zstream.next_out = _outbuf.ptr();
+        _zstream.avail_out = _outbuf.size();
+
+        int rc = inflate(&_zstream, indexing ? Z_BLOCK : Z_NO_FLUSH);
+
+        _checkInflate(rc);
+        _out_end = _outbuf.size() - _zstream.avail_out;
+
+        if (rc == Z_STREAM_END)
+            _member_end = true;
+        else if (indexing && (_zstream.data_type & 128) != 0 && (_zstream.data_type & 64) == 0)
+            _addAccessPoint(false);
+
+        if (_out_end > 0)
+            return true;
+    }
+}
+
+bool GZipScanner::_fillInput()
+{
+    _in_pos += _inbuf_end;
+    _inbuf_end = 0;
+
+    if (_source_length >= 0)
+    {
+        long long left = _source_length - _source.tell();
+
+        if (left > 0)
         {
-            memcpy(res, _outbuf.ptr(), n);
-            _outbuf_start += n;
-            _uncompressed_total += n;
-            res = (char*)res + n;
+            _inbuf_end = (int)std::min(left, (long long)_inbuf.size());
+            _source.read(_inbuf_end, _inbuf.ptr());
         }
+    }
+    else
+    {
+        while (_inbuf_end < _inbuf.size() && !_source.isEOF())
+            _inbuf[_inbuf_end++] = _source.readByte();
+    }
 
-        length -= n;
+    _zstream.next_in = _inbuf.ptr();
+    _zstream.avail_in = _inbuf_end;
+    return _inbuf_end > 0;
+}
 
-        if (rc == Z_STREAM_END)
-            _eof = true;
+void GZipScanner::_skipInput(int length)
+{
+    while (length > 0)
+    {
+        if (_zstream.avail_in == 0 && !_fillInput())
+            throw Error("unexpected end of compressed data");
+
+        int n = std::min(length, (int)_zstream.avail_in);
+
+        _zstream.next_in += n;
+        _zstream.avail_in -= n;
+        length -= n;
     }
+}
+
+// Moves on to the next member of a multi-member stream
+bool GZipScanner::_nextMember()
+{
+    // zlib does not consume the gzip trailer of a member inflated from an access point
+    if (_raw)
+        _skipInput(_GZIP_TRAILER_SIZE);
+
+    if (_zstream.avail_in == 0 && !_fillInput())
+        return false;
 
+    // Like gzip, ignore whatever follows the last member if it is not a gzip header
+    if (*_zstream.next_in != 0x1f)
+        return false;
+
+    inflateReset2(&_zstream, 16 + MAX_WBITS);
+    _raw = false;
+    _member_end = false;
+
+    if (_out_pos + _out_end - _points.top().out >= ACCESS_SPAN)
+        _addAccessPoint(true);
     return true;
 }
 
-void GZipScanner::readAll(Array<char>& arr)
+void GZipScanner::_addAccessPoint(bool member_start)
 {
-    arr.clear();
+    AccessPoint& point = _points.push();
 
-    while (!isEOF())
-        arr.push(readByte());
+    point.out = _out_pos + _out_end;
+    point.in = _in_pos + (_zstream.next_in - _inbuf.ptr());
+    point.member_start = member_start;
+    point.bits = member_start ? 0 : (_zstream.data_type & 7);
+    point.window.clear();
+
+    if (!member_start)
+    {
+        uInt size = _WINDOW_SIZE;
+
+        point.window.clear_resize(_WINDOW_SIZE);
+        inflateGetDictionary(&_zstream, point.window.ptr(), &size);
+        point.window.resize(size);
+    }
 }
 
-void GZipScanner::skip(int length)
+void GZipScanner::_restore(const AccessPoint& point)
 {
-    QS_DEF(Array<char>, dummy);
+    _stopWorkers();
+
+    long long in = point.in - (point.bits != 0 ? 1 : 0);
+
+    _source.seek(_source_start + in, SEEK_SET);
+    _in_pos = in;
+    _inbuf_end = 0;
+    _zstream.next_in = _inbuf.ptr();
+    _zstream.avail_in = 0;
+
+    if (point.member_start)
+    {
+        inflateReset2(&_zstream, 16 + MAX_WBITS);
+        _raw = false;
+    }
+    else
+    {
+        // The point is inside a member: inflate raw deflate data from there on
+        inflateReset2(&_zstream, -MAX_WBITS);
+        _raw = true;
+
+        if (point.bits != 0)
+        {
+            int c = _source.readByte();
 
-    dummy.clear_resize(length);
-    read(length, dummy.ptr());
+            _in_pos++;
+            inflatePrime(&_zstream, point.bits, c >> (8 - point.bits));
+        }
+        if (point.window.size() > 0)
+            inflateSetDictionary(&_zstream, point.window.ptr(), point.window.size());
+    }
+
+    _outbuf.clear_resize(CHUNK_SIZE);
+    _out_pos = point.out;
+    _out_begin = 0;
+    _out_end = 0;
+    _member_end = false;
+    _eof = false;
 }
 
-long long GZipScanner::tell()
+void GZipScanner::_checkInflate(int rc)
 {
-    return _uncompressed_total;
+    if (rc == Z_OK || rc == Z_STREAM_END)
+        return;
+
+    // No progress without more input
+    if (rc == Z_BUF_ERROR && _zstream.avail_in == 0)
+        return;
+
+    if (rc == Z_STREAM_ERROR)
+        throw Error("inconsistent stream structure");
+    if (rc == Z_NEED_DICT)
+        throw Error("need a dictionary");
+    if (rc == Z_MEM_ERROR)
+        throw Error("not enough memory");
+    if (rc == Z_DATA_ERROR)
+        throw Error("corrupted input data");
+    if (rc == Z_BUF_ERROR)
+        throw Error("Z_BUF_ERROR (workaround not implemented)");
+
+    throw Error("unknown zlib error code: %d", rc);
 }
 
-bool GZipScanner::isEOF()
+bool GZipScanner::_fillParallel()
 {
-    if ((unsigned)_outbuf_start + _zstream.avail_out == (unsigned)_outbuf.size())
+    while (true)
     {
-        if (_eof)
-            return true;
-        _read(1, 0);
+        // Keep the workers busy with the next members
+        while (!_blocks_end && (int)_blocks.size() < (int)_workers.size() * 4)
+            _blocks_end = !_dispatchBlock();
+
+        if (_blocks.empty())
+        {
+            if (_source_start + _block_in >= _source_length)
+                return false;
+
+            // Not a BGZF member: carry on inflating on this thread
+            AccessPoint point;
+
+            point.out = _out_pos;
+            point.in = _block_in;
+            point.bits = 0;
+            point.member_start = true;
+            _restore(point);
+            _member_end = true;
+            return _fillSequential();
+        }
+
+        std::shared_ptr<Block> block = _blocks.front();
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done_cond.wait(lock, [&block]() { return block->done; });
+        }
+        _blocks.pop_front();
+
+        if (!block->error.empty())
+            throw Error("%s", block->error.c_str());
+
+        // BGZF end-of-file marker
+        if (block->data.empty())
+            continue;
+
+        if (_out_pos - _points.top().out >= ACCESS_SPAN)
+        {
+            AccessPoint& point = _points.push();
+
+            point.out = _out_pos;
+            point.in = block->in;
+            point.bits = 0;
+            point.member_start = true;
+        }
+
+        _outbuf.copy(block->data.data(), (int)block->data.size());
+        _out_end = _outbuf.size();
+        return true;
     }
-    return _eof && (unsigned)_outbuf_start + _zstream.avail_out == (unsigned)_outbuf.size();
 }
 
-void GZipScanner::seek(long long pos, int from)
+bool GZipScanner::_dispatchBlock()
 {
-    throw Error("not implemented");
+    byte header[_BGZF_HEADER_SIZE];
+
+    if (_source_length - (_source_start + _block_in) < _BGZF_HEADER_SIZE)
+        return false;
+
+    _source.read(sizeof(header), header);
+
+    if (!_isBGZFHeader(header))
+    {
+        _source.seek(_source_start + _block_in, SEEK_SET);
+        return false;
+    }
+
+    int size = (header[16] | (header[17] << 8)) + 1;
+
+    if (size < _BGZF_HEADER_SIZE + _GZIP_TRAILER_SIZE || _source_start + _block_in + size > _source_length)
+        throw Error("corrupted BGZF block");
+
+    std::shared_ptr<Block> block = std::make_shared<Block>();
+
+    block->in = _block_in;
+    block->done = false;
+    block->compressed.resize(size);
+    memcpy(block->compressed.data(), header, sizeof(header));
+    _source.read(size - (int)sizeof(header), block->compressed.data() + sizeof(header));
+    _block_in += size;
+
+    _blocks.push_back(block);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(block);
+    }
+    _task_cond.notify_one();
+    return true;
 }
 
-int GZipScanner::lookNext()
+void GZipScanner::_worker()
 {
-    if (_outbuf_start < _outbuf.size() - (int)_zstream.avail_out)
-        return _outbuf[_outbuf_start];
+    z_stream zstream;
 
-    if (_eof)
-        return -1;
+    memset(&zstream, 0, sizeof(zstream));
+    bool ready = inflateInit2(&zstream, 16 + MAX_WBITS) == Z_OK;
 
-    _read(1, 0);
+    while (true)
+    {
+        std::shared_ptr<Block> block;
 
-    if (_eof)
-        return -1;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _task_cond.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+            if (_stop)
+                break;
+            block = _tasks.front();
+            _tasks.pop_front();
+        }
 
-    if (_outbuf_start < _outbuf.size() - (int)_zstream.avail_out)
-        return _outbuf[_outbuf_start];
+        // The trailer holds the inflated size, at most 64 KB for BGZF
+        const Bytef* trailer = block->compressed.data() + block->compressed.size() - 4;
+        uLong size = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uLong)trailer[3] << 24);
+        Bytef dummy;
+
+        if (!ready)
+            block->error = "not enough memory for zlib";
+        else if (size > 65536)
+            block->error = "corrupted BGZF block";
+        else
+        {
+            block->data.resize(size);
+            inflateReset(&zstream);
+            zstream.next_in = block->compressed.data();
+            zstream.avail_in = (uInt)block->compressed.size();
+            zstream.next_out = size > 0 ? block->data.data() : &dummy;
+            zstream.avail_out = (uInt)size;
+
+            if (inflate(&zstream, Z_FINISH) != Z_STREAM_END || zstream.avail_out != 0)
+                block->error = "corrupted BGZF block";
+        }
 
-    throw Error("internal");
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            block->done = true;
+        }
+        _done_cond.notify_all();
+    }
+
+    if (ready)
+        inflateEnd(&zstream);
 }
 
-long long GZipScanner::length()
+void GZipScanner::_stopWorkers()
 {
-    throw Error("not implemented");
+    if (_workers.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _tasks.clear();
+    }
+    _task_cond.notify_all();
+
+    for (auto& worker : _workers)
+        worker.join();
+
+    _workers.clear();
+    _blocks.clear();
+    _stop = false;
+    _parallel = false;
 }
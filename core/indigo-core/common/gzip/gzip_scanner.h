@@ -19,6 +19,15 @@
 #ifndef __gzip_scanner__
 #define __gzip_scanner__
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base_cpp/obj_array.h"
 #include "base_cpp/scanner.h"
 #include "base_cpp/tlscont.h"
 
@@ -27,12 +36,20 @@
 namespace indigo
 {
 
+    class Output;
+
+    // Decompresses gzip input, including multi-member and BGZF streams.
+    // While reading forward the scanner records access points every ACCESS_SPAN
+    // bytes of output (zran-style: the compressed position of a deflate block
+    // boundary and the 32 KB window before it), so that seek() restarts inflating
+    // from the nearest point instead of the beginning of the stream.
     class GZipScanner : public Scanner
     {
     public:
         enum
         {
-            CHUNK_SIZE = 32768
+            CHUNK_SIZE = 32768,
+            ACCESS_SPAN = 1 << 22
         };
 
         explicit GZipScanner(Scanner& source);
@@ -46,22 +63,86 @@ namespace indigo
         void skip(int length) override;
         long long length() override;
         void readAll(Array<char>& arr) override;
+        void appendLine(Array<char>& out, bool append_zero) override;
+
+        // Inflates BGZF members on worker threads while the input is read forward.
+        // Has no effect on other gzip input or once reading has started.
+        void setThreads(int threads);
+
+        // Access points found so far, e.g. to keep them in a RecordIndex sidecar
+        void saveAccessPoints(Output& output);
+        // Returns false if the data is damaged
+        bool loadAccessPoints(Scanner& input);
+
+        // Checks the gzip header at the current position for the BGZF "BC" subfield
+        static bool isBGZF(Scanner& source);
 
         DECL_ERROR;
 
     protected:
+        struct AccessPoint
+        {
+            long long out;     // uncompressed position
+            long long in;      // compressed position
+            int bits;          // bits of the byte before "in" not yet inflated
+            bool member_start; // the point is a gzip header, no window needed
+            Array<Bytef> window;
+        };
+
+        // BGZF member inflated by a worker thread
+        struct Block
+        {
+            long long in;
+            std::vector<Bytef> compressed;
+            std::vector<Bytef> data;
+            bool done;
+            std::string error;
+        };
+
+        bool _fill();
+        bool _fillSequential();
+        bool _fillParallel();
+        bool _fillInput();
+        void _skipInput(int length);
+        bool _nextMember();
+        void _addAccessPoint(bool member_start);
+        void _restore(const AccessPoint& point);
+        void _checkInflate(int rc);
+
+        bool _dispatchBlock();
+        void _worker();
+        void _stopWorkers();
+
         Scanner& _source;
+        long long _source_start;
+        long long _source_length;
         z_stream _zstream;
-
-        bool _read(int length, void* res);
+        bool _raw; // inflating a member from an access point, without its header
+        bool _member_end;
+        bool _eof;
 
         CP_DECL;
         TL_CP_DECL(Array<Bytef>, _inbuf);
         TL_CP_DECL(Array<Bytef>, _outbuf);
-        int _outbuf_start;
         int _inbuf_end;
-        int _uncompressed_total;
-        bool _eof;
+        long long _in_pos; // compressed position of _inbuf[0]
+        int _out_begin;
+        int _out_end;
+        long long _out_pos; // uncompressed position of _outbuf[0]
+        long long _length;
+
+        ObjArray<AccessPoint> _points;
+
+        std::vector<std::thread> _workers;
+        std::deque<std::shared_ptr<Block>> _blocks;
+        std::deque<std::shared_ptr<Block>> _tasks;
+        std::mutex _mutex;
+        std::condition_variable _task_cond;
+        std::condition_variable _done_cond;
+        bool _stop;
+        bool _parallel;
+        bool _blocks_end;
+        long long _block_in; // compressed position of the next BGZF member to dispatch
     };
 
 } // namespace indigo
@@ -23,6 +23,7 @@
 #include "base_cpp/reusable_obj_array.h"
 #include "base_cpp/tlscont.h"
 #include "graph/graph.h"
+#include "graph/graph_fast_access.h"
 
 namespace indigo
 {
@@ -112,6 +113,7 @@ namespace indigo
         TL_CP_DECL(Array<int>, _lab);
         TL_CP_DECL(Array<int>, _ptn);
         TL_CP_DECL(Graph, _graph);
+        TL_CP_DECL(GraphFastAccess, _graph_fast); // flat neighbour lists of _graph
 
         TL_CP_DECL(Array<int>, _mapping);
         TL_CP_DECL(Array<int>, _inv_mapping);
@@ -133,6 +135,8 @@ namespace indigo
         TL_CP_DECL(Array<int>, _fixedpts);
         TL_CP_DECL(Array<int[2]>, _work_active_cells);
         TL_CP_DECL(Array<int>, _edge_ranks_in_refine);
+        TL_CP_DECL(Array<int>, _edge_ranks);  // cb_edge_rank values of the _graph edges
+        TL_CP_DECL(Array<int>, _split_marks); // neighbours of the splitting cell, used in _refineByCell
 
         int _n;
         Graph* _given_graph;
@@ -162,7 +166,7 @@ namespace indigo
         void _buildFixMcr(const Array<int>& perm, Array<int>& fix, Array<int>& mcr);
         void _joinOrbits(const Array<int>& perm);
         void _handleAutomorphism(const Array<int>& perm);
-        bool _hasEdgeWithRank(int from, int to, int target_edge_rank);
+        bool _matchEdgeRank(int edge_idx, int target_edge_rank);
 
         static int _cmp_vertices(int idx1, int idx2, void* context);
         class CancellationHandler* _cancellation_handler;
@@ -53,6 +53,12 @@ namespace indigo
 
         ~EmbeddingEnumerator();
 
+        // Start over with another (or a modified) supergraph. Callbacks and
+        // options are kept, the internal buffers are reused without being
+        // freed, so screening loops can keep one enumerator for all targets.
+        // The subgraph has to be set again after this call.
+        void reset(Graph& supergraph);
+
         // when cb_embedding returns zero, enumeration stops
         int (*cb_embedding)(Graph& subgraph, Graph& supergraph, int* core_sub, int* core_super, void* userdata);
 
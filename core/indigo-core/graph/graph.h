@@ -222,6 +222,11 @@ namespace indigo
         bool vertexInRing(int idx);
         int edgeSmallestRingSize(int idx);
 
+        // Vertices joined by ring edges (fused and spiro rings) form one ring
+        // system. Returns -1 for a vertex that lies in no ring.
+        int vertexRingSystem(int idx);
+        int countRingSystems();
+
         List<int>& sssrEdges(int idx);
         List<int>& sssrVertices(int idx);
         int sssrCount();
@@ -242,9 +247,15 @@ namespace indigo
         ObjPool<Vertex>* _vertices;
         Pool<Edge> _edges;
 
+        // Ring data below survives edits that can not change the rings (adding an
+        // isolated vertex or a pendant edge, removing a chain edge) and full copies.
         Array<int> _topology; // for each edge: TOPOLOGY_RING, TOPOLOGY_CHAIN, or -1 (not calculated)
         bool _topology_valid;
 
+        Array<int> _ring_systems; // for each vertex: ring system index, or -1 if it lies in no ring
+        int _ring_systems_count;
+        bool _ring_systems_valid;
+
         Array<int> _v_smallest_ring_size, _e_smallest_ring_size;
         Array<int> _v_sssr_count;
         Pool<List<int>::Elem>* _sssr_pool;
@@ -264,6 +275,8 @@ namespace indigo
         void _calculateSSSRByCycleBasis(CycleBasis& basis);
         void _calculateSSSRAddEdgesAndVertices(const Array<int>& cycle, List<int>& edges, List<int>& vertices);
         void _calculateComponents();
+        void _copyRingData(const Graph& other, const Array<int>& vertex_mapping, const Array<int>& edge_mapping);
+        void _calculateRingSystems();
 
         // This is a bad hack for those who are too lazy to handle the mappings.
         // NEVER USE IT.
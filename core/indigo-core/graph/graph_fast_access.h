@@ -27,24 +27,31 @@ namespace indigo
 
     class Graph;
 
+    // Read-only copies of the graph topology filled on demand: the vertex
+    // list and the edge table on the first access after setGraph(), the
+    // neighbours of a vertex when they are first requested. A search that is
+    // rejected early therefore copies only the vertices it has looked at.
+    // The copies are private because enumerators keep using them while
+    // nested searches temporarily modify the graph.
+    // Note: graph changes made after the first access are not visible until
+    // setGraph() is called again.
     class GraphFastAccess
     {
     public:
+        GraphFastAccess();
+
         void setGraph(Graph& g);
 
-        int* prepareVertices(int& count);
+        const int* prepareVertices(int& count);
         int getVertex(int idx); // unsafe
         int vertexCount();
 
-        // Prepare both nei vertices and edges list. Runs faster then
-        // preparing them one by one.
+        // Prepare both nei vertices and edges list
         void prepareVertexNeiVerticesAndEdges(int v);
         // Returns nei vertices and nei edges for specified vertex
-        // Numeration is coherent
-        // Note: pointer might become invalid after preparing calls for
-        // different vertices. In this case use prepareVertexNeiVertices/getVertexNeiVertiex.
-        int* getVertexNeiVertices(int v, int& count);
-        int* getVertexNeiEdges(int v, int& count);
+        // Numeration is coherent. The pointers stay valid until setGraph().
+        const int* getVertexNeiVertices(int v, int& count);
+        const int* getVertexNeiEdges(int v, int& count);
 
         // Returns vertex identifier that can be used in getVertexNeiVertiex
         int prepareVertexNeiVertices(int v, int& count);
@@ -59,14 +66,17 @@ namespace indigo
         const Edge* getEdges();
 
     private:
-        Graph* _g;
+        void _prepareVertices();
+
+        Graph* _graph;
+        bool _vertices_ready;
+        bool _edges_ready;
 
         Array<int> _vertices;
 
         struct VertexNeiBlock
         {
-            int v_begin, v_count;
-            int e_begin, e_count;
+            int begin, count;
         };
         Array<VertexNeiBlock> _vertices_nei;
         Array<int> _nei_vertices_data, _nei_edges_data;
@@ -0,0 +1,148 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __max_common_induced_subgraph_h__
+#define __max_common_induced_subgraph_h__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "base_cpp/array.h"
+#include "base_cpp/exception.h"
+#include "base_cpp/obj_array.h"
+#include "graph/graph.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+    class CancellationHandler;
+
+    // Exact maximum common induced subgraph search based on the McSplit
+    // algorithm (McCreesh, Prosser, Trimble, IJCAI 2017): branch and bound over
+    // label classes with the sum of class intersections as the upper bound.
+    // Vertex and edge matching conditions must be equivalence relations.
+    // The search is anytime: when interrupted by the time limit or the
+    // cancellation handler the best solution found so far is kept.
+    class DLLEXPORT MaxCommonInducedSubgraph
+    {
+    public:
+        MaxCommonInducedSubgraph(Graph& sub, Graph& super);
+        ~MaxCommonInducedSubgraph();
+
+        // returns true if the solution is proven to be maximum
+        bool find();
+
+        // number of mapped vertices
+        int solutionSize() const;
+        // map from the first graph vertices to the second graph vertices (-1 for unmapped)
+        void getSolutionMap(Array<int>& map) const;
+        // vertices and induced edges of the solution in the second graph
+        void getSolutionListsSuper(Array<int>& v_list, Array<int>& e_list) const;
+
+        bool (*cbMatchVertex)(Graph& g1, Graph& g2, const int* core_sub, int i, int j, void* userdata);
+        bool (*cbMatchEdge)(Graph& g1, Graph& g2, int i, int j, void* userdata);
+        void* userdata;
+
+        // search for the connected common subgraph only (default is true)
+        bool connected;
+        // time limit in milliseconds, 0 means no limit
+        int timeLimit;
+        // number of worker threads, 0 means the search runs in the calling thread
+        int threadCount;
+
+        DECL_ERROR;
+
+    protected:
+        // pair of vertex ranges in _left/_right arrays with the same label
+        struct Bidomain
+        {
+            int l, r;
+            int left_len, right_len;
+            bool adjacent;
+        };
+
+        // per-thread search state, reused for the subtrees rooted at top level vertex pairs
+        class SearchState
+        {
+        public:
+            int v, w;
+            Array<int> left, right;
+            Array<int> current1, current2;
+            ObjArray<Array<Bidomain>> levels;
+            int nodes;
+        };
+
+        void _prepareLabels();
+        void _prepareTopLevel();
+        bool _nextTopLevelTask(SearchState& state);
+        void _searchThread();
+
+        void _solve(SearchState& state, int depth);
+        void _filterDomains(const Array<Bidomain>& domains, Array<Bidomain>& new_domains, Array<int>& left, Array<int>& right, int v, int w);
+        int _selectBidomain(const Array<Bidomain>& domains, const Array<int>& left, int depth) const;
+        bool _checkStop(SearchState& state);
+        void _updateBest(const Array<int>& current1, const Array<int>& current2, int size);
+
+        static int _calcBound(const Array<Bidomain>& domains);
+        static int _partition(Array<int>& all, int start, int len, const int* adjrow);
+        static int _findMinValue(const Array<int>& arr, int start, int len);
+        static int _indexOfNextSmallest(const Array<int>& arr, int start, int len, int w);
+
+        Graph& _g1;
+        Graph& _g2;
+
+        // dense vertex indices ordered by degree, mapped to graph vertices
+        int _n1, _n2;
+        Array<int> _vertices1, _vertices2;
+        // vertex label classes, -1 for vertices without compatible partners
+        Array<int> _labels1, _labels2;
+        // edge label matrices, 0 means no edge
+        Array<int> _adj1, _adj2;
+
+        // top level branching state
+        Array<Bidomain> _top_domains;
+        Array<int> _top_left, _top_right;
+        int _top_bd, _top_v, _top_w, _top_i;
+        std::mutex _top_lock;
+
+        // incumbent
+        Array<int> _best1, _best2;
+        std::atomic<int> _best_size;
+        std::mutex _best_lock;
+
+        std::atomic<bool> _stopped;
+        std::unique_ptr<Exception> _thread_exception;
+        qword _start_time;
+        CancellationHandler* _cancellation_handler;
+
+    private:
+        MaxCommonInducedSubgraph(const MaxCommonInducedSubgraph&); // no implicit copy
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
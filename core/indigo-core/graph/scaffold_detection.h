@@ -27,17 +27,29 @@ namespace indigo
     class ScaffoldDetection
     {
     public:
+        enum
+        {
+            SEARCH_EXACT,
+            SEARCH_APPROXIMATE,
+            SEARCH_MCSPLIT
+        };
+
         ScaffoldDetection(ObjArray<Graph>* graph_set);
-        // two main methods for extracting scaffolds
+        // main methods for extracting scaffolds
         // extracting exact scaffold from graphs set
         void extractExactScaffold(Graph& scaffold)
         {
-            _searchScaffold(scaffold, false);
+            _searchScaffold(scaffold, SEARCH_EXACT);
         }
         // extracting approximate scaffold from graphs set
         void extractApproximateScaffold(Graph& scaffold)
         {
-            _searchScaffold(scaffold, true);
+            _searchScaffold(scaffold, SEARCH_APPROXIMATE);
+        }
+        // extracting maximum common connected induced subgraph with McSplit
+        void extractMcSplitScaffold(Graph& scaffold)
+        {
+            _searchScaffold(scaffold, SEARCH_MCSPLIT);
         }
 
         // array for keeping graphs for searching scaffold
@@ -57,6 +69,13 @@ namespace indigo
 
         int maxIterations;
 
+        // McSplit search parameters: time limit in milliseconds for the whole set
+        // (0 means no limit) and number of worker threads
+        int timeLimit;
+        int threadCount;
+        // true if the McSplit search was interrupted and the result may be not maximum
+        bool searchStopped;
+
         DECL_ERROR;
 
     public:
@@ -138,9 +157,11 @@ namespace indigo
         void _searchExactScaffold(GraphBasket& basket);
         // method for extracting approximate scaffold from graph set
         void _searchApproximateScaffold(GraphBasket& basket);
+        // method for extracting scaffold from graph set with McSplit algorithm
+        void _searchMcSplitScaffold(GraphBasket& basket);
 
     private:
-        void _searchScaffold(Graph& scaffold, bool approximate);
+        void _searchScaffold(Graph& scaffold, int mode);
     };
 
 } // namespace indigo
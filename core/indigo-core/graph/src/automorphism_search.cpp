@@ -26,10 +26,10 @@ IMPL_TIMEOUT_EXCEPTION(AutomorphismSearch, "automorphism search");
 CP_DEF(AutomorphismSearch);
 
 AutomorphismSearch::AutomorphismSearch()
-    : CP_INIT, TL_CP_GET(_call_stack), TL_CP_GET(_lab), TL_CP_GET(_ptn), TL_CP_GET(_graph), TL_CP_GET(_mapping), TL_CP_GET(_inv_mapping), TL_CP_GET(_degree),
+    : CP_INIT, TL_CP_GET(_call_stack), TL_CP_GET(_lab), TL_CP_GET(_ptn), TL_CP_GET(_graph), TL_CP_GET(_graph_fast), TL_CP_GET(_mapping), TL_CP_GET(_inv_mapping), TL_CP_GET(_degree),
       TL_CP_GET(_tcells), TL_CP_GET(_fix), TL_CP_GET(_mcr), TL_CP_GET(_active), TL_CP_GET(_workperm), TL_CP_GET(_workperm2), TL_CP_GET(_bucket),
       TL_CP_GET(_count), TL_CP_GET(_firstlab), TL_CP_GET(_canonlab), TL_CP_GET(_orbits), TL_CP_GET(_fixedpts), TL_CP_GET(_work_active_cells),
-      TL_CP_GET(_edge_ranks_in_refine)
+      TL_CP_GET(_edge_ranks_in_refine), TL_CP_GET(_edge_ranks), TL_CP_GET(_split_marks)
 {
     getcanon = true;
     compare_vertex_degree_first = true;
@@ -69,6 +69,7 @@ void AutomorphismSearch::_prepareGraph(Graph& graph)
     _graph.clear();
     _mapping.clear();
     _degree.clear();
+    _edge_ranks.clear();
 
     _ptn.clear();
 
@@ -149,7 +150,12 @@ void AutomorphismSearch::_prepareGraph(Graph& graph)
         int beg = _inv_mapping[edge.beg];
         int end = _inv_mapping[edge.end];
 
-        _graph.addEdge(beg, end);
+        int idx = _graph.addEdge(beg, end);
+
+        // Edge ranks do not change during the search, so they are computed
+        // here once instead of in every refinement step
+        _edge_ranks.expand(idx + 1);
+        _edge_ranks[idx] = (cb_edge_rank != 0) ? cb_edge_rank(graph, i, context) : 0;
     }
 
     int start = 0;
@@ -170,7 +176,11 @@ void AutomorphismSearch::_prepareGraph(Graph& graph)
 
     _n = _graph.vertexCount();
 
+    _graph_fast.setGraph(_graph);
+
     _lab.clear_resize(_n);
+    _split_marks.clear_resize(_n);
+    _split_marks.zerofill();
 
     for (i = 0; i < _n; i++)
         _lab[buckets[ranks[i]]++] = i;
@@ -718,9 +728,9 @@ bool AutomorphismSearch::_isAutomorphism(Array<int>& perm)
 {
     for (int i = _graph.edgeBegin(); i != _graph.edgeEnd(); i = _graph.edgeNext(i))
     {
-        const Edge& edge = _graph.getEdge(i);
+        const Edge& edge = _graph_fast.getEdge(i);
 
-        if (!_graph.haveEdge(perm[edge.beg], perm[edge.end]))
+        if (_graph_fast.findEdgeIndex(perm[edge.beg], perm[edge.end]) == -1)
             return false;
     }
 
@@ -945,23 +955,12 @@ void AutomorphismSearch::_refineBySortingNeighbourhood(int level, int& numcells)
     }
 }
 
-bool AutomorphismSearch::_hasEdgeWithRank(int from, int to, int target_edge_rank)
+bool AutomorphismSearch::_matchEdgeRank(int edge_idx, int target_edge_rank)
 {
-    int edge_index = _graph.findEdgeIndex(from, to);
-
-    if (edge_index == -1)
-        return false;
-
     if (cb_edge_rank == 0)
         return true;
 
-    int mapped_v1 = _mapping[from];
-    int mapped_v2 = _mapping[to];
-    int edge_index_mapped = _given_graph->findEdgeIndex(mapped_v1, mapped_v2);
-    if (edge_index_mapped == -1)
-        throw Error("Internal error: edge must exists");
-
-    int edge_rank = cb_edge_rank(*_given_graph, edge_index_mapped, context);
+    int edge_rank = _edge_ranks[edge_idx];
 
     if (target_edge_rank == -1)
     {
@@ -984,6 +983,16 @@ void AutomorphismSearch::_refineByCell(int split1, int split2, int level, int& n
     {
         int cell1, cell2;
 
+        // Mark the neighbours of the splitting vertex with their edges,
+        // so the adjacency test below does not need an edge lookup
+        int split_vertex = _lab[split1];
+        int split_degree;
+        const int* split_nei_vertices = _graph_fast.getVertexNeiVertices(split_vertex, split_degree);
+        const int* split_nei_edges = _graph_fast.getVertexNeiEdges(split_vertex, split_degree);
+
+        for (i = 0; i < split_degree; i++)
+            _split_marks[split_nei_vertices[i]] = split_nei_edges[i] + 1;
+
         for (cell1 = 0; cell1 < _n; cell1 = cell2 + 1)
         {
             for (cell2 = cell1; _ptn[cell2] > level; cell2++)
@@ -995,7 +1004,9 @@ void AutomorphismSearch::_refineByCell(int split1, int split2, int level, int& n
 
             while (c1 <= c2)
             {
-                if (_hasEdgeWithRank(_lab[split1], _lab[c1], target_edge_rank))
+                int mark = _split_marks[_lab[c1]];
+
+                if (mark != 0 && _matchEdgeRank(mark - 1, target_edge_rank))
                     c1++;
                 else
                 {
@@ -1023,11 +1034,17 @@ void AutomorphismSearch::_refineByCell(int split1, int split2, int level, int& n
                 }
             }
         }
+
+        for (i = 0; i < split_degree; i++)
+            _split_marks[split_nei_vertices[i]] = 0;
     }
     else // nontrivial splitting cell
     {
         int cell1, cell2;
 
+        for (j = split1; j <= split2; j++)
+            _split_marks[_lab[j]] = 1;
+
         for (cell1 = 0; cell1 < _n; cell1 = cell2 + 1)
         {
             for (cell2 = cell1; _ptn[cell2] > level; ++cell2)
@@ -1042,9 +1059,13 @@ void AutomorphismSearch::_refineByCell(int split1, int split2, int level, int& n
             for (i = cell1; i <= cell2; i++)
             {
                 int cnt = 0;
+                int v = _lab[i];
+                int degree;
+                const int* nei_vertices = _graph_fast.getVertexNeiVertices(v, degree);
+                const int* nei_edges = _graph_fast.getVertexNeiEdges(v, degree);
 
-                for (j = split1; j <= split2; j++)
-                    if (_hasEdgeWithRank(_lab[i], _lab[j], target_edge_rank))
+                for (j = 0; j < degree; j++)
+                    if (_split_marks[nei_vertices[j]] && _matchEdgeRank(nei_edges[j], target_edge_rank))
                         cnt++;
 
                 while (_bucket.size() <= cnt)
@@ -1128,6 +1149,9 @@ void AutomorphismSearch::_refineByCell(int split1, int split2, int level, int& n
                     _active[last_c1] = 0;
             }
         }
+
+        for (j = split1; j <= split2; j++)
+            _split_marks[_lab[j]] = 0;
     }
 }
 
@@ -35,27 +35,38 @@ EmbeddingEnumerator::EmbeddingEnumerator(Graph& supergraph)
     : CP_INIT, TL_CP_GET(_core_1), TL_CP_GET(_core_2), TL_CP_GET(_term2), TL_CP_GET(_unterm2), TL_CP_GET(_s_pool), TL_CP_GET(_g1_fast), TL_CP_GET(_g2_fast),
       TL_CP_GET(_query_match_state), TL_CP_GET(_enumerators)
 {
-    _g2 = &supergraph;
-    _core_2.clear();
-    validate();
-
     cb_embedding = 0;
     cb_match_vertex = 0;
     cb_match_edge = 0;
     cb_vertex_remove = 0;
     cb_edge_add = 0;
     cb_vertex_add = 0;
+    cb_allow_many_to_one = 0;
     userdata = 0;
 
+    allow_many_to_one = false;
+
+    _enumerators.clear();
+    _enumerators.push(*this);
+
+    reset(supergraph);
+}
+
+void EmbeddingEnumerator::reset(Graph& supergraph)
+{
+    _g1 = 0;
+    _g2 = &supergraph;
+    _core_2.clear();
+    validate();
+
     _cancellation_handler = getCancellationHandler();
     _cancellation_check_number = 0;
 
-    allow_many_to_one = false;
-
     _equivalence_handler = NULL;
 
-    _enumerators.clear();
-    _enumerators.push(*this);
+    // Popped enumerators return their orbit set nodes to _s_pool
+    while (_enumerators.size() > 1)
+        _enumerators.pop();
 }
 
 EmbeddingEnumerator::~EmbeddingEnumerator()
@@ -361,7 +372,7 @@ void EmbeddingEnumerator::_Enumerator::_addPairNode2(int node1, int node2)
     if (_t1_len > 0)
     {
         int node2_nei_count;
-        int* node2_nei_v = _context._g2_fast.getVertexNeiVertices(node2, node2_nei_count);
+        const int* node2_nei_v = _context._g2_fast.getVertexNeiVertices(node2, node2_nei_count);
         for (i = 0; i < node2_nei_count; i++)
         {
             int other2 = node2_nei_v[i];
@@ -437,8 +448,8 @@ bool EmbeddingEnumerator::_Enumerator::_checkPair(int node1, int node2)
     bool needRemove = false;
 
     int node1_nei_count;
-    int* node1_nei_v = _context._g1_fast.getVertexNeiVertices(node1, node1_nei_count);
-    int* node1_nei_e = _context._g1_fast.getVertexNeiEdges(node1, node1_nei_count);
+    const int* node1_nei_v = _context._g1_fast.getVertexNeiVertices(node1, node1_nei_count);
+    const int* node1_nei_e = _context._g1_fast.getVertexNeiEdges(node1, node1_nei_count);
 
     for (j = 0; j < node1_nei_count; j++)
     {
@@ -555,7 +566,7 @@ int EmbeddingEnumerator::_Enumerator::nextPair()
     if (_t2_len == 0)
     {
         int v2_count;
-        int* g2_vertices = _context._g2_fast.prepareVertices(v2_count);
+        const int* g2_vertices = _context._g2_fast.prepareVertices(v2_count);
 
         // If _current_node2_idx == -1 then _current_node2_idx will be 0
         _current_node2_idx++;
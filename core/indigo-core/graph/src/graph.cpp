@@ -20,6 +20,7 @@
 #include <stdio.h>
 
 #include "base_c/defs.h"
+#include "base_cpp/profiling.h"
 #include "base_cpp/tlscont.h"
 #include "graph/cycle_basis.h"
 #include "graph/graph.h"
@@ -28,6 +29,17 @@
 
 using namespace indigo;
 
+// Ring data cache statistics (lookups, recalculations, data kept across
+// edits) are only counted when built with INDIGO_PROFILE_RING_DATA
+#ifdef INDIGO_PROFILE_RING_DATA
+#define RING_DATA_COUNTER(name) profIncCounter(name, 1)
+#else
+#define RING_DATA_COUNTER(name)                                                                                                                                \
+    do                                                                                                                                                         \
+    {                                                                                                                                                          \
+    } while (false)
+#endif
+
 NeighborsAuto Vertex::neighbors() const
 {
     return NeighborsAuto(*this);
@@ -58,7 +70,11 @@ Graph::Graph()
     _vertices = new ObjPool<Vertex>();
     _neighbors_pool = new Pool<List<VertexEdge>::Elem>();
     _sssr_pool = 0;
+    _topology_valid = false;
+    _ring_systems_valid = false;
+    _sssr_valid = false;
     _components_valid = false;
+    _ring_systems_count = 0;
 }
 
 Graph::~Graph()
@@ -75,7 +91,24 @@ Graph::~Graph()
 
 int Graph::addVertex()
 {
-    return _vertices->add(*_neighbors_pool);
+    int idx = _vertices->add(*_neighbors_pool);
+
+    // An isolated vertex lies in no ring, so the ring data stays valid
+    if (_sssr_valid)
+    {
+        _v_smallest_ring_size.expandFill(idx + 1, 0);
+        _v_sssr_count.expandFill(idx + 1, 0);
+        _v_smallest_ring_size[idx] = 0;
+        _v_sssr_count[idx] = 0;
+    }
+    if (_ring_systems_valid)
+    {
+        _ring_systems.expandFill(idx + 1, -1);
+        _ring_systems[idx] = -1;
+    }
+
+    _components_valid = false;
+    return idx;
 }
 
 int Graph::findEdgeIndex(int beg, int end) const
@@ -122,6 +155,9 @@ int Graph::addEdge(int beg, int end)
     if (findEdgeIndex(beg, end) != -1)
         throw Error("already have edge between vertices %d and %d", beg, end);
 
+    // An edge to an isolated vertex can not close a ring
+    bool chain = getVertex(beg).degree() == 0 || getVertex(end).degree() == 0;
+
     int edge_idx = _edges.add();
 
     Vertex& vbeg = _vertices->at(beg);
@@ -141,8 +177,26 @@ int Graph::addEdge(int beg, int end)
     _edges[edge_idx].beg = beg;
     _edges[edge_idx].end = end;
 
-    _topology_valid = false;
-    _sssr_valid = false;
+    if (chain && (_topology_valid || _sssr_valid))
+    {
+        if (_topology_valid)
+        {
+            _topology.expandFill(edge_idx + 1, -1);
+            _topology[edge_idx] = TOPOLOGY_CHAIN;
+        }
+        if (_sssr_valid)
+        {
+            _e_smallest_ring_size.expandFill(edge_idx + 1, 0);
+            _e_smallest_ring_size[edge_idx] = 0;
+        }
+        RING_DATA_COUNTER("graph.ring_data_kept");
+    }
+    else
+    {
+        _topology_valid = false;
+        _ring_systems_valid = false;
+        _sssr_valid = false;
+    }
     _components_valid = false;
 
     return edge_idx;
@@ -158,6 +212,13 @@ void Graph::removeEdge(int idx)
 {
     Edge edge = _edges[idx];
 
+    // Removing an edge that lies in no ring does not change the rings
+    bool chain = false;
+    if (_topology_valid)
+        chain = idx < _topology.size() && _topology[idx] == TOPOLOGY_CHAIN;
+    else if (_sssr_valid)
+        chain = _e_smallest_ring_size[idx] == 0;
+
     Vertex& beg = _vertices->at(edge.beg);
     Vertex& end = _vertices->at(edge.end);
 
@@ -166,8 +227,14 @@ void Graph::removeEdge(int idx)
     beg.neighbors_list.remove(beg.findNeiEdge(idx));
     end.neighbors_list.remove(end.findNeiEdge(idx));
 
-    _topology_valid = false;
-    _sssr_valid = false;
+    if (chain)
+        RING_DATA_COUNTER("graph.ring_data_kept");
+    else
+    {
+        _topology_valid = false;
+        _ring_systems_valid = false;
+        _sssr_valid = false;
+    }
     _components_valid = false;
 }
 
@@ -178,6 +245,7 @@ void Graph::removeAllEdges()
 
     _edges.clear();
     _topology_valid = false;
+    _ring_systems_valid = false;
     _sssr_valid = false;
     _components_valid = false;
 }
@@ -195,13 +263,12 @@ void Graph::removeVertex(int idx)
     for (i = vertex.neiBegin(); i != vertex.neiEnd(); i = vertex.neiNext(i))
         edges.push(vertex.neiEdge(i));
 
+    // removeEdge() keeps the ring data only if the vertex lies in no ring
     for (i = 0; i < edges.size(); i++)
         removeEdge(edges[i]);
 
     _vertices->remove(idx);
 
-    _topology_valid = false;
-    _sssr_valid = false;
     _components_valid = false;
 }
 
@@ -301,6 +368,7 @@ void Graph::clear()
     _vertices->clear();
     _edges.clear();
     _topology_valid = false;
+    _ring_systems_valid = false;
     _sssr_valid = false;
     _components_valid = false;
 }
@@ -366,11 +434,19 @@ void Graph::filterEdges(const Graph& graph, const int* filter, int filter_type,
 void Graph::_mergeWithSubgraph(const Graph& other, const Array<int>& vertices, const Array<int>* edges, Array<int>* vertex_mapping, Array<int>* edge_mapping)
 {
     QS_DEF(Array<int>, tmp_mapping);
+    QS_DEF(Array<int>, tmp_edge_mapping);
     int i;
 
     if (vertex_mapping == 0)
         vertex_mapping = &tmp_mapping;
 
+    // The ring data of a full copy is the ring data of the original
+    bool full_copy = vertexCount() == 0 && vertices.size() == other.vertexCount() && (edges == 0 || edges->size() == other.edgeCount()) &&
+                     (other._topology_valid || other._sssr_valid);
+
+    if (full_copy && edge_mapping == 0)
+        edge_mapping = &tmp_edge_mapping;
+
     vertex_mapping->clear_resize(other.vertexEnd());
     vertex_mapping->fffill();
 
@@ -422,6 +498,64 @@ void Graph::_mergeWithSubgraph(const Graph& other, const Array<int>& vertices, c
                     edge_mapping->at(i) = idx;
             }
         }
+
+    if (full_copy)
+        _copyRingData(other, *vertex_mapping, *edge_mapping);
+}
+
+void Graph::_copyRingData(const Graph& other, const Array<int>& vertex_mapping, const Array<int>& edge_mapping)
+{
+    int i, j;
+
+    if (other._topology_valid)
+    {
+        _topology.clear_resize(edgeEnd());
+        _topology.fffill();
+        for (i = other.edgeBegin(); i != other.edgeEnd(); i = other.edgeNext(i))
+            if (i < other._topology.size())
+                _topology[edge_mapping[i]] = other._topology[i];
+        _topology_valid = true;
+        _ring_systems_valid = false;
+    }
+
+    if (other._ring_systems_valid)
+    {
+        _ring_systems.clear_resize(vertexEnd());
+        _ring_systems.fffill();
+        for (i = other.vertexBegin(); i != other.vertexEnd(); i = other.vertexNext(i))
+            _ring_systems[vertex_mapping[i]] = other._ring_systems[i];
+        _ring_systems_count = other._ring_systems_count;
+        _ring_systems_valid = true;
+    }
+
+    if (other._sssr_valid)
+    {
+        _calculateSSSRInit();
+
+        for (i = other.vertexBegin(); i != other.vertexEnd(); i = other.vertexNext(i))
+        {
+            _v_smallest_ring_size[vertex_mapping[i]] = other._v_smallest_ring_size[i];
+            _v_sssr_count[vertex_mapping[i]] = other._v_sssr_count[i];
+        }
+        for (i = other.edgeBegin(); i != other.edgeEnd(); i = other.edgeNext(i))
+            _e_smallest_ring_size[edge_mapping[i]] = other._e_smallest_ring_size[i];
+
+        for (i = 0; i < other._sssr_vertices.size(); i++)
+        {
+            const List<int>& other_vertices = other._sssr_vertices[i];
+            const List<int>& other_edges = other._sssr_edges[i];
+            List<int>& ring_vertices = _sssr_vertices.push(*_sssr_pool);
+            List<int>& ring_edges = _sssr_edges.push(*_sssr_pool);
+
+            for (j = other_vertices.begin(); j != other_vertices.end(); j = other_vertices.next(j))
+                ring_vertices.add(vertex_mapping[other_vertices[j]]);
+            for (j = other_edges.begin(); j != other_edges.end(); j = other_edges.next(j))
+                ring_edges.add(edge_mapping[other_edges[j]]);
+        }
+        _sssr_valid = true;
+    }
+
+    RING_DATA_COUNTER("graph.ring_data_copied");
 }
 
 void Graph::buildEdgeMapping(const Graph& other, Array<int>* mapping, Array<int>* edge_mapping)
@@ -544,6 +678,7 @@ int Graph::findMappedEdge(const Graph& graph, const Graph& mapped_graph, int edg
 
 int Graph::getEdgeTopology(int idx)
 {
+    RING_DATA_COUNTER("graph.ring_lookups");
     if (!_topology_valid)
         _calculateTopology();
 
@@ -562,6 +697,65 @@ bool Graph::vertexInRing(int idx)
     return false;
 }
 
+int Graph::vertexRingSystem(int idx)
+{
+    RING_DATA_COUNTER("graph.ring_lookups");
+    if (!_ring_systems_valid)
+        _calculateRingSystems();
+
+    return _ring_systems[idx];
+}
+
+int Graph::countRingSystems()
+{
+    RING_DATA_COUNTER("graph.ring_lookups");
+    if (!_ring_systems_valid)
+        _calculateRingSystems();
+
+    return _ring_systems_count;
+}
+
+void Graph::_calculateRingSystems()
+{
+    QS_DEF(Array<int>, stack);
+
+    // Make sure the topology is there before the ring systems are marked valid
+    if (edgeCount() > 0)
+        getEdgeTopology(edgeBegin());
+
+    _ring_systems.clear_resize(vertexEnd());
+    _ring_systems.fffill();
+    _ring_systems_count = 0;
+
+    for (int v = vertexBegin(); v != vertexEnd(); v = vertexNext(v))
+    {
+        if (_ring_systems[v] != -1 || !vertexInRing(v))
+            continue;
+
+        // Vertices connected through ring edges belong to the same system
+        _ring_systems[v] = _ring_systems_count;
+        stack.clear();
+        stack.push(v);
+        while (stack.size() > 0)
+        {
+            const Vertex& vertex = getVertex(stack.pop());
+
+            for (int i = vertex.neiBegin(); i != vertex.neiEnd(); i = vertex.neiNext(i))
+            {
+                int nei = vertex.neiVertex(i);
+                if (_ring_systems[nei] == -1 && _topology[vertex.neiEdge(i)] == TOPOLOGY_RING)
+                {
+                    _ring_systems[nei] = _ring_systems_count;
+                    stack.push(nei);
+                }
+            }
+        }
+        _ring_systems_count++;
+    }
+    _ring_systems_valid = true;
+    RING_DATA_COUNTER("graph.ring_systems_calculated");
+}
+
 void Graph::_calculateTopology()
 {
     SpanningTree spt(*this, 0);
@@ -574,21 +768,26 @@ void Graph::_calculateTopology()
 
     spt.markAllEdgesInCycles(_topology.ptr(), TOPOLOGY_RING);
     _topology_valid = true;
+    _ring_systems_valid = false;
+    RING_DATA_COUNTER("graph.ring_topology_calculated");
 }
 
 void Graph::setEdgeTopology(int idx, int topology)
 {
     _topology.expandFill(idx + 1, -1);
     _topology[idx] = topology;
+    _ring_systems_valid = false;
 }
 
 void Graph::validateEdgeTopologies()
 {
     _topology_valid = true;
+    _ring_systems_valid = false;
 }
 
 int Graph::vertexCountSSSR(int idx)
 {
+    RING_DATA_COUNTER("graph.ring_lookups");
     if (!_sssr_valid)
         _calculateSSSR();
 
@@ -597,6 +796,7 @@ int Graph::vertexCountSSSR(int idx)
 
 int Graph::vertexSmallestRingSize(int idx)
 {
+    RING_DATA_COUNTER("graph.ring_lookups");
     if (!_sssr_valid)
         _calculateSSSR();
 
@@ -605,6 +805,7 @@ int Graph::vertexSmallestRingSize(int idx)
 
 int Graph::edgeSmallestRingSize(int idx)
 {
+    RING_DATA_COUNTER("graph.ring_lookups");
     if (!_sssr_valid)
         _calculateSSSR();
 
@@ -677,6 +878,7 @@ void Graph::_calculateSSSR()
     QS_DEF(CycleBasis, basis);
     basis.create(*this);
     _calculateSSSRByCycleBasis(basis);
+    RING_DATA_COUNTER("graph.sssr_calculated");
 }
 
 void Graph::_calculateComponents()
@@ -747,6 +949,7 @@ const Array<int>& Graph::getDecomposition()
 
 List<int>& Graph::sssrEdges(int idx)
 {
+    RING_DATA_COUNTER("graph.ring_lookups");
     if (!_sssr_valid)
         _calculateSSSR();
     return _sssr_edges[idx];
@@ -754,6 +957,7 @@ List<int>& Graph::sssrEdges(int idx)
 
 List<int>& Graph::sssrVertices(int idx)
 {
+    RING_DATA_COUNTER("graph.ring_lookups");
     if (!_sssr_valid)
         _calculateSSSR();
     return _sssr_vertices[idx];
@@ -761,6 +965,7 @@ List<int>& Graph::sssrVertices(int idx)
 
 int Graph::sssrCount()
 {
+    RING_DATA_COUNTER("graph.ring_lookups");
     if (!_sssr_valid)
         _calculateSSSR();
     return _sssr_vertices.size();
@@ -834,8 +1039,24 @@ void Graph::_cloneGraph_KeepIndices(const Graph& other)
         throw Error("_clone_KeepIndices: internal");
 
     _topology_valid = false;
+    _ring_systems_valid = false;
     _sssr_valid = false;
     _components_valid = false;
+
+    if (other._topology_valid || other._sssr_valid)
+    {
+        QS_DEF(Array<int>, vertex_mapping);
+        QS_DEF(Array<int>, edge_mapping);
+
+        vertex_mapping.clear_resize(max_vertex_idx + 1);
+        for (i = 0; i <= max_vertex_idx; i++)
+            vertex_mapping[i] = i;
+        edge_mapping.clear_resize(max_edge_idx + 1);
+        for (i = 0; i <= max_edge_idx; i++)
+            edge_mapping[i] = i;
+
+        _copyRingData(other, vertex_mapping, edge_mapping);
+    }
 }
 
 void Graph::_calculateSSSRAddEdgesAndVertices(const Array<int>& cycle, List<int>& edges, List<int>& vertices)
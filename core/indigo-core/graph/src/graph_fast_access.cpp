@@ -22,112 +22,124 @@
 
 using namespace indigo;
 
-void GraphFastAccess::setGraph(Graph& g)
+GraphFastAccess::GraphFastAccess() : _graph(nullptr), _vertices_ready(false), _edges_ready(false)
 {
-    _g = &g;
+}
 
-    _vertices.clear();
+void GraphFastAccess::setGraph(Graph& g)
+{
+    _graph = &g;
+    _vertices_ready = false;
+    _edges_ready = false;
 
     _vertices_nei.resize(g.vertexEnd());
     _vertices_nei.fffill();
 
+    // Every neighbourhood is appended at most once, so the data never
+    // reallocates and the returned pointers stay valid
     _nei_vertices_data.clear();
     _nei_edges_data.clear();
+    _nei_vertices_data.reserve(g.edgeCount() * 2);
+    _nei_edges_data.reserve(g.edgeCount() * 2);
 }
 
-int* GraphFastAccess::prepareVertices(int& count)
+void GraphFastAccess::_prepareVertices()
 {
-    count = _vertices.size();
-    if (count != 0)
-        return _vertices.ptr();
-
-    for (int v = _g->vertexBegin(); v != _g->vertexEnd(); v = _g->vertexNext(v))
+    if (_vertices_ready)
+        return;
+    _vertices.clear();
+    for (int v = _graph->vertexBegin(); v != _graph->vertexEnd(); v = _graph->vertexNext(v))
         _vertices.push(v);
+    _vertices_ready = true;
+}
 
+const int* GraphFastAccess::prepareVertices(int& count)
+{
+    _prepareVertices();
     count = _vertices.size();
     return _vertices.ptr();
 }
 
 int GraphFastAccess::getVertex(int idx)
 {
-    return _vertices.ptr()[idx];
+    _prepareVertices();
+    return _vertices[idx];
 }
 
 int GraphFastAccess::vertexCount()
 {
+    _prepareVertices();
     return _vertices.size();
 }
 
-// Prepare both nei vertices and edges list. Runs faster then
-// preparing them one by one.
 void GraphFastAccess::prepareVertexNeiVerticesAndEdges(int v)
 {
-    if (_vertices_nei[v].v_begin != -1 && _vertices_nei[v].e_begin != -1)
+    VertexNeiBlock& block = _vertices_nei[v];
+    if (block.begin != -1)
         return;
 
-    _vertices_nei[v].v_begin = _nei_vertices_data.size();
-    _vertices_nei[v].e_begin = _nei_edges_data.size();
+    block.begin = _nei_vertices_data.size();
 
-    const Vertex& vertex = _g->getVertex(v);
+    const Vertex& vertex = _graph->getVertex(v);
     for (int i = vertex.neiBegin(); i != vertex.neiEnd(); i = vertex.neiNext(i))
     {
         _nei_vertices_data.push(vertex.neiVertex(i));
         _nei_edges_data.push(vertex.neiEdge(i));
     }
 
-    _vertices_nei[v].v_count = _nei_vertices_data.size() - _vertices_nei[v].v_begin;
-    _vertices_nei[v].e_count = _nei_edges_data.size() - _vertices_nei[v].e_begin;
+    block.count = _nei_vertices_data.size() - block.begin;
 }
 
-// Returns nei vertices and nei edges for specified vertex
-// Numeration is coherent
-int* GraphFastAccess::getVertexNeiVertices(int v, int& count)
+const int* GraphFastAccess::getVertexNeiVertices(int v, int& count)
 {
     int offset = prepareVertexNeiVertices(v, count);
     return _nei_vertices_data.ptr() + offset;
 }
 
-int* GraphFastAccess::getVertexNeiEdges(int v, int& count)
+const int* GraphFastAccess::getVertexNeiEdges(int v, int& count)
 {
-    if (_vertices_nei[v].e_begin == -1)
-        prepareVertexNeiVerticesAndEdges(v);
-
-    count = _vertices_nei[v].e_count;
-    return _nei_edges_data.ptr() + _vertices_nei[v].e_begin;
+    int offset = prepareVertexNeiVertices(v, count);
+    return _nei_edges_data.ptr() + offset;
 }
 
 int GraphFastAccess::findEdgeIndex(int v1, int v2)
 {
     int count;
-    int* vertices = getVertexNeiVertices(v1, count);
-    int* edges = getVertexNeiEdges(v1, count);
+    int offset = prepareVertexNeiVertices(v1, count);
+    const int* vertices = _nei_vertices_data.ptr() + offset;
     for (int i = 0; i < count; i++)
         if (vertices[i] == v2)
-            return edges[i];
+            return _nei_edges_data[offset + i];
     return -1;
 }
 
 void GraphFastAccess::prepareEdges()
 {
-    _edges.clear_resize(_g->edgeEnd());
-    for (int e = _g->edgeBegin(); e != _g->edgeEnd(); e = _g->edgeNext(e))
-        _edges[e] = _g->getEdge(e);
+    if (_edges_ready)
+        return;
+    _edges.clear_resize(_graph->edgeEnd());
+    for (int e = _graph->edgeBegin(); e != _graph->edgeEnd(); e = _graph->edgeNext(e))
+        _edges[e] = _graph->getEdge(e);
+    _edges_ready = true;
 }
 
 const Edge& GraphFastAccess::getEdge(int e)
 {
+    prepareEdges();
     return _edges[e];
 }
 
 const Edge* GraphFastAccess::getEdges()
 {
+    prepareEdges();
     return _edges.ptr();
 }
 
 int GraphFastAccess::prepareVertexNeiVertices(int v, int& count)
 {
-    getVertexNeiEdges(v, count);
-    return _vertices_nei.ptr()[v].v_begin;
+    prepareVertexNeiVerticesAndEdges(v);
+    count = _vertices_nei[v].count;
+    return _vertices_nei[v].begin;
 }
 
 int GraphFastAccess::getVertexNeiVertiex(int v_id, int index)
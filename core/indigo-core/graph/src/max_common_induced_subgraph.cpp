@@ -0,0 +1,638 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "graph/max_common_induced_subgraph.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "base_c/nano.h"
+#include "base_cpp/cancellation_handler.h"
+
+using namespace indigo;
+
+IMPL_ERROR(MaxCommonInducedSubgraph, "MCIS");
+
+MaxCommonInducedSubgraph::MaxCommonInducedSubgraph(Graph& sub, Graph& super)
+    : cbMatchVertex(0), cbMatchEdge(0), userdata(0), connected(true), timeLimit(0), threadCount(0), _g1(sub), _g2(super), _n1(0), _n2(0), _top_bd(-1),
+      _top_v(-1), _top_w(-1), _top_i(0), _best_size(0), _stopped(false), _start_time(0), _cancellation_handler(0)
+{
+}
+
+MaxCommonInducedSubgraph::~MaxCommonInducedSubgraph()
+{
+}
+
+bool MaxCommonInducedSubgraph::find()
+{
+    _best1.clear();
+    _best2.clear();
+    _best_size = 0;
+    _stopped = false;
+    _start_time = nanoClock();
+    _cancellation_handler = getCancellationHandler();
+
+    // Callbacks are called here only, so the workers read the prepared arrays
+    _prepareLabels();
+    _prepareTopLevel();
+
+    if (threadCount > 0)
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; i++)
+            threads.emplace_back([this]() { _searchThread(); });
+        for (auto& thread : threads)
+            thread.join();
+
+        if (_thread_exception)
+        {
+            std::unique_ptr<Exception> exception(std::move(_thread_exception));
+            throw *exception;
+        }
+    }
+    else
+        _searchThread();
+
+    return !_stopped;
+}
+
+int MaxCommonInducedSubgraph::solutionSize() const
+{
+    return _best1.size();
+}
+
+void MaxCommonInducedSubgraph::getSolutionMap(Array<int>& map) const
+{
+    map.clear_resize(_g1.vertexEnd());
+    map.fill(-1);
+    for (int i = 0; i < _best1.size(); i++)
+        map[_vertices1[_best1[i]]] = _vertices2[_best2[i]];
+}
+
+void MaxCommonInducedSubgraph::getSolutionListsSuper(Array<int>& v_list, Array<int>& e_list) const
+{
+    Array<char> mapped;
+    mapped.clear_resize(_g2.vertexEnd());
+    mapped.zerofill();
+
+    v_list.clear();
+    e_list.clear();
+    for (int i = 0; i < _best2.size(); i++)
+    {
+        int vertex = _vertices2[_best2[i]];
+        mapped[vertex] = 1;
+        v_list.push(vertex);
+    }
+
+    for (int e = _g2.edgeBegin(); e != _g2.edgeEnd(); e = _g2.edgeNext(e))
+    {
+        const Edge& edge = _g2.getEdge(e);
+        if (mapped[edge.beg] && mapped[edge.end])
+            e_list.push(e);
+    }
+}
+
+void MaxCommonInducedSubgraph::_prepareLabels()
+{
+    Array<int> sub_vertices, super_vertices;
+    int i, j, k;
+
+    for (i = _g1.vertexBegin(); i != _g1.vertexEnd(); i = _g1.vertexNext(i))
+        sub_vertices.push(i);
+    for (i = _g2.vertexBegin(); i != _g2.vertexEnd(); i = _g2.vertexNext(i))
+        super_vertices.push(i);
+
+    int m1 = sub_vertices.size();
+    int m2 = super_vertices.size();
+
+    // Vertex label classes are the distinct rows of the compatibility matrix
+    Array<char> compat;
+    compat.clear_resize(m1 * m2);
+    for (i = 0; i < m1; i++)
+        for (j = 0; j < m2; j++)
+            compat[i * m2 + j] = (cbMatchVertex == 0 || cbMatchVertex(_g1, _g2, 0, sub_vertices[i], super_vertices[j], userdata)) ? 1 : 0;
+
+    Array<int> class_rows, sub_labels, super_labels;
+    sub_labels.clear_resize(m1);
+    super_labels.clear_resize(m2);
+    super_labels.fill(-1);
+
+    for (i = 0; i < m1; i++)
+    {
+        const char* row = compat.ptr() + i * m2;
+        sub_labels[i] = -1;
+        if (m2 == 0 || std::find(row, row + m2, 1) == row + m2)
+            continue;
+        for (k = 0; k < class_rows.size(); k++)
+            if (memcmp(row, compat.ptr() + class_rows[k] * m2, m2) == 0)
+                break;
+        if (k == class_rows.size())
+            class_rows.push(i);
+        sub_labels[i] = k;
+    }
+
+    for (k = 0; k < class_rows.size(); k++)
+    {
+        const char* row = compat.ptr() + class_rows[k] * m2;
+        for (j = 0; j < m2; j++)
+        {
+            if (!row[j])
+                continue;
+            if (super_labels[j] != -1)
+                throw Error("vertex matching condition is not an equivalence relation");
+            super_labels[j] = k;
+        }
+    }
+
+    // Dense indices in the order of decreasing degree, vertices without partners are dropped
+    Array<int> dense1, dense2;
+    dense1.clear_resize(_g1.vertexEnd());
+    dense1.fill(-1);
+    dense2.clear_resize(_g2.vertexEnd());
+    dense2.fill(-1);
+
+    _vertices1.clear();
+    for (i = 0; i < m1; i++)
+        if (sub_labels[i] >= 0)
+            _vertices1.push(i);
+    _vertices2.clear();
+    for (j = 0; j < m2; j++)
+        if (super_labels[j] >= 0)
+            _vertices2.push(j);
+
+    std::stable_sort(_vertices1.ptr(), _vertices1.ptr() + _vertices1.size(),
+                     [&](int a, int b) { return _g1.getVertex(sub_vertices[a]).degree() > _g1.getVertex(sub_vertices[b]).degree(); });
+    std::stable_sort(_vertices2.ptr(), _vertices2.ptr() + _vertices2.size(),
+                     [&](int a, int b) { return _g2.getVertex(super_vertices[a]).degree() > _g2.getVertex(super_vertices[b]).degree(); });
+
+    _n1 = _vertices1.size();
+    _n2 = _vertices2.size();
+    _labels1.clear_resize(_n1);
+    _labels2.clear_resize(_n2);
+    for (i = 0; i < _n1; i++)
+    {
+        _labels1[i] = sub_labels[_vertices1[i]];
+        _vertices1[i] = sub_vertices[_vertices1[i]];
+        dense1[_vertices1[i]] = i;
+    }
+    for (j = 0; j < _n2; j++)
+    {
+        _labels2[j] = super_labels[_vertices2[j]];
+        _vertices2[j] = super_vertices[_vertices2[j]];
+        dense2[_vertices2[j]] = j;
+    }
+
+    // Edge label classes, the same way
+    Array<int> sub_edges, super_edges;
+    for (i = _g1.edgeBegin(); i != _g1.edgeEnd(); i = _g1.edgeNext(i))
+        if (dense1[_g1.getEdge(i).beg] >= 0 && dense1[_g1.getEdge(i).end] >= 0)
+            sub_edges.push(i);
+    for (i = _g2.edgeBegin(); i != _g2.edgeEnd(); i = _g2.edgeNext(i))
+        if (dense2[_g2.getEdge(i).beg] >= 0 && dense2[_g2.getEdge(i).end] >= 0)
+            super_edges.push(i);
+
+    int k1 = sub_edges.size();
+    int k2 = super_edges.size();
+
+    compat.clear_resize(k1 * k2);
+    for (i = 0; i < k1; i++)
+        for (j = 0; j < k2; j++)
+            compat[i * k2 + j] = (cbMatchEdge == 0 || cbMatchEdge(_g1, _g2, sub_edges[i], super_edges[j], userdata)) ? 1 : 0;
+
+    // Edges without partners get labels that never match: -1 in the first graph, -2 in the second
+    class_rows.clear();
+    sub_labels.clear_resize(k1);
+    super_labels.clear_resize(k2);
+    super_labels.fill(-2);
+
+    for (i = 0; i < k1; i++)
+    {
+        const char* row = compat.ptr() + i * k2;
+        sub_labels[i] = -1;
+        if (k2 == 0 || std::find(row, row + k2, 1) == row + k2)
+            continue;
+        for (k = 0; k < class_rows.size(); k++)
+            if (memcmp(row, compat.ptr() + class_rows[k] * k2, k2) == 0)
+                break;
+        if (k == class_rows.size())
+            class_rows.push(i);
+        sub_labels[i] = k + 1;
+    }
+
+    for (k = 0; k < class_rows.size(); k++)
+    {
+        const char* row = compat.ptr() + class_rows[k] * k2;
+        for (j = 0; j < k2; j++)
+        {
+            if (!row[j])
+                continue;
+            if (super_labels[j] != -2)
+                throw Error("edge matching condition is not an equivalence relation");
+            super_labels[j] = k + 1;
+        }
+    }
+
+    _adj1.clear_resize(_n1 * _n1);
+    _adj1.zerofill();
+    for (i = 0; i < k1; i++)
+    {
+        const Edge& edge = _g1.getEdge(sub_edges[i]);
+        int a = dense1[edge.beg], b = dense1[edge.end];
+        _adj1[a * _n1 + b] = _adj1[b * _n1 + a] = sub_labels[i];
+    }
+
+    _adj2.clear_resize(_n2 * _n2);
+    _adj2.zerofill();
+    for (j = 0; j < k2; j++)
+    {
+        const Edge& edge = _g2.getEdge(super_edges[j]);
+        int a = dense2[edge.beg], b = dense2[edge.end];
+        _adj2[a * _n2 + b] = _adj2[b * _n2 + a] = super_labels[j];
+    }
+}
+
+void MaxCommonInducedSubgraph::_prepareTopLevel()
+{
+    int label_count = 0;
+    int i;
+
+    for (i = 0; i < _n1; i++)
+        label_count = std::max(label_count, _labels1[i] + 1);
+
+    _top_domains.clear();
+    _top_left.clear();
+    _top_right.clear();
+
+    for (int label = 0; label < label_count; label++)
+    {
+        Bidomain bd;
+        bd.l = _top_left.size();
+        bd.r = _top_right.size();
+        bd.adjacent = false;
+
+        for (i = 0; i < _n1; i++)
+            if (_labels1[i] == label)
+                _top_left.push(i);
+        for (i = 0; i < _n2; i++)
+            if (_labels2[i] == label)
+                _top_right.push(i);
+
+        bd.left_len = _top_left.size() - bd.l;
+        bd.right_len = _top_right.size() - bd.r;
+        if (bd.left_len > 0 && bd.right_len > 0)
+            _top_domains.push(bd);
+        else
+        {
+            _top_left.resize(bd.l);
+            _top_right.resize(bd.r);
+        }
+    }
+
+    _top_bd = -1;
+    _top_v = -1;
+    _top_w = -1;
+    _top_i = 0;
+}
+
+// The top level of the search tree is unrolled here: each (v, w) pair starts
+// an independent subtree, handed out to the workers as soon as one is idle.
+bool MaxCommonInducedSubgraph::_nextTopLevelTask(SearchState& state)
+{
+    while (true)
+    {
+        if (_stopped)
+            return false;
+
+        if (_top_v < 0)
+        {
+            if (_calcBound(_top_domains) <= _best_size)
+                return false;
+
+            _top_bd = _selectBidomain(_top_domains, _top_left, 0);
+            if (_top_bd < 0)
+                return false;
+
+            Bidomain& bd = _top_domains[_top_bd];
+            int idx = _findMinValue(_top_left, bd.l, bd.left_len);
+            _top_v = _top_left[bd.l + idx];
+            std::swap(_top_left[bd.l + idx], _top_left[bd.l + bd.left_len - 1]);
+            bd.left_len--;
+            bd.right_len--;
+            _top_w = -1;
+            _top_i = 0;
+        }
+
+        Bidomain& bd = _top_domains[_top_bd];
+
+        if (_top_i <= bd.right_len)
+        {
+            int idx = _indexOfNextSmallest(_top_right, bd.r, bd.right_len + 1, _top_w);
+            _top_w = _top_right[bd.r + idx];
+            std::swap(_top_right[bd.r + idx], _top_right[bd.r + bd.right_len]);
+            _top_i++;
+
+            int max_depth = std::min(_n1, _n2) + 1;
+
+            state.v = _top_v;
+            state.w = _top_w;
+            state.left.copy(_top_left);
+            state.right.copy(_top_right);
+            state.current1.clear_resize(max_depth);
+            state.current2.clear_resize(max_depth);
+            while (state.levels.size() < max_depth + 1)
+                state.levels.push();
+            state.levels[0].copy(_top_domains);
+            return true;
+        }
+
+        // All the pairs for _top_v are given out, continue with _top_v left unmatched
+        bd.right_len++;
+        if (bd.left_len == 0)
+        {
+            _top_domains[_top_bd] = _top_domains.top();
+            _top_domains.pop();
+        }
+        _top_v = -1;
+    }
+}
+
+// Workers take the top level subtrees one by one, so an idle thread
+// always picks up the next pending branch
+void MaxCommonInducedSubgraph::_searchThread()
+{
+    SearchState state;
+    state.nodes = 0;
+
+    try
+    {
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_top_lock);
+                if (!_nextTopLevelTask(state))
+                    break;
+            }
+
+            _filterDomains(state.levels[0], state.levels[1], state.left, state.right, state.v, state.w);
+            state.current1[0] = state.v;
+            state.current2[0] = state.w;
+            _solve(state, 1);
+        }
+    }
+    catch (Exception& e)
+    {
+        if (threadCount <= 0)
+            throw;
+
+        std::lock_guard<std::mutex> lock(_top_lock);
+        if (!_thread_exception)
+            _thread_exception.reset(new Exception(e));
+        _stopped = true;
+    }
+}
+
+void MaxCommonInducedSubgraph::_solve(SearchState& state, int depth)
+{
+    Array<Bidomain>& domains = state.levels[depth];
+
+    // The branch with the selected vertex left unmatched is a loop instead of a tail call
+    while (true)
+    {
+        if (_checkStop(state))
+            return;
+
+        if (depth > _best_size)
+            _updateBest(state.current1, state.current2, depth);
+
+        if (depth + _calcBound(domains) <= _best_size)
+            return;
+
+        int bd_idx = _selectBidomain(domains, state.left, depth);
+        if (bd_idx < 0)
+            return;
+
+        Bidomain& bd = domains[bd_idx];
+        Array<int>& left = state.left;
+        Array<int>& right = state.right;
+
+        int idx = _findMinValue(left, bd.l, bd.left_len);
+        int v = left[bd.l + idx];
+        std::swap(left[bd.l + idx], left[bd.l + bd.left_len - 1]);
+        bd.left_len--;
+
+        int w = -1;
+        bd.right_len--;
+        for (int i = 0; i <= bd.right_len; i++)
+        {
+            idx = _indexOfNextSmallest(right, bd.r, bd.right_len + 1, w);
+            w = right[bd.r + idx];
+            std::swap(right[bd.r + idx], right[bd.r + bd.right_len]);
+
+            _filterDomains(domains, state.levels[depth + 1], left, right, v, w);
+            state.current1[depth] = v;
+            state.current2[depth] = w;
+            _solve(state, depth + 1);
+        }
+        bd.right_len++;
+
+        if (bd.left_len == 0)
+        {
+            domains[bd_idx] = domains.top();
+            domains.pop();
+        }
+    }
+}
+
+void MaxCommonInducedSubgraph::_filterDomains(const Array<Bidomain>& domains, Array<Bidomain>& new_domains, Array<int>& left, Array<int>& right, int v,
+                                              int w)
+{
+    const int* row_v = _adj1.ptr() + v * _n1;
+    const int* row_w = _adj2.ptr() + w * _n2;
+
+    new_domains.clear();
+
+    for (int i = 0; i < domains.size(); i++)
+    {
+        const Bidomain& old_bd = domains[i];
+        int l = old_bd.l;
+        int r = old_bd.r;
+
+        // Vertices adjacent to v (resp. w) go first
+        int left_len = _partition(left, l, old_bd.left_len, row_v);
+        int right_len = _partition(right, r, old_bd.right_len, row_w);
+        int left_len_noedge = old_bd.left_len - left_len;
+        int right_len_noedge = old_bd.right_len - right_len;
+
+        if (left_len_noedge > 0 && right_len_noedge > 0)
+        {
+            Bidomain& bd = new_domains.push();
+            bd.l = l + left_len;
+            bd.r = r + right_len;
+            bd.left_len = left_len_noedge;
+            bd.right_len = right_len_noedge;
+            bd.adjacent = old_bd.adjacent;
+        }
+
+        if (left_len == 0 || right_len == 0)
+            continue;
+
+        // Adjacent vertices are split further by the edge label
+        int* l_begin = left.ptr() + l;
+        int* r_begin = right.ptr() + r;
+        int* l_top = l_begin + left_len;
+        int* r_top = r_begin + right_len;
+
+        std::sort(l_begin, l_top, [row_v](int a, int b) { return row_v[a] < row_v[b]; });
+        std::sort(r_begin, r_top, [row_w](int a, int b) { return row_w[a] < row_w[b]; });
+
+        while (l_begin != l_top && r_begin != r_top)
+        {
+            int left_label = row_v[*l_begin];
+            int right_label = row_w[*r_begin];
+
+            if (left_label < right_label)
+                l_begin++;
+            else if (left_label > right_label)
+                r_begin++;
+            else
+            {
+                int* l_mid = l_begin;
+                int* r_mid = r_begin;
+                while (l_mid != l_top && row_v[*l_mid] == left_label)
+                    l_mid++;
+                while (r_mid != r_top && row_w[*r_mid] == left_label)
+                    r_mid++;
+
+                Bidomain& bd = new_domains.push();
+                bd.l = (int)(l_begin - left.ptr());
+                bd.r = (int)(r_begin - right.ptr());
+                bd.left_len = (int)(l_mid - l_begin);
+                bd.right_len = (int)(r_mid - r_begin);
+                bd.adjacent = true;
+
+                l_begin = l_mid;
+                r_begin = r_mid;
+            }
+        }
+    }
+}
+
+int MaxCommonInducedSubgraph::_selectBidomain(const Array<Bidomain>& domains, const Array<int>& left, int depth) const
+{
+    // Smallest domain first, ties are broken by the first vertex
+    int min_size = INT_MAX;
+    int min_tie_breaker = INT_MAX;
+    int best = -1;
+
+    for (int i = 0; i < domains.size(); i++)
+    {
+        const Bidomain& bd = domains[i];
+
+        if (connected && depth > 0 && !bd.adjacent)
+            continue;
+
+        int len = std::max(bd.left_len, bd.right_len);
+        if (len > min_size)
+            continue;
+
+        int tie_breaker = left[bd.l + _findMinValue(left, bd.l, bd.left_len)];
+        if (len < min_size || tie_breaker < min_tie_breaker)
+        {
+            min_size = len;
+            min_tie_breaker = tie_breaker;
+            best = i;
+        }
+    }
+    return best;
+}
+
+bool MaxCommonInducedSubgraph::_checkStop(SearchState& state)
+{
+    if (_stopped.load(std::memory_order_relaxed))
+        return true;
+
+    if ((++state.nodes & 0x3FF) == 0)
+    {
+        if (timeLimit > 0 && nanoHowManySeconds(nanoClock() - _start_time) * 1000 > timeLimit)
+            _stopped = true;
+        else if (_cancellation_handler != 0 && _cancellation_handler->isCancelled())
+            _stopped = true;
+    }
+    return _stopped.load(std::memory_order_relaxed);
+}
+
+void MaxCommonInducedSubgraph::_updateBest(const Array<int>& current1, const Array<int>& current2, int size)
+{
+    std::lock_guard<std::mutex> lock(_best_lock);
+
+    if (size <= _best_size)
+        return;
+
+    _best1.copy(current1.ptr(), size);
+    _best2.copy(current2.ptr(), size);
+    _best_size = size;
+}
+
+int MaxCommonInducedSubgraph::_calcBound(const Array<Bidomain>& domains)
+{
+    int bound = 0;
+    for (int i = 0; i < domains.size(); i++)
+        bound += std::min(domains[i].left_len, domains[i].right_len);
+    return bound;
+}
+
+int MaxCommonInducedSubgraph::_partition(Array<int>& all, int start, int len, const int* adjrow)
+{
+    int count = 0;
+    for (int j = 0; j < len; j++)
+    {
+        if (adjrow[all[start + j]] != 0)
+        {
+            std::swap(all[start + count], all[start + j]);
+            count++;
+        }
+    }
+    return count;
+}
+
+int MaxCommonInducedSubgraph::_findMinValue(const Array<int>& arr, int start, int len)
+{
+    int idx = 0;
+    for (int i = 1; i < len; i++)
+        if (arr[start + i] < arr[start + idx])
+            idx = i;
+    return idx;
+}
+
+int MaxCommonInducedSubgraph::_indexOfNextSmallest(const Array<int>& arr, int start, int len, int w)
+{
+    int idx = -1;
+    int smallest = INT_MAX;
+    for (int i = 0; i < len; i++)
+    {
+        if (arr[start + i] > w && arr[start + i] < smallest)
+        {
+            smallest = arr[start + i];
+            idx = i;
+        }
+    }
+    return idx;
+}
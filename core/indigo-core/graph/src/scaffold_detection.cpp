@@ -18,7 +18,9 @@
 
 #include "graph/scaffold_detection.h"
 #include "base_cpp/array.h"
+#include "base_c/nano.h"
 #include "base_cpp/ptr_array.h"
+#include "graph/max_common_induced_subgraph.h"
 #include "graph/max_common_subgraph.h"
 
 using namespace indigo;
@@ -27,11 +29,11 @@ IMPL_ERROR(ScaffoldDetection, "Scaffold detection");
 
 ScaffoldDetection::ScaffoldDetection(ObjArray<Graph>* graph_set)
     : cbEdgeWeight(0), cbVerticesColor(0), cbSortSolutions(0), userdata(0), cbEmbedding(0), embeddingUserdata(0), searchStructures(graph_set),
-      basketStructures(0), maxIterations(0)
+      basketStructures(0), maxIterations(0), timeLimit(0), threadCount(0), searchStopped(false)
 {
 }
 
-void ScaffoldDetection::_searchScaffold(Graph& scaffold, bool approximate)
+void ScaffoldDetection::_searchScaffold(Graph& scaffold, int mode)
 {
     GraphBasket graph_basket;
     QS_DEF(ObjArray<Graph>, temp_set);
@@ -42,8 +44,10 @@ void ScaffoldDetection::_searchScaffold(Graph& scaffold, bool approximate)
 
     graph_basket.initBasket(searchStructures, basketStructures, GraphBasket::MAX_MOLECULES_NUMBER);
 
-    if (approximate)
+    if (mode == SEARCH_APPROXIMATE)
         _searchApproximateScaffold(graph_basket);
+    else if (mode == SEARCH_MCSPLIT)
+        _searchMcSplitScaffold(graph_basket);
     else
         _searchExactScaffold(graph_basket);
 
@@ -209,6 +213,67 @@ void ScaffoldDetection::_searchApproximateScaffold(GraphBasket& basket)
     }
 }
 
+void ScaffoldDetection::_searchMcSplitScaffold(GraphBasket& basket)
+{
+    Array<int> v_list;
+    Array<int> e_list;
+
+    int graphset_size = basket.getGraphSetSize();
+    qword start_time = nanoClock();
+
+    SubstructureMcs sub_mcs;
+    sub_mcs.cbMatchEdge = cbEdgeWeight;
+    sub_mcs.cbMatchVertex = cbVerticesColor;
+    sub_mcs.userdata = userdata;
+
+    basket.cbMatchEdges = cbEdgeWeight;
+    basket.cbMatchVertices = cbVerticesColor;
+    basket.userdata = userdata;
+
+    searchStopped = false;
+
+    for (int orgraph = 1; orgraph < graphset_size; orgraph++)
+    {
+        Graph& graph_set = basket.getGraphFromSet(orgraph);
+
+        for (int bgraph = basket.graphBegin(); bgraph >= 0; bgraph = basket.graphNext(bgraph))
+        {
+            Graph& graph_bask = basket.getGraph(bgraph);
+
+            sub_mcs.setGraphs(graph_bask, graph_set);
+            if (!sub_mcs.isInverted() && sub_mcs.searchSubstructure(0))
+                continue;
+
+            MaxCommonInducedSubgraph mcs(graph_bask, graph_set);
+            mcs.cbMatchEdge = cbEdgeWeight;
+            mcs.cbMatchVertex = cbVerticesColor;
+            mcs.userdata = userdata;
+            mcs.threadCount = threadCount;
+
+            // The time budget is shared by all the pairs, when it is spent
+            // each pair still gets the first solution found
+            if (timeLimit > 0)
+                mcs.timeLimit = std::max(timeLimit - (int)(nanoHowManySeconds(nanoClock() - start_time) * 1000), 1);
+
+            if (!mcs.find())
+                searchStopped = true;
+
+            mcs.getSolutionListsSuper(v_list, e_list);
+            if (e_list.size() > 0)
+                basket.addToNextEmptySpot(graph_set, v_list, e_list);
+
+            basket.removeGraph(bgraph);
+        }
+        basket.checkAddedGraphs();
+
+        if (cbEmbedding != 0)
+        {
+            if (!cbEmbedding(&orgraph, &graphset_size, 0, embeddingUserdata))
+                break;
+        }
+    }
+}
+
 void ScaffoldDetection::GraphBasket::_sortGraphsInSet()
 {
     int set_size = _searchStructures->size();
@@ -53,6 +53,9 @@ bool PatternLayoutFinder::tryToFindPattern(MoleculeLayoutGraphSmart& layout_grap
 
     layout_graph.calcMorganCode();
 
+    // Created for the first candidate pattern and reset for the others
+    Obj<EmbeddingEnumerator> ee;
+
     for (auto& pattern : _patterns)
     {
         MoleculeLayoutGraphSmart& plg = pattern->layout_graph;
@@ -72,16 +75,19 @@ bool PatternLayoutFinder::tryToFindPattern(MoleculeLayoutGraphSmart& layout_grap
         profTimerStart(t0, "layout.find-pattern");
 
         // Check if substructure matching found
-        EmbeddingEnumerator ee(layout_graph);
+        if (ee.get() == 0)
+            ee.create(layout_graph);
+        else
+            ee->reset(layout_graph);
 
-        ee.setSubgraph(pattern->query_molecule);
-        ee.cb_match_edge = _matchPatternBond;
-        ee.cb_match_vertex = _matchPatternAtom;
+        ee->setSubgraph(pattern->query_molecule);
+        ee->cb_match_edge = _matchPatternBond;
+        ee->cb_match_vertex = _matchPatternAtom;
 
-        if (!ee.process())
+        if (!ee->process())
         {
             // Embedding has been found -> copy coordinates
-            const int* mapping = ee.getSubgraphMapping();
+            const int* mapping = ee->getSubgraphMapping();
             QueryMolecule& qm = pattern->query_molecule;
             int v0 = layout_graph.vertexBegin();
             for (int v = qm.vertexBegin(); v != qm.vertexEnd(); v = qm.vertexNext(v))
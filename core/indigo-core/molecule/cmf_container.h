@@ -0,0 +1,140 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __cmf_container_h__
+#define __cmf_container_h__
+
+#include "base_cpp/array.h"
+#include "base_cpp/exception.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+    class Output;
+    class Scanner;
+    class PropertiesMap;
+    class CmfContainerReader;
+
+    // Container file of serialized molecules and reactions (IcmSaver and IcrSaver
+    // records) with random access by record number. Each record keeps its
+    // name and properties and, if the container has them, a fingerprint and a hash.
+    //
+    // The file is a header followed by segments. A segment is the data of its
+    // records, a table with one fixed-size entry per record, and a trailer that
+    // points to the table and to the trailer of the previous segment. Appending
+    // adds segments and leaves the ones already written untouched.
+    // Numbers are in native byte order.
+    class DLLEXPORT CmfContainerWriter
+    {
+    public:
+        DECL_ERROR;
+
+        // Container flags
+        enum
+        {
+            FINGERPRINTS = 1,
+            HASHES = 2
+        };
+
+        explicit CmfContainerWriter(Output& output);
+
+        // Starts a new container at the current output position.
+        // "metadata" is kept in the header as is.
+        void begin(int flags, int fingerprint_size, const char* metadata);
+        // Continues the container of "reader". The output has to write at the end of its file.
+        void beginAppend(const CmfContainerReader& reader);
+
+        // "fingerprint" and "hash" are ignored unless the container has them
+        void append(const char* data, int size, const char* name, PropertiesMap* properties, const byte* fingerprint, qword hash);
+
+        // Writes the table of the last segment
+        void close();
+
+    protected:
+        void _write(const void* data, int size);
+        void _writeSegment();
+
+        Output& _output;
+        long long _position;
+        long long _last_trailer;
+        int _flags;
+        int _fingerprint_size;
+        int _entry_size;
+        bool _started;
+        Array<char> _table;
+        int _segment_count;
+        Array<char> _properties;
+    };
+
+    class DLLEXPORT CmfContainerReader
+    {
+    public:
+        DECL_ERROR;
+
+        // Reads the header and the segment list. The container starts at the
+        // current scanner position and ends at the end of the scanner.
+        explicit CmfContainerReader(Scanner& scanner);
+
+        int count() const;
+        int flags() const;
+        int fingerprintSize() const;
+        const char* metadata() const;
+
+        // "name" (zero-terminated) and "properties" are optional
+        void readRecord(int index, Array<char>& data, Array<char>* name, PropertiesMap* properties);
+        void readFingerprint(int index, Array<byte>& fingerprint);
+        qword readHash(int index);
+        // Position of the record data in the container
+        long long offset(int index);
+
+    protected:
+        friend class CmfContainerWriter;
+
+        struct _Segment
+        {
+            int first;
+            int count;
+            long long table;
+        };
+
+        void _readEntry(int index, int part_offset, int size, void* dest);
+
+        Scanner& _scanner;
+        long long _start;
+        long long _length;
+        long long _last_trailer;
+        int _flags;
+        int _fingerprint_size;
+        int _entry_size;
+        int _count;
+        Array<char> _metadata;
+        Array<_Segment> _segments;
+        Array<char> _properties;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
@@ -54,9 +54,17 @@ namespace indigo
         void loadMolecule(Molecule& mol);
         void loadXyz(Scanner& scanner);
 
+        // In the lazy mode loadMolecule() gives the atoms and bonds with
+        // everything the atom and bond matchers look at, and keeps the stereo
+        // and the highlighting in the loader until these are called.
+        // Molecules with the atom mapping are always loaded in full.
+        void loadStereo();
+        void loadHighlighting();
+
         bool skip_cistrans;
         bool skip_stereocenters;
         bool skip_valence;
+        bool lazy;
 
         int version; // By default the latest version 2 is used
 
@@ -127,6 +135,9 @@ namespace indigo
         bool _readCycleNumber(int& code, int& n);
 
         void _readExtSection(Molecule& mol);
+
+        void _setStereo(Molecule& mol);
+        void _setHighlighting(Molecule& mol);
         void _readSGroup(int code, Molecule& mol);
         void _readGeneralSGroup(SGroup& sgroup);
 
@@ -154,6 +165,9 @@ namespace indigo
         TL_CP_DECL(Array<int>, _sgroup_order);
         Molecule* _mol;
 
+        bool _stereo_pending;
+        bool _highlighting_pending;
+
     private:
         CmfLoader(const CmfLoader&); // no implicit copy
     };
@@ -0,0 +1,138 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __ket_scanner_stream__
+#define __ket_scanner_stream__
+
+#include <algorithm>
+#include <rapidjson/rapidjson.h>
+
+#include "base_cpp/exception.h"
+#include "base_cpp/scanner.h"
+
+namespace indigo
+{
+
+    // rapidjson input stream reading the scanner in chunks. The reader may look
+    // past the end of a document, so the scanner is moved back with finish().
+    // The buffer is large, allocate the stream on the heap.
+    class KetScannerStream
+    {
+    public:
+        typedef char Ch;
+
+        enum
+        {
+            CHUNK_SIZE = 65536
+        };
+
+        explicit KetScannerStream(Scanner& scanner) : _scanner(scanner), _start(scanner.tell()), _taken(0), _pos(0), _end(0)
+        {
+            // Scanners of unknown length are read char by char
+            try
+            {
+                _length = _scanner.length();
+            }
+            catch (Exception&)
+            {
+                _length = -1;
+            }
+        }
+
+        Ch Peek()
+        {
+            if (_pos == _end)
+                _fill();
+            return _pos < _end ? _buf[_pos] : '\0';
+        }
+
+        Ch Take()
+        {
+            Ch c = Peek();
+
+            if (_pos < _end)
+                _pos++;
+            return c;
+        }
+
+        size_t Tell() const
+        {
+            return (size_t)(_taken + _pos);
+        }
+
+        // Leaves the scanner after the characters taken so far
+        void finish()
+        {
+            _scanner.seek(_start + Tell(), SEEK_SET);
+        }
+
+        Ch* PutBegin()
+        {
+            RAPIDJSON_ASSERT(false);
+            return 0;
+        }
+        void Put(Ch)
+        {
+            RAPIDJSON_ASSERT(false);
+        }
+        void Flush()
+        {
+            RAPIDJSON_ASSERT(false);
+        }
+        size_t PutEnd(Ch*)
+        {
+            RAPIDJSON_ASSERT(false);
+            return 0;
+        }
+
+    private:
+        void _fill()
+        {
+            _taken += _end;
+            _pos = 0;
+            _end = 0;
+
+            if (_length >= 0)
+            {
+                long long left = _length - _scanner.tell();
+
+                if (left > 0)
+                {
+                    _end = (int)std::min(left, (long long)CHUNK_SIZE);
+                    _scanner.read(_end, _buf);
+                }
+            }
+            else if (!_scanner.isEOF())
+            {
+                _buf[0] = _scanner.readChar();
+                _end = 1;
+            }
+        }
+
+        Scanner& _scanner;
+        long long _start;
+        long long _length;
+        long long _taken;
+        int _pos;
+        int _end;
+        Ch _buf[CHUNK_SIZE];
+    };
+
+} // namespace indigo
+
+#endif
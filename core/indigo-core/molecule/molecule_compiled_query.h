@@ -0,0 +1,173 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __molecule_compiled_query__
+#define __molecule_compiled_query__
+
+#include "base_cpp/array.h"
+#include "base_cpp/obj_array.h"
+#include "base_cpp/red_black.h"
+#include "molecule/query_molecule.h"
+#include <climits>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    class BaseMolecule;
+    class AromaticityMatcher;
+
+    // Lazily computed properties of target atoms checked by the compiled
+    // query constraints. One instance can be shared by the matchers of the
+    // same target: cached values are dropped when the target is edited.
+    class DLLEXPORT MoleculeTargetFeatures
+    {
+    public:
+        enum
+        {
+            FEATURE_NUMBER,
+            FEATURE_CHARGE,
+            FEATURE_ISOTOPE,
+            FEATURE_AROMATICITY,
+            FEATURE_CONNECTIVITY,
+            FEATURE_RING_BONDS,
+            FEATURE_SUBSTITUENTS,
+            FEATURE_UNSATURATION,
+            FEATURE_TOTAL_H,
+            FEATURE_RADICAL,
+            FEATURE_VALENCE,
+            FEATURE_TOTAL_BOND_ORDER,
+            FEATURE_SSSR_RINGS,
+            FEATURE_SMALLEST_RING_SIZE,
+            FEATURE_COUNT
+        };
+
+        // Value for target atoms on which the constraint never matches
+        static const int UNAVAILABLE = INT_MIN;
+
+        MoleculeTargetFeatures();
+
+        // Keeps the cached values if the target is the same and has not been edited
+        void setTarget(BaseMolecule& target);
+        void reset(BaseMolecule& target);
+
+        int get(int atom, int feature);
+
+        DECL_ERROR;
+
+    protected:
+        BaseMolecule* _target;
+        int _edit_revision;
+        int _vertex_end;
+
+        // Per target atom: FEATURE_COUNT cached values and the mask of computed ones
+        Array<int> _values;
+        Array<dword> _computed;
+    };
+
+    // Flattened form of the query atom and bond expression trees.
+    // Every query atom/bond is compiled into a contiguous pre-order
+    // instruction sequence with the cheap constraints of each AND/OR
+    // moved in front, plus an element bitmask prefilter. Target atom
+    // properties come from MoleculeTargetFeatures.
+    // Constraints without a compiled form (fragments, pseudoatoms,
+    // templates, ...) are evaluated by the generic matchQueryAtom()
+    // and matchQueryBond() on the original node.
+    class DLLEXPORT MoleculeCompiledQuery
+    {
+    public:
+        typedef ObjArray<RedBlackStringMap<int>> FragmentMatchCache;
+
+        MoleculeCompiledQuery();
+
+        void compile(QueryMolecule& query);
+        void clear();
+
+        // Must be called before matching whenever the target may have
+        // changed, e.g. after implicit hydrogens were unfolded. Shared
+        // features are kept while the target is unchanged, otherwise
+        // the own cache is cleared.
+        void setTarget(BaseMolecule& target, MoleculeTargetFeatures* shared_features = 0);
+
+        bool matchAtom(int query_atom, int target_atom, FragmentMatchCache* fmcache, dword flags);
+        bool matchBond(int query_bond, int target_bond, AromaticityMatcher* am, dword flags);
+
+        DECL_ERROR;
+
+    protected:
+        enum
+        {
+            _INSTR_AND,
+            _INSTR_OR,
+            _INSTR_NOT,
+            _INSTR_TRUE,
+            _INSTR_FEATURE,
+            _INSTR_BOND_ORDER,
+            _INSTR_BOND_TOPOLOGY,
+            _INSTR_FALLBACK
+        };
+
+        static const int _ELEMENT_MASK_WORDS = 4;
+
+        struct Instruction
+        {
+            int op;
+            int feature;
+            int value_min;
+            int value_max;
+            int children; // for AND, OR, NOT
+            int end;      // index just past the subtree
+            QueryMolecule::Node* node;
+        };
+
+        struct Program
+        {
+            int begin;
+            bool has_element_mask;
+            dword element_mask[_ELEMENT_MASK_WORDS];
+        };
+
+        void _compileAtom(QueryMolecule::Atom* atom);
+        void _compileBond(QueryMolecule::Bond* bond);
+        static int _atomCost(QueryMolecule::Atom* atom);
+        static bool _elementMask(QueryMolecule::Atom* atom, dword* mask);
+
+        bool _evalAtom(int pc, int super_idx, FragmentMatchCache* fmcache, dword flags);
+        bool _evalBond(int pc, int sub_idx, int super_idx, AromaticityMatcher* am, dword flags);
+
+        BaseMolecule* _target;
+
+        Array<Instruction> _code;
+        Array<Program> _atoms;
+        Array<Program> _bonds;
+
+        MoleculeTargetFeatures* _features;
+        MoleculeTargetFeatures _own_features;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
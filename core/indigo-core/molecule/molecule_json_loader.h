@@ -56,8 +56,17 @@ namespace indigo
         DECL_ERROR;
         explicit MoleculeJsonLoader(rapidjson::Document& ket);
         explicit MoleculeJsonLoader(rapidjson::Value& mol_nodes);
+        // For loadPlainMolecule(), which reads the document itself
+        MoleculeJsonLoader();
 
         void loadMolecule(BaseMolecule& mol, bool load_arrows = false);
+
+        // Loads a KET document straight from the scanner, without building a
+        // DOM, if its nodes are molecules with plain atoms and bonds, arrows
+        // and pluses. Otherwise returns false with the scanner back where it
+        // was and the molecule unchanged, or cleared if it had no atoms; the
+        // document is then to be parsed and loaded with loadMolecule().
+        bool loadPlainMolecule(Scanner& scanner, Molecule& mol, bool load_arrows = false);
         StereocentersOptions stereochemistry_options;
         bool treat_x_as_pseudoatom; // normally 'X' means 'any halogen'
         bool skip_3d_chirality;     // do not compute chirality from 3D coordinates
@@ -99,6 +108,8 @@ namespace indigo
         void parseSGroups(const rapidjson::Value& sgroups, BaseMolecule& mol);
         void setStereoFlagPosition(const rapidjson::Value& pos, int fragment_index, BaseMolecule& mol);
         void handleSGroup(SGroup& sgroup, const std::unordered_set<int>& atoms, BaseMolecule& bmol);
+        void mergeNode(BaseMolecule& mol, BaseMolecule& node, std::vector<EnhancedStereoCenter>& stereo_centers);
+        void completeMolecule(BaseMolecule& mol, bool load_arrows);
 
     private:
         rapidjson::Value& _mol_nodes;
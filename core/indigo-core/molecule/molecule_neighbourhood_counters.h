@@ -45,6 +45,7 @@ namespace indigo
         void _calculateNextLevel(BaseMolecule& mol, int r);
 
         bool _isAtomInformationStored(int atom_idx) const;
+        void _calculateSignatures(BaseMolecule& mol);
 
         static int _countersCmp(int& i1, int& i2, void* context);
 
@@ -81,6 +82,15 @@ namespace indigo
 
         Array<Counters> _per_atom_counters;
         Array<int> _use_atom;
+
+        // Tested counters of all radii packed into 7-bit lanes of two words
+        // for the word-parallel check in testSubstructure()
+        struct Signature
+        {
+            qword lanes[2];
+        };
+        Array<Signature> _signatures;
+        Array<char> _signature_exact; // no counter of the atom was clamped
     };
 
 } // namespace indigo
@@ -0,0 +1,85 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __molecule_prepared_target__
+#define __molecule_prepared_target__
+
+#include "base_cpp/ptr_array.h"
+#include "molecule/molecule.h"
+#include "molecule/molecule_arom.h"
+#include "molecule/molecule_compiled_query.h"
+#include "molecule/molecule_neighbourhood_counters.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    class MoleculeSubstructureMatcher;
+
+    // Target molecule prepared once for matching against many queries.
+    // Keeps aromatized copies of the target together with the data every
+    // substructure matcher run would otherwise recompute: neighbourhood
+    // counters and the atom properties checked by compiled queries. SSSR
+    // and ring topology are cached by the copies themselves. Copies are
+    // made on demand per aromaticity options, separately for the queries
+    // that need unfolded implicit hydrogens (the matcher unfolds them in
+    // that copy once and leaves them there). Changes of the original target
+    // made after the copies were created are not tracked.
+    class DLLEXPORT MoleculePreparedTarget
+    {
+    public:
+        class DLLEXPORT Variant
+        {
+        public:
+            Molecule molecule;
+            Array<int> mapping; // original target atom -> atom of the copy
+            MoleculeAtomNeighbourhoodCounters nei_counters;
+            MoleculeTargetFeatures features;
+
+            bool h_unfolded;
+            AromaticityOptions arom_options;
+        };
+
+        explicit MoleculePreparedTarget(Molecule& target);
+
+        Variant& get(bool h_unfolded, const AromaticityOptions& arom_options);
+
+        // Provide the prepared data of the variant to the matcher of its molecule.
+        // Query neighbourhood counters are optional.
+        static void setupMatcher(MoleculeSubstructureMatcher& matcher, Variant& variant, const MoleculeAtomNeighbourhoodCounters* query_counters);
+
+        DECL_ERROR;
+
+    protected:
+        static bool _sameOptions(const AromaticityOptions& o1, const AromaticityOptions& o2);
+
+        Molecule& _target;
+        PtrArray<Variant> _variants;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
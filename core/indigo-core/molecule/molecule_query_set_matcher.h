@@ -0,0 +1,130 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __molecule_query_set_matcher__
+#define __molecule_query_set_matcher__
+
+#include "base_cpp/obj.h"
+#include "base_cpp/obj_array.h"
+#include "graph/embedding_enumerator.h"
+#include "molecule/molecule_arom.h"
+#include "molecule/molecule_neighbourhood_counters.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    class Molecule;
+    class QueryMolecule;
+
+    // Screens a set of queries against a target by feature counts. Every
+    // query is reduced to the atoms and bonds that any embedding must use:
+    // counts of atoms of a definite element and of bonds between two such
+    // atoms. The requirement lists are merged into a trie, ordered so that
+    // the requirements most common across the set come first and are checked
+    // once for all the queries sharing them. A target passes a query when it
+    // has at least the required counts; this is necessary, not sufficient,
+    // for a substructure match.
+    class DLLEXPORT MoleculeQueryPrefilter
+    {
+    public:
+        MoleculeQueryPrefilter();
+
+        void build(const Array<QueryMolecule*>& queries);
+
+        // Ids of the queries the target passes, in ascending order
+        void filter(Molecule& target, Array<int>& ids_out);
+
+    protected:
+        struct _Node
+        {
+            int key;
+            int count;
+            int first_child;
+            int next_sibling;
+            int first_query;
+        };
+
+        void _collectRequirements(QueryMolecule& query, Array<int>& counts, Array<int>& keys);
+        int _findChild(int node, int key, int count);
+
+        static int _atomKey(int number);
+        static int _bondKey(int number1, int number2);
+        static int _keysCount();
+
+        Array<_Node> _nodes;
+        Array<int> _next_query; // query id -> next query id ending at the same node
+
+        Array<int> _target_counts;
+        Array<int> _touched_keys;
+        Array<int> _stack;
+    };
+
+    // Matches a whole set of queries (e.g. a library of structural alerts)
+    // against one target at a time. MoleculeQueryPrefilter drops the queries
+    // the target can not contain; every remaining query then runs its own
+    // substructure search. No embedding work is shared between the queries,
+    // only the prefilter, the target copy prepared for matching and the
+    // embedding enumerator buffers.
+    class DLLEXPORT MoleculeQuerySetMatcher
+    {
+    public:
+        MoleculeQuerySetMatcher();
+        ~MoleculeQuerySetMatcher();
+
+        // The query is referenced, not copied. Returns the query id.
+        int addQuery(QueryMolecule& query);
+        int count() const;
+        void clear();
+
+        // Ids of the queries having at least one embedding into the target,
+        // in ascending order
+        void match(Molecule& target, Array<int>& ids_out);
+
+        // Number of queries that passed the prefilter during the last match()
+        int lastCandidatesCount() const;
+
+        AromaticityOptions arom_options;
+
+        DECL_ERROR;
+
+    protected:
+        void _build();
+
+        Array<QueryMolecule*> _queries;
+        ObjArray<MoleculeAtomNeighbourhoodCounters> _query_counters;
+
+        bool _built;
+        MoleculeQueryPrefilter _prefilter;
+        Array<int> _candidates;
+
+        // Shared by the matchers of all the candidates and targets
+        Obj<EmbeddingEnumerator> _ee;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
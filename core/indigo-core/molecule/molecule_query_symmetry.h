@@ -0,0 +1,88 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __molecule_query_symmetry__
+#define __molecule_query_symmetry__
+
+#include "base_cpp/array.h"
+#include "base_cpp/exception.h"
+#include "base_cpp/obj_array.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    class Graph;
+    class QueryMolecule;
+
+    // Permutations of query atoms that keep the graph and every atom and
+    // bond constraint. Embeddings that differ only by such a permutation
+    // cover the same target atoms and bonds, so enumerating one of them is
+    // enough: the ordering conditions built here (Grochow-Kellis symmetry
+    // breaking) leave exactly one embedding of every such group.
+    class DLLEXPORT MoleculeQuerySymmetry
+    {
+    public:
+        MoleculeQuerySymmetry();
+
+        // Atoms with nonzero ignored[] are not mapped by the embeddings.
+        // Returns false and leaves the object empty if there are more than
+        // max_group_size symmetries.
+        bool build(QueryMolecule& query, const int* ignored, int max_group_size);
+        void clear();
+
+        // Number of the symmetries (1 if nothing has been built)
+        int groupSize() const;
+
+        // Check the ordering conditions for mapping query_atom to target_atom,
+        // core_sub is the current partial mapping of the query atoms
+        bool check(const int* core_sub, int query_atom, int target_atom) const;
+
+        DECL_ERROR;
+
+    protected:
+        static int _matchEmbedding(Graph& subgraph, Graph& supergraph, int* core_sub, int* core_super, void* userdata);
+        static bool _matchAtoms(Graph& subgraph, Graph& supergraph, const int* core_sub, int sub_idx, int super_idx, void* userdata);
+        static bool _matchBonds(Graph& subgraph, Graph& supergraph, int sub_idx, int super_idx, void* userdata);
+
+        int _group_size;
+        int _n_atoms;
+
+        // For each query atom: atoms that must be mapped to larger target
+        // indices, and atoms that must be mapped to smaller ones
+        ObjArray<Array<int>> _less;
+        ObjArray<Array<int>> _greater;
+
+        // Enumeration state
+        const int* _ignored;
+        int _max_group_size;
+        bool _overflow;
+        Array<int> _permutations; // all of them, _n_atoms items each
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
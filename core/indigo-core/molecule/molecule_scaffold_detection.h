@@ -72,22 +72,27 @@ namespace indigo
         };
 
     private:
-        void _searchScaffold(QueryMolecule& scaffold, bool approximate);
+        void _searchScaffold(QueryMolecule& scaffold, int mode);
 
     public:
         MoleculeScaffoldDetection(ObjArray<Molecule>* mol_set);
 
-        // two main methods for extracting scaffolds
+        // main methods for extracting scaffolds
         // extracting exact scaffold from molecules set
         void extractExactScaffold(QueryMolecule& scaffold)
         {
-            _searchScaffold(scaffold, false);
+            _searchScaffold(scaffold, SEARCH_EXACT);
         }
+        // extracting approximate scaffold from molecule set
         void extractApproximateScaffold(QueryMolecule& scaffold)
         {
-            _searchScaffold(scaffold, true);
+            _searchScaffold(scaffold, SEARCH_APPROXIMATE);
+        }
+        // extracting maximum common connected induced substructure with McSplit
+        void extractMcSplitScaffold(QueryMolecule& scaffold)
+        {
+            _searchScaffold(scaffold, SEARCH_MCSPLIT);
         }
-        // extracting approximate scaffold from molecule set
 
         int (*cbSortSolutions)(Molecule& mol1, Molecule& mol2, const void* userdata);
 
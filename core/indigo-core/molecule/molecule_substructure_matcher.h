@@ -24,7 +24,9 @@
 #include "graph/embeddings_storage.h"
 #include "molecule/molecule.h"
 #include "molecule/molecule_arom_match.h"
+#include "molecule/molecule_compiled_query.h"
 #include "molecule/molecule_pi_systems_matcher.h"
+#include "molecule/molecule_query_symmetry.h"
 #include "molecule/query_molecule.h"
 #include <memory>
 
@@ -63,6 +65,15 @@ namespace indigo
         // Set vertex neibourhood counters for effective matching
         void setNeiCounters(const MoleculeAtomNeighbourhoodCounters* query_counters, const MoleculeAtomNeighbourhoodCounters* target_counters);
 
+        // Set target atom properties cache shared with other matchers of the same target
+        void setTargetFeatures(MoleculeTargetFeatures* target_features);
+
+        // Use an enumerator owned by the caller instead of allocating one.
+        // It is reset to the target of this matcher by setQuery(), so a
+        // screening loop can pass the same enumerator to the matchers of
+        // all its targets and reuse its buffers.
+        void setEmbeddingEnumerator(EmbeddingEnumerator* ee);
+
         // Property indicating that first atom in the query should be ignored because
         // it will be used later. For example, it is fixed during fragment matching
         bool not_ignore_first_atom;
@@ -109,6 +120,13 @@ namespace indigo
 
         const GraphEmbeddingsStorage& getEmbeddingsStorage() const;
 
+        // Used instead of find(): count embeddings (unique ones if find_unique_embeddings
+        // is set) without saving them and without calling cb_embedding. Stops as soon as the count
+        // reaches the limit (0 means no limit); the result never exceeds the limit.
+        // Embeddings that differ only by a symmetry of the query are enumerated once
+        // when the query has no stereo, 3D, component or R-group constraints.
+        int countEmbeddings(int limit);
+
         static bool needCoords(int match_3d, QueryMolecule& query);
 
         static void removeAtom(Graph& subgraph, int sub_idx, AromaticityMatcher* am);
@@ -182,6 +200,7 @@ namespace indigo
         int _embedding_markush(int* core_sub, int* core_super);
 
         static bool _canUseEquivalenceHeuristic(QueryMolecule& query);
+        bool _canUseQuerySymmetry();
         static bool _isSingleBond(Graph& graph, int edge_idx);
 
         static bool _shouldUnfoldTargetHydrogens(QueryMolecule& query, bool is_fragment, bool disable_folding_query_h);
@@ -200,7 +219,8 @@ namespace indigo
 
         const MoleculeAtomNeighbourhoodCounters *_query_nei_counters, *_target_nei_counters;
 
-        Obj<EmbeddingEnumerator> _ee;
+        EmbeddingEnumerator* _ee;
+        Obj<EmbeddingEnumerator> _own_ee;
 
         std::unique_ptr<MarkushContext> _markush;
 
@@ -213,8 +233,21 @@ namespace indigo
         Obj<AromaticityMatcher> _am;
         Obj<MoleculePiSystemsMatcher> _pi_systems_matcher;
 
+        // Compiled atom and bond constraints of the query; not used for Markush queries
+        // because R-group fragments are attached to the query during matching
+        Obj<MoleculeCompiledQuery> _compiled_query;
+        MoleculeTargetFeatures* _target_features;
+
         bool _h_unfold; // implicit target hydrogens unfolded
 
+        // State of countEmbeddings()
+        bool _count_mode;
+        int _count_limit;
+        int _count_weight;
+        int _embeddings_count;
+        bool _use_symmetry;
+        MoleculeQuerySymmetry _symmetry;
+
         CP_DECL;
         TL_CP_DECL(Array<int>, _3d_constrained_atoms);
         TL_CP_DECL(Array<int>, _unfolded_target_h);
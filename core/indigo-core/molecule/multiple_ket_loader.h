@@ -0,0 +1,75 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __multiple_ket_loader__
+#define __multiple_ket_loader__
+
+#include <rapidjson/document.h>
+
+#include "base_cpp/exception.h"
+#include "base_cpp/tlscont.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    class Scanner;
+
+    // Reads KET documents following one another in a stream (e.g. one per line).
+    // The text goes through rapidjson's SAX reader straight from the scanner:
+    // finding where a document ends builds no DOM, and parse() builds the DOM
+    // without a copy of the text.
+    class DLLEXPORT MultipleKetLoader
+    {
+    public:
+        DECL_ERROR;
+
+        MultipleKetLoader(Scanner& scanner);
+
+        bool isEOF();
+        void readNext();
+        long long tell();
+        int currentNumber();
+
+        // The last document read has an arrow
+        bool isReaction();
+
+        // Parses the rest of the scanner as one document. Returns false if the
+        // text is not well-formed JSON or anything but whitespace follows the root value.
+        static bool parse(Scanner& scanner, rapidjson::Document& document);
+
+        CP_DECL;
+        TL_CP_DECL(Array<char>, data);
+
+    protected:
+        Scanner& _scanner;
+        int _current_number;
+        bool _reaction;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
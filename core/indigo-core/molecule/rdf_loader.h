@@ -27,6 +27,7 @@ namespace indigo
 {
 
     class Scanner;
+    class RecordIndex;
     /*
      * RD files loader
      * An RDfile (reaction-data file) consists of a set of editable “records.” Each record defines a
@@ -54,6 +55,14 @@ namespace indigo
         int currentNumber();
         int count();
 
+        // Record offsets for random access without scanning, see RecordIndex
+        void loadIndex(const RecordIndex& index);
+        // Scans the rest of the input so that the index covers every record
+        void buildIndex(RecordIndex& index);
+
+        // Inflates gzipped BGZF input on worker threads, see GZipScanner::setThreads()
+        void setThreads(int threads);
+
         CP_DECL;
         /*
          * Data buffer with reaction or molecule for current record
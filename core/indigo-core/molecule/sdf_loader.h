@@ -27,6 +27,7 @@ namespace indigo
 {
 
     class Scanner;
+    class RecordIndex;
 
     class SdfLoader
     {
@@ -49,6 +50,14 @@ namespace indigo
         int currentNumber();
         int count();
 
+        // Record offsets for random access without scanning, see RecordIndex
+        void loadIndex(const RecordIndex& index);
+        // Scans the rest of the input so that the index covers every record
+        void buildIndex(RecordIndex& index);
+
+        // Inflates gzipped BGZF input on worker threads, see GZipScanner::setThreads()
+        void setThreads(int threads);
+
         void readAt(int index);
 
         CP_DECL;
@@ -58,10 +67,13 @@ namespace indigo
         DECL_ERROR;
 
     protected:
+        void _readLine(const char*& line, int& length);
+
         Scanner* _scanner;
         bool _own_scanner;
         TL_CP_DECL(Array<long long>, _offsets);
         TL_CP_DECL(Array<char>, _preread);
+        TL_CP_DECL(Array<char>, _line);
         int _current_number;
         long long _max_offset;
     };
@@ -118,6 +118,14 @@ namespace indigo
             int index;
         };
 
+        // Atom of a SMILES taken by the plain fast path
+        struct _PlainAtom
+        {
+            int hydrogens;
+            bool aromatic;
+            bool brackets;
+        };
+
         struct _CycleDesc
         {
             void clear()
@@ -160,6 +168,14 @@ namespace indigo
         Molecule* _mol;
 
         void _loadMolecule();
+
+        // Fast path for non-query SMILES made of organic subset atoms, simple
+        // bracket atoms ([nH], [NH4+], [13C]), plain bonds, branches and ring
+        // closures. It fills _mol directly without the _AtomDesc/_BondDesc
+        // stage. Returns false and leaves the scanner where it was on anything
+        // else, so the full parser can take over.
+        bool _loadPlainMolecule();
+        bool _readPlainAtom(const char* str, int length, int& pos, int& label, _PlainAtom& atom, int& charge, int& isotope);
         void _parseMolecule();
         void _loadParsedMolecule();
 
@@ -168,6 +184,13 @@ namespace indigo
         void _readOtherStuff();
         void _markAromaticBonds();
         void _setRadicalsAndHCounts();
+
+        // The parts of _markAromaticBonds() and _setRadicalsAndHCounts()
+        // shared with the plain fast path, which has no _atoms and _bonds
+        template <typename AtomAromatic, typename BondType, typename AllowsAromatic, typename SetAromatic>
+        static void _markAromaticCycles(BaseMolecule& mol, AtomAromatic atom_aromatic, BondType bond_type, AllowsAromatic allows_aromatic,
+                                        SetAromatic set_aromatic);
+        void _setRadicalAndHCount(int idx, int label, bool brackets, bool aromatic, int hydrogens);
         void _forbidHydrogens();
         void _addExplicitHForStereo();
         void _addLigandsForStereo();
@@ -76,23 +76,30 @@ void CanonicalSmilesSaver::saveMolecule(Molecule& mol_)
         if (mol.convertableToImplicitHydrogen(i))
             ignored[i] = 1;
 
-    // Try to save into ordinary smiles and find what cis-trans bonds were used
-    NullOutput null_output;
-    SmilesSaver saver_cistrans(null_output);
-    saver_cistrans.ignore_hydrogens = true;
-    saver_cistrans.saveMolecule(mol);
-    // Then reset cis-trans infromation that is not saved into SMILES
-    const Array<int>& parities = saver_cistrans.getSavedCisTransParities();
-    for (i = mol.edgeBegin(); i < mol.edgeEnd(); i = mol.edgeNext(i))
+    // Try to save into ordinary smiles and find what cis-trans bonds were used.
+    // Without cis-trans bonds there is nothing to reset, so the pass is skipped.
+    if (mol.cis_trans.count() > 0)
     {
-        if (mol.cis_trans.getParity(i) != 0 && parities[i] == 0)
-            mol.cis_trans.setParity(i, 0);
+        NullOutput null_output;
+        SmilesSaver saver_cistrans(null_output);
+        saver_cistrans.ignore_hydrogens = true;
+        saver_cistrans.saveMolecule(mol);
+        // Then reset cis-trans infromation that is not saved into SMILES
+        const Array<int>& parities = saver_cistrans.getSavedCisTransParities();
+        for (i = mol.edgeBegin(); i < mol.edgeEnd(); i = mol.edgeNext(i))
+        {
+            if (mol.cis_trans.getParity(i) != 0 && parities[i] == 0)
+                mol.cis_trans.setParity(i, 0);
+        }
     }
 
+    // Invalid stereo is searched for only if there is some
+    bool has_stereo = mol.stereocenters.size() > 0 || mol.cis_trans.count() > 0;
+
     MoleculeAutomorphismSearch of;
 
-    of.detect_invalid_cistrans_bonds = find_invalid_stereo;
-    of.detect_invalid_stereocenters = find_invalid_stereo;
+    of.detect_invalid_cistrans_bonds = find_invalid_stereo && has_stereo;
+    of.detect_invalid_stereocenters = find_invalid_stereo && has_stereo;
     of.find_canonical_ordering = true;
     of.ignored_vertices = ignored.ptr();
     of.process(mol);
@@ -0,0 +1,414 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "molecule/cmf_container.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "base_cpp/output.h"
+#include "base_cpp/properties_map.h"
+#include "base_cpp/scanner.h"
+
+using namespace indigo;
+
+IMPL_ERROR(CmfContainerWriter, "CMF container writer");
+IMPL_ERROR(CmfContainerReader, "CMF container reader");
+
+// Header: magic, then version, flags, fingerprint size and metadata size as
+// 32-bit integers, the metadata, and zero padding to a multiple of 8 bytes.
+//
+// Table entry: record offset (64-bit), data size and properties size (32-bit),
+// then the hash (64-bit) and the fingerprint if the container has them.
+// The data of a record is followed by the size and the bytes of its name, the
+// property count, and the size and the bytes of each property name and value.
+//
+// Trailer: table offset, record count and offset of the previous trailer
+// (-1 for the first segment) as 64-bit integers, then the segment magic.
+static const char _MAGIC[8] = {'I', 'N', 'D', 'I', 'G', 'O', 'C', 'F'};
+static const char _SEGMENT_MAGIC[8] = {'I', 'N', 'D', 'I', 'G', 'O', 'C', 'S'};
+static const int _VERSION = 1;
+static const int _HEADER_SIZE = 24;
+static const int _ENTRY_SIZE = 16;
+static const int _TRAILER_SIZE = 32;
+
+// Records per segment. Bounds the memory the writer needs for the table.
+static const int _SEGMENT_RECORDS = 1 << 16;
+
+static int _entrySize(int flags, int fingerprint_size)
+{
+    int size = _ENTRY_SIZE;
+    if (flags & CmfContainerWriter::HASHES)
+        size += sizeof(qword);
+    if (flags & CmfContainerWriter::FINGERPRINTS)
+        size += fingerprint_size;
+    return size;
+}
+
+//
+// CmfContainerWriter
+//
+
+CmfContainerWriter::CmfContainerWriter(Output& output)
+    : _output(output), _position(0), _last_trailer(-1), _flags(0), _fingerprint_size(0), _entry_size(0), _started(false), _segment_count(0)
+{
+}
+
+void CmfContainerWriter::_write(const void* data, int size)
+{
+    _output.write(data, size);
+    _position += size;
+}
+
+void CmfContainerWriter::begin(int flags, int fingerprint_size, const char* metadata)
+{
+    if (_started)
+        throw Error("container has already been started");
+    if (fingerprint_size < 0 || (!(flags & FINGERPRINTS) && fingerprint_size != 0))
+        throw Error("invalid fingerprint size %d", fingerprint_size);
+
+    int metadata_size = metadata != 0 ? (int)strlen(metadata) : 0;
+    int header[4] = {_VERSION, flags, fingerprint_size, metadata_size};
+
+    _write(_MAGIC, sizeof(_MAGIC));
+    _write(header, sizeof(header));
+    _write(metadata, metadata_size);
+
+    static const char zeros[8] = {0};
+    _write(zeros, (int)((8 - _position % 8) % 8));
+
+    _flags = flags;
+    _fingerprint_size = fingerprint_size;
+    _entry_size = _entrySize(flags, fingerprint_size);
+    _started = true;
+}
+
+void CmfContainerWriter::beginAppend(const CmfContainerReader& reader)
+{
+    if (_started)
+        throw Error("container has already been started");
+
+    _position = reader._length;
+    _last_trailer = reader._last_trailer;
+    _flags = reader._flags;
+    _fingerprint_size = reader._fingerprint_size;
+    _entry_size = reader._entry_size;
+    _started = true;
+}
+
+void CmfContainerWriter::append(const char* data, int size, const char* name, PropertiesMap* properties, const byte* fingerprint, qword hash)
+{
+    if (!_started)
+        throw Error("container has not been started");
+
+    if (_segment_count == _SEGMENT_RECORDS)
+        _writeSegment();
+
+    _properties.clear();
+    {
+        ArrayOutput output(_properties);
+        int name_size = name != 0 ? (int)strlen(name) : 0;
+        int count = 0;
+
+        output.write(&name_size, sizeof(name_size));
+        output.write(name, name_size);
+
+        // The count is filled in after the properties
+        int count_pos = _properties.size();
+        output.write(&count, sizeof(count));
+
+        if (properties != 0)
+        {
+            for (auto i : properties->elements())
+            {
+                const char* key = properties->key(i);
+                const char* value = properties->value(i);
+                int key_size = (int)strlen(key);
+                int value_size = (int)strlen(value);
+
+                output.write(&key_size, sizeof(key_size));
+                output.write(key, key_size);
+                output.write(&value_size, sizeof(value_size));
+                output.write(value, value_size);
+                count++;
+            }
+        }
+        memcpy(_properties.ptr() + count_pos, &count, sizeof(count));
+    }
+
+    long long offset = _position;
+    int sizes[2] = {size, _properties.size()};
+
+    _write(data, size);
+    _write(_properties.ptr(), _properties.size());
+
+    int pos = _table.size();
+    _table.resize(pos + _entry_size);
+    char* entry = _table.ptr() + pos;
+
+    memcpy(entry, &offset, sizeof(offset));
+    memcpy(entry + sizeof(offset), sizes, sizeof(sizes));
+    entry += _ENTRY_SIZE;
+
+    if (_flags & HASHES)
+    {
+        memcpy(entry, &hash, sizeof(hash));
+        entry += sizeof(hash);
+    }
+    if (_flags & FINGERPRINTS)
+    {
+        if (fingerprint != 0)
+            memcpy(entry, fingerprint, _fingerprint_size);
+        else
+            memset(entry, 0, _fingerprint_size);
+    }
+
+    _segment_count++;
+}
+
+void CmfContainerWriter::_writeSegment()
+{
+    long long table = _position;
+
+    _write(_table.ptr(), _table.size());
+
+    long long trailer[3] = {table, _segment_count, _last_trailer};
+
+    _last_trailer = _position;
+    _write(trailer, sizeof(trailer));
+    _write(_SEGMENT_MAGIC, sizeof(_SEGMENT_MAGIC));
+
+    _table.clear();
+    _segment_count = 0;
+}
+
+void CmfContainerWriter::close()
+{
+    if (!_started)
+        throw Error("container has not been started");
+
+    // An empty container still gets a segment, so that every container ends with a trailer
+    if (_segment_count > 0 || _last_trailer == -1)
+        _writeSegment();
+    _output.flush();
+}
+
+//
+// CmfContainerReader
+//
+
+CmfContainerReader::CmfContainerReader(Scanner& scanner) : _scanner(scanner), _last_trailer(-1), _count(0)
+{
+    _start = scanner.tell();
+    _length = scanner.length() - _start;
+
+    char magic[sizeof(_MAGIC)];
+    int header[4];
+
+    if (_length < _HEADER_SIZE + _TRAILER_SIZE)
+        throw Error("not a CMF container");
+
+    scanner.read(sizeof(magic), magic);
+    scanner.read(sizeof(header), header);
+
+    if (memcmp(magic, _MAGIC, sizeof(magic)) != 0)
+        throw Error("not a CMF container");
+    if (header[0] != _VERSION)
+        throw Error("unsupported CMF container version %d", header[0]);
+
+    _flags = header[1];
+    _fingerprint_size = header[2];
+    if (_fingerprint_size < 0 || header[3] < 0 || header[3] > _length - _HEADER_SIZE - _TRAILER_SIZE)
+        throw Error("damaged CMF container header");
+
+    _metadata.clear_resize(header[3]);
+    scanner.read(header[3], _metadata.ptr());
+    _metadata.push(0);
+
+    _entry_size = _entrySize(_flags, _fingerprint_size);
+
+    // Segments are found from the last trailer backwards
+    long long header_end = (_HEADER_SIZE + header[3] + 7) / 8 * 8;
+    long long trailer_pos = _length - _TRAILER_SIZE;
+
+    _last_trailer = trailer_pos;
+    _segments.clear();
+
+    while (trailer_pos != -1)
+    {
+        long long trailer[3];
+
+        if (trailer_pos < header_end || trailer_pos > _length - _TRAILER_SIZE)
+            throw Error("damaged CMF container");
+
+        _scanner.seek(_start + trailer_pos, SEEK_SET);
+        _scanner.read(sizeof(trailer), trailer);
+        _scanner.read(sizeof(magic), magic);
+
+        long long table = trailer[0], count = trailer[1], prev = trailer[2];
+
+        if (memcmp(magic, _SEGMENT_MAGIC, sizeof(magic)) != 0)
+            throw Error("damaged CMF container: segment trailer not found");
+        if (count < 0 || count > _SEGMENT_RECORDS || table < header_end || table + count * _entry_size != trailer_pos || prev >= trailer_pos)
+            throw Error("damaged CMF container: invalid segment table");
+        if ((long long)_count + count > 0x7FFFFFFF)
+            throw Error("too many records in a CMF container");
+
+        _Segment& segment = _segments.push();
+        segment.count = (int)count;
+        segment.table = table;
+        _count += (int)count;
+        trailer_pos = prev;
+    }
+
+    for (int i = 0, j = _segments.size() - 1; i < j; i++, j--)
+        _segments.swap(i, j);
+
+    int first = 0;
+    for (int i = 0; i < _segments.size(); i++)
+    {
+        _segments[i].first = first;
+        first += _segments[i].count;
+    }
+}
+
+int CmfContainerReader::count() const
+{
+    return _count;
+}
+
+int CmfContainerReader::flags() const
+{
+    return _flags;
+}
+
+int CmfContainerReader::fingerprintSize() const
+{
+    return _fingerprint_size;
+}
+
+const char* CmfContainerReader::metadata() const
+{
+    return _metadata.ptr();
+}
+
+void CmfContainerReader::_readEntry(int index, int part_offset, int size, void* dest)
+{
+    if (index < 0 || index >= _count)
+        throw Error("record index %d is out of range [0, %d)", index, _count);
+
+    // The last segment whose first record is not after "index"
+    int lo = 0, hi = _segments.size() - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (_segments[mid].first <= index)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    const _Segment& segment = _segments[lo];
+    _scanner.seek(_start + segment.table + (long long)(index - segment.first) * _entry_size + part_offset, SEEK_SET);
+    _scanner.read(size, dest);
+}
+
+long long CmfContainerReader::offset(int index)
+{
+    long long offset;
+    _readEntry(index, 0, sizeof(offset), &offset);
+    return offset;
+}
+
+// Reads a size-prefixed string and terminates it with zero
+static void _readString(Scanner& scanner, Array<char>& str)
+{
+    int size = scanner.readBinaryInt();
+    if (size < 0 || size > scanner.length() - scanner.tell())
+        throw CmfContainerReader::Error("damaged CMF container: invalid string size %d", size);
+    str.clear_resize(size);
+    scanner.read(size, str.ptr());
+    str.push(0);
+}
+
+void CmfContainerReader::readRecord(int index, Array<char>& data, Array<char>* name, PropertiesMap* properties)
+{
+    char entry[_ENTRY_SIZE];
+    long long offset;
+    int sizes[2];
+
+    _readEntry(index, 0, _ENTRY_SIZE, entry);
+    memcpy(&offset, entry, sizeof(offset));
+    memcpy(sizes, entry + sizeof(offset), sizeof(sizes));
+
+    if (offset < 0 || sizes[0] < 0 || sizes[1] < 2 * (int)sizeof(int) || offset + sizes[0] + sizes[1] > _length)
+        throw Error("damaged CMF container: invalid record %d", index);
+
+    _scanner.seek(_start + offset, SEEK_SET);
+    data.clear_resize(sizes[0]);
+    _scanner.read(sizes[0], data.ptr());
+
+    if (name == 0 && properties == 0)
+        return;
+
+    _properties.clear_resize(sizes[1]);
+    _scanner.read(sizes[1], _properties.ptr());
+
+    BufferScanner scanner(_properties);
+    Array<char> key, value;
+
+    _readString(scanner, key);
+    if (name != 0)
+        name->copy(key);
+
+    if (properties == 0)
+        return;
+
+    properties->clear();
+    int count = scanner.readBinaryInt();
+
+    for (int i = 0; i < count; i++)
+    {
+        _readString(scanner, key);
+        _readString(scanner, value);
+        properties->insert(key.ptr(), value.ptr());
+    }
+}
+
+void CmfContainerReader::readFingerprint(int index, Array<byte>& fingerprint)
+{
+    if (!(_flags & CmfContainerWriter::FINGERPRINTS))
+        throw Error("CMF container has no fingerprints");
+
+    int part_offset = _ENTRY_SIZE;
+    if (_flags & CmfContainerWriter::HASHES)
+        part_offset += sizeof(qword);
+
+    fingerprint.clear_resize(_fingerprint_size);
+    _readEntry(index, part_offset, _fingerprint_size, fingerprint.ptr());
+}
+
+qword CmfContainerReader::readHash(int index)
+{
+    if (!(_flags & CmfContainerWriter::HASHES))
+        throw Error("CMF container has no hashes");
+
+    qword hash;
+    _readEntry(index, _ENTRY_SIZE, sizeof(hash), &hash);
+    return hash;
+}
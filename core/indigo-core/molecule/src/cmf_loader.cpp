@@ -66,10 +66,14 @@ void CmfLoader::_init()
     skip_cistrans = false;
     skip_stereocenters = false;
     skip_valence = false;
+    lazy = false;
     _ext_decoder = 0;
     _scanner = 0;
     atom_flags = 0;
     bond_flags = 0;
+    _mol = 0;
+    _stereo_pending = false;
+    _highlighting_pending = false;
 
     _sgroup_order.clear();
 
@@ -574,9 +578,6 @@ void CmfLoader::loadMolecule(Molecule& mol)
         if (_atoms[i].hydrogens >= 0)
             mol.setImplicitH(i, _atoms[i].hydrogens);
         mol.setAtomRadical(i, _atoms[i].radical);
-
-        if (_atoms[i].highlighted)
-            mol.highlightAtom(i);
     }
 
     for (i = 0; i < _bonds.size(); i++)
@@ -597,9 +598,6 @@ void CmfLoader::loadMolecule(Molecule& mol)
 
         if (_bonds[i].direction != 0)
             mol.setBondDirection(idx, _bonds[i].direction);
-
-        if (_bonds[i].highlighted)
-            mol.highlightBond(idx);
     }
 
     for (i = 0; i < _attachments.size(); i++)
@@ -626,6 +624,50 @@ void CmfLoader::loadMolecule(Molecule& mol)
             bond_flags->push(_bonds[i].flags);
     }
 
+    if (!skip_valence)
+    {
+        for (i = 0; i < _atoms.size(); i++)
+        {
+            if (_atoms[i].valence >= 0)
+                mol.setValence(i, _atoms[i].valence);
+        }
+    }
+
+    // for loadXyz(), loadStereo() and loadHighlighting()
+    _mol = &mol;
+
+    // The mapping below renumbers the atoms and bonds, so nothing can be put off
+    _stereo_pending = lazy && !has_mapping;
+    _highlighting_pending = lazy && !has_mapping;
+
+    if (!_stereo_pending)
+        _setStereo(mol);
+    if (!_highlighting_pending)
+        _setHighlighting(mol);
+
+    // Check if atom mapping was used
+    if (has_mapping)
+    {
+        // Compute inv_atom_mapping_to_restore
+        inv_atom_mapping_to_restore.clear_resize(atom_mapping_to_restore.size());
+        for (int i = 0; i < atom_mapping_to_restore.size(); i++)
+            inv_atom_mapping_to_restore[atom_mapping_to_restore[i]] = i;
+
+        // Compute inv_bond_mapping_to_restore
+        inv_bond_mapping_to_restore.clear_resize(bond_mapping_to_restore.size());
+        for (int i = 0; i < bond_mapping_to_restore.size(); i++)
+            inv_bond_mapping_to_restore[bond_mapping_to_restore[i]] = i;
+
+        QS_DEF(Molecule, tmp);
+        tmp.makeEdgeSubmolecule(mol, atom_mapping_to_restore, bond_mapping_to_restore, NULL);
+        mol.clone(tmp, NULL, NULL);
+    }
+}
+
+void CmfLoader::_setStereo(Molecule& mol)
+{
+    int i;
+
     if (!skip_cistrans)
     {
         for (i = 0; i < _bonds.size(); i++)
@@ -642,15 +684,6 @@ void CmfLoader::loadMolecule(Molecule& mol)
         }
     }
 
-    if (!skip_valence)
-    {
-        for (i = 0; i < _atoms.size(); i++)
-        {
-            if (_atoms[i].valence >= 0)
-                mol.setValence(i, _atoms[i].valence);
-        }
-    }
-
     if (!skip_stereocenters)
     {
         for (i = 0; i < _atoms.size(); i++)
@@ -691,29 +724,49 @@ void CmfLoader::loadMolecule(Molecule& mol)
             mol.allene_stereo.add(i, left, right, subst, parity);
         }
     }
+}
 
-    // for loadXyz()
-    _mol = &mol;
+void CmfLoader::_setHighlighting(Molecule& mol)
+{
+    int i;
 
-    // Check if atom mapping was used
-    if (has_mapping)
+    for (i = 0; i < _atoms.size(); i++)
     {
-        // Compute inv_atom_mapping_to_restore
-        inv_atom_mapping_to_restore.clear_resize(atom_mapping_to_restore.size());
-        for (int i = 0; i < atom_mapping_to_restore.size(); i++)
-            inv_atom_mapping_to_restore[atom_mapping_to_restore[i]] = i;
-
-        // Compute inv_bond_mapping_to_restore
-        inv_bond_mapping_to_restore.clear_resize(bond_mapping_to_restore.size());
-        for (int i = 0; i < bond_mapping_to_restore.size(); i++)
-            inv_bond_mapping_to_restore[bond_mapping_to_restore[i]] = i;
+        if (_atoms[i].highlighted)
+            mol.highlightAtom(i);
+    }
 
-        QS_DEF(Molecule, tmp);
-        tmp.makeEdgeSubmolecule(mol, atom_mapping_to_restore, bond_mapping_to_restore, NULL);
-        mol.clone(tmp, NULL, NULL);
+    for (i = 0; i < _bonds.size(); i++)
+    {
+        if (_bonds[i].highlighted)
+            mol.highlightBond(i);
     }
 }
 
+void CmfLoader::loadStereo()
+{
+    if (_mol == 0)
+        throw Error("loadMolecule() must be called prior to loadStereo()");
+
+    if (!_stereo_pending)
+        return;
+
+    _stereo_pending = false;
+    _setStereo(*_mol);
+}
+
+void CmfLoader::loadHighlighting()
+{
+    if (_mol == 0)
+        throw Error("loadMolecule() must be called prior to loadHighlighting()");
+
+    if (!_highlighting_pending)
+        return;
+
+    _highlighting_pending = false;
+    _setHighlighting(*_mol);
+}
+
 void CmfLoader::_readSGroup(int code, Molecule& mol)
 {
     int idx = -1;
@@ -30,6 +30,7 @@
 #include "molecule/molecule_json_loader.h"
 #include "molecule/molecule_name_parser.h"
 #include "molecule/molfile_loader.h"
+#include "molecule/multiple_ket_loader.h"
 #include "molecule/query_molecule.h"
 #include "molecule/sdf_loader.h"
 #include "molecule/smiles_loader.h"
@@ -240,6 +241,56 @@ void MoleculeAutoLoader::_loadMolecule(BaseMolecule& mol, bool query)
         }
     }
 
+    // check for KET format, ahead of the checks that scan the whole input
+    {
+        long long pos = _scanner->tell();
+        long long start = pos;
+
+        if (_scanner->length() >= 3)
+        {
+            unsigned char bom[3];
+            _scanner->readCharsFix(3, (char*)bom);
+            // skip utf8 BOM
+            if (bom[0] == 0xEF && bom[1] == 0xBB && bom[2] == 0xBF)
+                start += 3;
+            _scanner->seek(start, SEEK_SET);
+        }
+
+        if (_scanner->lookNext() == '{' && _scanner->findWord("root") && _scanner->findWord("nodes"))
+        {
+            auto setLoaderOptions = [this](MoleculeJsonLoader& loader) {
+                loader.stereochemistry_options = stereochemistry_options;
+                loader.ignore_noncritical_query_features = ignore_noncritical_query_features;
+                loader.treat_x_as_pseudoatom = treat_x_as_pseudoatom;
+                loader.skip_3d_chirality = skip_3d_chirality;
+                loader.ignore_no_chiral_flag = ignore_no_chiral_flag;
+                loader.treat_stereo_as = treat_stereo_as;
+            };
+
+            _scanner->seek(start, SEEK_SET);
+
+            // Most documents are plain molecules, which are built without a DOM
+            if (!query)
+            {
+                MoleculeJsonLoader loader;
+                setLoaderOptions(loader);
+                if (loader.loadPlainMolecule(*_scanner, mol.asMolecule()))
+                    return;
+            }
+
+            rapidjson::Document data;
+
+            if (MultipleKetLoader::parse(*_scanner, data) && data.HasMember("root"))
+            {
+                MoleculeJsonLoader loader(data);
+                setLoaderOptions(loader);
+                loader.loadMolecule(mol);
+                return;
+            }
+        }
+        _scanner->seek(pos, SEEK_SET);
+    }
+
     // check for CDX format
     {
         if (local_scanner->findWord("VjCD0100"))
@@ -334,56 +385,6 @@ void MoleculeAutoLoader::_loadMolecule(BaseMolecule& mol, bool query)
         _scanner->seek(pos, SEEK_SET);
     }
 
-    // check json format
-    long long pos = _scanner->tell();
-    {
-        bool hasbom = false;
-        if (_scanner->length() >= 3)
-        {
-            unsigned char bom[3];
-            _scanner->readCharsFix(3, (char*)bom);
-            if (bom[0] == 0xEF && bom[1] == 0xBB && bom[2] == 0xBF)
-                hasbom = true;
-            else
-                _scanner->seek(pos, SEEK_SET);
-        }
-
-        if (_scanner->lookNext() == '{')
-        {
-            if (_scanner->findWord("root") && _scanner->findWord("nodes"))
-            {
-                using namespace rapidjson;
-                _scanner->seek(pos, SEEK_SET);
-                {
-                    Array<char> buf;
-                    _scanner->readAll(buf);
-                    buf.push(0);
-                    unsigned char* ptr = (unsigned char*)buf.ptr();
-                    // skip utf8 BOM
-                    if (hasbom)
-                        ptr += 3;
-                    Document data;
-                    if (!data.Parse((char*)ptr).HasParseError())
-                    {
-                        if (data.HasMember("root"))
-                        {
-                            MoleculeJsonLoader loader(data);
-                            loader.stereochemistry_options = stereochemistry_options;
-                            loader.ignore_noncritical_query_features = ignore_noncritical_query_features;
-                            loader.treat_x_as_pseudoatom = treat_x_as_pseudoatom;
-                            loader.skip_3d_chirality = skip_3d_chirality;
-                            loader.ignore_no_chiral_flag = ignore_no_chiral_flag;
-                            loader.treat_stereo_as = treat_stereo_as;
-                            loader.loadMolecule(mol);
-                            return;
-                        }
-                    }
-                }
-            }
-        }
-        _scanner->seek(pos, SEEK_SET);
-    }
-
     // check for single line formats
     if (Scanner::isSingleLine(*_scanner))
     {
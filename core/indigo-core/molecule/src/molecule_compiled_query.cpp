@@ -0,0 +1,532 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "molecule/molecule_compiled_query.h"
+#include "molecule/base_molecule.h"
+#include "molecule/molecule.h"
+#include "molecule/molecule_arom_match.h"
+#include "molecule/molecule_substructure_matcher.h"
+
+using namespace indigo;
+
+IMPL_ERROR(MoleculeTargetFeatures, "target features");
+
+MoleculeTargetFeatures::MoleculeTargetFeatures() : _target(0), _edit_revision(-1), _vertex_end(0)
+{
+}
+
+void MoleculeTargetFeatures::setTarget(BaseMolecule& target)
+{
+    if (_target != &target || _edit_revision != target.getEditRevision() || _vertex_end != target.vertexEnd())
+        reset(target);
+}
+
+void MoleculeTargetFeatures::reset(BaseMolecule& target)
+{
+    _target = &target;
+    _edit_revision = target.getEditRevision();
+    _vertex_end = target.vertexEnd();
+    _computed.clear_resize(_vertex_end);
+    _computed.zerofill();
+    _values.clear_resize(_vertex_end * FEATURE_COUNT);
+}
+
+int MoleculeTargetFeatures::get(int atom, int feature)
+{
+    if (atom >= _computed.size())
+    {
+        _computed.expandFill(atom + 1, 0);
+        _values.resize((atom + 1) * FEATURE_COUNT);
+    }
+
+    dword bit = (dword)1 << feature;
+
+    if (_computed[atom] & bit)
+        return _values[atom * FEATURE_COUNT + feature];
+
+    BaseMolecule& target = *_target;
+    bool special = target.isPseudoAtom(atom) || target.isRSite(atom);
+    int result;
+
+    switch (feature)
+    {
+    case FEATURE_NUMBER:
+        result = target.getAtomNumber(atom);
+        break;
+    case FEATURE_CHARGE:
+        result = target.getAtomCharge(atom);
+        break;
+    case FEATURE_ISOTOPE:
+        result = target.getAtomIsotope(atom);
+        break;
+    case FEATURE_AROMATICITY:
+        result = target.getAtomAromaticity(atom);
+        break;
+    case FEATURE_CONNECTIVITY:
+        result = target.getVertex(atom).degree();
+        if (!special)
+            result += target.asMolecule().getImplicitH_NoThrow(atom, 0);
+        break;
+    case FEATURE_RING_BONDS:
+        result = target.getAtomRingBondsCount(atom);
+        break;
+    case FEATURE_SUBSTITUENTS:
+        result = target.getAtomSubstCount(atom);
+        break;
+    case FEATURE_UNSATURATION:
+        result = target.isSaturatedAtom(atom) ? 0 : 1;
+        break;
+    case FEATURE_TOTAL_H:
+        if (special || target.isTemplateAtom(atom))
+            result = UNAVAILABLE;
+        else
+            result = target.getAtomTotalH(atom);
+        break;
+    case FEATURE_RADICAL:
+        result = special ? -1 : target.getAtomRadical_NoThrow(atom, -1);
+        if (result == -1)
+            result = UNAVAILABLE;
+        break;
+    case FEATURE_VALENCE:
+        result = special ? -1 : target.getAtomValence_NoThrow(atom, -1);
+        if (result == -1)
+            result = UNAVAILABLE;
+        break;
+    case FEATURE_TOTAL_BOND_ORDER:
+        result = target.asMolecule().getAtomConnectivity_NoThrow(atom, -1);
+        if (result == -1)
+            result = UNAVAILABLE;
+        break;
+    case FEATURE_SSSR_RINGS:
+        result = target.vertexCountSSSR(atom);
+        break;
+    case FEATURE_SMALLEST_RING_SIZE:
+        result = target.vertexSmallestRingSize(atom);
+        break;
+    default:
+        throw Error("unknown feature %d", feature);
+    }
+
+    _values[atom * FEATURE_COUNT + feature] = result;
+    _computed[atom] |= bit;
+    return result;
+}
+
+IMPL_ERROR(MoleculeCompiledQuery, "compiled query");
+
+MoleculeCompiledQuery::MoleculeCompiledQuery() : _target(0), _features(&_own_features)
+{
+}
+
+void MoleculeCompiledQuery::clear()
+{
+    _code.clear();
+    _atoms.clear();
+    _bonds.clear();
+    _features = &_own_features;
+    _target = 0;
+}
+
+void MoleculeCompiledQuery::compile(QueryMolecule& query)
+{
+    int i;
+
+    clear();
+
+    _atoms.clear_resize(query.vertexEnd());
+    for (i = query.vertexBegin(); i != query.vertexEnd(); i = query.vertexNext(i))
+    {
+        QueryMolecule::Atom& atom = query.getAtom(i);
+        Program& program = _atoms[i];
+
+        program.begin = _code.size();
+        memset(program.element_mask, 0, sizeof(program.element_mask));
+        program.has_element_mask = _elementMask(&atom, program.element_mask);
+        _compileAtom(&atom);
+    }
+
+    _bonds.clear_resize(query.edgeEnd());
+    for (i = query.edgeBegin(); i != query.edgeEnd(); i = query.edgeNext(i))
+    {
+        Program& program = _bonds[i];
+
+        program.begin = _code.size();
+        program.has_element_mask = false;
+        _compileBond(&query.getBond(i));
+    }
+}
+
+void MoleculeCompiledQuery::setTarget(BaseMolecule& target, MoleculeTargetFeatures* shared_features)
+{
+    _target = &target;
+    if (shared_features != 0)
+    {
+        _features = shared_features;
+        _features->setTarget(target);
+    }
+    else
+    {
+        _features = &_own_features;
+        _features->reset(target);
+    }
+}
+
+int MoleculeCompiledQuery::_atomCost(QueryMolecule::Atom* atom)
+{
+    int i, cost = 0;
+
+    switch (atom->type)
+    {
+    case QueryMolecule::OP_NONE:
+    case QueryMolecule::ATOM_NUMBER:
+    case QueryMolecule::ATOM_CHARGE:
+    case QueryMolecule::ATOM_ISOTOPE:
+        return 0;
+    case QueryMolecule::ATOM_AROMATICITY:
+    case QueryMolecule::ATOM_RADICAL:
+        return 1;
+    case QueryMolecule::ATOM_CONNECTIVITY:
+    case QueryMolecule::ATOM_RING_BONDS:
+    case QueryMolecule::ATOM_RING_BONDS_AS_DRAWN:
+    case QueryMolecule::ATOM_SUBSTITUENTS:
+    case QueryMolecule::ATOM_SUBSTITUENTS_AS_DRAWN:
+    case QueryMolecule::ATOM_UNSATURATION:
+        return 2;
+    case QueryMolecule::ATOM_TOTAL_H:
+    case QueryMolecule::ATOM_VALENCE:
+    case QueryMolecule::ATOM_TOTAL_BOND_ORDER:
+        return 3;
+    case QueryMolecule::ATOM_SSSR_RINGS:
+    case QueryMolecule::ATOM_SMALLEST_RING_SIZE:
+        return 4;
+    case QueryMolecule::ATOM_FRAGMENT:
+        return 100;
+    case QueryMolecule::OP_AND:
+    case QueryMolecule::OP_OR:
+    case QueryMolecule::OP_NOT:
+        for (i = 0; i < atom->children.size(); i++)
+            cost = std::max(cost, _atomCost(atom->child(i)));
+        return cost;
+    default:
+        return 10;
+    }
+}
+
+// Adds the set of target elements the atom can possibly match to the mask.
+// Returns false if the expression does not restrict the element.
+bool MoleculeCompiledQuery::_elementMask(QueryMolecule::Atom* atom, dword* mask)
+{
+    int i, j;
+
+    if (atom->type == QueryMolecule::ATOM_NUMBER)
+    {
+        int from = std::max(atom->value_min, 0);
+        int to = std::min(atom->value_max, _ELEMENT_MASK_WORDS * 32 - 1);
+
+        for (j = from; j <= to; j++)
+            mask[j / 32] |= (dword)1 << (j % 32);
+        return true;
+    }
+
+    if (atom->type == QueryMolecule::OP_AND)
+    {
+        bool restricted = false;
+        dword and_mask[_ELEMENT_MASK_WORDS], child_mask[_ELEMENT_MASK_WORDS];
+
+        for (i = 0; i < atom->children.size(); i++)
+        {
+            memset(child_mask, 0, sizeof(child_mask));
+            if (!_elementMask(atom->child(i), child_mask))
+                continue;
+
+            for (j = 0; j < _ELEMENT_MASK_WORDS; j++)
+                and_mask[j] = restricted ? (and_mask[j] & child_mask[j]) : child_mask[j];
+            restricted = true;
+        }
+
+        if (restricted)
+            for (j = 0; j < _ELEMENT_MASK_WORDS; j++)
+                mask[j] |= and_mask[j];
+        return restricted;
+    }
+
+    if (atom->type == QueryMolecule::OP_OR && atom->children.size() > 0)
+    {
+        for (i = 0; i < atom->children.size(); i++)
+            if (!_elementMask(atom->child(i), mask))
+                return false;
+        return true;
+    }
+
+    return false;
+}
+
+void MoleculeCompiledQuery::_compileAtom(QueryMolecule::Atom* atom)
+{
+    int i, j, idx = _code.size();
+    Instruction instr;
+
+    instr.op = _INSTR_FALLBACK;
+    instr.feature = -1;
+    instr.value_min = atom->value_min;
+    instr.value_max = atom->value_max;
+    instr.children = 0;
+    instr.end = -1;
+    instr.node = atom;
+
+    switch (atom->type)
+    {
+    case QueryMolecule::OP_NONE:
+        instr.op = _INSTR_TRUE;
+        break;
+    case QueryMolecule::OP_AND:
+    case QueryMolecule::OP_OR:
+    case QueryMolecule::OP_NOT: {
+        instr.op = (atom->type == QueryMolecule::OP_AND) ? _INSTR_AND : (atom->type == QueryMolecule::OP_OR ? _INSTR_OR : _INSTR_NOT);
+        instr.children = (atom->type == QueryMolecule::OP_NOT) ? 1 : atom->children.size();
+        _code.push(instr);
+
+        // Emit the children in the order of increasing evaluation cost
+        // (stable insertion sort, children count is small)
+        Array<int> order, costs;
+
+        for (i = 0; i < instr.children; i++)
+        {
+            int cost = _atomCost(atom->child(i));
+
+            order.push(i);
+            costs.push(cost);
+            for (j = i; j > 0 && costs[j - 1] > cost; j--)
+            {
+                order.swap(j, j - 1);
+                costs.swap(j, j - 1);
+            }
+        }
+
+        for (i = 0; i < order.size(); i++)
+            _compileAtom(atom->child(order[i]));
+
+        _code[idx].end = _code.size();
+        return;
+    }
+    case QueryMolecule::ATOM_NUMBER:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_NUMBER;
+        break;
+    case QueryMolecule::ATOM_CHARGE:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_CHARGE;
+        break;
+    case QueryMolecule::ATOM_ISOTOPE:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_ISOTOPE;
+        break;
+    case QueryMolecule::ATOM_AROMATICITY:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_AROMATICITY;
+        break;
+    case QueryMolecule::ATOM_RADICAL:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_RADICAL;
+        break;
+    case QueryMolecule::ATOM_VALENCE:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_VALENCE;
+        break;
+    case QueryMolecule::ATOM_CONNECTIVITY:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_CONNECTIVITY;
+        break;
+    case QueryMolecule::ATOM_TOTAL_BOND_ORDER:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_TOTAL_BOND_ORDER;
+        break;
+    case QueryMolecule::ATOM_TOTAL_H:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_TOTAL_H;
+        break;
+    case QueryMolecule::ATOM_SUBSTITUENTS:
+    case QueryMolecule::ATOM_SUBSTITUENTS_AS_DRAWN:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_SUBSTITUENTS;
+        break;
+    case QueryMolecule::ATOM_SSSR_RINGS:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_SSSR_RINGS;
+        break;
+    case QueryMolecule::ATOM_SMALLEST_RING_SIZE:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_SMALLEST_RING_SIZE;
+        break;
+    case QueryMolecule::ATOM_RING_BONDS:
+    case QueryMolecule::ATOM_RING_BONDS_AS_DRAWN:
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_RING_BONDS;
+        break;
+    case QueryMolecule::ATOM_UNSATURATION:
+        // value of the constraint is ignored: the atom must be unsaturated
+        instr.op = _INSTR_FEATURE;
+        instr.feature = MoleculeTargetFeatures::FEATURE_UNSATURATION;
+        instr.value_min = instr.value_max = 1;
+        break;
+    default:
+        break;
+    }
+
+    instr.end = idx + 1;
+    _code.push(instr);
+}
+
+void MoleculeCompiledQuery::_compileBond(QueryMolecule::Bond* bond)
+{
+    int i, idx = _code.size();
+    Instruction instr;
+
+    instr.op = _INSTR_FALLBACK;
+    instr.feature = -1;
+    instr.value_min = instr.value_max = bond->value;
+    instr.children = 0;
+    instr.end = idx + 1;
+    instr.node = bond;
+
+    switch (bond->type)
+    {
+    case QueryMolecule::OP_NONE:
+        instr.op = _INSTR_TRUE;
+        break;
+    case QueryMolecule::OP_AND:
+    case QueryMolecule::OP_OR:
+    case QueryMolecule::OP_NOT:
+        instr.op = (bond->type == QueryMolecule::OP_AND) ? _INSTR_AND : (bond->type == QueryMolecule::OP_OR ? _INSTR_OR : _INSTR_NOT);
+        instr.children = (bond->type == QueryMolecule::OP_NOT) ? 1 : bond->children.size();
+        _code.push(instr);
+        for (i = 0; i < instr.children; i++)
+            _compileBond(bond->child(i));
+        _code[idx].end = _code.size();
+        return;
+    case QueryMolecule::BOND_ORDER:
+        instr.op = _INSTR_BOND_ORDER;
+        break;
+    case QueryMolecule::BOND_TOPOLOGY:
+        instr.op = _INSTR_BOND_TOPOLOGY;
+        break;
+    default:
+        break;
+    }
+
+    _code.push(instr);
+}
+
+bool MoleculeCompiledQuery::_evalAtom(int pc, int super_idx, FragmentMatchCache* fmcache, dword flags)
+{
+    const Instruction& instr = _code[pc];
+    int i, child;
+
+    switch (instr.op)
+    {
+    case _INSTR_TRUE:
+        return true;
+    case _INSTR_AND:
+        for (i = 0, child = pc + 1; i < instr.children; i++, child = _code[child].end)
+            if (!_evalAtom(child, super_idx, fmcache, flags))
+                return false;
+        return true;
+    case _INSTR_OR:
+        for (i = 0, child = pc + 1; i < instr.children; i++, child = _code[child].end)
+            if (_evalAtom(child, super_idx, fmcache, flags))
+                return true;
+        return false;
+    case _INSTR_NOT:
+        return !_evalAtom(pc + 1, super_idx, fmcache, flags ^ MoleculeSubstructureMatcher::MATCH_DISABLED_AS_TRUE);
+    case _INSTR_FEATURE: {
+        if (instr.feature == MoleculeTargetFeatures::FEATURE_CHARGE && !(flags & MoleculeSubstructureMatcher::MATCH_ATOM_CHARGE))
+            return (flags & MoleculeSubstructureMatcher::MATCH_DISABLED_AS_TRUE) != 0;
+        if (instr.feature == MoleculeTargetFeatures::FEATURE_VALENCE && !(flags & MoleculeSubstructureMatcher::MATCH_ATOM_VALENCE))
+            return (flags & MoleculeSubstructureMatcher::MATCH_DISABLED_AS_TRUE) != 0;
+
+        int value = _features->get(super_idx, instr.feature);
+
+        if (value == MoleculeTargetFeatures::UNAVAILABLE)
+            return false;
+        return value >= instr.value_min && value <= instr.value_max;
+    }
+    default:
+        return MoleculeSubstructureMatcher::matchQueryAtom((QueryMolecule::Atom*)instr.node, *_target, super_idx, fmcache, flags);
+    }
+}
+
+bool MoleculeCompiledQuery::_evalBond(int pc, int sub_idx, int super_idx, AromaticityMatcher* am, dword flags)
+{
+    const Instruction& instr = _code[pc];
+    int i, child;
+
+    switch (instr.op)
+    {
+    case _INSTR_TRUE:
+        return true;
+    case _INSTR_AND:
+        for (i = 0, child = pc + 1; i < instr.children; i++, child = _code[child].end)
+            if (!_evalBond(child, sub_idx, super_idx, am, flags))
+                return false;
+        return true;
+    case _INSTR_OR:
+        for (i = 0, child = pc + 1; i < instr.children; i++, child = _code[child].end)
+            if (_evalBond(child, sub_idx, super_idx, am, flags))
+                return true;
+        return false;
+    case _INSTR_NOT:
+        return !_evalBond(pc + 1, sub_idx, super_idx, am, flags ^ MoleculeSubstructureMatcher::MATCH_DISABLED_AS_TRUE);
+    case _INSTR_BOND_ORDER:
+        if (flags & MoleculeSubstructureMatcher::MATCH_BOND_TYPE)
+        {
+            if (am != 0)
+            {
+                if (_target->getBondOrder(super_idx) == BOND_AROMATIC)
+                    return am->canFixQueryBond(sub_idx, true);
+                else if (!am->canFixQueryBond(sub_idx, false))
+                    return false;
+            }
+            return _target->possibleBondOrder(super_idx, instr.value_min);
+        }
+        return (flags & MoleculeSubstructureMatcher::MATCH_DISABLED_AS_TRUE) != 0;
+    case _INSTR_BOND_TOPOLOGY:
+        return _target->getEdgeTopology(super_idx) == instr.value_min;
+    default:
+        return MoleculeSubstructureMatcher::matchQueryBond((QueryMolecule::Bond*)instr.node, *_target, sub_idx, super_idx, am, flags);
+    }
+}
+
+bool MoleculeCompiledQuery::matchAtom(int query_atom, int target_atom, FragmentMatchCache* fmcache, dword flags)
+{
+    const Program& program = _atoms[query_atom];
+
+    if (program.has_element_mask)
+    {
+        int number = _features->get(target_atom, MoleculeTargetFeatures::FEATURE_NUMBER);
+
+        if (number >= 0 && number < _ELEMENT_MASK_WORDS * 32 && !(program.element_mask[number / 32] & ((dword)1 << (number % 32))))
+            return false;
+    }
+
+    return _evalAtom(program.begin, target_atom, fmcache, flags);
+}
+
+bool MoleculeCompiledQuery::matchBond(int query_bond, int target_bond, AromaticityMatcher* am, dword flags)
+{
+    return _evalBond(_bonds[query_bond].begin, query_bond, target_bond, am, flags);
+}
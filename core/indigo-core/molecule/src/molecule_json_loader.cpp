@@ -1,5 +1,10 @@
 #include "molecule/molecule_json_loader.h"
 
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <rapidjson/reader.h>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -9,6 +14,7 @@
 #include "layout/molecule_layout.h"
 #include "molecule/elements.h"
 #include "molecule/ket_commons.h"
+#include "molecule/ket_scanner_stream.h"
 #include "molecule/molecule.h"
 #include "molecule/query_molecule.h"
 
@@ -18,6 +24,600 @@ using namespace std;
 
 IMPL_ERROR(MoleculeJsonLoader, "molecule json loader");
 
+namespace
+{
+    bool isMoleculeBondOrder(int order)
+    {
+        return order == BOND_SINGLE || order == BOND_DOUBLE || order == BOND_TRIPLE || order == BOND_AROMATIC || order == _BOND_COORDINATION ||
+               order == _BOND_HYDROGEN;
+    }
+
+    int addMoleculeAtom(Molecule& mol, int elem, const char* label, int charge, int valence, int radical, int isotope)
+    {
+        int atom_idx = mol.addAtom(elem);
+        mol.setAtomCharge_Silent(atom_idx, charge);
+        mol.setAtomRadical(atom_idx, radical);
+        mol.setAtomIsotope(atom_idx, isotope);
+        if (valence > 0 && valence <= 14)
+            mol.setExplicitValence(atom_idx, valence);
+        if (valence == 15)
+            mol.setExplicitValence(atom_idx, 0);
+        if (elem == ELEM_PSEUDO)
+            mol.setPseudoAtom(atom_idx, label);
+        return atom_idx;
+    }
+
+    void setBondStereo(BaseMolecule& mol, int bond_idx, int stereo)
+    {
+        switch (stereo)
+        {
+        case 1:
+            mol.setBondDirection(bond_idx, BOND_UP);
+            break;
+        case 3:
+            mol.cis_trans.ignore(bond_idx);
+            break;
+        case 4:
+            mol.setBondDirection(bond_idx, BOND_EITHER);
+            break;
+        case 6:
+            mol.setBondDirection(bond_idx, BOND_DOWN);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // "abs", "or<group>" or "&<group>". Returns false for group 0 and unknown labels.
+    bool parseStereoLabel(const std::string& label, int& type, int& group)
+    {
+        if (label.find("abs") != std::string::npos)
+        {
+            type = MoleculeStereocenters::ATOM_ABS;
+            group = 1;
+            return true;
+        }
+        if (label.find("or") != std::string::npos)
+        {
+            type = MoleculeStereocenters::ATOM_OR;
+            group = std::stoi(label.substr(2));
+            return group != 0;
+        }
+        if (label.find("&") != std::string::npos)
+        {
+            type = MoleculeStereocenters::ATOM_AND;
+            group = std::stoi(label.substr(1));
+            return group != 0;
+        }
+        return false;
+    }
+
+    const std::unordered_map<std::string, int> arrow_string2type = {
+        {"open-angle", ReactionComponent::ARROW_BASIC},
+        {"filled-triangle", ReactionComponent::ARROW_FILLED_TRIANGLE},
+        {"filled-bow", ReactionComponent::ARROW_FILLED_BOW},
+        {"dashed-open-angle", ReactionComponent::ARROW_DASHED},
+        {"failed", ReactionComponent::ARROW_FAILED},
+        {"both-ends-filled-triangle", ReactionComponent::ARROW_BOTH_ENDS_FILLED_TRIANGLE},
+        {"equilibrium-filled-half-bow", ReactionComponent::ARROW_EQUILIBRIUM_FILLED_HALF_BOW},
+        {"equilibrium-filled-triangle", ReactionComponent::ARROW_EQUILIBRIUM_FILLED_TRIANGLE},
+        {"equilibrium-open-angle", ReactionComponent::ARROW_EQUILIBRIUM_OPEN_ANGLE},
+        {"unbalanced-equilibrium-filled-half-bow", ReactionComponent::ARROW_UNBALANCED_EQUILIBRIUM_FILLED_HALF_BOW},
+        {"unbalanced-equilibrium-large-filled-half-bow", ReactionComponent::ARROW_UNBALANCED_EQUILIBRIUM_LARGE_FILLED_HALF_BOW},
+        {"unbalanced-equilibrium-filled-half-triangle", ReactionComponent::ARROW_BOTH_ENDS_FILLED_TRIANGLE}};
+
+    // Builds the molecule nodes of a KET document while rapidjson reads it, so
+    // no DOM is held. Only molecules with plain atoms and bonds, arrows and
+    // pluses are taken: on anything else a callback returns false, which stops
+    // the reader, and the document has to be loaded through the DOM.
+    // Nodes that come in the order of the root refs, after the root, are built
+    // straight into the target molecule, the others are merged afterwards.
+    class PlainKetHandler : public BaseReaderHandler<UTF8<>, PlainKetHandler>
+    {
+    public:
+        struct StereoLabel
+        {
+            int atom_idx;
+            int type;
+            int group;
+        };
+
+        struct Node
+        {
+            Node() : has_type(false), has_atoms(false), has_bonds(false), has_flag_position(false), merged(false)
+            {
+            }
+
+            std::unique_ptr<Molecule> mol; // null for a node built in the target
+            std::vector<int> atoms;        // node atom -> molecule atom
+            std::vector<StereoLabel> stereo_labels;
+            Vec3f flag_position;
+            bool has_type, has_atoms, has_bonds, has_flag_position;
+            bool merged;
+        };
+
+        // Atoms are added to the target only if it has none
+        explicit PlainKetHandler(Molecule& target)
+            : has_nodes(false), built_in_target(0), _target(target), _in_target(target.vertexCount() == 0), _node(nullptr), _mol(nullptr)
+        {
+            _states.push_back(DOCUMENT);
+        }
+
+        // Nulls, booleans and 64-bit numbers
+        bool Default()
+        {
+            return false;
+        }
+
+        bool Int(int value)
+        {
+            return _integer(value);
+        }
+
+        bool Uint(unsigned value)
+        {
+            return value <= INT_MAX && _integer((int)value);
+        }
+
+        bool Double(double value)
+        {
+            return _real((float)value);
+        }
+
+        bool String(const char* str, SizeType length, bool)
+        {
+            switch (_states.back())
+            {
+            case ROOT_NODE:
+                if (_key == "$ref" && _ref.empty() && _meta_type == META_NONE)
+                    _ref.assign(str, length);
+                else if (_key == "type" && _ref.empty() && _meta_type == META_NONE)
+                {
+                    // Other objects, e.g. texts, are left to the DOM
+                    if (length == 5 && strncmp(str, "arrow", 5) == 0)
+                        _meta_type = META_ARROW;
+                    else if (length == 4 && strncmp(str, "plus", 4) == 0)
+                        _meta_type = META_PLUS;
+                    else
+                        return false;
+                }
+                else
+                    return false;
+                return true;
+            case ARROW_DATA:
+                if (_key != "mode" || _has_mode)
+                    return false;
+                _arrow_mode.assign(str, length);
+                _has_mode = true;
+                return true;
+            case NODE:
+                // Other node types, e.g. "rgroup", are left to the DOM
+                if (_key != "type" || length != 8 || strncmp(str, "molecule", 8) != 0)
+                    return false;
+                _node->has_type = true;
+                return true;
+            case ATOM:
+                if (_key == "label")
+                    _atom.label.assign(str, length);
+                else if (_key == "stereoLabel")
+                    _atom.stereo_label.assign(str, length);
+                else
+                    return false;
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool Key(const char* str, SizeType length, bool)
+        {
+            _key.assign(str, length);
+            return true;
+        }
+
+        bool StartObject()
+        {
+            switch (_states.back())
+            {
+            case DOCUMENT:
+                return _push(TOP);
+            case TOP:
+                if (_key == "root")
+                    return _push(ROOT);
+                return _startNode();
+            case ROOT_NODES:
+                _ref.clear();
+                _meta_type = META_NONE;
+                _has_mode = false;
+                _points_count = 0;
+                _coords_count = 0;
+                return _push(ROOT_NODE);
+            case ROOT_NODE:
+                if (_key != "data" || _meta_type != META_ARROW || _has_mode)
+                    return false;
+                return _push(ARROW_DATA);
+            case ARROW_POS:
+                if (_points_count == 2)
+                    return false;
+                _coords_count = 0;
+                return _push(ARROW_POINT);
+            case NODE:
+                if (_key != "stereoFlagPosition" || _node->has_flag_position)
+                    return false;
+                _node->has_flag_position = true;
+                return _push(FLAG_POSITION);
+            case ATOMS:
+                _atom.reset();
+                return _push(ATOM);
+            case BONDS:
+                _bond.reset();
+                return _push(BOND);
+            default:
+                return false;
+            }
+        }
+
+        bool EndObject(SizeType)
+        {
+            switch (_pop())
+            {
+            case ROOT_NODE:
+                return _endRootNode();
+            case ARROW_POINT:
+                // z is not used
+                if ((_coords_count & 3) != 3)
+                    return false;
+                _points[_points_count++].set(_coords[0], _coords[1]);
+                return true;
+            case NODE:
+                return _node->has_type && _node->has_atoms;
+            case ATOM:
+                return _addAtom();
+            case BOND:
+                return _addBond();
+            default:
+                return true;
+            }
+        }
+
+        bool StartArray()
+        {
+            switch (_states.back())
+            {
+            case ROOT:
+                if (_key != "nodes" || has_nodes)
+                    return false;
+                has_nodes = true;
+                return _push(ROOT_NODES);
+            case ROOT_NODE:
+                if (_key != "location" || _meta_type != META_PLUS || _coords_count != 0)
+                    return false;
+                return _push(PLUS_LOCATION);
+            case ARROW_DATA:
+                if (_key != "pos" || _points_count != 0)
+                    return false;
+                return _push(ARROW_POS);
+            case NODE:
+                // Bonds refer to the atoms, which must come first
+                if (_key == "atoms" && !_node->has_atoms)
+                {
+                    _node->has_atoms = true;
+                    return _push(ATOMS);
+                }
+                if (_key == "bonds" && _node->has_atoms && !_node->has_bonds)
+                {
+                    _node->has_bonds = true;
+                    return _push(BONDS);
+                }
+                return false;
+            case ATOM:
+                if (_key != "location" || _atom.coords_count != 0)
+                    return false;
+                return _push(LOCATION);
+            case BOND:
+                if (_key != "atoms" || _bond.atoms_count != 0)
+                    return false;
+                return _push(BOND_ATOMS);
+            default:
+                return false;
+            }
+        }
+
+        bool EndArray(SizeType)
+        {
+            switch (_pop())
+            {
+            case PLUS_LOCATION:
+                return _coords_count == 3;
+            case ARROW_POS:
+                return _points_count == 2;
+            case LOCATION:
+                return _atom.coords_count == 0 || _atom.coords_count == 3;
+            case BOND_ATOMS:
+                return _bond.atoms_count == 2;
+            default:
+                return true;
+            }
+        }
+
+        bool has_nodes;
+        int built_in_target; // the first refs, built straight into the target
+        std::vector<std::string> refs;
+        std::unordered_map<std::string, std::unique_ptr<Node>> nodes;
+        std::vector<std::unique_ptr<MetaObject>> meta_objects;
+
+    private:
+        enum
+        {
+            DOCUMENT,
+            TOP,
+            ROOT,
+            ROOT_NODES,
+            ROOT_NODE,
+            ARROW_DATA,
+            ARROW_POS,
+            ARROW_POINT,
+            PLUS_LOCATION,
+            NODE,
+            FLAG_POSITION,
+            ATOMS,
+            ATOM,
+            LOCATION,
+            BONDS,
+            BOND,
+            BOND_ATOMS
+        };
+
+        enum
+        {
+            META_NONE,
+            META_ARROW,
+            META_PLUS
+        };
+
+        struct Atom
+        {
+            void reset()
+            {
+                label.clear();
+                stereo_label.clear();
+                charge = isotope = radical = valence = mapping = coords_count = 0;
+            }
+
+            std::string label, stereo_label;
+            int charge, isotope, radical, valence, mapping;
+            int coords_count;
+            float coords[3];
+        };
+
+        struct Bond
+        {
+            void reset()
+            {
+                type = -1;
+                stereo = 0;
+                atoms_count = 0;
+            }
+
+            int type, stereo;
+            int atoms_count;
+            int atoms[2];
+        };
+
+        bool _push(int state)
+        {
+            _states.push_back(state);
+            return true;
+        }
+
+        int _pop()
+        {
+            int state = _states.back();
+            _states.pop_back();
+            return state;
+        }
+
+        bool _startNode()
+        {
+            std::unique_ptr<Node>& node = nodes[_key];
+            if (node)
+                return false;
+            node = std::make_unique<Node>();
+            _node = node.get();
+
+            // Once a node is put aside, the later ones are merged after it
+            if (_in_target && built_in_target < (int)refs.size() && refs[built_in_target] == _key)
+            {
+                built_in_target++;
+                _mol = &_target;
+            }
+            else
+            {
+                _in_target = false;
+                _node->mol = std::make_unique<Molecule>();
+                _mol = _node->mol.get();
+            }
+            return _push(NODE);
+        }
+
+        bool _endRootNode()
+        {
+            switch (_meta_type)
+            {
+            case META_ARROW: {
+                if (!_has_mode || _points_count != 2)
+                    return false;
+                auto arrow_type = arrow_string2type.find(_arrow_mode);
+                meta_objects.push_back(std::make_unique<KETReactionArrow>(
+                    arrow_type != arrow_string2type.end() ? arrow_type->second : (int)ReactionComponent::ARROW_BASIC, _points[0], _points[1]));
+                return true;
+            }
+            case META_PLUS:
+                if (_coords_count != 3)
+                    return false;
+                meta_objects.push_back(std::make_unique<KETReactionPlus>(Vec2f(_coords[0], _coords[1])));
+                return true;
+            default:
+                if (_ref.empty())
+                    return false;
+                refs.push_back(_ref);
+                return true;
+            }
+        }
+
+        bool _integer(int value)
+        {
+            switch (_states.back())
+            {
+            case ATOM:
+                if (_key == "charge")
+                    _atom.charge = value;
+                else if (_key == "isotope")
+                    _atom.isotope = value;
+                else if (_key == "radical")
+                    _atom.radical = value;
+                else if (_key == "explicitValence")
+                    _atom.valence = value;
+                else if (_key == "mapping")
+                    _atom.mapping = value;
+                else
+                    return false;
+                return true;
+            case BOND:
+                if (_key == "type")
+                    _bond.type = value;
+                else if (_key == "stereo")
+                    _bond.stereo = value;
+                else
+                    return false;
+                return true;
+            case BOND_ATOMS:
+                if (_bond.atoms_count == 2)
+                    return false;
+                _bond.atoms[_bond.atoms_count++] = value;
+                return true;
+            default:
+                return _real((float)value);
+            }
+        }
+
+        bool _real(float value)
+        {
+            switch (_states.back())
+            {
+            case LOCATION:
+                if (_atom.coords_count == 3)
+                    return false;
+                _atom.coords[_atom.coords_count++] = value;
+                return true;
+            case PLUS_LOCATION:
+                if (_coords_count == 3)
+                    return false;
+                _coords[_coords_count++] = value;
+                return true;
+            case ARROW_POINT: {
+                int coord = _key == "x" ? 0 : _key == "y" ? 1 : _key == "z" ? 2 : -1;
+                if (coord == -1 || (_coords_count & (1 << coord)))
+                    return false;
+                _coords[coord] = value;
+                _coords_count |= 1 << coord;
+                return true;
+            }
+            case FLAG_POSITION:
+                if (_key == "x")
+                    _node->flag_position.x = value;
+                else if (_key == "y")
+                    _node->flag_position.y = value;
+                else if (_key == "z")
+                    _node->flag_position.z = value;
+                else
+                    return false;
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool _addAtom()
+        {
+            int elem, isotope = _atom.isotope;
+
+            if (_atom.label == "D")
+            {
+                elem = ELEM_H;
+                isotope = 2;
+            }
+            else if (_atom.label == "T")
+            {
+                elem = ELEM_H;
+                isotope = 3;
+            }
+            else
+            {
+                // Pseudoatoms and query labels are left to the DOM
+                elem = Element::fromString2(_atom.label.c_str());
+                if (elem == -1)
+                    return false;
+            }
+
+            Molecule& mol = *_mol;
+            int atom_idx = addMoleculeAtom(mol, elem, _atom.label.c_str(), _atom.charge, _atom.valence, _atom.radical, isotope);
+            _node->atoms.push_back(atom_idx);
+            mol.reaction_atom_mapping[atom_idx] = _atom.mapping;
+            if (_atom.coords_count == 3)
+                mol.setAtomXyz(atom_idx, Vec3f(_atom.coords[0], _atom.coords[1], _atom.coords[2]));
+
+            StereoLabel label;
+            label.atom_idx = atom_idx;
+            if (parseStereoLabel(_atom.stereo_label, label.type, label.group))
+                _node->stereo_labels.push_back(label);
+            return true;
+        }
+
+        bool _addBond()
+        {
+            // Query bonds are left to the DOM, broken ones fail there
+            if (!isMoleculeBondOrder(_bond.type) || _bond.atoms_count != 2)
+                return false;
+
+            const std::vector<int>& atoms = _node->atoms;
+            int beg = _bond.atoms[0], end = _bond.atoms[1];
+
+            if (beg < 0 || end < 0 || beg >= (int)atoms.size() || end >= (int)atoms.size() || beg == end)
+                return false;
+
+            Molecule& mol = *_mol;
+            beg = atoms[beg];
+            end = atoms[end];
+            if (mol.findEdgeIndex(beg, end) != -1)
+                return false;
+
+            int bond_idx = mol.addBond_Silent(beg, end, _bond.type);
+            setBondStereo(mol, bond_idx, _bond.stereo);
+            return true;
+        }
+
+        std::vector<int> _states;
+        std::string _key;
+        Molecule& _target;
+        bool _in_target;
+        Node* _node;
+        Molecule* _mol;
+        Atom _atom;
+        Bond _bond;
+
+        // The root node being read: a ref, an arrow or a plus
+        std::string _ref;
+        int _meta_type;
+        std::string _arrow_mode;
+        bool _has_mode;
+        Vec2f _points[2];
+        int _points_count;
+        float _coords[3];
+        int _coords_count; // a bit per coordinate for arrow points
+    };
+} // namespace
+
 MoleculeJsonLoader::MoleculeJsonLoader(Document& ket)
     : _mol_array(kArrayType), _mol_nodes(_mol_array), _meta_objects(kArrayType), _pmol(0), _pqmol(0), ignore_noncritical_query_features(false)
 {
@@ -58,6 +658,11 @@ MoleculeJsonLoader::MoleculeJsonLoader(Value& mol_nodes)
 {
 }
 
+MoleculeJsonLoader::MoleculeJsonLoader()
+    : _mol_array(kArrayType), _mol_nodes(_mol_array), _meta_objects(kArrayType), _pmol(0), _pqmol(0), ignore_noncritical_query_features(false)
+{
+}
+
 int MoleculeJsonLoader::addBondToMoleculeQuery(int beg, int end, int order, int topology)
 {
     std::unique_ptr<QueryMolecule::Bond> bond;
@@ -194,8 +799,7 @@ int MoleculeJsonLoader::addAtomToMoleculeQuery(const char* label, int element, i
 
 void MoleculeJsonLoader::validateMoleculeBond(int order)
 {
-    if (order == BOND_SINGLE || order == BOND_DOUBLE || order == BOND_TRIPLE || order == BOND_AROMATIC || order == _BOND_COORDINATION ||
-        order == _BOND_HYDROGEN)
+    if (isMoleculeBondOrder(order))
         return;
     else if (order == _BOND_SINGLE_OR_DOUBLE)
         throw Error("'single or double' bonds are allowed only for queries");
@@ -326,20 +930,7 @@ void MoleculeJsonLoader::parseAtoms(const rapidjson::Value& atoms, BaseMolecule&
             radical = a["radical"].GetInt();
 
         if (_pmol)
-        {
-            atom_idx = _pmol->addAtom(elem);
-            _pmol->setAtomCharge_Silent(atom_idx, charge);
-            _pmol->setAtomRadical(atom_idx, radical);
-            _pmol->setAtomIsotope(atom_idx, isotope);
-            if (valence > 0 && valence <= 14)
-                _pmol->setExplicitValence(atom_idx, valence);
-            if (valence == 15)
-                _pmol->setExplicitValence(atom_idx, 0);
-            if (elem == ELEM_PSEUDO)
-            {
-                _pmol->setPseudoAtom(atom_idx, label.c_str());
-            }
-        }
+            atom_idx = addMoleculeAtom(*_pmol, elem, label.c_str(), charge, valence, radical, isotope);
         else
         {
             atom_idx = addAtomToMoleculeQuery(label.c_str(), elem, charge, valence, radical, isotope);
@@ -443,23 +1034,9 @@ void MoleculeJsonLoader::parseAtoms(const rapidjson::Value& atoms, BaseMolecule&
 
         if (a.HasMember("stereoLabel"))
         {
-            std::string sl = a["stereoLabel"].GetString();
-            if (sl.find("abs") != std::string::npos)
-            {
-                stereo_centers.emplace_back(atom_idx, MoleculeStereocenters::ATOM_ABS, 1);
-            }
-            else if (sl.find("or") != std::string::npos)
-            {
-                int grp = std::stoi(sl.substr(2));
-                if (grp)
-                    stereo_centers.emplace_back(atom_idx, MoleculeStereocenters::ATOM_OR, grp);
-            }
-            else if (sl.find("&") != std::string::npos)
-            {
-                int grp = std::stoi(sl.substr(1));
-                if (grp)
-                    stereo_centers.emplace_back(atom_idx, MoleculeStereocenters::ATOM_AND, grp);
-            }
+            int type, group;
+            if (parseStereoLabel(a["stereoLabel"].GetString(), type, group))
+                stereo_centers.emplace_back(atom_idx, type, group);
         }
 
         if (a.HasMember("location"))
@@ -561,28 +1138,7 @@ void MoleculeJsonLoader::parseBonds(const rapidjson::Value& bonds, BaseMolecule&
             int a2 = refs[1].GetInt();
             int bond_idx = 0;
             bond_idx = _pmol ? _pmol->addBond_Silent(a1, a2, order) : addBondToMoleculeQuery(a1, a2, order, topology);
-            if (stereo)
-            {
-                switch (stereo)
-                {
-                case 1:
-                    mol.setBondDirection(bond_idx, BOND_UP);
-                    break;
-                case 3:
-                    mol.cis_trans.ignore(bond_idx);
-                    break;
-                case 4:
-                    mol.setBondDirection(bond_idx, BOND_EITHER);
-                    break;
-                case 6:
-                    mol.setBondDirection(bond_idx, BOND_DOWN);
-                    break;
-                    break;
-
-                default:
-                    break;
-                }
-            }
+            setBondStereo(mol, bond_idx, stereo);
             if (rcenter)
             {
                 mol.reaction_bond_reacting_center[i] = rcenter;
@@ -930,14 +1486,7 @@ void MoleculeJsonLoader::loadMolecule(BaseMolecule& mol, bool load_arrows)
             throw Error("unknown type: %s", type.c_str());
         }
 
-        Array<int> mapping;
-        mol.mergeWithMolecule(*pmol, &mapping, COPY_BOND_DIRECTIONS);
-
-        for (auto& sc : stereo_centers)
-        {
-            sc._atom_idx = mapping[sc._atom_idx];
-            _stereo_centers.push_back(sc);
-        }
+        mergeNode(mol, *pmol, stereo_centers);
     }
 
     MoleculeRGroups& rgroups = mol.rgroups;
@@ -955,6 +1504,87 @@ void MoleculeJsonLoader::loadMolecule(BaseMolecule& mol, bool load_arrows)
         rgroup.fragments.add(fragment.release());
     }
 
+    completeMolecule(mol, load_arrows);
+}
+
+bool MoleculeJsonLoader::loadPlainMolecule(Scanner& scanner, Molecule& mol, bool load_arrows)
+{
+    long long start = scanner.tell();
+    PlainKetHandler handler(mol);
+    bool plain = false;
+
+    try
+    {
+        std::unique_ptr<KetScannerStream> stream = std::make_unique<KetScannerStream>(scanner);
+        Reader reader;
+
+        // Without kParseStopWhenDone the reader fails on anything but whitespace after the root value
+        plain = reader.Parse(*stream, handler) && handler.has_nodes;
+        if (plain)
+            stream->finish();
+    }
+    catch (Exception&)
+    {
+        plain = false;
+    }
+    catch (std::logic_error&)
+    {
+        // A stereo label without a number
+        plain = false;
+    }
+
+    for (int i = 0; plain && i < handler.refs.size(); i++)
+    {
+        auto node = handler.nodes.find(handler.refs[i]);
+        plain = node != handler.nodes.end() && !node->second->merged;
+        if (plain)
+            node->second->merged = true;
+    }
+
+    if (!plain)
+    {
+        if (handler.built_in_target > 0)
+            mol.clear();
+        scanner.seek(start, SEEK_SET);
+        return false;
+    }
+
+    for (int node_idx = 0; node_idx < handler.refs.size(); node_idx++)
+    {
+        PlainKetHandler::Node& node = *handler.nodes[handler.refs[node_idx]];
+        std::vector<EnhancedStereoCenter> stereo_centers;
+
+        for (const auto& label : node.stereo_labels)
+            stereo_centers.emplace_back(label.atom_idx, label.type, label.group);
+        if (node.has_flag_position)
+            mol.setStereoFlagPosition(node_idx, node.flag_position);
+        if (node.mol)
+            mergeNode(mol, *node.mol, stereo_centers);
+        else
+            _stereo_centers.insert(_stereo_centers.end(), stereo_centers.begin(), stereo_centers.end());
+    }
+
+    for (auto& meta_object : handler.meta_objects)
+        mol.meta().addMetaObject(meta_object.release());
+
+    completeMolecule(mol, load_arrows);
+    return true;
+}
+
+void MoleculeJsonLoader::mergeNode(BaseMolecule& mol, BaseMolecule& node, std::vector<EnhancedStereoCenter>& stereo_centers)
+{
+    Array<int> mapping;
+    mol.mergeWithMolecule(node, &mapping, COPY_BOND_DIRECTIONS);
+
+    for (auto& sc : stereo_centers)
+    {
+        sc._atom_idx = mapping[sc._atom_idx];
+        _stereo_centers.push_back(sc);
+    }
+}
+
+void MoleculeJsonLoader::completeMolecule(BaseMolecule& mol, bool load_arrows)
+{
     std::vector<int> ignore_cistrans(mol.edgeCount());
     std::vector<int> sensible_bond_directions(mol.edgeCount());
     for (int i = 0; i < mol.edgeCount(); i++)
@@ -1027,20 +1657,6 @@ void MoleculeJsonLoader::loadMolecule(BaseMolecule& mol, bool load_arrows)
 
 void MoleculeJsonLoader::loadMetaObjects(rapidjson::Value& meta_objects, MetaDataStorage& meta_interface)
 {
-    static const std::unordered_map<std::string, int> arrow_string2type = {
-        {"open-angle", ReactionComponent::ARROW_BASIC},
-        {"filled-triangle", ReactionComponent::ARROW_FILLED_TRIANGLE},
-        {"filled-bow", ReactionComponent::ARROW_FILLED_BOW},
-        {"dashed-open-angle", ReactionComponent::ARROW_DASHED},
-        {"failed", ReactionComponent::ARROW_FAILED},
-        {"both-ends-filled-triangle", ReactionComponent::ARROW_BOTH_ENDS_FILLED_TRIANGLE},
-        {"equilibrium-filled-half-bow", ReactionComponent::ARROW_EQUILIBRIUM_FILLED_HALF_BOW},
-        {"equilibrium-filled-triangle", ReactionComponent::ARROW_EQUILIBRIUM_FILLED_TRIANGLE},
-        {"equilibrium-open-angle", ReactionComponent::ARROW_EQUILIBRIUM_OPEN_ANGLE},
-        {"unbalanced-equilibrium-filled-half-bow", ReactionComponent::ARROW_UNBALANCED_EQUILIBRIUM_FILLED_HALF_BOW},
-        {"unbalanced-equilibrium-large-filled-half-bow", ReactionComponent::ARROW_UNBALANCED_EQUILIBRIUM_LARGE_FILLED_HALF_BOW},
-        {"unbalanced-equilibrium-filled-half-triangle", ReactionComponent::ARROW_BOTH_ENDS_FILLED_TRIANGLE}};
-
     if (meta_objects.IsArray())
     {
         for (int obj_idx = 0; obj_idx < meta_objects.Size(); ++obj_idx)
@@ -18,6 +18,8 @@
 
 #include "molecule/molecule_neighbourhood_counters.h"
 
+#include <algorithm>
+
 #include "base_cpp/exception.h"
 #include "base_cpp/tlscont.h"
 #include "molecule/elements.h"
@@ -76,8 +78,67 @@ void MoleculeAtomNeighbourhoodCounters::_calculate(BaseMolecule& mol, bool is_qu
             cur.degree_sum -= prev.degree_sum;
         }
     }
+
+    _calculateSignatures(mol);
+}
+
+// Lanes per radius: C, hetero, N, O, triple, degree sum
+static const int _LANES_PER_RADIUS = 6;
+static const int _DEGREE_LANE = 5;
+static const int _LANE_MAX = 0x7F;
+
+static bool _setLane(MoleculeAtomNeighbourhoodCounters::Signature& signature, int lane, int value)
+{
+    // Clamping keeps the packed test monotonic; clamped atoms are rechecked exactly
+    qword clamped = (qword)std::min(std::max(value, 0), _LANE_MAX);
+    signature.lanes[lane / 8] |= clamped << (8 * (lane % 8));
+    return value >= 0 && value < _LANE_MAX;
+}
+
+void MoleculeAtomNeighbourhoodCounters::_calculateSignatures(BaseMolecule& mol)
+{
+    _signatures.resize(mol.vertexEnd());
+    _signatures.zerofill();
+    _signature_exact.clear_resize(mol.vertexEnd());
+    _signature_exact.zerofill();
+
+    for (int i = mol.vertexBegin(); i < mol.vertexEnd(); i = mol.vertexNext(i))
+    {
+        if (!_use_atom[i])
+            continue;
+
+        Signature& signature = _signatures[i];
+        bool exact = true;
+        for (int r = 0; r < Counters::RADIUS; r++)
+        {
+            const CountersPerRadius& cnt = _per_atom_counters[i].per_rad[r];
+            int lane = r * _LANES_PER_RADIUS;
+
+            exact &= _setLane(signature, lane, cnt.C_cnt);
+            exact &= _setLane(signature, lane + 1, cnt.hetero_cnt);
+            exact &= _setLane(signature, lane + 2, cnt.heteroN_cnt);
+            exact &= _setLane(signature, lane + 3, cnt.heteroO_cnt);
+            exact &= _setLane(signature, lane + 4, cnt.trip_cnt);
+            exact &= _setLane(signature, lane + _DEGREE_LANE, cnt.degree_sum);
+        }
+        _signature_exact[i] = exact ? 1 : 0;
+    }
+}
+
+static MoleculeAtomNeighbourhoodCounters::Signature _makeNoDegreeMask()
+{
+    MoleculeAtomNeighbourhoodCounters::Signature mask;
+    mask.lanes[0] = mask.lanes[1] = ~(qword)0;
+    for (int r = 0; r < MoleculeAtomNeighbourhoodCounters::Counters::RADIUS; r++)
+    {
+        int lane = r * _LANES_PER_RADIUS + _DEGREE_LANE;
+        mask.lanes[lane / 8] &= ~((qword)0xFF << (8 * (lane % 8)));
+    }
+    return mask;
 }
 
+static const MoleculeAtomNeighbourhoodCounters::Signature _no_degree_mask = _makeNoDegreeMask();
+
 bool MoleculeAtomNeighbourhoodCounters::_isAtomInformationStored(int atom_idx) const
 {
     if (atom_idx >= _use_atom.size() || _use_atom[atom_idx] == 0)
@@ -95,6 +156,23 @@ bool MoleculeAtomNeighbourhoodCounters::testSubstructure(const MoleculeAtomNeigh
         return true;
     // End
 
+    // Each counter is one byte lane: a lane of the query exceeding the target's
+    // borrows out of its high bit, so all counters are compared in two subtractions
+    const qword high = 0x8080808080808080ULL;
+    const Signature& query_sig = _signatures[query_atom_idx];
+    const Signature& target_sig = target_counters._signatures[target_atom_idx];
+    qword q0 = query_sig.lanes[0], q1 = query_sig.lanes[1];
+
+    if (!use_bond_types)
+    {
+        q0 &= _no_degree_mask.lanes[0];
+        q1 &= _no_degree_mask.lanes[1];
+    }
+    if ((((target_sig.lanes[0] | high) - q0) & high) != high || (((target_sig.lanes[1] | high) - q1) & high) != high)
+        return false;
+    if (_signature_exact[query_atom_idx])
+        return true;
+
     const Counters& target_atom_counters = target_counters._per_atom_counters[target_atom_idx];
     const Counters& query_atom_counters = _per_atom_counters[query_atom_idx];
 
@@ -0,0 +1,66 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "molecule/molecule_prepared_target.h"
+#include "molecule/molecule_substructure_matcher.h"
+
+using namespace indigo;
+
+IMPL_ERROR(MoleculePreparedTarget, "prepared target");
+
+MoleculePreparedTarget::MoleculePreparedTarget(Molecule& target) : _target(target)
+{
+}
+
+bool MoleculePreparedTarget::_sameOptions(const AromaticityOptions& o1, const AromaticityOptions& o2)
+{
+    return o1.method == o2.method && o1.dearomatize_check == o2.dearomatize_check && o1.unique_dearomatization == o2.unique_dearomatization &&
+           o1.aromatize_skip_superatoms == o2.aromatize_skip_superatoms;
+}
+
+MoleculePreparedTarget::Variant& MoleculePreparedTarget::get(bool h_unfolded, const AromaticityOptions& arom_options)
+{
+    int i;
+
+    for (i = 0; i < _variants.size(); i++)
+    {
+        Variant& variant = *_variants[i];
+
+        if (variant.h_unfolded == h_unfolded && _sameOptions(variant.arom_options, arom_options))
+            return variant;
+    }
+
+    Variant& variant = _variants.add(new Variant());
+
+    variant.h_unfolded = h_unfolded;
+    variant.arom_options = arom_options;
+    variant.molecule.clone(_target, &variant.mapping, 0);
+    if (!_target.isAromatized())
+        variant.molecule.aromatize(arom_options);
+    variant.nei_counters.calculate(variant.molecule);
+    return variant;
+}
+
+void MoleculePreparedTarget::setupMatcher(MoleculeSubstructureMatcher& matcher, Variant& variant, const MoleculeAtomNeighbourhoodCounters* query_counters)
+{
+    if (query_counters != 0)
+        matcher.setNeiCounters(query_counters, &variant.nei_counters);
+    matcher.setTargetFeatures(&variant.features);
+    matcher.arom_options = variant.arom_options;
+    matcher.restore_unfolded_h = false;
+}
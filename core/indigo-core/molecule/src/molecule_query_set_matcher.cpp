@@ -0,0 +1,327 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "molecule/molecule_query_set_matcher.h"
+#include "molecule/elements.h"
+#include "molecule/molecule_prepared_target.h"
+#include "molecule/molecule_substructure_matcher.h"
+#include "molecule/query_molecule.h"
+
+using namespace indigo;
+
+//
+// MoleculeQueryPrefilter
+//
+
+MoleculeQueryPrefilter::MoleculeQueryPrefilter()
+{
+}
+
+int MoleculeQueryPrefilter::_atomKey(int number)
+{
+    return number;
+}
+
+int MoleculeQueryPrefilter::_bondKey(int number1, int number2)
+{
+    if (number1 > number2)
+        std::swap(number1, number2);
+    return ELEM_MAX + number1 * ELEM_MAX + number2;
+}
+
+int MoleculeQueryPrefilter::_keysCount()
+{
+    return ELEM_MAX + ELEM_MAX * ELEM_MAX;
+}
+
+static bool _isCountedElement(int number)
+{
+    // Hydrogens are skipped as they may be implicit in the target
+    return number > ELEM_H && number < ELEM_MAX;
+}
+
+void MoleculeQueryPrefilter::_collectRequirements(QueryMolecule& query, Array<int>& counts, Array<int>& keys)
+{
+    keys.clear();
+
+    // Atoms of the R-group fragments are not necessarily mapped
+    if (query.rgroups.getRGroupCount() > 0)
+        return;
+
+    for (int i = query.vertexBegin(); i != query.vertexEnd(); i = query.vertexNext(i))
+    {
+        int number = query.getAtomNumber(i);
+
+        if (!_isCountedElement(number))
+            continue;
+
+        int key = _atomKey(number);
+
+        if (counts[key]++ == 0)
+            keys.push(key);
+    }
+
+    for (int i = query.edgeBegin(); i != query.edgeEnd(); i = query.edgeNext(i))
+    {
+        const Edge& edge = query.getEdge(i);
+        int number1 = query.getAtomNumber(edge.beg);
+        int number2 = query.getAtomNumber(edge.end);
+
+        if (!_isCountedElement(number1) || !_isCountedElement(number2))
+            continue;
+
+        int key = _bondKey(number1, number2);
+
+        if (counts[key]++ == 0)
+            keys.push(key);
+    }
+}
+
+static int _compareKeys(int key1, int key2, void* context)
+{
+    const int* frequency = (const int*)context;
+
+    if (frequency[key1] != frequency[key2])
+        return frequency[key2] - frequency[key1];
+    return key1 - key2;
+}
+
+int MoleculeQueryPrefilter::_findChild(int node, int key, int count)
+{
+    int child;
+
+    for (child = _nodes[node].first_child; child != -1; child = _nodes[child].next_sibling)
+        if (_nodes[child].key == key && _nodes[child].count == count)
+            return child;
+
+    _Node& added = _nodes.push();
+
+    added.key = key;
+    added.count = count;
+    added.first_child = -1;
+    added.first_query = -1;
+    added.next_sibling = _nodes[node].first_child;
+    child = _nodes.size() - 1;
+    _nodes[node].first_child = child;
+    return child;
+}
+
+void MoleculeQueryPrefilter::build(const Array<QueryMolecule*>& queries)
+{
+    int i, j;
+    ObjArray<Array<int>> query_keys;
+    ObjArray<Array<int>> query_counts;
+    Array<int> counts;
+    Array<int> frequency;
+
+    counts.clear_resize(_keysCount());
+    counts.zerofill();
+    frequency.clear_resize(_keysCount());
+    frequency.zerofill();
+
+    for (i = 0; i < queries.size(); i++)
+    {
+        Array<int>& keys = query_keys.push();
+        Array<int>& key_counts = query_counts.push();
+
+        _collectRequirements(*queries[i], counts, keys);
+        for (j = 0; j < keys.size(); j++)
+        {
+            key_counts.push(counts[keys[j]]);
+            counts[keys[j]] = 0;
+            frequency[keys[j]]++;
+        }
+    }
+
+    // Requirements found in more queries go closer to the root
+    _nodes.clear();
+    _Node& root = _nodes.push();
+
+    root.key = -1;
+    root.count = 0;
+    root.first_child = -1;
+    root.next_sibling = -1;
+    root.first_query = -1;
+
+    _next_query.clear_resize(queries.size());
+
+    for (i = queries.size() - 1; i >= 0; i--)
+    {
+        Array<int>& keys = query_keys[i];
+        int node = 0;
+
+        for (j = 0; j < keys.size(); j++)
+            counts[keys[j]] = query_counts[i][j];
+
+        keys.qsort(_compareKeys, frequency.ptr());
+
+        for (j = 0; j < keys.size(); j++)
+        {
+            node = _findChild(node, keys[j], counts[keys[j]]);
+            counts[keys[j]] = 0;
+        }
+
+        _next_query[i] = _nodes[node].first_query;
+        _nodes[node].first_query = i;
+    }
+
+    _target_counts.clear_resize(_keysCount());
+    _target_counts.zerofill();
+}
+
+void MoleculeQueryPrefilter::filter(Molecule& target, Array<int>& ids_out)
+{
+    int i;
+
+    ids_out.clear();
+    _touched_keys.clear();
+
+    for (i = target.vertexBegin(); i != target.vertexEnd(); i = target.vertexNext(i))
+    {
+        int number = target.getAtomNumber(i);
+
+        if (!_isCountedElement(number))
+            continue;
+
+        int key = _atomKey(number);
+
+        if (_target_counts[key]++ == 0)
+            _touched_keys.push(key);
+    }
+
+    for (i = target.edgeBegin(); i != target.edgeEnd(); i = target.edgeNext(i))
+    {
+        const Edge& edge = target.getEdge(i);
+        int number1 = target.getAtomNumber(edge.beg);
+        int number2 = target.getAtomNumber(edge.end);
+
+        if (!_isCountedElement(number1) || !_isCountedElement(number2))
+            continue;
+
+        int key = _bondKey(number1, number2);
+
+        if (_target_counts[key]++ == 0)
+            _touched_keys.push(key);
+    }
+
+    // Walk the trie, descending only into the requirements the target meets
+    _stack.clear();
+    _stack.push(0);
+    while (_stack.size() > 0)
+    {
+        const _Node& node = _nodes[_stack.pop()];
+
+        for (i = node.first_query; i != -1; i = _next_query[i])
+            ids_out.push(i);
+
+        for (i = node.first_child; i != -1; i = _nodes[i].next_sibling)
+            if (_target_counts[_nodes[i].key] >= _nodes[i].count)
+                _stack.push(i);
+    }
+
+    for (i = 0; i < _touched_keys.size(); i++)
+        _target_counts[_touched_keys[i]] = 0;
+
+    ids_out.qsort(0, ids_out.size() - 1, [](int a, int b) { return a - b; });
+}
+
+//
+// MoleculeQuerySetMatcher
+//
+
+IMPL_ERROR(MoleculeQuerySetMatcher, "query set matcher");
+
+MoleculeQuerySetMatcher::MoleculeQuerySetMatcher()
+{
+    _built = false;
+}
+
+MoleculeQuerySetMatcher::~MoleculeQuerySetMatcher()
+{
+}
+
+int MoleculeQuerySetMatcher::addQuery(QueryMolecule& query)
+{
+    _queries.push(&query);
+    _built = false;
+    return _queries.size() - 1;
+}
+
+int MoleculeQuerySetMatcher::count() const
+{
+    return _queries.size();
+}
+
+void MoleculeQuerySetMatcher::clear()
+{
+    _queries.clear();
+    _query_counters.clear();
+    _candidates.clear();
+    _built = false;
+}
+
+int MoleculeQuerySetMatcher::lastCandidatesCount() const
+{
+    return _candidates.size();
+}
+
+void MoleculeQuerySetMatcher::_build()
+{
+    _query_counters.clear();
+    for (int i = 0; i < _queries.size(); i++)
+        _query_counters.push().calculate(*_queries[i]);
+
+    _prefilter.build(_queries);
+    _built = true;
+}
+
+void MoleculeQuerySetMatcher::match(Molecule& target, Array<int>& ids_out)
+{
+    ids_out.clear();
+    _candidates.clear();
+
+    if (!_built)
+        _build();
+
+    _prefilter.filter(target, _candidates);
+    if (_candidates.size() == 0)
+        return;
+
+    MoleculePreparedTarget prepared(target);
+
+    for (int i = 0; i < _candidates.size(); i++)
+    {
+        QueryMolecule& query = *_queries[_candidates[i]];
+        bool h_unfolded = MoleculeSubstructureMatcher::shouldUnfoldTargetHydrogens(query, false);
+        MoleculePreparedTarget::Variant& variant = prepared.get(h_unfolded, arom_options);
+
+        MoleculeSubstructureMatcher matcher(variant.molecule);
+        MoleculeSubstructureMatcher::FragmentMatchCache fmcache;
+
+        if (_ee.get() == 0)
+            _ee.create(variant.molecule);
+        matcher.setEmbeddingEnumerator(_ee.get());
+        matcher.setQuery(query);
+        matcher.fmcache = &fmcache;
+        matcher.find_unique_embeddings = false;
+        MoleculePreparedTarget::setupMatcher(matcher, variant, &_query_counters[_candidates[i]]);
+
+        if (matcher.find())
+            ids_out.push(_candidates[i]);
+    }
+}
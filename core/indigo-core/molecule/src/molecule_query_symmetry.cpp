@@ -0,0 +1,281 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "molecule/molecule_query_symmetry.h"
+#include "graph/embedding_enumerator.h"
+#include "molecule/query_molecule.h"
+#include <cstring>
+
+using namespace indigo;
+
+IMPL_ERROR(MoleculeQuerySymmetry, "molecule query symmetry");
+
+namespace
+{
+    bool _isOperation(int type)
+    {
+        return type == QueryMolecule::OP_NONE || type == QueryMolecule::OP_AND || type == QueryMolecule::OP_OR || type == QueryMolecule::OP_NOT;
+    }
+
+    bool _sameAtomConstraint(QueryMolecule::Atom* atom1, QueryMolecule::Atom* atom2)
+    {
+        if (atom1->type != atom2->type || atom1->children.size() != atom2->children.size())
+            return false;
+
+        // Operation nodes do not use the values
+        if (_isOperation(atom1->type))
+        {
+            for (int i = 0; i < atom1->children.size(); i++)
+                if (!_sameAtomConstraint(atom1->child(i), atom2->child(i)))
+                    return false;
+            return true;
+        }
+
+        if (atom1->value_min != atom2->value_min || atom1->value_max != atom2->value_max)
+            return false;
+
+        if (atom1->type == QueryMolecule::ATOM_PSEUDO || atom1->type == QueryMolecule::ATOM_TEMPLATE || atom1->type == QueryMolecule::ATOM_TEMPLATE_CLASS)
+            return atom1->alias.size() == atom2->alias.size() && strcmp(atom1->alias.ptr(), atom2->alias.ptr()) == 0;
+
+        if (atom1->type == QueryMolecule::ATOM_FRAGMENT)
+        {
+            // Recursive SMARTS are compared by their text only
+            if (atom1 == atom2)
+                return true;
+            const char* smarts1 = atom1->fragment->fragment_smarts.ptr();
+            const char* smarts2 = atom2->fragment->fragment_smarts.ptr();
+            return smarts1 != 0 && smarts2 != 0 && strlen(smarts1) > 0 && strcmp(smarts1, smarts2) == 0;
+        }
+
+        return true;
+    }
+
+    bool _sameBondConstraint(QueryMolecule::Bond* bond1, QueryMolecule::Bond* bond2)
+    {
+        if (bond1->type != bond2->type || bond1->children.size() != bond2->children.size())
+            return false;
+
+        if (!_isOperation(bond1->type) && bond1->value != bond2->value)
+            return false;
+
+        for (int i = 0; i < bond1->children.size(); i++)
+            if (!_sameBondConstraint(bond1->child(i), bond2->child(i)))
+                return false;
+        return true;
+    }
+} // namespace
+
+MoleculeQuerySymmetry::MoleculeQuerySymmetry()
+{
+    _ignored = 0;
+    _max_group_size = 0;
+    _overflow = false;
+    clear();
+}
+
+void MoleculeQuerySymmetry::clear()
+{
+    _group_size = 1;
+    _n_atoms = 0;
+    _less.clear();
+    _greater.clear();
+    _permutations.clear();
+}
+
+int MoleculeQuerySymmetry::groupSize() const
+{
+    return _group_size;
+}
+
+bool MoleculeQuerySymmetry::build(QueryMolecule& query, const int* ignored, int max_group_size)
+{
+    int i, j, k;
+
+    clear();
+
+    _n_atoms = query.vertexEnd();
+    _ignored = ignored;
+    _max_group_size = max_group_size;
+    _overflow = false;
+
+    if (query.vertexCount() == 0)
+        return true;
+
+    // Automorphisms of the query restricted to the atoms that are matched
+    EmbeddingEnumerator ee(query);
+
+    ee.cb_match_vertex = _matchAtoms;
+    ee.cb_match_edge = _matchBonds;
+    ee.cb_embedding = _matchEmbedding;
+    ee.userdata = this;
+
+    ee.setSubgraph(query);
+    for (i = query.vertexBegin(); i != query.vertexEnd(); i = query.vertexNext(i))
+    {
+        if (ignored[i])
+        {
+            ee.ignoreSubgraphVertex(i);
+            ee.ignoreSupergraphVertex(i);
+        }
+    }
+
+    ee.process();
+    _ignored = 0;
+
+    if (_overflow)
+    {
+        clear();
+        return false;
+    }
+
+    int group_size = _permutations.size() / _n_atoms;
+
+    for (i = 0; i < _n_atoms; i++)
+    {
+        _less.push();
+        _greater.push();
+    }
+
+    // Ordering conditions: pick an atom with a nontrivial orbit, make it the
+    // smallest one of its orbit, then go on with the stabilizer of this atom
+    int n_perms = group_size;
+
+    while (n_perms > 1)
+    {
+        int v = -1;
+
+        for (i = query.vertexBegin(); i != query.vertexEnd() && v == -1; i = query.vertexNext(i))
+            for (j = 0; j < n_perms; j++)
+                if (_permutations[j * _n_atoms + i] != i)
+                {
+                    v = i;
+                    break;
+                }
+
+        if (v == -1)
+            break;
+
+        for (j = 0; j < n_perms; j++)
+        {
+            int w = _permutations[j * _n_atoms + v];
+
+            if (w == v || _less[v].find(w) != -1)
+                continue;
+
+            _less[v].push(w);
+            _greater[w].push(v);
+        }
+
+        // Keep the permutations fixing v
+        int kept = 0;
+
+        for (j = 0; j < n_perms; j++)
+        {
+            if (_permutations[j * _n_atoms + v] != v)
+                continue;
+            if (kept != j)
+                for (k = 0; k < _n_atoms; k++)
+                    _permutations[kept * _n_atoms + k] = _permutations[j * _n_atoms + k];
+            kept++;
+        }
+        n_perms = kept;
+    }
+
+    _permutations.clear();
+    _group_size = group_size;
+    return true;
+}
+
+bool MoleculeQuerySymmetry::check(const int* core_sub, int query_atom, int target_atom) const
+{
+    if (query_atom >= _less.size())
+        return true;
+
+    const Array<int>& less = _less[query_atom];
+    const Array<int>& greater = _greater[query_atom];
+    int i;
+
+    for (i = 0; i < less.size(); i++)
+    {
+        int mapped = core_sub[less[i]];
+        if (mapped >= 0 && target_atom >= mapped)
+            return false;
+    }
+
+    for (i = 0; i < greater.size(); i++)
+    {
+        int mapped = core_sub[greater[i]];
+        if (mapped >= 0 && target_atom <= mapped)
+            return false;
+    }
+
+    return true;
+}
+
+bool MoleculeQuerySymmetry::_matchAtoms(Graph& subgraph, Graph& supergraph, const int* core_sub, int sub_idx, int super_idx, void* userdata)
+{
+    MoleculeQuerySymmetry* self = (MoleculeQuerySymmetry*)userdata;
+    QueryMolecule& query = (QueryMolecule&)subgraph;
+
+    if (subgraph.getVertex(sub_idx).degree() != subgraph.getVertex(super_idx).degree())
+        return false;
+
+    // Ignored hydrogens are folded into their neighbours
+    int ignored_nei1 = 0, ignored_nei2 = 0;
+    const Vertex& v1 = subgraph.getVertex(sub_idx);
+    const Vertex& v2 = subgraph.getVertex(super_idx);
+
+    for (int i = v1.neiBegin(); i != v1.neiEnd(); i = v1.neiNext(i))
+        if (self->_ignored[v1.neiVertex(i)])
+            ignored_nei1++;
+    for (int i = v2.neiBegin(); i != v2.neiEnd(); i = v2.neiNext(i))
+        if (self->_ignored[v2.neiVertex(i)])
+            ignored_nei2++;
+
+    if (ignored_nei1 != ignored_nei2)
+        return false;
+
+    return _sameAtomConstraint(&query.getAtom(sub_idx), &query.getAtom(super_idx));
+}
+
+bool MoleculeQuerySymmetry::_matchBonds(Graph& subgraph, Graph& supergraph, int sub_idx, int super_idx, void* userdata)
+{
+    QueryMolecule& query = (QueryMolecule&)subgraph;
+
+    return _sameBondConstraint(&query.getBond(sub_idx), &query.getBond(super_idx));
+}
+
+int MoleculeQuerySymmetry::_matchEmbedding(Graph& subgraph, Graph& supergraph, int* core_sub, int* core_super, void* userdata)
+{
+    MoleculeQuerySymmetry* self = (MoleculeQuerySymmetry*)userdata;
+    int n = self->_n_atoms;
+
+    if (self->_permutations.size() / n >= self->_max_group_size)
+    {
+        self->_overflow = true;
+        return 0;
+    }
+
+    int base = self->_permutations.size();
+
+    self->_permutations.resize(base + n);
+    for (int i = 0; i < n; i++)
+        self->_permutations[base + i] = core_sub[i] >= 0 ? core_sub[i] : i;
+
+    return 1;
+}
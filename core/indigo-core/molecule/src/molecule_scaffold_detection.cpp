@@ -33,7 +33,7 @@ MoleculeScaffoldDetection::MoleculeScaffoldDetection(ObjArray<Molecule>* mol_set
     cbVerticesColor = matchAtoms;
 }
 
-void MoleculeScaffoldDetection::_searchScaffold(QueryMolecule& scaffold, bool approximate)
+void MoleculeScaffoldDetection::_searchScaffold(QueryMolecule& scaffold, int mode)
 {
     QS_DEF(ObjArray<QueryMolecule>, temp_set);
     if (basketStructures == 0)
@@ -43,8 +43,10 @@ void MoleculeScaffoldDetection::_searchScaffold(QueryMolecule& scaffold, bool ap
     MoleculeBasket mol_basket;
     mol_basket.initBasket(searchStructures, basketStructures, GraphBasket::MAX_MOLECULES_NUMBER);
 
-    if (approximate)
+    if (mode == SEARCH_APPROXIMATE)
         _searchApproximateScaffold(mol_basket);
+    else if (mode == SEARCH_MCSPLIT)
+        _searchMcSplitScaffold(mol_basket);
     else
         _searchExactScaffold(mol_basket);
 
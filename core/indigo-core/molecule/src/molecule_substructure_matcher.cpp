@@ -60,6 +60,9 @@ IMPL_ERROR(MoleculeSubstructureMatcher, "molecule substructure matcher");
 
 CP_DEF(MoleculeSubstructureMatcher);
 
+// Queries with more symmetries than this are counted without symmetry breaking
+static const int MAX_QUERY_SYMMETRY_GROUP_SIZE = 1024;
+
 MoleculeSubstructureMatcher::MoleculeSubstructureMatcher(BaseMolecule& target)
     : _target(target), CP_INIT, TL_CP_GET(_3d_constrained_atoms), TL_CP_GET(_unfolded_target_h), TL_CP_GET(_used_target_h)
 {
@@ -90,6 +93,14 @@ MoleculeSubstructureMatcher::MoleculeSubstructureMatcher(BaseMolecule& target)
 
     _query_nei_counters = 0;
     _target_nei_counters = 0;
+    _target_features = 0;
+    _ee = 0;
+
+    _count_mode = false;
+    _count_limit = 0;
+    _count_weight = 1;
+    _embeddings_count = 0;
+    _use_symmetry = false;
 
     _used_target_h.clear_resize(target.vertexEnd());
 
@@ -252,10 +263,14 @@ void MoleculeSubstructureMatcher::setQuery(QueryMolecule& query)
     else
         _h_unfold = false;
 
-    if (_ee.get() != 0)
-        _ee.free();
+    if (_ee == 0)
+    {
+        _own_ee.create(_target);
+        _ee = _own_ee.get();
+    }
+    else
+        _ee->reset(_target);
 
-    _ee.create(_target);
     _ee->cb_match_vertex = _matchAtoms;
     _ee->cb_match_edge = _matchBonds;
     _ee->cb_vertex_remove = _removeAtom;
@@ -263,6 +278,16 @@ void MoleculeSubstructureMatcher::setQuery(QueryMolecule& query)
     _ee->cb_embedding = _embedding;
     _ee->userdata = this;
 
+    if (_markush.get() == 0)
+    {
+        if (_compiled_query.get() == 0)
+            _compiled_query.create();
+        _compiled_query->compile(*_query);
+        _compiled_query->setTarget(_target, _target_features);
+    }
+    else
+        _compiled_query.free();
+
     _ee->setSubgraph(*_query);
     for (i = _query->vertexBegin(); i != _query->vertexEnd(); i = _query->vertexNext(i))
     {
@@ -281,6 +306,11 @@ QueryMolecule& MoleculeSubstructureMatcher::getQuery()
     return *_query;
 }
 
+void MoleculeSubstructureMatcher::setEmbeddingEnumerator(EmbeddingEnumerator* ee)
+{
+    _ee = ee;
+}
+
 void MoleculeSubstructureMatcher::setNeiCounters(const MoleculeAtomNeighbourhoodCounters* query_counters,
                                                  const MoleculeAtomNeighbourhoodCounters* target_counters)
 {
@@ -288,6 +318,11 @@ void MoleculeSubstructureMatcher::setNeiCounters(const MoleculeAtomNeighbourhood
     _target_nei_counters = target_counters;
 }
 
+void MoleculeSubstructureMatcher::setTargetFeatures(MoleculeTargetFeatures* target_features)
+{
+    _target_features = target_features;
+}
+
 bool MoleculeSubstructureMatcher::find()
 {
     if (_query == 0)
@@ -305,6 +340,9 @@ bool MoleculeSubstructureMatcher::find()
         _ee->validate();
     }
 
+    if (_compiled_query.get() != 0)
+        _compiled_query->setTarget(_target, _target_features);
+
     if (_canUseEquivalenceHeuristic(*_query))
         _ee->setEquivalenceHandler(vertex_equivalence_handler);
     else
@@ -340,6 +378,96 @@ bool MoleculeSubstructureMatcher::find()
     }
 }
 
+int MoleculeSubstructureMatcher::countEmbeddings(int limit)
+{
+    if (_query == 0)
+        throw Error("no query");
+
+    _use_symmetry = false;
+    _count_weight = 1;
+
+    if (_canUseQuerySymmetry())
+    {
+        QS_DEF(Array<int>, ignored);
+        const int* mapping = _ee->getSubgraphMapping();
+
+        ignored.clear_resize(_query->vertexEnd());
+        ignored.zerofill();
+        for (int i = _query->vertexBegin(); i != _query->vertexEnd(); i = _query->vertexNext(i))
+            if (mapping[i] == EmbeddingEnumerator::IGNORE)
+                ignored[i] = 1;
+
+        if (_symmetry.build(*_query, ignored.ptr(), MAX_QUERY_SYMMETRY_GROUP_SIZE) && _symmetry.groupSize() > 1)
+        {
+            _use_symmetry = true;
+            // Atom (or bond) sets are the same for all embeddings of a symmetry class
+            if (!find_unique_embeddings)
+                _count_weight = _symmetry.groupSize();
+        }
+    }
+
+    bool saved_find_all = find_all_embeddings;
+    bool saved_save_for_iteration = save_for_iteration;
+
+    find_all_embeddings = true;
+    save_for_iteration = false;
+    _count_mode = true;
+    _count_limit = limit;
+    _embeddings_count = 0;
+
+    try
+    {
+        find();
+    }
+    catch (...)
+    {
+        find_all_embeddings = saved_find_all;
+        save_for_iteration = saved_save_for_iteration;
+        _count_mode = false;
+        _use_symmetry = false;
+        throw;
+    }
+
+    find_all_embeddings = saved_find_all;
+    save_for_iteration = saved_save_for_iteration;
+    _count_mode = false;
+    _use_symmetry = false;
+    _symmetry.clear();
+
+    if (limit > 0 && _embeddings_count > limit)
+        return limit;
+    return _embeddings_count;
+}
+
+bool MoleculeSubstructureMatcher::_canUseQuerySymmetry()
+{
+    QueryMolecule& query = *_query;
+
+    if (_markush.get() != 0 || match_3d != 0 || not_ignore_first_atom || vertex_equivalence_handler != 0)
+        return false;
+
+    if (query.stereocenters.size() > 0 || query.cis_trans.count() > 0 || query.allene_stereo.size() > 0)
+        return false;
+
+    if (query.fixed_atoms.size() > 0 || query.spatial_constraints.haveConstraints())
+        return false;
+
+    for (int i = 0; i < query.components.size(); i++)
+        if (query.components[i] > 0)
+            return false;
+
+    const int* mapping = _ee->getSubgraphMapping();
+
+    for (int i = query.vertexBegin(); i != query.vertexEnd(); i = query.vertexNext(i))
+    {
+        // Fixed atoms break the symmetry and R-sites are handled by the Markush matching
+        if (mapping[i] >= 0 || query.isRSite(i))
+            return false;
+    }
+
+    return true;
+}
+
 void MoleculeSubstructureMatcher::_createEmbeddingsStorage()
 {
     _embeddings_storage.create();
@@ -367,6 +495,9 @@ bool MoleculeSubstructureMatcher::findNext()
     if (_h_unfold)
         _target.asMolecule().unfoldHydrogens(&_unfolded_target_h, -1, true);
 
+    if (_compiled_query.get() != 0)
+        _compiled_query->setTarget(_target, _target_features);
+
     bool found = _ee->processNext();
 
     if (_h_unfold && restore_unfolded_h)
@@ -564,6 +695,12 @@ bool MoleculeSubstructureMatcher::_matchAtoms(Graph& subgraph, Graph& supergraph
 {
     MoleculeSubstructureMatcher* self = (MoleculeSubstructureMatcher*)userdata;
 
+    if (self->_use_symmetry && (&subgraph == (Graph*)self->_query))
+    {
+        if (!self->_symmetry.check(core_sub, sub_idx, super_idx))
+            return false;
+    }
+
     if (self->_h_unfold && (&subgraph == (Graph*)self->_query))
     {
         if (sub_idx < self->_3d_constrained_atoms.size() && self->_3d_constrained_atoms[sub_idx])
@@ -584,6 +721,13 @@ bool MoleculeSubstructureMatcher::_matchAtoms(Graph& subgraph, Graph& supergraph
     QueryMolecule& query = (QueryMolecule&)subgraph;
     BaseMolecule& target = (BaseMolecule&)supergraph;
 
+    // Compiled constraints are cheap and reject most of the pairs, so check them first
+    if (self->_compiled_query.get() != 0)
+    {
+        if (!self->_compiled_query->matchAtom(sub_idx, super_idx, self->fmcache, match_atoms_flags))
+            return false;
+    }
+
     if (!target.isPseudoAtom(super_idx) && !target.isRSite(super_idx) && !target.isTemplateAtom(super_idx))
     {
         int q_min_h;
@@ -631,10 +775,13 @@ bool MoleculeSubstructureMatcher::_matchAtoms(Graph& subgraph, Graph& supergraph
         }
     }
 
-    QueryMolecule::Atom& sub_atom = query.getAtom(sub_idx);
+    if (self->_compiled_query.get() == 0)
+    {
+        QueryMolecule::Atom& sub_atom = query.getAtom(sub_idx);
 
-    if (!matchQueryAtom(&sub_atom, target, super_idx, self->fmcache, match_atoms_flags))
-        return false;
+        if (!matchQueryAtom(&sub_atom, target, super_idx, self->fmcache, match_atoms_flags))
+            return false;
+    }
 
     if (query.stereocenters.getType(sub_idx) > target.stereocenters.getType(super_idx))
         return false;
@@ -686,6 +833,9 @@ bool MoleculeSubstructureMatcher::_matchBonds(Graph& subgraph, Graph& supergraph
             flags &= ~MATCH_BOND_TYPE;
     }
 
+    if (self->_compiled_query.get() != 0)
+        return self->_compiled_query->matchBond(sub_idx, super_idx, self->_am.get(), flags);
+
     QueryMolecule& query = (QueryMolecule&)subgraph;
     BaseMolecule& target = (BaseMolecule&)supergraph;
     QueryMolecule::Bond& sub_bond = query.getBond(sub_idx);
@@ -827,6 +977,12 @@ int MoleculeSubstructureMatcher::_embedding_common(int* core_sub, int* core_supe
     if (highlight)
         _target.highlightSubmolecule(query, core_sub, true);
 
+    if (_count_mode)
+    {
+        _embeddings_count += _count_weight;
+        return (_count_limit > 0 && _embeddings_count >= _count_limit) ? 0 : 1;
+    }
+
     if (cb_embedding != 0)
         if (!cb_embedding(query, _target, core_sub, core_super, cb_embedding_context))
             return 0;
@@ -0,0 +1,136 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "molecule/multiple_ket_loader.h"
+
+#include <memory>
+#include <rapidjson/error/en.h>
+#include <rapidjson/reader.h>
+#include <string.h>
+
+#include "base_cpp/scanner.h"
+#include "molecule/ket_scanner_stream.h"
+
+using namespace indigo;
+using namespace rapidjson;
+
+IMPL_ERROR(MultipleKetLoader, "multiple KET loader");
+
+CP_DEF(MultipleKetLoader);
+
+namespace
+{
+    // Builds nothing, only notes whether a node has "type": "arrow"
+    class ArrowFinder : public BaseReaderHandler<UTF8<>, ArrowFinder>
+    {
+    public:
+        ArrowFinder() : arrow(false), _type_key(false)
+        {
+        }
+
+        bool Default()
+        {
+            _type_key = false;
+            return true;
+        }
+
+        bool Key(const char* str, SizeType length, bool)
+        {
+            _type_key = length == 4 && strncmp(str, "type", 4) == 0;
+            return true;
+        }
+
+        bool String(const char* str, SizeType length, bool)
+        {
+            if (_type_key && length == 5 && strncmp(str, "arrow", 5) == 0)
+                arrow = true;
+            _type_key = false;
+            return true;
+        }
+
+        bool arrow;
+
+    private:
+        bool _type_key;
+    };
+} // namespace
+
+MultipleKetLoader::MultipleKetLoader(Scanner& scanner) : CP_INIT, TL_CP_GET(data), _scanner(scanner)
+{
+    data.clear();
+    _current_number = 0;
+    _reaction = false;
+}
+
+bool MultipleKetLoader::isEOF()
+{
+    _scanner.skipSpace();
+    return _scanner.isEOF();
+}
+
+void MultipleKetLoader::readNext()
+{
+    if (isEOF())
+        throw Error("end of stream");
+
+    long long beg = _scanner.tell();
+    std::unique_ptr<KetScannerStream> stream = std::make_unique<KetScannerStream>(_scanner);
+    Reader reader;
+    ArrowFinder finder;
+
+    if (!reader.Parse<kParseStopWhenDoneFlag>(*stream, finder))
+        throw Error("%s at offset %lld", GetParseError_En(reader.GetParseErrorCode()), beg + (long long)reader.GetErrorOffset());
+
+    long long size = (long long)stream->Tell();
+
+    if (size > 0x7FFFFFFF)
+        throw Error("document at offset %lld is too large", beg);
+
+    _scanner.seek(beg, SEEK_SET);
+    _scanner.read((int)size, data);
+    _reaction = finder.arrow;
+    _current_number++;
+}
+
+long long MultipleKetLoader::tell()
+{
+    return _scanner.tell();
+}
+
+int MultipleKetLoader::currentNumber()
+{
+    return _current_number;
+}
+
+bool MultipleKetLoader::isReaction()
+{
+    return _reaction;
+}
+
+bool MultipleKetLoader::parse(Scanner& scanner, Document& document)
+{
+    std::unique_ptr<KetScannerStream> stream = std::make_unique<KetScannerStream>(scanner);
+
+    // Without kParseStopWhenDone the reader fails on anything but whitespace after the root value
+    document.ParseStream(*stream);
+    if (document.HasParseError())
+        return false;
+
+    stream->finish();
+    return true;
+}
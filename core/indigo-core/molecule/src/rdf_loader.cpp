@@ -18,6 +18,7 @@
 
 #include "molecule/rdf_loader.h"
 #include "base_cpp/output.h"
+#include "base_cpp/record_index.h"
 #include "base_cpp/scanner.h"
 #include "gzip/gzip_scanner.h"
 
@@ -309,6 +310,39 @@ int RdfLoader::currentNumber()
     return _current_number;
 }
 
+void RdfLoader::loadIndex(const RecordIndex& index)
+{
+    _offsets.copy(index.offsets);
+    _max_offset = index.end_offset;
+
+    // _scanner is a GZipScanner if we own it
+    if (_ownScanner && index.access_points.size() > 0)
+    {
+        BufferScanner access_points(index.access_points);
+        static_cast<GZipScanner*>(_scanner)->loadAccessPoints(access_points);
+    }
+}
+
+void RdfLoader::buildIndex(RecordIndex& index)
+{
+    count();
+    index.offsets.copy(_offsets);
+    index.end_offset = _max_offset;
+    index.access_points.clear();
+
+    if (_ownScanner)
+    {
+        ArrayOutput access_points(index.access_points);
+        static_cast<GZipScanner*>(_scanner)->saveAccessPoints(access_points);
+    }
+}
+
+void RdfLoader::setThreads(int threads)
+{
+    if (_ownScanner)
+        static_cast<GZipScanner*>(_scanner)->setThreads(threads);
+}
+
 void RdfLoader::readAt(int index)
 {
     if (index < _offsets.size())
@@ -18,6 +18,7 @@
 
 #include "molecule/sdf_loader.h"
 #include "base_cpp/output.h"
+#include "base_cpp/record_index.h"
 #include "base_cpp/scanner.h"
 #include "gzip/gzip_scanner.h"
 
@@ -27,7 +28,7 @@ IMPL_ERROR(SdfLoader, "SDF loader");
 
 CP_DEF(SdfLoader);
 
-SdfLoader::SdfLoader(Scanner& scanner) : CP_INIT, TL_CP_GET(data), TL_CP_GET(properties), TL_CP_GET(_offsets), TL_CP_GET(_preread)
+SdfLoader::SdfLoader(Scanner& scanner) : CP_INIT, TL_CP_GET(data), TL_CP_GET(properties), TL_CP_GET(_offsets), TL_CP_GET(_preread), TL_CP_GET(_line)
 {
     data.clear();
     properties.clear();
@@ -113,13 +114,25 @@ bool SdfLoader::isEOF()
     return true;
 }
 
+void SdfLoader::_readLine(const char*& line, int& length)
+{
+    // Scanners holding the input in memory give the line without a copy
+    if (_scanner->readLineView(line, length))
+        return;
+
+    _scanner->readLine(_line, false);
+    line = _line.ptr();
+    length = _line.size();
+}
+
 void SdfLoader::readNext()
 {
     ArrayOutput output(data);
     output.writeArray(_preread);
     int n_preread = _preread.size();
     _preread.clear();
-    QS_DEF(Array<char>, str);
+    const char* line = "";
+    int length = 0;
 
     if (_scanner->isEOF())
         throw Error("end of stream");
@@ -131,24 +144,25 @@ void SdfLoader::readNext()
 
     bool pending_emptyline = false;
 
-    long long last_offset = -1LL;
     while (!_scanner->isEOF())
     {
-        last_offset = _scanner->tell();
-        _scanner->readLine(str, true);
-        if (str.size() > 0 && str[0] == '>')
+        _readLine(line, length);
+        if (length > 0 && line[0] == '>')
             break;
-        if (str.size() > 3 && strncmp(str.ptr(), "$$$$", 4) == 0)
+        if (length > 3 && strncmp(line, "$$$$", 4) == 0)
             break;
         if (pending_emptyline)
             output.printf("\n");
-        if (str.size() <= 1)
+        if (length == 0)
             pending_emptyline = true;
         else
             pending_emptyline = false;
 
         if (!pending_emptyline)
-            output.writeStringCR(str.ptr());
+        {
+            output.write(line, length);
+            output.writeCR();
+        }
 
         if (data.size() > MAX_DATA_SIZE)
             throw Error("data size exceeded the acceptable size %d bytes, Please check for correct file format", MAX_DATA_SIZE);
@@ -156,73 +170,99 @@ void SdfLoader::readNext()
 
     while (1)
     {
-        if (strncmp(str.ptr(), "$$$$", 4) == 0)
+        if (length > 3 && strncmp(line, "$$$$", 4) == 0)
             break;
 
-        output.writeStringCR(str.ptr());
-
-        BufferScanner ws(str.ptr());
-
-        while (!ws.isEOF())
-            if (ws.readChar() == '<')
-                break;
+        output.write(line, length);
+        output.writeCR();
 
-        QS_DEF(Array<char>, word);
-        bool have_word = false;
+        // Property name is the text between '<' and '>' in the header line
+        const char* name_begin = (const char*)memchr(line, '<', length);
+        const char* name_end = 0;
 
-        word.clear();
-
-        while (!ws.isEOF())
+        if (name_begin != 0)
         {
-            char c = ws.readChar();
-
-            if (c == '>')
-            {
-                have_word = true;
-                break;
-            }
-            word.push(c);
+            name_begin++;
+            name_end = (const char*)memchr(name_begin, '>', line + length - name_begin);
         }
 
-        if (have_word && word.size() > 0)
+        if (name_end != 0 && name_end > name_begin)
         {
+            QS_DEF(Array<char>, word);
+
+            word.copy(name_begin, (int)(name_end - name_begin));
             word.push(0);
 
-            _scanner->readLine(str, true);
+            _readLine(line, length);
             auto& propBuf = properties.insert(word.ptr());
-            //         auto& propBuf = properties.valueBuf(word.ptr());
-            //         int idx = properties.findOrInsert(word.ptr());
-            propBuf.copy(str);
-            output.writeStringCR(str.ptr());
-            if (str.size() > 1)
+            propBuf.copy(line, length);
+            propBuf.push(0);
+            output.write(line, length);
+            output.writeCR();
+            if (length > 0)
             {
                 do
                 {
                     if (_scanner->isEOF())
                         break;
 
-                    _scanner->readLine(str, true);
-                    output.writeStringCR(str.ptr());
-                    if (str.size() > 1)
+                    _readLine(line, length);
+                    output.write(line, length);
+                    output.writeCR();
+                    if (length > 0)
                     {
                         propBuf.pop(); // Remove string end marker (0)
                         propBuf.push('\n');
-                        propBuf.appendString(str.ptr(), true);
+                        propBuf.concat(line, length);
+                        propBuf.push(0);
                     }
-                } while (str.size() > 1);
+                } while (length > 0);
             }
         }
 
         if (_scanner->isEOF())
             break;
 
-        _scanner->readLine(str, true);
+        _readLine(line, length);
     }
 
     if (_scanner->tell() > _max_offset)
         _max_offset = _scanner->tell();
 }
 
+void SdfLoader::loadIndex(const RecordIndex& index)
+{
+    _offsets.copy(index.offsets);
+    _max_offset = index.end_offset;
+
+    // _scanner is a GZipScanner if we own it
+    if (_own_scanner && index.access_points.size() > 0)
+    {
+        BufferScanner access_points(index.access_points);
+        static_cast<GZipScanner*>(_scanner)->loadAccessPoints(access_points);
+    }
+}
+
+void SdfLoader::buildIndex(RecordIndex& index)
+{
+    count();
+    index.offsets.copy(_offsets);
+    index.end_offset = _max_offset;
+    index.access_points.clear();
+
+    if (_own_scanner)
+    {
+        ArrayOutput access_points(index.access_points);
+        static_cast<GZipScanner*>(_scanner)->saveAccessPoints(access_points);
+    }
+}
+
+void SdfLoader::setThreads(int threads)
+{
+    if (_own_scanner)
+        static_cast<GZipScanner*>(_scanner)->setThreads(threads);
+}
+
 void SdfLoader::readAt(int index)
 {
     if (index < _offsets.size())
@@ -59,7 +59,9 @@ void SmilesLoader::loadMolecule(Molecule& mol)
     _bmol = &mol;
     _mol = &mol;
     _qmol = 0;
-    _loadMolecule();
+
+    if (smarts_mode || inside_rsmiles || ignorable_aam != 0 || !_loadPlainMolecule())
+        _loadMolecule();
 
     mol.setIgnoreBadValenceFlag(ignore_bad_valence);
 }
@@ -73,6 +75,403 @@ void SmilesLoader::loadQueryMolecule(QueryMolecule& mol)
     _loadMolecule();
 }
 
+// Reads a ring bond number of the plain fast path: a digit or '%' with two
+// digits. Returns -1 on anything else, including 0 that the full parser rejects.
+static int _readPlainCycleNumber(const char* str, int length, int& pos)
+{
+    int number;
+
+    if (str[pos] == '%')
+    {
+        if (pos + 2 >= length || !isdigit(str[pos + 1]) || !isdigit(str[pos + 2]))
+            return -1;
+        number = (str[pos + 1] - '0') * 10 + (str[pos + 2] - '0');
+        pos += 3;
+    }
+    else
+        number = str[pos++] - '0';
+
+    return number > 0 ? number : -1;
+}
+
+bool SmilesLoader::_loadPlainMolecule()
+{
+    QS_DEF(Array<char>, smiles);
+    QS_DEF(Array<_PlainAtom>, atoms);
+    QS_DEF(Array<int>, dirs);
+    int cycles[100];
+    long long start = _scanner.tell();
+    int i;
+
+    smiles.clear();
+    while (!_scanner.isEOF())
+    {
+        int next = _scanner.lookNext();
+
+        if (isspace(next) || next == '|')
+            break;
+        smiles.push(_scanner.readChar());
+    }
+
+    _atom_stack.clear();
+    atoms.clear();
+    for (size_t k = 0; k < NELEM(cycles); k++)
+        cycles[k] = -1;
+
+    const char* str = smiles.ptr();
+    int length = smiles.size();
+    int pos = 0;
+    int balance = 0;
+    int open_cycles = 0;
+    bool first_atom = true;
+    bool plain = true;
+    bool aromatic_candidates = false;
+
+    while (pos < length)
+    {
+        char next = str[pos];
+        int order = -1;
+
+        if (!first_atom && (isdigit(next) || next == '%'))
+        {
+            int number = _readPlainCycleNumber(str, length, pos);
+
+            if (number < 0)
+            {
+                plain = false;
+                break;
+            }
+
+            int cur = _atom_stack.top();
+
+            if (cycles[number] < 0)
+            {
+                cycles[number] = cur;
+                open_cycles++;
+                continue;
+            }
+
+            // closing bond goes from the current atom, like in the full parser
+            int beg = cycles[number];
+            if (beg == cur || _mol->findEdgeIndex(cur, beg) != -1)
+            {
+                plain = false;
+                break;
+            }
+            _mol->addBond_Silent(cur, beg, -1);
+            aromatic_candidates |= atoms[cur].aromatic && atoms[beg].aromatic;
+            cycles[number] = -1;
+            open_cycles--;
+            continue;
+        }
+
+        if (next == '.')
+        {
+            pos++;
+            if (_atom_stack.size() > 0)
+                _atom_stack.pop();
+            first_atom = true;
+            continue;
+        }
+
+        if (next == '(')
+        {
+            if (_atom_stack.size() < 1)
+            {
+                plain = false;
+                break;
+            }
+            pos++;
+            _atom_stack.push(_atom_stack.top());
+            balance++;
+            continue;
+        }
+
+        if (next == ')')
+        {
+            if (balance <= 0)
+            {
+                plain = false;
+                break;
+            }
+            pos++;
+            balance--;
+            _atom_stack.pop();
+            continue;
+        }
+
+        if (!first_atom)
+        {
+            if (next == '-')
+                order = BOND_SINGLE;
+            else if (next == '=')
+                order = BOND_DOUBLE;
+            else if (next == '#')
+                order = BOND_TRIPLE;
+            else if (next == ':')
+                order = BOND_AROMATIC;
+
+            if (order != -1)
+            {
+                // a trailing bond is left to the full parser to report
+                if (pos + 1 == length)
+                {
+                    plain = false;
+                    break;
+                }
+                next = str[++pos];
+
+                // Only ring bonds written at the closing digit are taken here.
+                // A bond written at the opening one is moved around by the
+                // full parser.
+                if (isdigit(next) || next == '%')
+                {
+                    int number = _readPlainCycleNumber(str, length, pos);
+
+                    if (number < 0)
+                    {
+                        plain = false;
+                        break;
+                    }
+
+                    int cur = _atom_stack.top();
+                    int beg = cycles[number];
+
+                    if (beg < 0 || beg == cur || _mol->findEdgeIndex(cur, beg) != -1)
+                    {
+                        plain = false;
+                        break;
+                    }
+                    _mol->addBond_Silent(cur, beg, order);
+                    cycles[number] = -1;
+                    open_cycles--;
+                    continue;
+                }
+            }
+        }
+
+        int label, charge, isotope;
+        _PlainAtom& atom = atoms.push();
+
+        if (!_readPlainAtom(str, length, pos, label, atom, charge, isotope))
+        {
+            plain = false;
+            break;
+        }
+
+        int idx = _mol->addAtom(label);
+        _mol->setAtomCharge(idx, charge);
+        _mol->setAtomIsotope(idx, isotope);
+
+        if (!first_atom)
+        {
+            int beg = _atom_stack.pop();
+            _mol->addBond_Silent(beg, idx, order);
+            aromatic_candidates |= order == -1 && atoms[beg].aromatic && atom.aromatic;
+        }
+        _atom_stack.push(idx);
+        first_atom = false;
+    }
+
+    if (!plain || open_cycles > 0)
+    {
+        _mol->clear();
+        _scanner.seek(start, SEEK_SET);
+        return false;
+    }
+
+    _scanner.skipSpace();
+    if (_scanner.lookNext() == '|')
+    {
+        // CXSMILES extensions are left to the full parser
+        _mol->clear();
+        _scanner.seek(start, SEEK_SET);
+        return false;
+    }
+
+    // Same as _markAromaticBonds() and _setRadicalsAndHCounts() do, with the
+    // bond orders read from the molecule, where -1 stands for an empty bond
+    if (aromatic_candidates)
+    {
+        _markAromaticCycles(
+            *_mol, [&](int v) { return atoms[v].aromatic; }, [&](int e) { return _mol->getBondOrder(e); }, [](int) { return true; },
+            [&](int e) { _mol->setBondOrder_Silent(e, BOND_AROMATIC); });
+    }
+
+    for (i = _mol->edgeBegin(); i != _mol->edgeEnd(); i = _mol->edgeNext(i))
+        if (_mol->getBondOrder(i) == -1)
+            _mol->setBondOrder_Silent(i, BOND_SINGLE);
+
+    for (i = 0; i < atoms.size(); i++)
+        _setRadicalAndHCount(i, _mol->getAtomNumber(i), atoms[i].brackets, atoms[i].aromatic, atoms[i].hydrogens);
+
+    dirs.clear_resize(_mol->edgeEnd());
+    dirs.zerofill();
+    _mol->buildFromSmilesCisTrans(dirs.ptr());
+
+    if (!_scanner.isEOF())
+        _scanner.readLine(_mol->name, true);
+
+    _mol->reaction_atom_mapping.clear_resize(_mol->vertexCount() + 1);
+    _mol->reaction_atom_mapping.zerofill();
+    _mol->reaction_atom_inversion.clear_resize(_mol->vertexCount() + 1);
+    _mol->reaction_atom_inversion.zerofill();
+    _mol->reaction_atom_exact_change.clear_resize(_mol->vertexCount() + 1);
+    _mol->reaction_atom_exact_change.zerofill();
+    _mol->reaction_bond_reacting_center.clear_resize(_mol->edgeCount() + 1);
+    _mol->reaction_bond_reacting_center.zerofill();
+    return true;
+}
+
+bool SmilesLoader::_readPlainAtom(const char* str, int length, int& pos, int& label, _PlainAtom& atom, int& charge, int& isotope)
+{
+    atom.hydrogens = -1;
+    atom.aromatic = false;
+    atom.brackets = false;
+    charge = 0;
+    isotope = 0;
+
+    char next = str[pos++];
+
+    if (next != '[')
+    {
+        switch (next)
+        {
+        case 'B':
+            label = ELEM_B;
+            if (pos < length && str[pos] == 'r')
+            {
+                label = ELEM_Br;
+                pos++;
+            }
+            return true;
+        case 'C':
+            label = ELEM_C;
+            if (pos < length && str[pos] == 'l')
+            {
+                label = ELEM_Cl;
+                pos++;
+            }
+            return true;
+        case 'N':
+            label = ELEM_N;
+            return true;
+        case 'O':
+            label = ELEM_O;
+            return true;
+        case 'P':
+            label = ELEM_P;
+            return true;
+        case 'S':
+            label = ELEM_S;
+            return true;
+        case 'F':
+            label = ELEM_F;
+            return true;
+        case 'I':
+            label = ELEM_I;
+            return true;
+        case 'b':
+            label = ELEM_B;
+            break;
+        case 'c':
+            label = ELEM_C;
+            break;
+        case 'n':
+            label = ELEM_N;
+            break;
+        case 'o':
+            label = ELEM_O;
+            break;
+        case 'p':
+            label = ELEM_P;
+            break;
+        case 's':
+            label = ELEM_S;
+            break;
+        default:
+            return false;
+        }
+        atom.aromatic = true;
+        return true;
+    }
+
+    atom.brackets = true;
+
+    while (pos < length && isdigit(str[pos]))
+        isotope = isotope * 10 + (str[pos++] - '0');
+
+    if (pos >= length)
+        return false;
+
+    next = str[pos++];
+
+    if (strchr("bcnops", next) != NULL)
+    {
+        // [se] and [si] are left to the full parser
+        if (next == 's' && pos < length && (str[pos] == 'e' || str[pos] == 'i'))
+            return false;
+        label = next == 's' ? ELEM_S : Element::fromChar(toupper(next));
+        atom.aromatic = true;
+    }
+    // H, A, D, R and X have special meanings within brackets
+    else if (isupper(next) && strchr("HADRX", next) == NULL)
+    {
+        int two = -1;
+
+        if (pos < length && islower(str[pos]))
+            two = Element::fromTwoChars2(next, str[pos]);
+
+        if (two > 0 && two != ELEM_Cn)
+        {
+            label = two;
+            pos++;
+        }
+        else if (strchr("BCNOPSFIKUVWY", next) != NULL)
+            label = Element::fromChar(next);
+        else
+            return false;
+    }
+    else
+        return false;
+
+    if (pos < length && str[pos] == 'H')
+    {
+        pos++;
+        if (pos < length && strchr("esfog", str[pos]) != NULL)
+            return false;
+        atom.hydrogens = 0;
+        if (pos < length && isdigit(str[pos]))
+            while (pos < length && isdigit(str[pos]))
+                atom.hydrogens = atom.hydrogens * 10 + (str[pos++] - '0');
+        else
+            atom.hydrogens = 1;
+    }
+
+    if (pos < length && (str[pos] == '+' || str[pos] == '-'))
+    {
+        char sign = str[pos++];
+
+        charge = 1;
+        if (pos < length && isdigit(str[pos]))
+        {
+            charge = 0;
+            while (pos < length && isdigit(str[pos]))
+                charge = charge * 10 + (str[pos++] - '0');
+        }
+        else
+            while (pos < length && str[pos] == sign)
+            {
+                charge++;
+                pos++;
+            }
+        if (sign == '-')
+            charge = -charge;
+    }
+
+    return pos < length && str[pos++] == ']';
+}
+
 void SmilesLoader::_calcStereocenters()
 {
     int i, j;
@@ -1659,12 +2058,14 @@ void SmilesLoader::_loadParsedMolecule()
         _handlePolymerRepetition(i);
 }
 
-void SmilesLoader::_markAromaticBonds()
+template <typename AtomAromatic, typename BondType, typename AllowsAromatic, typename SetAromatic>
+void SmilesLoader::_markAromaticCycles(BaseMolecule& mol, AtomAromatic atom_aromatic, BondType bond_type, AllowsAromatic allows_aromatic,
+                                       SetAromatic set_aromatic)
 {
     CycleBasis basis;
     int i;
 
-    basis.create(*_bmol);
+    basis.create(mol);
 
     // Mark all 'empty' bonds in "aromatic" rings as aromatic.
     // We use SSSR here because we do not want "empty" bonds to
@@ -1678,15 +2079,16 @@ void SmilesLoader::_markAromaticBonds()
         for (j = 0; j < cycle.size(); j++)
         {
             int idx = cycle[j];
-            const Edge& edge = _bmol->getEdge(idx);
+            const Edge& edge = mol.getEdge(idx);
+            int type = bond_type(idx);
 
-            if (!_atoms[edge.beg].aromatic || !_atoms[edge.end].aromatic)
+            if (!atom_aromatic(edge.beg) || !atom_aromatic(edge.end))
                 break;
-            if (_bonds[idx].type == BOND_SINGLE || _bonds[idx].type == BOND_DOUBLE || _bonds[idx].type == BOND_TRIPLE)
+            if (type == BOND_SINGLE || type == BOND_DOUBLE || type == BOND_TRIPLE)
                 break;
-            if (_qmol != 0 && !_qmol->possibleBondOrder(_bonds[idx].index, BOND_AROMATIC))
+            if (!allows_aromatic(idx))
                 break;
-            if (_bonds[idx].type == -1)
+            if (type == -1)
                 needs_modification = true;
         }
 
@@ -1696,19 +2098,8 @@ void SmilesLoader::_markAromaticBonds()
         if (needs_modification)
         {
             for (j = 0; j < cycle.size(); j++)
-            {
-                int idx = cycle[j];
-                if (_bonds[idx].type == -1)
-                {
-                    _bonds[idx].type = BOND_AROMATIC;
-                    int bond_index = _bonds[idx].index;
-                    if (_mol != 0)
-                        _mol->setBondOrder_Silent(bond_index, BOND_AROMATIC);
-                    if (_qmol != 0)
-                        _qmol->resetBond(bond_index, QueryMolecule::Bond::und(_qmol->releaseBond(bond_index),
-                                                                              new QueryMolecule::Bond(QueryMolecule::BOND_ORDER, BOND_AROMATIC)));
-                }
-            }
+                if (bond_type(cycle[j]) == -1)
+                    set_aromatic(cycle[j]);
         }
     }
 
@@ -1721,18 +2112,19 @@ void SmilesLoader::_markAromaticBonds()
         for (j = 0; j < cycle.size(); j++)
         {
             int idx = cycle[j];
-            const Edge& edge = _bmol->getEdge(idx);
+            const Edge& edge = mol.getEdge(idx);
+            int type = bond_type(idx);
 
-            if (!_atoms[edge.beg].aromatic || !_atoms[edge.end].aromatic)
+            if (!atom_aromatic(edge.beg) || !atom_aromatic(edge.end))
             {
                 needs_modification = false;
                 break;
             }
-            if (_bonds[idx].type == BOND_SINGLE || _bonds[idx].type == BOND_DOUBLE || _bonds[idx].type == BOND_TRIPLE)
+            if (type == BOND_SINGLE || type == BOND_DOUBLE || type == BOND_TRIPLE)
                 continue;
-            if (_qmol != 0 && !_qmol->possibleBondOrder(_bonds[idx].index, BOND_AROMATIC))
+            if (!allows_aromatic(idx))
                 continue;
-            if (_bonds[idx].type == -1)
+            if (type == -1)
                 needs_modification = true;
         }
 
@@ -1741,20 +2133,30 @@ void SmilesLoader::_markAromaticBonds()
             for (j = 0; j < cycle.size(); j++)
             {
                 int idx = cycle[j];
-                const Edge& edge = _bmol->getEdge(idx);
-                if ((_bonds[idx].type == -1) && (_atoms[edge.beg].aromatic && _atoms[edge.end].aromatic))
-                {
-                    _bonds[idx].type = BOND_AROMATIC;
-                    int bond_index = _bonds[idx].index;
-                    if (_mol != 0)
-                        _mol->setBondOrder_Silent(bond_index, BOND_AROMATIC);
-                    if (_qmol != 0)
-                        _qmol->resetBond(bond_index, QueryMolecule::Bond::und(_qmol->releaseBond(bond_index),
-                                                                              new QueryMolecule::Bond(QueryMolecule::BOND_ORDER, BOND_AROMATIC)));
-                }
+                const Edge& edge = mol.getEdge(idx);
+                if (bond_type(idx) == -1 && atom_aromatic(edge.beg) && atom_aromatic(edge.end))
+                    set_aromatic(idx);
             }
         }
     }
+}
+
+void SmilesLoader::_markAromaticBonds()
+{
+    int i;
+
+    _markAromaticCycles(
+        *_bmol, [this](int v) { return _atoms[v].aromatic; }, [this](int e) { return _bonds[e].type; },
+        [this](int e) { return _qmol == 0 || _qmol->possibleBondOrder(_bonds[e].index, BOND_AROMATIC); },
+        [this](int e) {
+            _bonds[e].type = BOND_AROMATIC;
+            int bond_index = _bonds[e].index;
+            if (_mol != 0)
+                _mol->setBondOrder_Silent(bond_index, BOND_AROMATIC);
+            if (_qmol != 0)
+                _qmol->resetBond(bond_index,
+                                 QueryMolecule::Bond::und(_qmol->releaseBond(bond_index), new QueryMolecule::Bond(QueryMolecule::BOND_ORDER, BOND_AROMATIC)));
+        });
 
     // mark the rest 'empty' bonds as single
     for (i = 0; i < _bonds.size(); i++)
@@ -1773,46 +2175,45 @@ void SmilesLoader::_markAromaticBonds()
 
 void SmilesLoader::_setRadicalsAndHCounts()
 {
-    int i;
+    for (int i = 0; i < _atoms.size(); i++)
+        _setRadicalAndHCount(i, _atoms[i].label, _atoms[i].brackets, _atoms[i].aromatic, _atoms[i].hydrogens);
+}
 
-    for (i = 0; i < _atoms.size(); i++)
+void SmilesLoader::_setRadicalAndHCount(int idx, int label, bool brackets, bool aromatic, int hydrogens)
+{
+    // The SMILES specification says: Elements in the "organic subset"
+    // B, C, N, O, P, S, F, Cl, Br, and I may be written without brackets
+    // if the number of attached hydrogens conforms to the lowest normal
+    // valence consistent with explicit bonds. We assume that there are
+    // no radicals in that case.
+    if (!brackets)
+        // We set zero radicals explicitly to properly detect errors like FClF
+        // (while F[Cl]F is correct)
+        _mol->setAtomRadical(idx, 0);
+
+    if (hydrogens >= 0)
+        _mol->setImplicitH(idx, hydrogens);
+    else if (brackets)              // no hydrogens in brackets?
+        _mol->setImplicitH(idx, 0); // no implicit hydrogens on atom then
+    else if (aromatic && _mol->getAtomAromaticity(idx) == ATOM_AROMATIC)
     {
-        int idx = i;
-
-        // The SMILES specification says: Elements in the "organic subset"
-        // B, C, N, O, P, S, F, Cl, Br, and I may be written without brackets
-        // if the number of attached hydrogens conforms to the lowest normal
-        // valence consistent with explicit bonds. We assume that there are
-        // no radicals in that case.
-        if (!_atoms[i].brackets)
-            // We set zero radicals explicitly to properly detect errors like FClF
-            // (while F[Cl]F is correct)
-            _mol->setAtomRadical(idx, 0);
-
-        if (_atoms[i].hydrogens >= 0)
-            _mol->setImplicitH(idx, _atoms[i].hydrogens);
-        else if (_atoms[i].brackets)    // no hydrogens in brackets?
-            _mol->setImplicitH(idx, 0); // no implicit hydrogens on atom then
-        else if (_atoms[i].aromatic && _mol->getAtomAromaticity(i) == ATOM_AROMATIC)
-        {
-            // Additional check for _mol->getAtomAromaticity(i) is required because
-            // a cycle can be non-aromatic while atom letters are small
-            if (_atoms[i].label == ELEM_C)
-            {
-                // here we are basing on the fact that
-                // aromatic uncharged carbon always has a double bond
-                if (_mol->getVertex(i).degree() < 3)
-                    // 2-connected aromatic carbon must have 1 single bond and 1 double bond,
-                    // so we have one implicit hydrogen left
-                    _mol->setImplicitH(idx, 1);
-                else
-                    _mol->setImplicitH(idx, 0);
-            }
+        // Additional check for _mol->getAtomAromaticity(idx) is required because
+        // a cycle can be non-aromatic while atom letters are small
+        if (label == ELEM_C)
+        {
+            // here we are basing on the fact that
+            // aromatic uncharged carbon always has a double bond
+            if (_mol->getVertex(idx).degree() < 3)
+                // 2-connected aromatic carbon must have 1 single bond and 1 double bond,
+                // so we have one implicit hydrogen left
+                _mol->setImplicitH(idx, 1);
             else
-            {
-                // Leave the number of hydrogens as unspecified
-                // Dearomatization algorithm can find any suitable configuration
-            }
+                _mol->setImplicitH(idx, 0);
+        }
+        else
+        {
+            // Leave the number of hydrogens as unspecified
+            // Dearomatization algorithm can find any suitable configuration
         }
     }
 }
@@ -57,10 +57,17 @@ namespace indigo
         typedef std::vector<FLOAT_INT_PAIR> FLOAT_INT_PAIRS;
 
         ReactionJsonLoader(rapidjson::Document& ket);
+        // For loadPlainReaction(), which reads the document itself
+        ReactionJsonLoader();
         ~ReactionJsonLoader();
 
         void loadReaction(BaseReaction& rxn);
 
+        // Loads a KET document straight from the scanner, without building a
+        // DOM, if MoleculeJsonLoader::loadPlainMolecule() takes its nodes.
+        // Otherwise returns false with the scanner back where it was.
+        bool loadPlainReaction(Scanner& scanner, Reaction& rxn);
+
         StereocentersOptions stereochemistry_options;
         bool ignore_bad_valence;
         bool ignore_noncritical_query_features;
@@ -72,6 +79,7 @@ namespace indigo
 
     private:
         ReactionJsonLoader(const ReactionJsonLoader&); // no implicit copy
+        void buildReaction(BaseReaction& rxn);
         void parseOneArrowReaction(BaseReaction& rxn);
         void parseMultipleArrowReaction(BaseReaction& rxn);
         void constructMultipleArrowReaction(BaseReaction& rxn);
@@ -19,6 +19,7 @@
 #include "reaction/reaction_auto_loader.h"
 #include "gzip/gzip_scanner.h"
 #include "molecule/molecule_auto_loader.h"
+#include "molecule/multiple_ket_loader.h"
 #include "reaction/icr_loader.h"
 #include "reaction/icr_saver.h"
 #include "reaction/query_reaction.h"
@@ -27,6 +28,7 @@
 #include "reaction/reaction_json_loader.h"
 #include "reaction/rsmiles_loader.h"
 #include "reaction/rxnfile_loader.h"
+#include <rapidjson/error/en.h>
 #include <string>
 
 using namespace indigo;
@@ -184,21 +186,32 @@ void ReactionAutoLoader::_loadReaction(BaseReaction& reaction, bool query)
             if (_scanner->findWord("arrow"))
             {
                 using namespace rapidjson;
+                auto setLoaderOptions = [this](ReactionJsonLoader& loader) {
+                    loader.stereochemistry_options = stereochemistry_options;
+                    loader.ignore_noncritical_query_features = ignore_noncritical_query_features;
+                    loader.treat_x_as_pseudoatom = treat_x_as_pseudoatom;
+                    loader.ignore_no_chiral_flag = ignore_no_chiral_flag;
+                };
+
                 _scanner->seek(pos, SEEK_SET);
+
+                // Most reactions have plain molecules, which are built without a DOM
+                if (!query)
+                {
+                    ReactionJsonLoader loader;
+                    setLoaderOptions(loader);
+                    if (loader.loadPlainReaction(*_scanner, reaction.asReaction()))
+                        return;
+                }
+
                 {
-                    Array<char> buf;
-                    _scanner->readAll(buf);
-                    buf.push(0);
                     Document data;
-                    if (data.Parse(buf.ptr()).HasParseError())
-                        throw Error("Error at parsing JSON: %s", buf.ptr());
+                    if (!MultipleKetLoader::parse(*_scanner, data))
+                        throw Error("Error at parsing JSON: %s at offset %d", GetParseError_En(data.GetParseError()), (int)data.GetErrorOffset());
                     if (data.HasMember("root") && data["root"].HasMember("nodes"))
                     {
                         ReactionJsonLoader loader(data);
-                        loader.stereochemistry_options = stereochemistry_options;
-                        loader.ignore_noncritical_query_features = ignore_noncritical_query_features;
-                        loader.treat_x_as_pseudoatom = treat_x_as_pseudoatom;
-                        loader.ignore_no_chiral_flag = ignore_no_chiral_flag;
+                        setLoaderOptions(loader);
 
                         loader.loadReaction(reaction);
                     }
@@ -44,6 +44,16 @@ ReactionJsonLoader::ReactionJsonLoader(Document& ket)
     _loader.ignore_no_chiral_flag = ignore_no_chiral_flag;
 }
 
+ReactionJsonLoader::ReactionJsonLoader() : _molecule(kArrayType), _prxn(nullptr), _pqrxn(nullptr), ignore_noncritical_query_features(false)
+{
+    ignore_bad_valence = false;
+
+    _loader.stereochemistry_options = stereochemistry_options;
+    _loader.ignore_noncritical_query_features = ignore_noncritical_query_features;
+    _loader.treat_x_as_pseudoatom = treat_x_as_pseudoatom;
+    _loader.ignore_no_chiral_flag = ignore_no_chiral_flag;
+}
+
 ReactionJsonLoader::~ReactionJsonLoader()
 {
 }
@@ -68,6 +78,22 @@ void ReactionJsonLoader::loadReaction(BaseReaction& rxn)
     else
         throw Error("unknown reaction type: %s", typeid(rxn).name());
 
+    buildReaction(rxn);
+}
+
+bool ReactionJsonLoader::loadPlainReaction(Scanner& scanner, Reaction& rxn)
+{
+    _prxn = &rxn;
+    _pmol = &_mol;
+    if (!_loader.loadPlainMolecule(scanner, _mol, true))
+        return false;
+
+    buildReaction(rxn);
+    return true;
+}
+
+void ReactionJsonLoader::buildReaction(BaseReaction& rxn)
+{
     rxn.meta().clone(_pmol->meta());
     _pmol->meta().resetMetaData();
 
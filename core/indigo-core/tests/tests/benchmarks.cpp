@@ -0,0 +1,646 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <rapidjson/document.h>
+
+#include <base_cpp/mmap_scanner.h>
+#include <base_cpp/obj.h>
+#include <base_cpp/obj_array.h>
+#include <base_cpp/output.h>
+#include <base_cpp/record_index.h>
+#include <base_cpp/scanner.h>
+#include <base_cpp/tlscont.h>
+#include <graph/embedding_enumerator.h>
+#include <gzip/gzip_output.h>
+#include <gzip/gzip_scanner.h>
+#include <layout/molecule_layout.h>
+#include <layout/reaction_layout.h>
+#include <molecule/canonical_smiles_saver.h>
+#include <molecule/molecule_fingerprint.h>
+#include <molecule/molecule_json_loader.h>
+#include <molecule/molecule_json_saver.h>
+#include <molecule/molecule_query_set_matcher.h>
+#include <molecule/molecule_substructure_matcher.h>
+#include <molecule/multiple_ket_loader.h>
+#include <molecule/query_molecule.h>
+#include <molecule/sdf_loader.h>
+#include <molecule/smiles_loader.h>
+#include <reaction/reaction.h>
+#include <reaction/reaction_json_loader.h>
+#include <reaction/reaction_json_saver.h>
+
+#include "common.h"
+
+using namespace indigo;
+
+namespace
+{
+    struct BenchmarkSessionValue
+    {
+        int value = 0;
+    };
+
+    _SessionLocalContainer<BenchmarkSessionValue> benchmark_session_values;
+} // namespace
+
+// Timings of the hot paths. The tests are disabled, run them with
+//   indigo-core-unit-tests --gtest_also_run_disabled_tests --gtest_filter='IndigoCoreBenchmarkTest.*'
+class IndigoCoreBenchmarkTest : public IndigoCoreTest
+{
+protected:
+    static void loadSmilesFile(const char* path, ObjArray<Molecule>& molecules)
+    {
+        FileScanner scanner(dataPath(path).c_str());
+        Array<char> line;
+
+        while (!scanner.isEOF())
+        {
+            scanner.readLine(line, true);
+            if (line.size() <= 1)
+                continue;
+            try
+            {
+                Molecule& mol = molecules.push();
+                loadMolecule(line.ptr(), mol);
+            }
+            catch (Exception&)
+            {
+                molecules.pop();
+            }
+        }
+    }
+
+    // A temporary file with "copies" copies of a data file, returns its path
+    static std::string writeRepeated(const char* path, int copies, const char* name)
+    {
+        Array<char> part;
+        FileScanner(dataPath(path).c_str()).readAll(part);
+
+        const std::string out_path = ::testing::TempDir() + name;
+        FileOutput output(out_path.c_str());
+        for (int i = 0; i < copies; i++)
+            output.write(part.ptr(), part.size());
+        return out_path;
+    }
+
+    static void loadQueries(const std::vector<const char*>& smarts, ObjArray<QueryMolecule>& queries)
+    {
+        for (const char* item : smarts)
+        {
+            BufferScanner scanner(item);
+            SmilesLoader loader(scanner);
+            loader.loadSMARTS(queries.push());
+        }
+    }
+
+    // Best of "repeats" runs of fn(), in seconds
+    template <typename F>
+    static double measure(int repeats, F fn)
+    {
+        double best = 0;
+        for (int i = 0; i < repeats; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (i == 0 || seconds < best)
+                best = seconds;
+        }
+        return best;
+    }
+
+    static void report(const char* name, double seconds, int count)
+    {
+        printf("[ BENCH    ] %-40s %10.3f ms %12.1f ns/op (%d ops)\n", name, seconds * 1000, seconds * 1e9 / count, count);
+    }
+};
+
+// Session-local lookups from many threads, each with its own session: the
+// per-thread cache versus the shared-locked map lookup every call used to do
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_session_local_lookup)
+{
+    const int lookups = 2000000;
+    sf::safe_shared_hide_obj<std::unordered_map<qword, std::unique_ptr<BenchmarkSessionValue>>> map;
+
+    for (const int threads_count : {1, 4, 16})
+    {
+        auto run = [&](bool cached) {
+            std::vector<std::thread> threads;
+            for (int t = 0; t < threads_count; t++)
+            {
+                threads.emplace_back([&]() {
+                    const qword id = TL_ALLOC_SESSION_ID();
+                    TL_SET_SESSION_ID(id);
+                    benchmark_session_values.createOrGetLocalCopy();
+                    {
+                        auto locked = sf::xlock_safe_ptr(map);
+                        (*locked)[id] = std::make_unique<BenchmarkSessionValue>();
+                    }
+
+                    int sum = 0;
+                    for (int i = 0; i < lookups; i++)
+                    {
+                        if (cached)
+                            sum += benchmark_session_values.getLocalCopy().value;
+                        else
+                            sum += sf::slock_safe_ptr(map)->at(TL_GET_SESSION_ID())->value;
+                    }
+                    benchmark_session_values.getLocalCopy().value = sum;
+
+                    benchmark_session_values.removeLocalCopy();
+                    sf::xlock_safe_ptr(map)->erase(id);
+                    TL_RELEASE_SESSION_ID(id);
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+        };
+
+        char name[64];
+        snprintf(name, sizeof(name), "session_local_lookup: cache, %d thr", threads_count);
+        report(name, measure(3, [&]() { run(true); }), lookups * threads_count);
+        snprintf(name, sizeof(name), "session_local_lookup: map, %d thr", threads_count);
+        report(name, measure(3, [&]() { run(false); }), lookups * threads_count);
+    }
+}
+
+// Queries of different selectivity against the same targets, one matcher per target
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_substructure_matching)
+{
+    ObjArray<Molecule> targets;
+    ObjArray<QueryMolecule> queries;
+
+    loadSmilesFile("molecules/basic/pubchem_slice_5000.smi", targets);
+    for (int i = 0; i < targets.size(); i++)
+        targets[i].aromatize(AromaticityOptions());
+    loadQueries({"c1ccccc1", "C(=O)[OH]", "[#7]~[#6]~[#8]", "S(=O)(=O)N", "C1CCNCC1", "[Cl,Br,I]", "c1ccc2ccccc2c1", "C=CC=O", "[Si]", "P(=O)(O)O"},
+                queries);
+
+    int hits = 0;
+    double seconds = measure(7, [&]() {
+        hits = 0;
+        for (int i = 0; i < targets.size(); i++)
+        {
+            MoleculeSubstructureMatcher matcher(targets[i]);
+            for (int j = 0; j < queries.size(); j++)
+            {
+                matcher.setQuery(queries[j]);
+                hits += matcher.find() ? 1 : 0;
+            }
+        }
+    });
+    ASSERT_GT(hits, 0);
+    report("substructure_matching", seconds, targets.size() * queries.size());
+}
+
+// Full fingerprints with the default session parameters: subtree and cycle
+// enumeration followed by a subgraph hash of every fragment
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_fingerprints)
+{
+    ObjArray<Molecule> molecules;
+    loadSmilesFile("molecules/basic/pubchem_slice_5000.smi", molecules);
+    for (int i = 0; i < molecules.size(); i++)
+        molecules[i].aromatize(AromaticityOptions());
+
+    MoleculeFingerprintParameters parameters;
+    parameters.ext = true;
+    parameters.similarity_type = SimilarityType::SIM;
+    parameters.ord_qwords = 25;
+    parameters.any_qwords = 15;
+    parameters.tau_qwords = 10;
+    parameters.sim_qwords = 8;
+
+    int bits = 0;
+    double seconds = measure(3, [&]() {
+        bits = 0;
+        for (int i = 0; i < molecules.size(); i++)
+        {
+            MoleculeFingerprintBuilder builder(molecules[i], parameters);
+            builder.process();
+            bits += builder.get()[parameters.fingerprintSizeExt()] != 0 ? 1 : 0;
+        }
+    });
+    ASSERT_GT(bits, 0);
+    report("fingerprints: pubchem_slice_5000", seconds, molecules.size());
+}
+
+// A set of structural alerts against the same targets: MoleculeQuerySetMatcher,
+// which searches only the queries passing its prefilter, versus one
+// substructure matcher per target trying every query
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_query_set_matching)
+{
+    ObjArray<Molecule> targets;
+    ObjArray<QueryMolecule> queries;
+
+    loadSmilesFile("molecules/basic/pubchem_slice_5000.smi", targets);
+    loadQueries({"c1ccccc1[N+](=O)[O-]", "C(=O)[OH]", "[#6]C(=O)O[#6]", "N=N", "[N;!H0]c", "C=CC=O", "S(=O)(=O)N", "[Cl,Br,I]C", "C(=O)Cl", "N=C=O",
+                 "N=C=S", "[N+]#N", "OO", "SS", "C1OC1", "C1NC1", "[CH]=O", "P(=O)(O)O", "[Si]", "[Sn,Hg,Pb,As]", "C#C", "N-N", "O=C-C=O", "[N;R0]=[N;R0]",
+                 "c1ccc2ccccc2c1", "C1CCNCC1", "c1ccncc1", "[S;X2]", "C(F)(F)F", "B(O)O"},
+                queries);
+
+    MoleculeQuerySetMatcher set_matcher;
+    for (int i = 0; i < queries.size(); i++)
+        set_matcher.addQuery(queries[i]);
+
+    int set_hits = 0;
+    double set_seconds = measure(5, [&]() {
+        Array<int> ids;
+        set_hits = 0;
+        for (int i = 0; i < targets.size(); i++)
+        {
+            set_matcher.match(targets[i], ids);
+            set_hits += ids.size();
+        }
+    });
+
+    int loop_hits = 0;
+    double loop_seconds = measure(5, [&]() {
+        loop_hits = 0;
+        for (int i = 0; i < targets.size(); i++)
+        {
+            Molecule target;
+            target.clone(targets[i], 0, 0);
+            target.aromatize(AromaticityOptions());
+
+            MoleculeSubstructureMatcher matcher(target);
+            for (int j = 0; j < queries.size(); j++)
+            {
+                matcher.setQuery(queries[j]);
+                loop_hits += matcher.find() ? 1 : 0;
+            }
+        }
+    });
+
+    ASSERT_EQ(loop_hits, set_hits);
+    report("query_set_matching: query set", set_seconds, targets.size());
+    report("query_set_matching: per-query loop", loop_seconds, targets.size());
+}
+
+// Many targets, one matcher each: an enumerator per matcher versus one
+// enumerator shared by all the matchers and reset to each target
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_embedding_enumerator_reuse)
+{
+    ObjArray<Molecule> targets;
+    ObjArray<QueryMolecule> queries;
+
+    loadSmilesFile("molecules/basic/pubchem_slice_5000.smi", targets);
+    for (int i = 0; i < targets.size(); i++)
+        targets[i].aromatize(AromaticityOptions());
+    loadQueries({"c1ccccc1", "C(=O)[OH]", "[#7]~[#6]~[#8]", "C1CCNCC1", "[Cl,Br,I]"}, queries);
+
+    auto run = [&](bool shared, int& hits) {
+        Obj<EmbeddingEnumerator> ee;
+        hits = 0;
+        for (int i = 0; i < targets.size(); i++)
+        {
+            MoleculeSubstructureMatcher matcher(targets[i]);
+            if (shared)
+            {
+                if (ee.get() == 0)
+                    ee.create(targets[i]);
+                matcher.setEmbeddingEnumerator(ee.get());
+            }
+            for (int j = 0; j < queries.size(); j++)
+            {
+                matcher.setQuery(queries[j]);
+                hits += matcher.find() ? 1 : 0;
+            }
+        }
+    };
+
+    int own_hits = 0, shared_hits = 0;
+    double own_seconds = measure(7, [&]() { run(false, own_hits); });
+    double shared_seconds = measure(7, [&]() { run(true, shared_hits); });
+
+    ASSERT_EQ(own_hits, shared_hits);
+    report("embedding_enumerator_reuse: own", own_seconds, targets.size() * queries.size());
+    report("embedding_enumerator_reuse: shared", shared_seconds, targets.size() * queries.size());
+}
+
+// Canonical SMILES of highly symmetric molecules, where the automorphism
+// search dominates
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_canonical_smiles_symmetric)
+{
+    // Three branches at every carbon, 6 levels deep: 1093 atoms
+    std::function<std::string(int)> dendrimer = [&](int depth) -> std::string {
+        if (depth == 0)
+            return "C";
+        std::string branch = dendrimer(depth - 1);
+        return "C(" + branch + ")(" + branch + ")" + branch;
+    };
+    const std::string ring = "C1" + std::string(1998, 'C') + "C1";
+    const std::string fullerene = "c12c3c4c5c1c6c7c8c2c9c%10c3c%11c%12c4c%13c%14c5c%15c6c%16c7c%17c%18c8c9c%19c%20c%10c%11c%21c%22c%12c%13c%23c%24c%14c%15c%25c%16c%17c%26c%27c%"
+                                  "18c%19c%28c%20c%21c%29c%22c%23c%30c%24c%25c%26c%31c%27c%28c%29c%30c%31";
+    const std::pair<const char*, std::string> molecules[] = {{"dendrimer, 1093 atoms", dendrimer(6)}, {"ring, 2000 atoms", ring}, {"fullerene", fullerene}};
+
+    for (const auto& item : molecules)
+    {
+        Molecule mol;
+        loadMolecule(item.second.c_str(), mol);
+
+        Array<char> smiles;
+        double seconds = measure(3, [&]() {
+            ArrayOutput output(smiles);
+            CanonicalSmilesSaver saver(output);
+            saver.saveMolecule(mol);
+        });
+        ASSERT_GT(smiles.size(), 0);
+
+        std::string name = std::string("canonical_smiles: ") + item.first;
+        report(name.c_str(), seconds, 1);
+    }
+}
+
+// Splitting a large SDF file into raw records, read through FileScanner and
+// through the memory-mapped scanner
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_sdf_scanning)
+{
+    const std::string path = writeRepeated("molecules/basic/thiazolidines.sdf", 40, "benchmark.sdf");
+    int file_count = 0, mmap_count = 0;
+
+    double file_seconds = measure(3, [&]() {
+        FileScanner scanner(path.c_str());
+        SdfLoader loader(scanner);
+        for (file_count = 0; !loader.isEOF(); file_count++)
+            loader.readNext();
+    });
+    double mmap_seconds = measure(3, [&]() {
+        std::unique_ptr<Scanner> scanner = MMapScanner::open(ENCODING_ASCII, path.c_str());
+        SdfLoader loader(*scanner);
+        for (mmap_count = 0; !loader.isEOF(); mmap_count++)
+            loader.readNext();
+    });
+    std::remove(path.c_str());
+
+    ASSERT_EQ(file_count, mmap_count);
+    report("sdf_scanning: FileScanner", file_seconds, file_count);
+    report("sdf_scanning: MMapScanner", mmap_seconds, mmap_count);
+}
+
+// Reading a gzipped SDF forward and by record number, plain gzip and BGZF
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_sdf_gzip_reading)
+{
+    const std::string path = writeRepeated("molecules/basic/thiazolidines.sdf", 40, "benchmark.sdf");
+    Array<char> sdf, plain, bgzf;
+
+    FileScanner(path.c_str()).readAll(sdf);
+    std::remove(path.c_str());
+    {
+        ArrayOutput output(plain);
+        GZipOutput gzip(output, 6);
+        gzip.write(sdf.ptr(), sdf.size());
+    }
+    {
+        ArrayOutput output(bgzf);
+        GZipOutput gzip(output, 6, true);
+        gzip.write(sdf.ptr(), sdf.size());
+    }
+
+    Array<char> all;
+    for (const bool is_bgzf : {false, true})
+    {
+        Array<char>& compressed = is_bgzf ? bgzf : plain;
+        const char* kind = is_bgzf ? "bgzf" : "gzip";
+        char name[64];
+
+        double seconds = measure(3, [&]() {
+            BufferScanner source(compressed);
+            GZipScanner scanner(source);
+            scanner.readAll(all);
+        });
+        ASSERT_EQ(sdf.size(), all.size());
+        snprintf(name, sizeof(name), "sdf_gzip: %s readAll, per MB", kind);
+        report(name, seconds, sdf.size() >> 20);
+
+        int count = 0;
+        seconds = measure(3, [&]() {
+            BufferScanner source(compressed);
+            SdfLoader loader(source);
+            for (count = 0; !loader.isEOF(); count++)
+                loader.readNext();
+        });
+        snprintf(name, sizeof(name), "sdf_gzip: %s records", kind);
+        report(name, seconds, count);
+
+        // Records picked across the whole file, with the access points of a built index
+        RecordIndex index;
+        {
+            BufferScanner source(compressed);
+            SdfLoader loader(source);
+            loader.buildIndex(index);
+        }
+        const int reads = 100;
+        seconds = measure(3, [&]() {
+            BufferScanner source(compressed);
+            SdfLoader loader(source);
+            loader.loadIndex(index);
+            for (int i = 0; i < reads; i++)
+                loader.readAt((int)((i * 7919LL) % count));
+        });
+        snprintf(name, sizeof(name), "sdf_gzip: %s readAt with index", kind);
+        report(name, seconds, reads);
+    }
+}
+
+// Loading KET molecules and reactions through a rapidjson DOM and straight
+// from the reader. The DOM bytes are what its allocator holds per document,
+// on top of the 64 KB stream buffer both paths read through. The reactions
+// join three molecules each, two reactants and a product.
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_ket_loading)
+{
+    ObjArray<Molecule> molecules;
+    loadSmilesFile("molecules/basic/pubchem_slice_5000.smi", molecules);
+
+    std::vector<std::string> mol_documents, rxn_documents;
+    for (int i = 0; i < molecules.size(); i++)
+    {
+        Array<char> ket;
+        try
+        {
+            MoleculeLayout layout(molecules[i]);
+            layout.make();
+            molecules[i].markBondsStereocenters();
+            ArrayOutput output(ket);
+            MoleculeJsonSaver saver(output);
+            saver.saveMolecule(molecules[i]);
+        }
+        catch (Exception&)
+        {
+            continue;
+        }
+        mol_documents.emplace_back(ket.ptr(), ket.size());
+    }
+    for (int i = 0; i + 2 < molecules.size(); i += 3)
+    {
+        Array<char> ket;
+        try
+        {
+            Reaction rxn;
+            rxn.addReactantCopy(molecules[i], 0, 0);
+            rxn.addReactantCopy(molecules[i + 1], 0, 0);
+            rxn.addProductCopy(molecules[i + 2], 0, 0);
+            ReactionLayout layout(rxn);
+            layout.make();
+            ArrayOutput output(ket);
+            ReactionJsonSaver saver(output);
+            saver.saveReaction(rxn);
+        }
+        catch (Exception&)
+        {
+            continue;
+        }
+        rxn_documents.emplace_back(ket.ptr(), ket.size());
+    }
+    ASSERT_GT(mol_documents.size(), 0U);
+    ASSERT_GT(rxn_documents.size(), 0U);
+
+    for (const bool is_rxn : {false, true})
+    {
+        const std::vector<std::string>& documents = is_rxn ? rxn_documents : mol_documents;
+        const char* kind = is_rxn ? "reactions" : "molecules";
+        char name[64];
+
+        size_t text_bytes = 0, dom_bytes = 0;
+        int loaded = 0;
+        double seconds = measure(3, [&]() {
+            text_bytes = dom_bytes = 0;
+            loaded = 0;
+            for (const std::string& item : documents)
+            {
+                BufferScanner scanner(item.c_str(), (int)item.size());
+                rapidjson::Document data;
+                if (!MultipleKetLoader::parse(scanner, data))
+                    continue;
+                text_bytes += item.size();
+                dom_bytes += data.GetAllocator().Size();
+                if (is_rxn)
+                {
+                    Reaction rxn;
+                    ReactionJsonLoader loader(data);
+                    loader.loadReaction(rxn);
+                }
+                else
+                {
+                    Molecule mol;
+                    MoleculeJsonLoader loader(data);
+                    loader.loadMolecule(mol);
+                }
+                loaded++;
+            }
+        });
+        ASSERT_EQ((int)documents.size(), loaded);
+        snprintf(name, sizeof(name), "ket_loading: %s, dom", kind);
+        report(name, seconds, loaded);
+
+        seconds = measure(3, [&]() {
+            loaded = 0;
+            for (const std::string& item : documents)
+            {
+                BufferScanner scanner(item.c_str(), (int)item.size());
+                if (is_rxn)
+                {
+                    Reaction rxn;
+                    ReactionJsonLoader loader;
+                    loaded += loader.loadPlainReaction(scanner, rxn) ? 1 : 0;
+                }
+                else
+                {
+                    Molecule mol;
+                    MoleculeJsonLoader loader;
+                    loaded += loader.loadPlainMolecule(scanner, mol) ? 1 : 0;
+                }
+            }
+        });
+        ASSERT_EQ((int)documents.size(), loaded);
+        snprintf(name, sizeof(name), "ket_loading: %s, reader", kind);
+        report(name, seconds, loaded);
+
+        printf("[ BENCH    ] ket_loading: %s, %zu bytes of text, %zu bytes of DOM per document\n", kind, text_bytes / loaded, dom_bytes / loaded);
+    }
+}
+
+// Loading plain SMILES through the fast path and through the full parser.
+// The empty CXSMILES block sends the same string to the full parser.
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_smiles_loading)
+{
+    std::vector<std::string> lines;
+    FileScanner file(dataPath("molecules/basic/pubchem_slice_5000.smi").c_str());
+    Array<char> line;
+    while (!file.isEOF())
+    {
+        file.readLine(line, true);
+        if (line.size() > 1)
+            lines.emplace_back(line.ptr());
+    }
+
+    for (const bool fast : {true, false})
+    {
+        std::vector<std::string> inputs;
+        for (const std::string& item : lines)
+            inputs.push_back(fast ? item : item + " ||");
+
+        int loaded = 0;
+        double seconds = measure(5, [&]() {
+            Molecule mol;
+            loaded = 0;
+            for (const std::string& item : inputs)
+            {
+                BufferScanner scanner(item.c_str());
+                SmilesLoader loader(scanner);
+                try
+                {
+                    loader.loadMolecule(mol);
+                    loaded++;
+                }
+                catch (Exception&)
+                {
+                }
+            }
+        });
+        ASSERT_GT(loaded, 0);
+        report(fast ? "smiles_loading: fast path" : "smiles_loading: full parser", seconds, loaded);
+    }
+}
+
+// Canonical SMILES of ordinary molecules, most of them without stereo
+TEST_F(IndigoCoreBenchmarkTest, DISABLED_canonical_smiles)
+{
+    ObjArray<Molecule> molecules;
+    loadSmilesFile("molecules/basic/pubchem_slice_5000.smi", molecules);
+
+    Array<char> smiles;
+    double seconds = measure(5, [&]() {
+        for (int i = 0; i < molecules.size(); i++)
+        {
+            ArrayOutput output(smiles);
+            CanonicalSmilesSaver saver(output);
+            saver.saveMolecule(molecules[i]);
+        }
+    });
+    report("canonical_smiles: pubchem_slice_5000", seconds, molecules.size());
+}
@@ -16,10 +16,15 @@
  * limitations under the License.
  ***************************************************************************/
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <base_cpp/output.h>
 #include <base_cpp/scanner.h>
+#include <base_cpp/tlscont.h>
 #include <molecule/cmf_loader.h>
 #include <molecule/cmf_saver.h>
 #include <molecule/cml_saver.h>
@@ -94,3 +99,49 @@ TEST_F(IndigoCoreContainersTest, test_red_black_map)
     map.clear();
     ASSERT_EQ(map.size(), 0);
 }
+
+namespace
+{
+    struct SessionCounter
+    {
+        int value = 0;
+    };
+
+    _SessionLocalContainer<SessionCounter> session_counters;
+}
+
+TEST_F(IndigoCoreContainersTest, test_session_local_container_threads)
+{
+    const int threads_count = 32;
+    const int iterations = 100000;
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++)
+    {
+        threads.emplace_back([&failures]() {
+            const qword id = TL_ALLOC_SESSION_ID();
+            TL_SET_SESSION_ID(id);
+            for (int i = 0; i < iterations; i++)
+            {
+                session_counters.createOrGetLocalCopy().value++;
+            }
+            if (session_counters.getLocalCopy().value != iterations)
+            {
+                failures++;
+            }
+            // A removed copy must not be served from the cache
+            session_counters.removeLocalCopy();
+            if (session_counters.hasLocalCopy() || session_counters.createOrGetLocalCopy().value != 0)
+            {
+                failures++;
+            }
+            session_counters.removeLocalCopy();
+            TL_RELEASE_SESSION_ID(id);
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    ASSERT_EQ(failures, 0);
+}
@@ -16,20 +16,38 @@
  * limitations under the License.
  ***************************************************************************/
 
+#include <cstdio>
+#include <cstring>
+
 #include <gtest/gtest.h>
+#include <rapidjson/document.h>
 
+#include <base_cpp/arrow_ipc_writer.h>
+#include <base_cpp/mmap_scanner.h>
 #include <base_cpp/output.h>
+#include <base_cpp/record_index.h>
 #include <base_cpp/scanner.h>
+#include <gzip/gzip_output.h>
+#include <gzip/gzip_scanner.h>
+#include <layout/molecule_layout.h>
+#include <layout/reaction_layout.h>
 #include <molecule/cmf_loader.h>
 #include <molecule/cmf_saver.h>
 #include <molecule/cml_saver.h>
 #include <molecule/molecule_cdxml_saver.h>
+#include <molecule/molecule_json_loader.h>
+#include <molecule/molecule_json_saver.h>
 #include <molecule/molecule_mass.h>
 #include <molecule/molecule_substructure_matcher.h>
 #include <molecule/molfile_loader.h>
+#include <molecule/multiple_ket_loader.h>
 #include <molecule/query_molecule.h>
 #include <molecule/sdf_loader.h>
 #include <molecule/smiles_loader.h>
+#include <reaction/reaction.h>
+#include <reaction/reaction_json_loader.h>
+#include <reaction/reaction_json_saver.h>
+#include <reaction/rsmiles_loader.h>
 
 #include "common.h"
 
@@ -39,6 +57,61 @@ class IndigoCoreFormatsTest : public IndigoCoreTest
 {
 };
 
+namespace
+{
+    // Just enough of a flatbuffers reader to walk the Arrow IPC metadata
+    class FlatReader
+    {
+    public:
+        FlatReader(const char* buf) : _buf(buf)
+        {
+        }
+
+        template <typename T> T read(int pos) const
+        {
+            T value;
+            memcpy(&value, _buf + pos, sizeof(T));
+            return value;
+        }
+
+        int root() const
+        {
+            return read<unsigned>(0);
+        }
+
+        // Position of the field in the table, or -1 if it is absent
+        int field(int table, int id) const
+        {
+            int vtable = table - read<int>(table);
+            if (4 + 2 * id >= read<unsigned short>(vtable))
+                return -1;
+            int offset = read<unsigned short>(vtable + 4 + 2 * id);
+            return offset != 0 ? table + offset : -1;
+        }
+
+        // Table, vector or string the offset field refers to
+        int deref(int table, int id) const
+        {
+            int pos = field(table, id);
+            return pos + read<unsigned>(pos);
+        }
+
+        int vectorSize(int vector) const
+        {
+            return read<unsigned>(vector);
+        }
+
+        std::string string(int table, int id) const
+        {
+            int pos = deref(table, id);
+            return std::string(_buf + pos + 4, vectorSize(pos));
+        }
+
+    private:
+        const char* _buf;
+    };
+} // namespace
+
 TEST_F(IndigoCoreFormatsTest, load_targets_cmf)
 {
     FileScanner sc(dataPath("molecules/resonance/resonance.sdf").c_str());
@@ -112,3 +185,466 @@ TEST_F(IndigoCoreFormatsTest, save_cml)
 
     ASSERT_TRUE(out.size() > 1000);
 }
+
+TEST_F(IndigoCoreFormatsTest, sdf_mmap_scanner)
+{
+    const std::string path = dataPath("molecules/basic/thiazolidines.sdf");
+
+    FileScanner file_scanner(path.c_str());
+    std::unique_ptr<Scanner> mmap_scanner = MMapScanner::open(ENCODING_ASCII, path.c_str());
+    ASSERT_TRUE(dynamic_cast<MMapScanner*>(mmap_scanner.get()) != nullptr);
+
+    SdfLoader file_sdf(file_scanner);
+    SdfLoader mmap_sdf(*mmap_scanner);
+    int count = 0;
+
+    while (!file_sdf.isEOF())
+    {
+        ASSERT_FALSE(mmap_sdf.isEOF());
+        file_sdf.readNext();
+        mmap_sdf.readNext();
+        count++;
+
+        ASSERT_EQ(file_sdf.data.size(), mmap_sdf.data.size());
+        ASSERT_EQ(0, memcmp(file_sdf.data.ptr(), mmap_sdf.data.ptr(), file_sdf.data.size()));
+        ASSERT_EQ(file_sdf.tell(), mmap_sdf.tell());
+        for (auto i : file_sdf.properties.elements())
+            ASSERT_STREQ(file_sdf.properties.value(i), mmap_sdf.properties.at(file_sdf.properties.key(i)));
+    }
+    ASSERT_TRUE(mmap_sdf.isEOF());
+    ASSERT_GT(count, 0);
+
+    mmap_sdf.readAt(1);
+    file_sdf.readAt(1);
+    ASSERT_EQ(file_sdf.data.size(), mmap_sdf.data.size());
+}
+
+TEST_F(IndigoCoreFormatsTest, mmap_scanner_lines)
+{
+    const std::string path = dataPath("molecules/basic/thiazolidines.sdf");
+    std::unique_ptr<Scanner> scanner = MMapScanner::open(ENCODING_ASCII, path.c_str());
+    FileScanner file_scanner(path.c_str());
+    Array<char> line, file_line;
+
+    ASSERT_EQ(file_scanner.length(), scanner->length());
+    while (!file_scanner.isEOF())
+    {
+        file_scanner.readLine(file_line, true);
+        scanner->readLine(line, true);
+        ASSERT_STREQ(file_line.ptr(), line.ptr());
+    }
+    ASSERT_TRUE(scanner->isEOF());
+
+    scanner->seek(0, SEEK_SET);
+    scanner->skipUntil("$");
+    ASSERT_EQ('$', scanner->readChar());
+    ASSERT_EQ('$', scanner->lookNext());
+}
+
+TEST_F(IndigoCoreFormatsTest, sdf_gzip_random_access)
+{
+    const std::string path = dataPath("molecules/basic/thiazolidines.sdf");
+    Array<char> part, sdf, single, bgzf, multi;
+
+    // Repeated to get past the first access point of the gzip scanner
+    FileScanner(path.c_str()).readAll(part);
+    for (int i = 0; i < 4; i++)
+        sdf.concat(part);
+    ASSERT_GT(sdf.size(), (int)GZipScanner::ACCESS_SPAN);
+
+    {
+        ArrayOutput output(single);
+        GZipOutput gzip(output, 6);
+        gzip.write(sdf.ptr(), sdf.size());
+    }
+    {
+        ArrayOutput output(bgzf);
+        GZipOutput gzip(output, 6, true);
+        gzip.write(sdf.ptr(), sdf.size());
+    }
+    // Two members split in the middle of a record
+    {
+        ArrayOutput output(multi);
+        {
+            GZipOutput gzip(output, 6);
+            gzip.write(sdf.ptr(), sdf.size() / 2);
+        }
+        GZipOutput gzip(output, 6);
+        gzip.write(sdf.ptr() + sdf.size() / 2, sdf.size() - sdf.size() / 2);
+    }
+
+    BufferScanner bgzf_scanner(bgzf);
+    ASSERT_TRUE(GZipScanner::isBGZF(bgzf_scanner));
+    ASSERT_GT(bgzf.size(), 0);
+
+    BufferScanner plain_scanner(sdf);
+    SdfLoader plain(plain_scanner);
+    int count = plain.count();
+    // Records before and after the access point, in both directions
+    const int indices[] = {count - 1, 0, count / 2, count - count / 8, count / 8};
+
+    auto check = [&](SdfLoader& loader) {
+        for (int index : indices)
+        {
+            plain.readAt(index);
+            loader.readAt(index);
+            ASSERT_EQ(plain.data.size(), loader.data.size()) << index;
+            ASSERT_EQ(0, memcmp(plain.data.ptr(), loader.data.ptr(), plain.data.size())) << index;
+        }
+    };
+
+    for (Array<char>* compressed : {&single, &bgzf, &multi})
+    {
+        BufferScanner scanner(*compressed);
+        SdfLoader loader(scanner);
+
+        loader.setThreads(2);
+        ASSERT_EQ(count, loader.count());
+        check(loader);
+    }
+
+    // Access points kept in the sidecar of a file
+    const std::string gz_path = ::testing::TempDir() + "random_access.sdf.gz";
+    {
+        FileOutput output(gz_path.c_str());
+        output.write(single.ptr(), single.size());
+    }
+
+    RecordIndex index;
+    {
+        FileScanner scanner(gz_path.c_str());
+        SdfLoader loader(scanner);
+        loader.buildIndex(index);
+        index.save(ENCODING_ASCII, gz_path.c_str());
+    }
+    // A point in the middle of the member keeps its 32 KB window
+    ASSERT_GT(index.access_points.size(), 32768);
+
+    // Without the sidecar the records are found by reading forward
+    {
+        FileScanner scanner(gz_path.c_str());
+        SdfLoader loader(scanner);
+        check(loader);
+    }
+
+    RecordIndex loaded;
+    ASSERT_TRUE(loaded.load(ENCODING_ASCII, gz_path.c_str()));
+    ASSERT_EQ(index.access_points.size(), loaded.access_points.size());
+    ASSERT_EQ(0, memcmp(index.access_points.ptr(), loaded.access_points.ptr(), index.access_points.size()));
+    {
+        FileScanner scanner(gz_path.c_str());
+        SdfLoader loader(scanner);
+        loader.loadIndex(loaded);
+        ASSERT_EQ(count, loader.count());
+        check(loader);
+    }
+
+    Array<char> sidecar;
+    RecordIndex::getSidecarName(gz_path.c_str(), sidecar);
+    std::remove(sidecar.ptr());
+    std::remove(gz_path.c_str());
+}
+
+TEST_F(IndigoCoreFormatsTest, cmf_lazy_loading)
+{
+    Molecule mol;
+    loadMolecule("C[C@H](N)/C=C/C(O)=O", mol);
+    mol.highlightAtom(1);
+    mol.highlightBond(0);
+
+    Array<char> buf;
+    ArrayOutput buf_out(buf);
+    CmfSaver cmf_saver(buf_out);
+    cmf_saver.saveMolecule(mol);
+
+    Molecule full;
+    BufferScanner full_scanner(buf);
+    CmfLoader full_loader(full_scanner);
+    full_loader.loadMolecule(full);
+    ASSERT_EQ(1, full.stereocenters.size());
+    ASSERT_EQ(1, full.cis_trans.count());
+
+    Molecule lazy;
+    BufferScanner lazy_scanner(buf);
+    CmfLoader lazy_loader(lazy_scanner);
+    lazy_loader.lazy = true;
+    lazy_loader.loadMolecule(lazy);
+
+    ASSERT_EQ(full.vertexCount(), lazy.vertexCount());
+    ASSERT_EQ(full.edgeCount(), lazy.edgeCount());
+    ASSERT_EQ(0, lazy.stereocenters.size());
+    ASSERT_EQ(0, lazy.cis_trans.count());
+    ASSERT_FALSE(lazy.isAtomHighlighted(1));
+
+    lazy_loader.loadStereo();
+    lazy_loader.loadHighlighting();
+    // A second call does not add anything
+    lazy_loader.loadStereo();
+
+    ASSERT_EQ(1, lazy.stereocenters.size());
+    ASSERT_EQ(1, lazy.cis_trans.count());
+    for (int i = full.vertexBegin(); i != full.vertexEnd(); i = full.vertexNext(i))
+    {
+        ASSERT_EQ(full.stereocenters.getType(i), lazy.stereocenters.getType(i));
+        ASSERT_EQ(full.isAtomHighlighted(i), lazy.isAtomHighlighted(i));
+    }
+    for (int i = full.edgeBegin(); i != full.edgeEnd(); i = full.edgeNext(i))
+    {
+        ASSERT_EQ(full.cis_trans.getParity(i), lazy.cis_trans.getParity(i));
+        ASSERT_EQ(full.isBondHighlighted(i), lazy.isBondHighlighted(i));
+    }
+}
+
+TEST_F(IndigoCoreFormatsTest, arrow_ipc_layout)
+{
+    ASSERT_TRUE(ArrowColumn::isValidUtf8("\xC3\xA9\xF0\x9F\x98\x80", 6));
+    ASSERT_FALSE(ArrowColumn::isValidUtf8("\xC0\xAF", 2));     // overlong
+    ASSERT_FALSE(ArrowColumn::isValidUtf8("\xED\xA0\x80", 3)); // surrogate
+    ASSERT_FALSE(ArrowColumn::isValidUtf8("\xE2\x82", 2));     // truncated
+
+    Array<char> file;
+    ArrayOutput output(file);
+    ArrowIpcWriter writer(output);
+
+    ASSERT_THROW(writer.addField("\xFF", ArrowColumn::UTF8), Exception);
+    writer.addField("name", ArrowColumn::UTF8);
+    writer.addField("mw", ArrowColumn::FLOAT64);
+    writer.addField("cmf", ArrowColumn::BINARY);
+
+    ObjArray<ArrowColumn> columns;
+    columns.push().init(ArrowColumn::UTF8);
+    columns.push().init(ArrowColumn::FLOAT64);
+    columns.push().init(ArrowColumn::BINARY);
+
+    // Rows 1 and 3 of "name" are null, the second because it is not UTF-8
+    columns[0].appendBytes("a", 1);
+    columns[0].appendNull();
+    columns[0].appendBytes("\xC3\xA9", 2);
+    columns[0].appendBytes("\xFF", 1);
+    columns[0].appendBytes("", 0);
+    for (int i = 0; i < 5; i++)
+    {
+        if (i == 2)
+            columns[1].appendNull();
+        else
+            columns[1].appendDouble(i + 0.5);
+        columns[2].appendBytes("\xFF", 1);
+    }
+    writer.writeBatch(columns);
+    for (int i = 0; i < columns.size(); i++)
+        columns[i].clear();
+    columns[0].appendBytes("b", 1);
+    columns[1].appendDouble(1);
+    columns[2].appendNull();
+    writer.writeBatch(columns);
+    writer.close();
+
+    ASSERT_EQ(0, memcmp(file.ptr(), "ARROW1\0\0", 8));
+    ASSERT_EQ(0, memcmp(file.ptr() + file.size() - 6, "ARROW1", 6));
+
+    // Footer: schema and the record batch blocks
+    int footer_length;
+    memcpy(&footer_length, file.ptr() + file.size() - 10, 4);
+    FlatReader footer(file.ptr() + file.size() - 10 - footer_length);
+    int root = footer.root();
+
+    int schema = footer.deref(root, 1);
+    int fields = footer.deref(schema, 1);
+    ASSERT_EQ(3, footer.vectorSize(fields));
+    const char* names[] = {"name", "mw", "cmf"};
+    const int types[] = {5, 3, 4}; // Utf8, FloatingPoint, Binary
+    for (int i = 0; i < 3; i++)
+    {
+        int pos = fields + 4 + i * 4;
+        int field = pos + footer.read<unsigned>(pos);
+        ASSERT_EQ(names[i], footer.string(field, 0));
+        ASSERT_EQ(1, footer.read<unsigned char>(footer.field(field, 1)));
+        ASSERT_EQ(types[i], footer.read<unsigned char>(footer.field(field, 2)));
+    }
+
+    int blocks = footer.deref(root, 3);
+    ASSERT_EQ(2, footer.vectorSize(blocks));
+    long long offset = footer.read<long long>(blocks + 4);
+    int metadata_length = footer.read<int>(blocks + 4 + 8);
+
+    // The first batch: continuation marker, metadata length, then the message
+    ASSERT_EQ(-1, *(const int*)(file.ptr() + offset));
+    FlatReader message(file.ptr() + offset + 8);
+    int message_root = message.root();
+    ASSERT_EQ(3, message.read<unsigned char>(message.field(message_root, 1))); // RecordBatch
+    int batch = message.deref(message_root, 2);
+    ASSERT_EQ(5, message.read<long long>(message.field(batch, 0)));
+
+    int nodes = message.deref(batch, 1);
+    ASSERT_EQ(3, message.vectorSize(nodes));
+    ASSERT_EQ(2, message.read<long long>(nodes + 4 + 8));
+    ASSERT_EQ(1, message.read<long long>(nodes + 4 + 16 + 8));
+    ASSERT_EQ(0, message.read<long long>(nodes + 4 + 32 + 8));
+
+    // Buffers of "name": validity bitmap, offsets, data
+    int buffers = message.deref(batch, 2);
+    ASSERT_EQ(8, message.vectorSize(buffers));
+    const char* body = file.ptr() + offset + metadata_length;
+    auto buffer = [&](int i) { return body + message.read<long long>(buffers + 4 + i * 16); };
+    auto bufferLength = [&](int i) { return message.read<long long>(buffers + 4 + i * 16 + 8); };
+
+    ASSERT_EQ(1, bufferLength(0));
+    ASSERT_EQ(0x15, (unsigned char)buffer(0)[0]);
+    const int expected_offsets[] = {0, 1, 1, 3, 3, 3};
+    ASSERT_EQ(24, bufferLength(1));
+    ASSERT_EQ(0, memcmp(expected_offsets, buffer(1), sizeof(expected_offsets)));
+    ASSERT_EQ(3, bufferLength(2));
+    ASSERT_EQ(0, memcmp("a\xC3\xA9", buffer(2), 3));
+
+    // "mw": validity bitmap and values
+    ASSERT_EQ(0x1B, (unsigned char)buffer(3)[0]);
+    double value;
+    memcpy(&value, buffer(4) + 8, 8);
+    ASSERT_EQ(1.5, value);
+
+    // Binary cells are not checked for UTF-8
+    ASSERT_EQ(0x1F, (unsigned char)buffer(5)[0]);
+    ASSERT_EQ(5, bufferLength(7));
+}
+
+
+TEST_F(IndigoCoreFormatsTest, ket_plain_molecules)
+{
+    const char* smiles[] = {"[NH3+]CC([O-])=O", "[2H]C([3H])[13CH2]C", "[CH3:1][OH:2].[Na+]", "C/C=C/C(F)=C(/Cl)Br",
+                            "C[C@H](N)C(O)=O |o1:1|", "C[C@@H]1CC[C@H](O)CC1 |&1:1,4|", "CN(=O)=O"};
+
+    for (const char* s : smiles)
+    {
+        Molecule source;
+        loadMolecule(s, source);
+        // Coordinates and wedges, which the stereocenters are read back from
+        MoleculeLayout layout(source);
+        layout.make();
+        source.markBondsStereocenters();
+        Array<char> ket;
+        {
+            ArrayOutput output(ket);
+            MoleculeJsonSaver saver(output);
+            saver.saveMolecule(source);
+        }
+
+        Molecule plain, dom;
+        {
+            BufferScanner scanner(ket);
+            MoleculeJsonLoader loader;
+            ASSERT_TRUE(loader.loadPlainMolecule(scanner, plain)) << s;
+            ASSERT_TRUE(scanner.isEOF());
+        }
+        {
+            BufferScanner scanner(ket);
+            rapidjson::Document data;
+            ASSERT_TRUE(MultipleKetLoader::parse(scanner, data));
+            MoleculeJsonLoader loader(data);
+            loader.loadMolecule(dom);
+        }
+
+        ASSERT_EQ(dom.vertexCount(), plain.vertexCount()) << s;
+        ASSERT_EQ(dom.edgeCount(), plain.edgeCount()) << s;
+        for (int i = dom.vertexBegin(); i != dom.vertexEnd(); i = dom.vertexNext(i))
+        {
+            ASSERT_EQ(dom.getAtomNumber(i), plain.getAtomNumber(i)) << s;
+            ASSERT_EQ(dom.getAtomCharge(i), plain.getAtomCharge(i)) << s;
+            ASSERT_EQ(dom.getAtomIsotope(i), plain.getAtomIsotope(i)) << s;
+            ASSERT_EQ(dom.getAtomRadical(i), plain.getAtomRadical(i)) << s;
+            ASSERT_EQ(dom.reaction_atom_mapping[i], plain.reaction_atom_mapping[i]) << s;
+            ASSERT_EQ(dom.stereocenters.getType(i), plain.stereocenters.getType(i)) << s;
+            if (dom.stereocenters.getType(i) != 0)
+                ASSERT_EQ(dom.stereocenters.getGroup(i), plain.stereocenters.getGroup(i)) << s;
+            ASSERT_TRUE(dom.getAtomXyz(i).x == plain.getAtomXyz(i).x && dom.getAtomXyz(i).y == plain.getAtomXyz(i).y) << s;
+        }
+        for (int i = dom.edgeBegin(); i != dom.edgeEnd(); i = dom.edgeNext(i))
+        {
+            ASSERT_EQ(dom.getBondOrder(i), plain.getBondOrder(i)) << s;
+            ASSERT_EQ(dom.getBondDirection(i), plain.getBondDirection(i)) << s;
+            ASSERT_EQ(dom.cis_trans.getParity(i), plain.cis_trans.getParity(i)) << s;
+        }
+    }
+
+    // Anything but plain atoms and bonds is left to the DOM, with the scanner untouched
+    const char* other[] = {
+        R"({"root":{"nodes":[{"$ref":"mol0"}]},"mol0":{"type":"molecule","atoms":[{"label":"Pol","location":[0,0,0]}]}})",
+        R"({"root":{"nodes":[{"$ref":"mol0"}]},"mol0":{"type":"molecule","atoms":[{"label":"C","location":[0,0,0],"hCount":2}]}})",
+        R"({"root":{"nodes":[{"$ref":"mol0"}]},"mol0":{"type":"molecule","atoms":[{"label":"C","location":[0,0,0]}]}} {})",
+        R"({"root":{"nodes":[{"$ref":"mol1"}]},"mol0":{"type":"molecule","atoms":[{"label":"C","location":[0,0,0]}]}})"};
+
+    for (const char* s : other)
+    {
+        BufferScanner scanner(s);
+        Molecule molecule;
+        MoleculeJsonLoader loader;
+        ASSERT_FALSE(loader.loadPlainMolecule(scanner, molecule)) << s;
+        ASSERT_EQ(0, scanner.tell());
+        ASSERT_EQ(0, molecule.vertexCount());
+    }
+}
+
+TEST_F(IndigoCoreFormatsTest, ket_plain_reactions)
+{
+    const char* smiles[] = {"CC(=O)O.OCC>>CC(=O)OCC.O", "[CH3:1][Br:2]>>[CH3:1][OH:3]", "C=C.C=CC=C>>C1=CCCCC1"};
+
+    for (const char* s : smiles)
+    {
+        Reaction source;
+        {
+            BufferScanner scanner(s);
+            RSmilesLoader loader(scanner);
+            loader.loadReaction(source);
+        }
+        ReactionLayout layout(source);
+        layout.make();
+        Array<char> ket;
+        {
+            ArrayOutput output(ket);
+            ReactionJsonSaver saver(output);
+            saver.saveReaction(source);
+        }
+
+        Reaction plain, dom;
+        {
+            BufferScanner scanner(ket);
+            ReactionJsonLoader loader;
+            ASSERT_TRUE(loader.loadPlainReaction(scanner, plain)) << s;
+            ASSERT_TRUE(scanner.isEOF());
+        }
+        {
+            BufferScanner scanner(ket);
+            rapidjson::Document data;
+            ASSERT_TRUE(MultipleKetLoader::parse(scanner, data));
+            ReactionJsonLoader loader(data);
+            loader.loadReaction(dom);
+        }
+
+        ASSERT_EQ(source.reactantsCount(), plain.reactantsCount()) << s;
+        ASSERT_EQ(dom.reactantsCount(), plain.reactantsCount()) << s;
+        ASSERT_EQ(dom.productsCount(), plain.productsCount()) << s;
+        ASSERT_EQ(dom.meta().metaData().size(), plain.meta().metaData().size()) << s;
+        for (int i = dom.begin(), j = plain.begin(); i != dom.end(); i = dom.next(i), j = plain.next(j))
+        {
+            ASSERT_EQ(dom.getSideType(i), plain.getSideType(j)) << s;
+            Molecule& a = dom.getMolecule(i);
+            Molecule& b = plain.getMolecule(j);
+            ASSERT_EQ(a.vertexCount(), b.vertexCount()) << s;
+            ASSERT_EQ(a.edgeCount(), b.edgeCount()) << s;
+            for (int k = a.vertexBegin(); k != a.vertexEnd(); k = a.vertexNext(k))
+            {
+                ASSERT_EQ(a.getAtomNumber(k), b.getAtomNumber(k)) << s;
+                ASSERT_EQ(a.reaction_atom_mapping[k], b.reaction_atom_mapping[k]) << s;
+            }
+        }
+    }
+
+    // A text box is left to the DOM
+    const char* other = R"({"root":{"nodes":[{"$ref":"mol0"},{"type":"arrow","data":{"mode":"open-angle","pos":[{"x":1,"y":0,"z":0},{"x":2,"y":0,"z":0}]}},)"
+                        R"({"type":"text","data":{"content":"","position":{"x":0,"y":0,"z":0}}}]},)"
+                        R"("mol0":{"type":"molecule","atoms":[{"label":"C","location":[0,0,0]}]}})";
+    BufferScanner scanner(other);
+    Reaction reaction;
+    ReactionJsonLoader loader;
+    ASSERT_FALSE(loader.loadPlainReaction(scanner, reaction));
+    ASSERT_EQ(0, scanner.tell());
+}
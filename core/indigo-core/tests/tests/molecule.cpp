@@ -19,10 +19,17 @@
 #include <gtest/gtest.h>
 
 #include <base_cpp/output.h>
+#include <base_cpp/profiling.h>
+#include <base_cpp/scanner.h>
 #include <molecule/crippen.h>
 #include <molecule/hybridization.h>
 #include <molecule/lipinski.h>
+#include <molecule/molecule_compiled_query.h>
 #include <molecule/molecule_mass.h>
+#include <molecule/molecule_neighbourhood_counters.h>
+#include <molecule/molecule_query_set_matcher.h>
+#include <molecule/molecule_query_symmetry.h>
+#include <molecule/molecule_substructure_matcher.h>
 #include <molecule/smiles_loader.h>
 #include <molecule/tpsa.h>
 
@@ -297,3 +304,426 @@ TEST_F(IndigoCoreMoleculeTest, hybridization)
         }
     }
 }
+
+TEST_F(IndigoCoreMoleculeTest, compiled_query)
+{
+    const char* smarts[] = {"[N&a,O&a,S&X2]", "[#6;R2;!a]", "[C,N;H1,H2;+0]", "[!#6;!#1;D2,D3]", "[c;r6;v4]", "[*;x2,X3;!R]", "[#7,#8;-,+]"};
+    const char* targets[] = {"c1ccncc1CS(=O)C", "OC(=O)c1ccc2ccccc2c1N", "C[N+](C)(C)CC[O-]", "NC1CCCC2C1CC=C2"};
+
+    for (auto target_smiles : targets)
+    {
+        Molecule target;
+        loadMolecule(target_smiles, target);
+        target.aromatize(AromaticityOptions());
+
+        for (auto query_smarts : smarts)
+        {
+            QueryMolecule query;
+            BufferScanner scanner(query_smarts);
+            SmilesLoader loader(scanner);
+            loader.loadSMARTS(query);
+
+            MoleculeCompiledQuery compiled;
+            compiled.compile(query);
+            compiled.setTarget(target);
+
+            for (int q = query.vertexBegin(); q != query.vertexEnd(); q = query.vertexNext(q))
+                for (int t = target.vertexBegin(); t != target.vertexEnd(); t = target.vertexNext(t))
+                {
+                    bool expected = MoleculeSubstructureMatcher::matchQueryAtom(&query.getAtom(q), target, t, 0, 0xFFFFFFFF);
+                    ASSERT_EQ(expected, compiled.matchAtom(q, t, 0, 0xFFFFFFFF)) << query_smarts << " on " << target_smiles << ", atom " << t;
+                }
+        }
+    }
+}
+
+TEST_F(IndigoCoreMoleculeTest, query_set_matcher)
+{
+    const char* smarts[] = {"c1ccccc1", "c1ccccc1[N+](=O)[O-]", "C(=O)[OH]", "[#6]C(=O)O[#6]", "N=N", "[N;!H0]c", "[#1]O", "*~*~*~*~*", "C=CC=O", "S(=O)(=O)N", "[Cl,Br,I]C"};
+    const char* targets[] = {"OC(=O)c1ccccc1[N+](=O)[O-]", "CCOC(=O)C", "C=CC=O", "Nc1ccc(cc1)S(=O)(=O)N", "CN=NC", "ClCC", "C"};
+
+    ObjArray<QueryMolecule> queries;
+    MoleculeQuerySetMatcher set_matcher;
+
+    for (auto query_smarts : smarts)
+    {
+        QueryMolecule& query = queries.push();
+        BufferScanner scanner(query_smarts);
+        SmilesLoader loader(scanner);
+        loader.loadSMARTS(query);
+    }
+    for (int i = 0; i < queries.size(); i++)
+        set_matcher.addQuery(queries[i]);
+
+    for (auto target_smiles : targets)
+    {
+        Molecule target;
+        loadMolecule(target_smiles, target);
+
+        Array<int> ids;
+        set_matcher.match(target, ids);
+
+        Array<int> expected;
+        for (int i = 0; i < queries.size(); i++)
+        {
+            Molecule copy;
+            copy.clone(target, 0, 0);
+            copy.aromatize(AromaticityOptions());
+
+            MoleculeSubstructureMatcher matcher(copy);
+            matcher.setQuery(queries[i]);
+            if (matcher.find())
+                expected.push(i);
+        }
+
+        ASSERT_EQ(expected.size(), ids.size()) << target_smiles;
+        for (int i = 0; i < ids.size(); i++)
+            ASSERT_EQ(expected[i], ids[i]) << target_smiles;
+        ASSERT_LE(set_matcher.lastCandidatesCount(), queries.size());
+    }
+
+    // Methane meets only the requirements of "*~*~*~*~*" and "[Cl,Br,I]C"
+    Molecule methane;
+    Array<int> ids;
+    loadMolecule("C", methane);
+    set_matcher.match(methane, ids);
+    ASSERT_EQ(2, set_matcher.lastCandidatesCount());
+}
+
+TEST_F(IndigoCoreMoleculeTest, shared_embedding_enumerator)
+{
+    const char* targets[] = {"c1ccccc1CC(=O)O", "CCN", "OC(=O)C1CCCCC1C(=O)O", "C"};
+
+    QueryMolecule query;
+    BufferScanner scanner("[#6]C(=O)[OH]");
+    SmilesLoader loader(scanner);
+    loader.loadSMARTS(query);
+
+    Molecule first;
+    loadMolecule(targets[0], first);
+    EmbeddingEnumerator ee(first);
+
+    for (auto target_smiles : targets)
+    {
+        Molecule target;
+        loadMolecule(target_smiles, target);
+        target.aromatize(AromaticityOptions());
+
+        MoleculeSubstructureMatcher own(target);
+        own.find_all_embeddings = true;
+        own.find_unique_embeddings = true;
+        own.setQuery(query);
+        bool expected = own.find();
+
+        for (int i = 0; i < 2; i++)
+        {
+            MoleculeSubstructureMatcher shared(target);
+            shared.setEmbeddingEnumerator(&ee);
+            shared.find_all_embeddings = true;
+            shared.find_unique_embeddings = true;
+            shared.setQuery(query);
+            ASSERT_EQ(expected, shared.find()) << target_smiles;
+            if (expected)
+                ASSERT_EQ(own.getEmbeddingsStorage().count(), shared.getEmbeddingsStorage().count()) << target_smiles;
+        }
+    }
+}
+
+static bool _countEmbeddingCallback(Graph& sub, Graph& super, const int* core1, const int* core2, void* context)
+{
+    (*(int*)context)++;
+    return true;
+}
+
+TEST_F(IndigoCoreMoleculeTest, count_embeddings)
+{
+    const char* queries[] = {"c1ccccc1", "*~*~*", "C(C)(C)C", "[#6]C(=O)[OH]", "CC"};
+    const char* targets[] = {"c1ccccc1Cc1ccccc1", "CC(C)(C)CCO", "OC(=O)C1CCCCC1C(=O)O"};
+
+    {
+        QueryMolecule benzene;
+        BufferScanner scanner(queries[0]);
+        SmilesLoader loader(scanner);
+        loader.loadSMARTS(benzene);
+
+        Array<int> ignored;
+        ignored.clear_resize(benzene.vertexEnd());
+        ignored.zerofill();
+
+        MoleculeQuerySymmetry symmetry;
+        ASSERT_TRUE(symmetry.build(benzene, ignored.ptr(), 1024));
+        ASSERT_EQ(12, symmetry.groupSize());
+        ASSERT_FALSE(symmetry.build(benzene, ignored.ptr(), 4));
+        ASSERT_EQ(1, symmetry.groupSize());
+    }
+
+    for (auto query_smarts : queries)
+    {
+        QueryMolecule query;
+        BufferScanner scanner(query_smarts);
+        SmilesLoader loader(scanner);
+        loader.loadSMARTS(query);
+
+        for (auto target_smiles : targets)
+        {
+            Molecule target;
+            loadMolecule(target_smiles, target);
+            target.aromatize(AromaticityOptions());
+
+            for (int unique = 0; unique < 2; unique++)
+            {
+                int expected = 0;
+                MoleculeSubstructureMatcher reference(target);
+                reference.find_all_embeddings = true;
+                reference.find_unique_embeddings = unique != 0;
+                reference.cb_embedding = _countEmbeddingCallback;
+                reference.cb_embedding_context = &expected;
+                reference.setQuery(query);
+                reference.find();
+
+                for (int limit : {0, 5})
+                {
+                    MoleculeSubstructureMatcher matcher(target);
+                    matcher.find_unique_embeddings = unique != 0;
+                    matcher.setQuery(query);
+                    ASSERT_EQ(limit > 0 ? std::min(expected, limit) : expected, matcher.countEmbeddings(limit)) << query_smarts << " " << target_smiles;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(IndigoCoreMoleculeTest, ring_data_edits)
+{
+    Molecule molecule;
+    loadMolecule("C1CCC2CCCCC2C1CCO", molecule);
+
+    ASSERT_EQ(2, molecule.sssrCount());
+    ASSERT_EQ(2, molecule.vertexCountSSSR(3));
+    ASSERT_EQ(0, molecule.vertexSmallestRingSize(11));
+
+    // Pendant atoms and bonds do not touch the rings
+    molecule.unfoldHydrogens(0);
+    ASSERT_EQ(2, molecule.sssrCount());
+    for (int v = molecule.vertexBegin(); v != molecule.vertexEnd(); v = molecule.vertexNext(v))
+    {
+        ASSERT_EQ(v < 10 ? 6 : 0, molecule.vertexSmallestRingSize(v));
+        ASSERT_EQ(v == 3 || v == 8 ? 2 : (v < 10 ? 1 : 0), molecule.vertexCountSSSR(v));
+    }
+    for (int e = molecule.edgeBegin(); e != molecule.edgeEnd(); e = molecule.edgeNext(e))
+    {
+        const Edge& edge = molecule.getEdge(e);
+        bool ring = edge.beg < 10 && edge.end < 10;
+        ASSERT_EQ(ring ? TOPOLOGY_RING : TOPOLOGY_CHAIN, molecule.getEdgeTopology(e));
+        ASSERT_EQ(ring ? 6 : 0, molecule.edgeSmallestRingSize(e));
+    }
+
+    Molecule copy;
+    copy.clone(molecule, 0, 0);
+    ASSERT_EQ(2, copy.sssrCount());
+    ASSERT_EQ(2, copy.vertexCountSSSR(8));
+
+    molecule.removeAtom(12);
+    ASSERT_EQ(2, molecule.sssrCount());
+
+    // Breaking a ring bond drops the ring data
+    molecule.removeBond(molecule.findEdgeIndex(0, 1));
+    ASSERT_EQ(1, molecule.sssrCount());
+    ASSERT_EQ(0, molecule.vertexSmallestRingSize(0));
+    ASSERT_EQ(TOPOLOGY_CHAIN, molecule.getEdgeTopology(molecule.findEdgeIndex(1, 2)));
+    ASSERT_EQ(2, copy.sssrCount());
+}
+
+TEST_F(IndigoCoreMoleculeTest, ring_systems)
+{
+    Molecule molecule;
+    // Naphthalene, a spiro pair of rings and a separate cyclopropane
+    loadMolecule("c1ccc2ccccc2c1CCC13(CCC1)CCC3.C1CC1", molecule);
+
+    ASSERT_EQ(3, molecule.countRingSystems());
+    ASSERT_EQ(molecule.vertexRingSystem(0), molecule.vertexRingSystem(5));
+    ASSERT_EQ(-1, molecule.vertexRingSystem(10));
+    ASSERT_EQ(molecule.vertexRingSystem(12), molecule.vertexRingSystem(18));
+    ASSERT_NE(molecule.vertexRingSystem(0), molecule.vertexRingSystem(12));
+    ASSERT_NE(molecule.vertexRingSystem(12), molecule.vertexRingSystem(20));
+
+    // A pendant atom keeps the ring systems, a ring bond edit drops them
+    int atom = molecule.addAtom(ELEM_C);
+    molecule.addBond(atom, 10, BOND_SINGLE);
+    ASSERT_EQ(-1, molecule.vertexRingSystem(atom));
+    ASSERT_EQ(3, molecule.countRingSystems());
+
+    Molecule copy;
+    copy.clone(molecule, 0, 0);
+    ASSERT_EQ(3, copy.countRingSystems());
+
+    molecule.addBond(9, 12, BOND_SINGLE);
+    ASSERT_EQ(2, molecule.countRingSystems());
+    ASSERT_EQ(molecule.vertexRingSystem(0), molecule.vertexRingSystem(15));
+    ASSERT_EQ(3, copy.countRingSystems());
+}
+
+#ifdef INDIGO_PROFILE_RING_DATA
+TEST_F(IndigoCoreMoleculeTest, ring_data_counters)
+{
+    auto counter = [](const char* name) { return sf::xlock_safe_ptr(ProfilingSystem::getInstance())->getLabelValue(name, true); };
+    auto calculations = [&]() { return counter("graph.sssr_calculated") + counter("graph.ring_topology_calculated"); };
+    qword lookups = counter("graph.ring_lookups");
+    qword calculated = calculations();
+
+    {
+        Graph graph;
+        for (int i = 0; i < 4; i++)
+            graph.addVertex();
+        graph.addEdge(0, 1);
+        graph.addEdge(1, 2);
+        graph.addEdge(2, 0);
+        graph.addEdge(2, 3);
+
+        ASSERT_EQ(1, graph.sssrCount());
+        ASSERT_EQ(3, graph.vertexSmallestRingSize(0));
+        ASSERT_EQ(0, graph.vertexSmallestRingSize(3));
+        ASSERT_EQ(TOPOLOGY_CHAIN, graph.getEdgeTopology(3));
+        ASSERT_EQ(TOPOLOGY_RING, graph.getEdgeTopology(0));
+    }
+
+    // Five lookups, two of them calculate (SSSR and topology)
+    ASSERT_EQ(lookups + 5, counter("graph.ring_lookups"));
+    ASSERT_EQ(calculated + 2, calculations());
+}
+#endif
+
+TEST_F(IndigoCoreMoleculeTest, smiles_plain_fast_path)
+{
+    // The empty CXSMILES block sends the same string to the full parser
+    const char* smiles[] = {"CC(=O)Oc1ccccc1C(=O)O", "c1cc[nH]c1", "C1CCCC=1", "C=1CCCC1",          "[13CH4]",  "[NH4+].[Cl-]", "[O--]",  "[Fe+3]",
+                            "c1ccc2ccccc2c1",        "c1cccc1",    "C%10CC%10", "c1ccccc1-c1ccccc1", "b1ccccc1", "[c-]1cccc1",   "C(C",    "N(=O)=O"};
+
+    std::vector<std::string> items(std::begin(smiles), std::end(smiles));
+    FileScanner file(dataPath("molecules/basic/pubchem_slice_5000.smi").c_str());
+    Array<char> line;
+    while (!file.isEOF())
+    {
+        file.readLine(line, true);
+        if (line.size() > 1)
+            items.emplace_back(line.ptr());
+    }
+
+    for (const std::string& item : items)
+    {
+        Molecule fast, full;
+        std::string cx = item + " ||";
+
+        BufferScanner full_scanner(cx.c_str());
+        try
+        {
+            SmilesLoader(full_scanner).loadMolecule(full);
+        }
+        catch (Exception&)
+        {
+            BufferScanner fast_scanner(item.c_str());
+            ASSERT_THROW(SmilesLoader(fast_scanner).loadMolecule(fast), Exception) << item;
+            continue;
+        }
+        BufferScanner fast_scanner(item.c_str());
+        SmilesLoader(fast_scanner).loadMolecule(fast);
+
+        ASSERT_EQ(full.vertexCount(), fast.vertexCount()) << item;
+        ASSERT_EQ(full.edgeCount(), fast.edgeCount()) << item;
+        for (int i = full.vertexBegin(); i != full.vertexEnd(); i = full.vertexNext(i))
+        {
+            ASSERT_EQ(full.getAtomNumber(i), fast.getAtomNumber(i)) << item;
+            ASSERT_EQ(full.getAtomCharge(i), fast.getAtomCharge(i)) << item;
+            ASSERT_EQ(full.getAtomIsotope(i), fast.getAtomIsotope(i)) << item;
+            ASSERT_EQ(full.getAtomRadical_NoThrow(i, -1), fast.getAtomRadical_NoThrow(i, -1)) << item;
+            ASSERT_EQ(full.getAtomAromaticity(i), fast.getAtomAromaticity(i)) << item;
+            ASSERT_EQ(full.getImplicitH_NoThrow(i, -1), fast.getImplicitH_NoThrow(i, -1)) << item;
+        }
+        for (int i = full.edgeBegin(); i != full.edgeEnd(); i = full.edgeNext(i))
+        {
+            ASSERT_EQ(full.getEdge(i).beg, fast.getEdge(i).beg) << item;
+            ASSERT_EQ(full.getEdge(i).end, fast.getEdge(i).end) << item;
+            ASSERT_EQ(full.getBondOrder(i), fast.getBondOrder(i)) << item;
+        }
+    }
+
+    // Errors still come from the full parser
+    Molecule molecule;
+    BufferScanner scanner("CC=");
+    ASSERT_THROW(SmilesLoader(scanner).loadMolecule(molecule), Exception);
+}
+
+TEST_F(IndigoCoreMoleculeTest, neighbourhood_counters_packed)
+{
+    // A center with n C-N arms: its counters and the ones of its neighbours
+    // grow past the 7-bit lanes of the packed signatures for large n
+    auto star = [](int n, Molecule& mol) {
+        int center = mol.addAtom(ELEM_C);
+        for (int i = 0; i < n; i++)
+        {
+            int arm = mol.addAtom(ELEM_C);
+            mol.addBond(center, arm, BOND_SINGLE);
+            mol.addBond(arm, mol.addAtom(ELEM_N), i % 2 == 0 ? BOND_DOUBLE : BOND_SINGLE);
+        }
+    };
+
+    ObjArray<Molecule> molecules;
+    for (int n : {3, 60, 100, 126, 127, 128, 130})
+        star(n, molecules.push());
+    for (const char* smiles : {"CC(=O)Oc1ccccc1C(=O)O", "C=CC", "CCC", "c1ccncc1", "OCC#N", "CC(C)(C)C", "N#CC(C#N)(C#N)C#N"})
+        loadMolecule(smiles, molecules.push());
+
+    ObjArray<MoleculeAtomNeighbourhoodCounters> counters;
+    for (int i = 0; i < molecules.size(); i++)
+        counters.push().calculate(molecules[i]);
+
+    // Query molecules have their own counters
+    for (const char* smarts : {"[#6]=[#6]", "c1ccccc1", "[#6]~[#7]", "C(C)(C)(C)C"})
+    {
+        QueryMolecule query;
+        BufferScanner scanner(smarts);
+        SmilesLoader loader(scanner);
+        loader.loadSMARTS(query);
+        counters.push().calculate(query);
+    }
+
+    int clamped = 0, clamped_rejected = 0, clamped_accepted = 0, bond_types_only = 0;
+    for (int q = 0; q < counters.size(); q++)
+    {
+        const MoleculeAtomNeighbourhoodCounters& query = counters[q];
+        for (int t = 0; t < molecules.size(); t++)
+        {
+            const MoleculeAtomNeighbourhoodCounters& target = counters[t];
+            for (int qa = 0; qa < query._per_atom_counters.size(); qa++)
+            {
+                if (!query._use_atom[qa])
+                    continue;
+                if (t == 0 && !query._signature_exact[qa])
+                    clamped++;
+                for (int ta = 0; ta < target._per_atom_counters.size(); ta++)
+                {
+                    if (!target._use_atom[ta])
+                        continue;
+                    bool expected[2];
+                    for (int use_bond_types = 0; use_bond_types < 2; use_bond_types++)
+                    {
+                        expected[use_bond_types] = query._per_atom_counters[qa].testSubstructure(target._per_atom_counters[ta], use_bond_types != 0);
+                        ASSERT_EQ(expected[use_bond_types], query.testSubstructure(target, qa, ta, use_bond_types != 0))
+                            << "query " << q << ":" << qa << ", target " << t << ":" << ta << ", use_bond_types " << use_bond_types;
+                    }
+                    if (!query._signature_exact[qa])
+                        (expected[1] ? clamped_accepted : clamped_rejected)++;
+                    if (expected[0] != expected[1])
+                        bond_types_only++;
+                }
+            }
+        }
+    }
+
+    // Clamped query atoms went through the exact check both ways, and the
+    // degree lanes made a difference somewhere
+    ASSERT_GT(clamped, 0);
+    ASSERT_GT(clamped_accepted, 0);
+    ASSERT_GT(clamped_rejected, 0);
+    ASSERT_GT(bond_types_only, 0);
+}
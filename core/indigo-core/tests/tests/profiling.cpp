@@ -0,0 +1,141 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <base_cpp/output.h>
+#include <base_cpp/profiling.h>
+
+#include "common.h"
+
+using namespace indigo;
+
+class IndigoCoreProfilingTest : public IndigoCoreTest
+{
+};
+
+TEST_F(IndigoCoreProfilingTest, histogram_buckets)
+{
+    for (qword value : {0ULL, 1ULL, 3ULL, 4ULL, 7ULL, 8ULL, 1000ULL, 123456789ULL, 0xFFFFFFFFFFFFFFFFULL})
+    {
+        const int bucket = ProfilingSystem::histogramBucket(value);
+        ASSERT_LT(bucket, ProfilingSystem::HISTOGRAM_BUCKETS);
+        ASSERT_LE(ProfilingSystem::histogramBucketLowerBound(bucket), value);
+        if (bucket + 1 < ProfilingSystem::HISTOGRAM_BUCKETS)
+        {
+            ASSERT_GT(ProfilingSystem::histogramBucketLowerBound(bucket + 1), value);
+        }
+    }
+}
+
+TEST_F(IndigoCoreProfilingTest, labels_past_the_limit)
+{
+    ProfilingSystem system;
+    char name[32];
+    for (int i = 0; i < ProfilingSystem::MAX_LABELS + 10; i++)
+    {
+        snprintf(name, sizeof(name), "test_label_%d", i);
+        ASSERT_EQ(std::min(i, ProfilingSystem::MAX_LABELS - 1), system.getNameIndex(name));
+    }
+    ASSERT_EQ(ProfilingSystem::MAX_LABELS - 1, system.getNameIndex(ProfilingSystem::OVERFLOW_LABEL, false));
+    ASSERT_EQ(-1, system.getNameIndex("test_label_5000", false));
+}
+
+TEST_F(IndigoCoreProfilingTest, counters_from_threads)
+{
+    const int threads_count = 4;
+    const int iterations = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++)
+    {
+        threads.emplace_back([]() {
+            for (int i = 1; i <= iterations; i++)
+            {
+                profIncCounter("test_profiling_counter", i);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    auto inst = sf::xlock_safe_ptr(ProfilingSystem::getInstance());
+    ASSERT_TRUE(inst->hasLabel("test_profiling_counter"));
+    ASSERT_EQ(inst->getLabelCallCount("test_profiling_counter", true), threads_count * iterations);
+    ASSERT_EQ(inst->getLabelValue("test_profiling_counter", true), threads_count * (iterations * (iterations + 1) / 2));
+
+    const qword p50 = inst->getLabelPercentile("test_profiling_counter", 0.5f, true);
+    ASSERT_GE(p50, 400);
+    ASSERT_LE(p50, 600);
+    ASSERT_EQ(inst->getLabelPercentile("test_profiling_counter", 1.0f, true), iterations);
+
+    inst->reset(false);
+    ASSERT_EQ(inst->getLabelCallCount("test_profiling_counter", false), 0);
+    ASSERT_EQ(inst->getLabelCallCount("test_profiling_counter", true), threads_count * iterations);
+}
+
+TEST_F(IndigoCoreProfilingTest, statistics)
+{
+    {
+        profTimerStart(t, "test_profiling_timer");
+    }
+    Array<char> buf;
+    ArrayOutput output(buf);
+    profGetStatistics(output, true);
+    buf.push(0);
+    ASSERT_NE(strstr(buf.ptr(), "test_profiling_timer"), nullptr);
+    ASSERT_NE(strstr(buf.ptr(), "p99"), nullptr);
+}
+
+TEST_F(IndigoCoreProfilingTest, trace)
+{
+    profTraceEnable(true);
+    std::thread thread([]() {
+        profTimerStart(outer, "test_trace_outer");
+        {
+            profTimerStart(inner, "test_trace_inner");
+        }
+    });
+    thread.join();
+    profTraceEnable(false);
+    {
+        profTimerStart(untraced, "test_trace_untraced");
+    }
+
+    Array<char> buf;
+    ArrayOutput output(buf);
+    profTraceDump(output);
+    buf.push(0);
+    const char* trace = buf.ptr();
+    ASSERT_EQ(strncmp(trace, "{\"traceEvents\":[", 16), 0);
+    ASSERT_NE(strstr(trace, "{\"name\":\"test_trace_outer\",\"cat\":\"indigo\",\"ph\":\"B\""), nullptr);
+    ASSERT_NE(strstr(trace, "{\"name\":\"test_trace_inner\",\"cat\":\"indigo\",\"ph\":\"E\""), nullptr);
+    ASSERT_EQ(strstr(trace, "test_trace_untraced"), nullptr);
+
+    // Events are written only once
+    buf.clear();
+    profTraceDump(output);
+    buf.push(0);
+    ASSERT_EQ(strstr(buf.ptr(), "test_trace_outer"), nullptr);
+}